@@ -25,9 +25,13 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "bgmusic.h"
 
 static void CL_FinishTimeDemo (void);
+static void CL_ClearDemoKeyframes (void);
+static void CL_SaveDemoKeyframe (void);
 
 static char name[MAX_OSPATH];
 
+cvar_t cl_demokeyframes = {"cl_demokeyframes", "20", CVAR_ARCHIVE}; // seconds of demo time between seek keyframes, 0 disables
+
 /*
 ==============================================================================
 
@@ -60,6 +64,7 @@ void CL_StopPlayback (void)
 	cls.demofile = NULL;
 	cls.state = ca_disconnected;
 	cls.demo_prespawn_end = 0;
+	CL_ClearDemoKeyframes ();
 
 	if (cls.timedemo)
 		CL_FinishTimeDemo ();
@@ -128,7 +133,13 @@ static int CL_GetDemoMessage (void)
 		}
 	}
 	else if (cls.signon < (SIGNONS - 2))
+	{
 		cls.demo_prespawn_end = 0;
+		CL_ClearDemoKeyframes ();
+	}
+
+	if (cls.signon == SIGNONS)
+		CL_SaveDemoKeyframe ();
 
 	// get the next message
 	if (fread (&net_message.cursize, 4, 1, cls.demofile) != 1)
@@ -160,6 +171,342 @@ static int CL_GetDemoMessage (void)
 	return 1;
 }
 
+/*
+==============================================================================
+
+DEMO KEYFRAMES
+
+While a demo plays, the client state rebuilt by the demo messages is saved
+every cl_demokeyframes seconds of demo time, together with the file position
+of the next message. A backwards seek restores the last keyframe before the
+target and only replays the messages after it, instead of replaying the whole
+level from its signon.
+==============================================================================
+*/
+
+typedef struct
+{
+	qboolean		 forcelink;
+	int				 update_type;
+	entity_state_t	 baseline;
+	entity_state_t	 netstate;
+	double			 msgtime;
+	vec3_t			 msg_origins[2];
+	vec3_t			 origin;
+	vec3_t			 msg_angles[2];
+	vec3_t			 angles;
+	struct qmodel_s *model;
+	int				 frame;
+	float			 syncbase;
+	byte			*colormap;
+	int				 effects;
+	int				 skinnum;
+	byte			 eflags;
+	byte			 alpha;
+	entlerp_t		 lerp;
+} demoentity_t;
+
+typedef struct
+{
+	char  name[MAX_SCOREBOARDNAME];
+	float entertime;
+	int	  frags;
+	int	  colors;
+	int	  ping;
+} demoscore_t;
+
+typedef struct
+{
+	qfileofs_t	  filepos; // of the first message after the keyframe
+	double		  mtime[2];
+	vec3_t		  mviewangles[2];
+	vec3_t		  mvelocity[2];
+	vec3_t		  punchangle;
+	int			  stats[MAX_CL_STATS];
+	float		  statsf[MAX_CL_STATS];
+	int			  items;
+	float		  item_gettime[32];
+	float		  faceanimtime;
+	float		  idealpitch;
+	float		  viewheight;
+	qboolean	  paused;
+	qboolean	  onground;
+	qboolean	  inwater;
+	double		  fixangle_time;
+	int			  intermission;
+	int			  completed_time;
+	int			  viewentity;
+	int			  cdtrack, looptrack;
+	int			  num_entities;
+	demoentity_t *entities;
+	demoscore_t	 *scores;
+	lightstyle_t  lightstyles[MAX_LIGHTSTYLES];
+	char		 *fogcmd;
+	char		 *skycmd;
+} demokeyframe_t;
+
+static demokeyframe_t *demo_keyframes;
+static int			   demo_numkeyframes;
+static int			   demo_maxkeyframes;
+
+/*
+====================
+CL_ClearDemoKeyframes
+====================
+*/
+static void CL_ClearDemoKeyframes (void)
+{
+	int i;
+
+	for (i = 0; i < demo_numkeyframes; i++)
+	{
+		Mem_Free (demo_keyframes[i].entities);
+		Mem_Free (demo_keyframes[i].scores);
+		Mem_Free (demo_keyframes[i].fogcmd);
+		Mem_Free (demo_keyframes[i].skycmd);
+	}
+	Mem_Free (demo_keyframes);
+	demo_keyframes = NULL;
+	demo_numkeyframes = demo_maxkeyframes = 0;
+}
+
+/*
+====================
+CL_SaveDemoKeyframe
+
+Called between demo messages once fully signed on. Saves a keyframe when
+cl_demokeyframes seconds of demo time have passed since the last one.
+====================
+*/
+static void CL_SaveDemoKeyframe (void)
+{
+	demokeyframe_t *kf;
+	const char	   *cmd;
+	int				i;
+
+	if (cl_demokeyframes.value <= 0.f || cl.qcvm.progs) // csqc keeps state of its own
+		return;
+	if (cl.mtime[0] < (demo_numkeyframes ? demo_keyframes[demo_numkeyframes - 1].mtime[0] : 0.0) + cl_demokeyframes.value)
+		return;
+
+	if (demo_numkeyframes == demo_maxkeyframes)
+	{
+		demo_maxkeyframes = q_max (demo_maxkeyframes * 2, 64);
+		demo_keyframes = Mem_Realloc (demo_keyframes, demo_maxkeyframes * sizeof (demokeyframe_t));
+	}
+	kf = &demo_keyframes[demo_numkeyframes++];
+	memset (kf, 0, sizeof (*kf));
+
+	kf->filepos = Sys_ftell (cls.demofile);
+	memcpy (kf->mtime, cl.mtime, sizeof (kf->mtime));
+	memcpy (kf->mviewangles, cl.mviewangles, sizeof (kf->mviewangles));
+	memcpy (kf->mvelocity, cl.mvelocity, sizeof (kf->mvelocity));
+	VectorCopy (cl.punchangle, kf->punchangle);
+	memcpy (kf->stats, cl.stats, sizeof (kf->stats));
+	memcpy (kf->statsf, cl.statsf, sizeof (kf->statsf));
+	kf->items = cl.items;
+	memcpy (kf->item_gettime, cl.item_gettime, sizeof (kf->item_gettime));
+	kf->faceanimtime = cl.faceanimtime;
+	kf->idealpitch = cl.idealpitch;
+	kf->viewheight = cl.viewheight;
+	kf->paused = cl.paused;
+	kf->onground = cl.onground;
+	kf->inwater = cl.inwater;
+	kf->fixangle_time = cl.fixangle_time;
+	kf->intermission = cl.intermission;
+	kf->completed_time = cl.completed_time;
+	kf->viewentity = cl.viewentity;
+	kf->cdtrack = cl.cdtrack;
+	kf->looptrack = cl.looptrack;
+	memcpy (kf->lightstyles, cl_lightstyle, sizeof (kf->lightstyles));
+
+	kf->num_entities = cl.num_entities;
+	kf->entities = (demoentity_t *)Mem_AllocNonZero (q_max (cl.num_entities, 1) * sizeof (demoentity_t));
+	for (i = 0; i < cl.num_entities; i++)
+	{
+		const entity_t *ent = &cl.entities[i];
+		demoentity_t   *de = &kf->entities[i];
+
+		de->forcelink = ent->forcelink;
+		de->update_type = ent->update_type;
+		de->baseline = ent->baseline;
+		de->netstate = ent->netstate;
+		de->msgtime = ent->msgtime;
+		memcpy (de->msg_origins, ent->msg_origins, sizeof (de->msg_origins));
+		VectorCopy (ent->origin, de->origin);
+		memcpy (de->msg_angles, ent->msg_angles, sizeof (de->msg_angles));
+		VectorCopy (ent->angles, de->angles);
+		de->model = ent->model;
+		de->frame = ent->frame;
+		de->syncbase = ent->syncbase;
+		de->colormap = ent->colormap;
+		de->effects = ent->effects;
+		de->skinnum = ent->skinnum;
+		de->eflags = ent->eflags;
+		de->alpha = ent->alpha;
+		de->lerp = ent->lerp;
+	}
+
+	kf->scores = (demoscore_t *)Mem_AllocNonZero (q_max (cl.maxclients, 1) * sizeof (demoscore_t));
+	for (i = 0; i < cl.maxclients; i++)
+	{
+		q_strlcpy (kf->scores[i].name, cl.scores[i].name, sizeof (kf->scores[i].name));
+		kf->scores[i].entertime = cl.scores[i].entertime;
+		kf->scores[i].frags = cl.scores[i].frags;
+		kf->scores[i].colors = cl.scores[i].colors;
+		kf->scores[i].ping = cl.scores[i].ping;
+	}
+
+	// fog and sky changes are stuffed commands, which the replay would otherwise miss
+	if ((cmd = Fog_GetFogCommand (true)))
+		kf->fogcmd = q_strdup (cmd);
+	if ((cmd = Sky_GetSkyCommand (false)))
+		kf->skycmd = q_strdup (cmd);
+}
+
+/*
+====================
+CL_RestoreDemoKeyframe
+====================
+*/
+static void CL_RestoreDemoKeyframe (const demokeyframe_t *kf)
+{
+	int i;
+
+	memcpy (cl.mtime, kf->mtime, sizeof (cl.mtime));
+	cl.time = cl.oldtime = cl.mtime[0];
+	memcpy (cl.mviewangles, kf->mviewangles, sizeof (cl.mviewangles));
+	memcpy (cl.mvelocity, kf->mvelocity, sizeof (cl.mvelocity));
+	VectorCopy (kf->punchangle, cl.punchangle);
+	memcpy (cl.stats, kf->stats, sizeof (cl.stats));
+	memcpy (cl.statsf, kf->statsf, sizeof (cl.statsf));
+	cl.items = kf->items;
+	memcpy (cl.item_gettime, kf->item_gettime, sizeof (cl.item_gettime));
+	cl.faceanimtime = kf->faceanimtime;
+	cl.idealpitch = kf->idealpitch;
+	cl.viewheight = kf->viewheight;
+	cl.paused = kf->paused;
+	cl.onground = kf->onground;
+	cl.inwater = kf->inwater;
+	cl.fixangle_time = kf->fixangle_time;
+	cl.intermission = kf->intermission;
+	cl.completed_time = kf->completed_time;
+	cl.viewentity = kf->viewentity;
+	cl.cdtrack = kf->cdtrack;
+	cl.looptrack = kf->looptrack;
+	memcpy (cl_lightstyle, kf->lightstyles, sizeof (cl_lightstyle));
+
+	// entities past the keyframe's count are reset as they get used again, see CL_EntityNum
+	cl.num_entities = kf->num_entities;
+	for (i = 0; i < kf->num_entities; i++)
+	{
+		entity_t		   *ent = &cl.entities[i];
+		const demoentity_t *de = &kf->entities[i];
+
+		ent->forcelink = de->forcelink;
+		ent->update_type = de->update_type;
+		ent->baseline = de->baseline;
+		ent->netstate = de->netstate;
+		ent->msgtime = de->msgtime;
+		memcpy (ent->msg_origins, de->msg_origins, sizeof (ent->msg_origins));
+		VectorCopy (de->origin, ent->origin);
+		memcpy (ent->msg_angles, de->msg_angles, sizeof (ent->msg_angles));
+		VectorCopy (de->angles, ent->angles);
+		ent->model = de->model;
+		ent->frame = de->frame;
+		ent->syncbase = de->syncbase;
+		ent->colormap = de->colormap;
+		ent->effects = de->effects;
+		ent->skinnum = de->skinnum;
+		ent->eflags = de->eflags;
+		ent->alpha = de->alpha;
+		ent->lerp = de->lerp;
+		ent->traildelay = 0;
+		VectorCopy (ent->origin, ent->trailorg);
+	}
+
+	for (i = 0; i < cl.maxclients; i++)
+	{
+		q_strlcpy (cl.scores[i].name, kf->scores[i].name, sizeof (cl.scores[i].name));
+		cl.scores[i].entertime = kf->scores[i].entertime;
+		cl.scores[i].frags = kf->scores[i].frags;
+		cl.scores[i].ping = kf->scores[i].ping;
+		if (cl.scores[i].colors != kf->scores[i].colors)
+		{
+			cl.scores[i].colors = kf->scores[i].colors;
+			CL_NewTranslation (i);
+		}
+	}
+
+	if (kf->fogcmd)
+		Cbuf_AddText (kf->fogcmd);
+	if (kf->skycmd)
+		Cbuf_AddText (kf->skycmd);
+}
+
+/*
+====================
+CL_DemoSeek
+
+Backwards seeks rewind to the last keyframe before seektime if there is one
+and usekeyframes is set, or to the start of the level otherwise, and then
+fast-forward through the messages up to seektime
+====================
+*/
+static void CL_DemoSeek (float seektime, qboolean usekeyframes)
+{
+	const demokeyframe_t *kf = NULL;
+	int					  i;
+
+	cls.seektime = seektime;
+
+	// large positive offsets could benefit from demoseeking, but we'd lose prints etc
+	if (cls.seektime < cl.time && cls.demo_prespawn_end)
+	{
+		if (usekeyframes)
+			for (i = demo_numkeyframes - 1; i >= 0 && !kf; i--)
+				if (demo_keyframes[i].mtime[0] < cls.seektime)
+					kf = &demo_keyframes[i];
+
+		memset (cl_dlights, 0, sizeof (cl_dlights));
+		memset (cl_temp_entities, 0, sizeof (cl_temp_entities));
+		memset (cl_beams, 0, sizeof (cl_beams));
+		V_ResetBlend ();
+		Fog_NewMap ();
+		Sky_NewMap ();
+		R_ClearParticles ();
+#ifdef PSET_SCRIPT
+		PScript_ClearParticles (false);
+#endif
+		SCR_CenterPrintClear ();
+		if (cl.intermission && !(kf && kf->intermission))
+		{
+			cl.intermission = 0;
+			BGM_Stop ();
+		}
+		S_StopAllSounds (true, true);
+		cls.demoseeking = true;
+
+		if (kf)
+		{
+			Sys_fseek (cls.demofile, kf->filepos, SEEK_SET);
+			CL_RestoreDemoKeyframe (kf);
+		}
+		else
+		{
+			Sys_fseek (cls.demofile, cls.demo_prespawn_end, SEEK_SET);
+			cl.mtime[0] = cl.time = 0;
+			memset (cl.stats, 0, sizeof (cl.stats));
+			memset (cl.statsf, 0, sizeof (cl.statsf));
+
+			// replay last signon for stats and lightstyles
+			cls.signon = (SIGNONS - 2);
+		}
+	}
+	else
+		cl.time = cls.seektime;
+}
+
 /*
 ====================
 CL_Seek_f
@@ -200,42 +547,84 @@ void		 CL_Seek_f (void)
 	}
 
 	qboolean relative = offset < 0 || Cmd_Argv (1)[0] == '+';
-	cls.seektime = relative ? cl.time + offset : offset;
+	CL_DemoSeek (relative ? cl.time + offset : offset, true);
 
-	// large positive offsets could benefit from demoseeking, but we'd lose prints etc
-	if ((offset < 0 || (!relative && offset < cl.time)) && cls.demo_prespawn_end)
+	scr_clock_off = 2.5f; // show clock for a few seconds after a seek
+}
+
+/*
+====================
+CL_TimedDemoSeek
+
+Seeks and runs the message loop until the seek completes, returns the
+time it took
+====================
+*/
+static double CL_TimedDemoSeek (float seektime, qboolean usekeyframes)
+{
+	double start = Sys_DoubleTime ();
+
+	CL_DemoSeek (seektime, usekeyframes);
+	cls.demoseeking = true; // also fast-forward forward seeks
+	while (cls.demoplayback && cls.demoseeking)
 	{
-		Sys_fseek (cls.demofile, cls.demo_prespawn_end, SEEK_SET);
-		cl.mtime[0] = cl.time = 0;
-		cls.demoseeking = true;
+		if (CL_GetMessage () != 1)
+			break;
+		CL_ParseServerMessage ();
+	}
 
-		memset (cl_dlights, 0, sizeof (cl_dlights));
-		memset (cl_temp_entities, 0, sizeof (cl_temp_entities));
-		memset (cl_beams, 0, sizeof (cl_beams));
-		V_ResetBlend ();
-		Fog_NewMap ();
-		Sky_NewMap ();
-		R_ClearParticles ();
-#ifdef PSET_SCRIPT
-		PScript_ClearParticles (false);
-#endif
-		SCR_CenterPrintClear ();
-		if (cl.intermission)
-		{
-			cl.intermission = 0;
-			BGM_Stop ();
-		}
-		memset (cl.stats, 0, sizeof (cl.stats));
-		memset (cl.statsf, 0, sizeof (cl.statsf));
+	return Sys_DoubleTime () - start;
+}
 
-		// replay last signon for stats and lightstyles
-		cls.signon = (SIGNONS - 2);
-		S_StopAllSounds (true, true);
+/*
+====================
+CL_SeekBenchmark_f
+
+seek_benchmark [steps]: seeks back from the current demo position to evenly
+spaced points down to the start of the level, once replaying from the level
+start and once from the nearest keyframe, and prints the latency of each
+====================
+*/
+void CL_SeekBenchmark_f (void)
+{
+	int		 i, steps;
+	float	 end, target;
+	double	 full, keyed, totalfull = 0.0, totalkeyed = 0.0;
+	qboolean paused = cls.demopaused;
+
+	if (cmd_source != src_command)
+		return;
+
+	if (!cls.demoplayback || cls.signon != SIGNONS || !cls.demo_prespawn_end)
+	{
+		Con_Printf ("Not playing a demo.\n");
+		return;
 	}
-	else
-		cl.time = cls.seektime;
 
-	scr_clock_off = 2.5f; // show clock for a few seconds after a seek
+	steps = (Cmd_Argc () > 1) ? q_max (atoi (Cmd_Argv (1)), 1) : 10;
+	end = cl.mtime[0];
+	cls.demopaused = false;
+
+	Con_Printf ("%i keyframes over %.1f seconds of demo\n", demo_numkeyframes, end);
+	Con_Printf ("  target   replay ms  keyframe ms\n");
+	for (i = steps; i > 0 && cls.demoplayback; i--)
+	{
+		target = end * (i - 0.5f) / steps;
+		full = CL_TimedDemoSeek (target, false);
+		keyed = CL_TimedDemoSeek (target, true);
+		totalfull += full;
+		totalkeyed += keyed;
+		Con_Printf ("%8.1f %11.2f %12.2f\n", target, full * 1000.0, keyed * 1000.0);
+	}
+	if (!cls.demoplayback)
+		return;
+
+	Con_Printf ("average: replay %.2f ms, keyframe %.2f ms\n", totalfull * 1000.0 / steps, totalkeyed * 1000.0 / steps);
+
+	// return to where the benchmark started
+	CL_TimedDemoSeek (end, true);
+	S_StopAllSounds (true, true);
+	cls.demopaused = paused;
 }
 
 /*
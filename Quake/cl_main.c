@@ -1383,6 +1383,7 @@ void CL_Init (void)
 	Cvar_RegisterVariable (&cl_anglespeedkey);
 	Cvar_RegisterVariable (&cl_shownet);
 	Cvar_RegisterVariable (&cl_nolerp);
+	Cvar_RegisterVariable (&cl_demokeyframes);
 	Cvar_RegisterVariable (&lookspring);
 	Cvar_RegisterVariable (&lookstrafe);
 	Cvar_RegisterVariable (&sensitivity);
@@ -1409,6 +1410,7 @@ void CL_Init (void)
 	Cmd_AddCommand ("playdemo", CL_PlayDemo_f);
 	Cmd_AddCommand ("timedemo", CL_TimeDemo_f);
 	Cmd_AddCommand ("seek", CL_Seek_f);
+	Cmd_AddCommand ("seek_benchmark", CL_SeekBenchmark_f);
 
 	Cmd_AddCommand ("tracepos", CL_Tracepos_f);		// johnfitz
 	cmd = Cmd_AddCommand ("viewpos", CL_Viewpos_f); // johnfitz
@@ -312,6 +312,7 @@ extern cvar_t cl_autofire;
 
 extern cvar_t cl_shownet;
 extern cvar_t cl_nolerp;
+extern cvar_t cl_demokeyframes;
 
 extern cvar_t cfg_unbindall;
 
@@ -404,6 +405,7 @@ void CL_ClearTrailStates (void);
 void CL_StopPlayback (void);
 int	 CL_GetMessage (void);
 void CL_Seek_f (void);
+void CL_SeekBenchmark_f (void);
 
 void CL_Stop_f (void);
 void CL_Record_f (void);
@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 // cmd.c -- Quake script command processing module
 
 #include "quakedef.h"
+#include "q_ctype.h"
 
 cvar_t cl_nopext = {"cl_nopext", "0", CVAR_NONE};	 // Spike -- prevent autodetection of protocol extensions, so that servers fall back to only their base
 													 // protocol (without needing to reconfigure the server. Requires reconnect.
@@ -30,17 +31,13 @@ cvar_t cmd_warncmd = {"cl_warncmd", "1", CVAR_NONE}; // Spike -- prevent autodet
 													 // protocol (without needing to reconfigure the server. Requires reconnect.
 void   Cmd_ForwardToServer (void);
 
-#define MAX_ALIAS_NAME 32
-
-typedef struct cmdalias_s
-{
-	struct cmdalias_s *next;
-	char			   name[MAX_ALIAS_NAME];
-	char			  *value;
-} cmdalias_t;
-
 cmdalias_t *cmd_alias;
 
+// case insensitive name hash -> first command/alias with that hash. the
+// lists stay the reference for ordered walks and completion.
+static hash_map_t *cmd_function_map;
+static hash_map_t *cmd_alias_map;
+
 static qboolean cmd_wait;
 
 //=============================================================================
@@ -59,6 +56,24 @@ void Cmd_Wait_f (void)
 	cmd_wait = true;
 }
 
+/*
+============
+Cmd_HashName
+
+FNV-1a of the lowercased name, so names differing in case share a chain
+============
+*/
+static uint32_t Cmd_HashName (const char *name)
+{
+	uint32_t hash = 0x811c9dc5u;
+	for (; *name; name++)
+	{
+		hash ^= (uint32_t)q_tolower (*name);
+		hash *= 0x01000193u;
+	}
+	return hash;
+}
+
 /*
 =============================================================================
 
@@ -361,6 +376,40 @@ void Cmd_Echo_f (void)
 	Con_Printf ("\n");
 }
 
+/*
+===============
+Cmd_FindAlias
+
+First alias in list order whose name matches with compare
+===============
+*/
+static cmdalias_t *Cmd_FindAlias (const char *name, int (*compare) (const char *, const char *))
+{
+	const uint32_t hash = Cmd_HashName (name);
+	cmdalias_t	 **head = cmd_alias_map ? HashMap_Lookup (cmdalias_t *, cmd_alias_map, &hash) : NULL;
+	cmdalias_t	  *a;
+
+	for (a = head ? *head : NULL; a; a = a->hashnext)
+		if (!compare (name, a->name))
+			return a;
+	return NULL;
+}
+
+static void Cmd_UnhashAlias (cmdalias_t *alias)
+{
+	const uint32_t hash = Cmd_HashName (alias->name);
+	cmdalias_t	 **link = HashMap_Lookup (cmdalias_t *, cmd_alias_map, &hash);
+
+	if (*link == alias && !alias->hashnext)
+	{
+		HashMap_Erase (cmd_alias_map, &hash);
+		return;
+	}
+	while (*link != alias)
+		link = &(*link)->hashnext;
+	*link = alias->hashnext;
+}
+
 /*
 ===============
 Cmd_Alias_f -- johnfitz -- rewritten
@@ -386,9 +435,8 @@ void Cmd_Alias_f (void)
 			Con_SafePrintf ("no alias commands found\n");
 		break;
 	case 2: // output current alias string
-		for (a = cmd_alias; a; a = a->next)
-			if (!strcmp (Cmd_Argv (1), a->name))
-				Con_Printf ("   %s: %s", a->name, a->value);
+		if ((a = Cmd_FindAlias (Cmd_Argv (1), strcmp)))
+			Con_Printf ("   %s: %s", a->name, a->value);
 		break;
 	default: // set alias string
 		s = Cmd_Argv (1);
@@ -399,22 +447,25 @@ void Cmd_Alias_f (void)
 		}
 
 		// if the alias allready exists, reuse it
-		for (a = cmd_alias; a; a = a->next)
+		if ((a = Cmd_FindAlias (s, strcmp)))
+			Mem_Free (a->value);
+		else
 		{
-			if (!strcmp (s, a->name))
-			{
-				Mem_Free (a->value);
-				break;
-			}
-		}
+			const uint32_t hash = Cmd_HashName (s);
+			cmdalias_t	 **head;
 
-		if (!a)
-		{
 			a = (cmdalias_t *)Mem_Alloc (sizeof (cmdalias_t));
 			a->next = cmd_alias;
 			cmd_alias = a;
+			strcpy (a->name, s);
+
+			// newest first, like the list
+			if (!cmd_alias_map)
+				cmd_alias_map = HashMap_Create (uint32_t, cmdalias_t *, &HashInt32, NULL);
+			head = HashMap_Lookup (cmdalias_t *, cmd_alias_map, &hash);
+			a->hashnext = head ? *head : NULL;
+			HashMap_Insert (cmd_alias_map, &hash, &a);
 		}
-		strcpy (a->name, s);
 
 		// copy the rest of the command line
 		cmd[0] = 0; // start out with a null string
@@ -463,6 +514,7 @@ void Cmd_Unalias_f (void)
 				else
 					cmd_alias = a->next;
 
+				Cmd_UnhashAlias (a);
 				Mem_Free (a->value);
 				Mem_Free (a);
 				return;
@@ -476,13 +528,7 @@ void Cmd_Unalias_f (void)
 
 qboolean Cmd_AliasExists (const char *aliasname)
 {
-	cmdalias_t *a;
-	for (a = cmd_alias; a; a = a->next)
-	{
-		if (!q_strcasecmp (aliasname, a->name))
-			return true;
-	}
-	return false;
+	return Cmd_FindAlias (aliasname, q_strcasecmp) != NULL;
 }
 
 /*
@@ -501,6 +547,8 @@ void Cmd_Unaliasall_f (void)
 		Mem_Free (cmd_alias);
 		cmd_alias = blah;
 	}
+	if (cmd_alias_map)
+		HashMap_Clear (cmd_alias_map);
 }
 
 /*
@@ -623,6 +671,91 @@ void Cmd_Apropos_f (void)
 		Con_SafePrintf ("no cvars nor commands contain that substring\n");
 }
 
+static void Cmd_BenchNop_f (void) {}
+
+/*
+============
+Cmd_Bench_f
+
+Runs a generated config through Cmd_ExecuteString like exec would: half cvar
+sets, a quarter commands and a quarter aliases. Then times the name lookups
+alone against walks of the lists they used to scan.
+============
+*/
+static void Cmd_Bench_f (void)
+{
+	const int		numlines = (Cmd_Argc () > 1) ? q_max (atoi (Cmd_Argv (1)), 4) : 10000;
+	cvar_t		  **vars = NULL;
+	char		  **lines;
+	cmd_function_t *nop, *cmd;
+	cvar_t		   *var;
+	cmdalias_t	   *a;
+	int				i, numvars, found[2];
+	double			start, exectime, lookuptime[2];
+
+	if (!Host_BenchAllowed ())
+		return;
+
+	for (var = Cvar_FindVarAfter ("", 0); var; var = var->next)
+		if (!(var->flags & (CVAR_ROM | CVAR_LOCKED)) && !strchr (var->string, '"'))
+			VEC_PUSH (vars, var);
+	numvars = VEC_SIZE (vars);
+	nop = Cmd_AddCommand ("cmdbench_nop", Cmd_BenchNop_f);
+	if (!numvars || !nop)
+	{
+		Con_Printf ("cmdbench: nothing to run\n");
+		VEC_FREE (vars);
+		return;
+	}
+	Cmd_ExecuteString ("alias cmdbench_alias \"\"", src_command);
+
+	// setting a cvar to its current value doesn't run callbacks
+	lines = (char **)Mem_Alloc (numlines * sizeof (char *));
+	for (i = 0; i < numlines; i++)
+	{
+		if (i % 4 < 2)
+			lines[i] = q_strdup (va ("%s \"%s\"", vars[(i * 7919u) % numvars]->name, vars[(i * 7919u) % numvars]->string));
+		else
+			lines[i] = q_strdup ((i % 4 == 2) ? "cmdbench_nop" : "cmdbench_alias");
+	}
+
+	start = Sys_DoubleTime ();
+	for (i = 0; i < numlines; i++)
+		Cmd_ExecuteString (lines[i], src_command);
+	exectime = Sys_DoubleTime () - start;
+
+	// the commands still have to miss before a cvar is found
+	start = Sys_DoubleTime ();
+	for (i = found[0] = 0; i < numvars; i++)
+		found[0] += !Cmd_FindCommand (vars[i]->name) && !Cmd_FindAlias (vars[i]->name, q_strcasecmp) && Cvar_FindVar (vars[i]->name);
+	lookuptime[0] = Sys_DoubleTime () - start;
+
+	start = Sys_DoubleTime ();
+	for (i = found[1] = 0; i < numvars; i++)
+	{
+		for (cmd = cmd_functions; cmd && q_strcasecmp (vars[i]->name, cmd->name); cmd = cmd->next)
+			;
+		for (a = cmd_alias; a && q_strcasecmp (vars[i]->name, a->name); a = a->next)
+			;
+		for (var = Cvar_FindVarAfter ("", 0); var && strcmp (vars[i]->name, var->name); var = var->next)
+			;
+		found[1] += !cmd && !a && var;
+	}
+	lookuptime[1] = Sys_DoubleTime () - start;
+
+	Con_Printf ("%d lines: %.3f ms, %.2f us/line\n", numlines, exectime * 1e3, exectime * 1e6 / numlines);
+	Con_Printf (
+		"cvar dispatch lookup, %d cvars: hashed %.1f ns, list walk %.1f ns (%.1fx)%s\n", numvars, lookuptime[0] * 1e9 / numvars, lookuptime[1] * 1e9 / numvars,
+		lookuptime[0] > 0 ? lookuptime[1] / lookuptime[0] : 0.0, (found[0] != found[1]) ? " RESULTS DIFFER" : "");
+
+	for (i = 0; i < numlines; i++)
+		Mem_Free (lines[i]);
+	Mem_Free (lines);
+	VEC_FREE (vars);
+	Cmd_RemoveCommand (nop);
+	Cmd_ExecuteString ("unalias cmdbench_alias", src_command);
+}
+
 /*
 ============
 Cmd_Init
@@ -643,6 +776,7 @@ void Cmd_Init (void)
 
 	Cmd_AddCommand ("apropos", Cmd_Apropos_f);
 	Cmd_AddCommand ("find", Cmd_Apropos_f);
+	Cmd_AddCommand ("cmdbench", Cmd_Bench_f);
 
 	Cvar_RegisterVariable (&cl_nopext);
 	Cvar_RegisterVariable (&cmd_warncmd);
@@ -742,6 +876,70 @@ void Cmd_AddArg (const char *arg)
 	}
 }
 
+/*
+============
+Cmd_FirstHashedCommand
+
+Head of the chain of commands whose name hashes like cmd_name, callers
+compare the names
+============
+*/
+static cmd_function_t *Cmd_FirstHashedCommand (const char *cmd_name)
+{
+	const uint32_t	 hash = Cmd_HashName (cmd_name);
+	cmd_function_t **head = cmd_function_map ? HashMap_Lookup (cmd_function_t *, cmd_function_map, &hash) : NULL;
+
+	return head ? *head : NULL;
+}
+
+/*
+============
+Cmd_HashCommand
+
+Adds a command that was just linked into cmd_functions to its chain, in
+the same order as the list so lookups find the same command a list walk would
+============
+*/
+static void Cmd_HashCommand (cmd_function_t *cmd)
+{
+	const uint32_t	 hash = Cmd_HashName (cmd->name);
+	cmd_function_t **link, *later;
+
+	if (!cmd_function_map)
+		cmd_function_map = HashMap_Create (uint32_t, cmd_function_t *, &HashInt32, NULL);
+	link = HashMap_Lookup (cmd_function_t *, cmd_function_map, &hash);
+	if (!link)
+	{
+		cmd->hashnext = NULL;
+		HashMap_Insert (cmd_function_map, &hash, &cmd);
+		return;
+	}
+
+	// rare: the same name for another source, in another case, or a hash
+	// collision. link before the first chained command that follows in the list
+	for (later = cmd->next; later && Cmd_HashName (later->name) != hash; later = later->next)
+		;
+	while (*link != later)
+		link = &(*link)->hashnext;
+	cmd->hashnext = later;
+	*link = cmd;
+}
+
+static void Cmd_UnhashCommand (cmd_function_t *cmd)
+{
+	const uint32_t	 hash = Cmd_HashName (cmd->name);
+	cmd_function_t **link = HashMap_Lookup (cmd_function_t *, cmd_function_map, &hash);
+
+	if (*link == cmd && !cmd->hashnext)
+	{
+		HashMap_Erase (cmd_function_map, &hash);
+		return;
+	}
+	while (*link != cmd)
+		link = &(*link)->hashnext;
+	*link = cmd->hashnext;
+}
+
 /*
 ============
 Cmd_AddCommand
@@ -762,7 +960,7 @@ cmd_function_t *Cmd_AddCommand2 (const char *cmd_name, xcommand_t function, cmd_
 	}
 
 	// fail if the command already exists
-	for (cmd = cmd_functions; cmd; cmd = cmd->next)
+	for (cmd = Cmd_FirstHashedCommand (cmd_name); cmd; cmd = cmd->hashnext)
 	{
 		if (!strcmp (cmd_name, cmd->name) && cmd->srctype == srctype)
 		{
@@ -807,6 +1005,7 @@ cmd_function_t *Cmd_AddCommand2 (const char *cmd_name, xcommand_t function, cmd_
 		prev->next = cmd;
 	}
 	// johnfitz
+	Cmd_HashCommand (cmd);
 
 	return cmd;
 }
@@ -818,6 +1017,7 @@ void Cmd_RemoveCommand (cmd_function_t *cmd)
 		if (*link == cmd)
 		{
 			*link = cmd->next;
+			Cmd_UnhashCommand (cmd);
 			Mem_Free (cmd);
 			return;
 		}
@@ -834,7 +1034,7 @@ cmd_function_t *Cmd_FindCommand (const char *cmd_name)
 {
 	cmd_function_t *cmd;
 
-	for (cmd = cmd_functions; cmd; cmd = cmd->next)
+	for (cmd = Cmd_FirstHashedCommand (cmd_name); cmd; cmd = cmd->hashnext)
 		if (!q_strcasecmp (cmd_name, cmd->name))
 			return cmd;
 
@@ -862,7 +1062,7 @@ qboolean Cmd_Exists (const char *cmd_name)
 {
 	cmd_function_t *cmd;
 
-	for (cmd = cmd_functions; cmd; cmd = cmd->next)
+	for (cmd = Cmd_FirstHashedCommand (cmd_name); cmd; cmd = cmd->hashnext)
 	{
 		if (!strcmp (cmd_name, cmd->name))
 		{
@@ -903,7 +1103,6 @@ const char *Cmd_CompleteCommand (const char *partial)
 Cmd_ExecuteString
 
 A complete command line has been parsed, so try to execute it
-FIXME: lookupnoadd the token to speed search?
 ============
 */
 qboolean Cmd_ExecuteString (const char *text, cmd_source_t src)
@@ -919,7 +1118,7 @@ qboolean Cmd_ExecuteString (const char *text, cmd_source_t src)
 		return true; // no tokens
 
 	// check functions
-	for (cmd = cmd_functions; cmd; cmd = cmd->next)
+	for (cmd = Cmd_FirstHashedCommand (cmd_argv[0]); cmd; cmd = cmd->hashnext)
 	{
 		if (!q_strcasecmp (cmd_argv[0], cmd->name))
 		{
@@ -944,13 +1143,10 @@ qboolean Cmd_ExecuteString (const char *text, cmd_source_t src)
 		return false;
 
 	// check alias
-	for (a = cmd_alias; a; a = a->next)
+	if ((a = Cmd_FindAlias (cmd_argv[0], q_strcasecmp)))
 	{
-		if (!q_strcasecmp (cmd_argv[0], a->name))
-		{
-			Cbuf_InsertText (a->value);
-			return true;
-		}
+		Cbuf_InsertText (a->value);
+		return true;
 	}
 
 	// check cvars
@@ -92,6 +92,7 @@ typedef void (*xtabcommand_t) (const char *partial);
 typedef struct cmd_function_s
 {
 	struct cmd_function_s *next;
+	struct cmd_function_s *hashnext; // same name hash, in list order
 	const char			  *name;
 	xcommand_t			   function;
 	xtabcommand_t		   completion;
@@ -100,6 +101,16 @@ typedef struct cmd_function_s
 	qboolean			   qcinterceptable;
 } cmd_function_t;
 
+#define MAX_ALIAS_NAME 32
+
+typedef struct cmdalias_s
+{
+	struct cmdalias_s *next;
+	struct cmdalias_s *hashnext; // same name hash, in list order
+	char			   name[MAX_ALIAS_NAME];
+	char			  *value;
+} cmdalias_t;
+
 void Cmd_Init (void);
 
 cmd_function_t *Cmd_AddCommand2 (const char *cmd_name, xcommand_t function, cmd_source_t srctype, qboolean qcinterceptable);
@@ -48,6 +48,7 @@ cvar_t registered = {"registered", "1", CVAR_ROM};				 /* set to correct value i
 cvar_t cmdline = {"cmdline", "", CVAR_ROM /*|CVAR_SERVERINFO*/}; /* sending cmdline upon CCREQ_RULE_INFO is evil */
 
 static qboolean com_modified; // set true if using non-id files
+static qboolean com_nomappaks; // read paks through file handles instead of mapping them
 
 qboolean multiuser;
 
@@ -2215,6 +2216,155 @@ static qfilesize_t COM_filelength (FILE *f)
 	return Sys_filelength (f);
 }
 
+/*
+===========
+COM_IndexPackFile
+
+Hashes the pak directory so COM_FindFile doesn't have to scan it
+===========
+*/
+static void COM_IndexPackFile (pack_t *pack)
+{
+	int i;
+
+	pack->index = HashMap_Create (const char *, int, &HashStr, &HashStrCmp);
+	HashMap_Reserve (pack->index, pack->numfiles);
+	// reverse insert, so duplicate names resolve to the first entry like a linear search did
+	for (i = pack->numfiles - 1; i >= 0; --i)
+	{
+		const char *name = pack->files[i].name;
+		HashMap_Insert (pack->index, &name, &i);
+	}
+}
+
+/*
+===========
+COM_FindInPack
+
+Returns the index of filename in the pak directory, or -1
+===========
+*/
+static int COM_FindInPack (pack_t *pack, const char *filename)
+{
+	int *i = HashMap_Lookup (int, pack->index, &filename);
+	return i ? *i : -1;
+}
+
+/*
+============
+COM_Benchmark_f
+
+fs_benchmark [entries]: times pak directory lookups on a synthetic pak,
+with a linear scan of the directory and with the hash index, then reads
+the first mapped pak in the search path through file handles and from
+the mapping
+============
+*/
+static void COM_Benchmark_f (void)
+{
+	pack_t		  pack;
+	char		(*queries)[MAX_QPATH];
+	const int	  numqueries = 1024;
+	int			  entries, i, j, pass, rounds, found, h;
+	uint32_t	  seed = 1;
+	double		  start, rate[2];
+	searchpath_t *search;
+	pack_t		 *pak;
+	byte		 *buf;
+	qfilesize_t	  bytes;
+
+	entries = (Cmd_Argc () > 1) ? q_max (atoi (Cmd_Argv (1)), 1) : 50000;
+
+	memset (&pack, 0, sizeof (pack));
+	pack.numfiles = entries;
+	pack.files = (packfile_t *)Mem_Alloc (entries * sizeof (packfile_t));
+	for (i = 0; i < entries; i++)
+		q_snprintf (pack.files[i].name, sizeof (pack.files[i].name), "progs/bench/%05i/model%05i.mdl", i / 100, i);
+	COM_IndexPackFile (&pack);
+
+	// three quarters present, the rest missing like lookups that fall through to the next pak
+	queries = Mem_Alloc (numqueries * sizeof (*queries));
+	for (i = 0; i < numqueries; i++)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		j = (seed >> 8) % entries;
+		if (i & 3)
+			q_strlcpy (queries[i], pack.files[j].name, sizeof (queries[i]));
+		else
+			q_snprintf (queries[i], sizeof (queries[i]), "progs/bench/%05i/missing%05i.mdl", j / 100, j);
+	}
+
+	for (pass = 0; pass < 2; pass++)
+	{
+		found = 0;
+		rounds = 0;
+		start = Sys_DoubleTime ();
+		do
+		{
+			for (i = 0; i < numqueries; i++)
+			{
+				if (pass == 0)
+				{
+					for (j = 0; j < pack.numfiles; j++)
+						if (!strcmp (pack.files[j].name, queries[i]))
+							break;
+					found += (j < pack.numfiles);
+				}
+				else
+					found += (COM_FindInPack (&pack, queries[i]) >= 0);
+			}
+			rounds++;
+		} while (Sys_DoubleTime () - start < 0.5);
+		rate[pass] = rounds * numqueries / (Sys_DoubleTime () - start);
+		if (found != rounds * (numqueries - numqueries / 4))
+			Con_Printf ("fs_benchmark: pass %i found %i files, expected %i\n", pass, found, rounds * (numqueries - numqueries / 4));
+	}
+
+	Con_Printf ("%i entry pak: linear %.0f lookups/sec, hashed %.0f lookups/sec (%.0fx)\n", entries, rate[0], rate[1], rate[1] / rate[0]);
+
+	Mem_Free (queries);
+	HashMap_Destroy (pack.index);
+	Mem_Free (pack.files);
+
+	for (search = com_searchpaths; search; search = search->next)
+		if (search->pack && search->pack->mapped)
+			break;
+	if (!search)
+		return;
+
+	pak = search->pack;
+	buf = (byte *)Mem_AllocNonZero (pak->datasize);
+	for (pass = 0; pass < 2; pass++)
+	{
+		bytes = 0;
+		start = Sys_DoubleTime ();
+		for (i = 0; i < pak->numfiles; i++)
+		{
+			if (pak->files[i].filepos < 0 || pak->files[i].filelen < 0 || (qfilesize_t)pak->files[i].filepos + pak->files[i].filelen > pak->datasize)
+				continue;
+			if (pass == 0)
+			{
+				// what a pak lookup did before mapping: a private handle per read
+				if (Sys_FileOpenRead (pak->filename, &h) == -1)
+					break;
+				Sys_FileSeek (h, pak->files[i].filepos);
+				bytes += Sys_FileRead (h, buf, pak->files[i].filelen);
+				Sys_FileClose (h);
+			}
+			else
+			{
+				memcpy (buf, pak->data + pak->files[i].filepos, pak->files[i].filelen);
+				bytes += pak->files[i].filelen;
+			}
+		}
+		rate[pass] = Sys_DoubleTime () - start;
+	}
+	Mem_Free (buf);
+
+	Con_Printf (
+		"%s: %i files, %.1f MB: handles %.2f ms, mapped %.2f ms\n", pak->filename, pak->numfiles, bytes / (1024.0 * 1024.0), rate[0] * 1000.0, rate[1] * 1000.0);
+}
+
 /*
 ===========
 COM_FindFile
@@ -2223,9 +2373,12 @@ Finds the file in the search path.
 Sets com_filesize and one of handle or file
 If neither of file or handle is set, this
 can be used for detecting a file's presence.
+If view is set and the file is found in a memory
+resident pak, *view points straight at its data
+and no handle is opened.
 ===========
 */
-static qfilesize_t COM_FindFile (const char *filename, int *handle, FILE **file, unsigned int *path_id)
+static qfilesize_t COM_FindFile (const char *filename, int *handle, FILE **file, const byte **view, unsigned int *path_id)
 {
 	searchpath_t *search;
 	char		  netpath[MAX_OSPATH];
@@ -2237,6 +2390,8 @@ static qfilesize_t COM_FindFile (const char *filename, int *handle, FILE **file,
 		Sys_Error ("COM_FindFile: both handle and file set");
 
 	file_from_pak = 0;
+	if (view)
+		*view = NULL;
 
 	//
 	// search through the path, one element at a time
@@ -2246,15 +2401,22 @@ static qfilesize_t COM_FindFile (const char *filename, int *handle, FILE **file,
 		if (search->pack) /* look through all the pak file elements */
 		{
 			pak = search->pack;
-			for (i = 0; i < pak->numfiles; i++)
+			i = COM_FindInPack (pak, filename);
+			if (i >= 0)
 			{
-				if (strcmp (pak->files[i].name, filename) != 0)
-					continue;
 				// found it!
 				com_filesize = pak->files[i].filelen;
 				file_from_pak = 1;
 				if (path_id)
 					*path_id = search->path_id;
+				if (view && pak->data && pak->files[i].filepos >= 0 && pak->files[i].filelen >= 0 &&
+					(qfilesize_t)pak->files[i].filepos + pak->files[i].filelen <= pak->datasize)
+				{
+					*view = pak->data + pak->files[i].filepos;
+					if (handle)
+						*handle = -1;
+					return com_filesize;
+				}
 				if (handle)
 				{
 					// We can have concurrent reads to the pack (either as file or memory-based)
@@ -2344,7 +2506,7 @@ Returns whether the file is found in the quake filesystem.
 */
 qboolean COM_FileExists (const char *filename, unsigned int *path_id)
 {
-	qfilesize_t ret = COM_FindFile (filename, NULL, NULL, path_id);
+	qfilesize_t ret = COM_FindFile (filename, NULL, NULL, NULL, path_id);
 	return (ret == -1) ? false : true;
 }
 
@@ -2359,7 +2521,7 @@ it may actually be inside a pak file
 */
 qfilesize_t COM_OpenFile (const char *filename, int *handle, unsigned int *path_id)
 {
-	return COM_FindFile (filename, handle, NULL, path_id);
+	return COM_FindFile (filename, handle, NULL, NULL, path_id);
 }
 
 /*
@@ -2372,7 +2534,7 @@ into the file.
 */
 qfilesize_t COM_FOpenFile (const char *filename, FILE **file, unsigned int *path_id)
 {
-	return COM_FindFile (filename, NULL, file, path_id);
+	return COM_FindFile (filename, NULL, file, NULL, path_id);
 }
 
 /*
@@ -2402,19 +2564,22 @@ COM_LoadFile
 
 Filename are reletive to the quake directory.
 Allways appends a 0 byte.
+Files in memory resident paks are copied straight
+from the pak data without opening a handle.
 ============
 */
 byte *COM_LoadFile (const char *path, unsigned int *path_id)
 {
 	int			h;
 	byte	   *buf;
+	const byte *view;
 	qfilesize_t len;
 
 	buf = NULL; // quiet compiler warning
 
 	// look for it in the filesystem or pack files
-	len = COM_OpenFile (path, &h, path_id);
-	if (h == -1)
+	len = COM_FindFile (path, &h, NULL, &view, path_id);
+	if (!view && h == -1)
 		return NULL;
 
 	buf = (byte *)Mem_AllocNonZero (len + 1);
@@ -2424,8 +2589,13 @@ byte *COM_LoadFile (const char *path, unsigned int *path_id)
 
 	((byte *)buf)[len] = 0;
 
-	Sys_FileRead (h, buf, len);
-	COM_CloseFile (h);
+	if (view)
+		memcpy (buf, view, len);
+	else
+	{
+		Sys_FileRead (h, buf, len);
+		COM_CloseFile (h);
+	}
 
 	return buf;
 }
@@ -2474,6 +2644,31 @@ byte *COM_LoadMallocFile_TextMode_OSPath (const char *path, long *len_out)
 	return data;
 }
 
+/*
+============
+COM_Deflate
+
+Returns a Mem_Alloc'ed raw deflate stream of data, or NULL
+============
+*/
+byte *COM_Deflate (const void *data, size_t len, size_t *out_len)
+{
+	*out_len = 0;
+	return (byte *)tdefl_compress_mem_to_heap (data, len, out_len, TDEFL_DEFAULT_MAX_PROBES);
+}
+
+/*
+============
+COM_Inflate
+
+Decompresses a raw deflate stream that must expand to exactly out_len bytes
+============
+*/
+qboolean COM_Inflate (const void *data, size_t len, void *out, size_t out_len)
+{
+	return tinfl_decompress_mem_to_mem (out, out_len, data, len, TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF) == out_len;
+}
+
 const char *COM_ParseIntNewline (const char *buffer, int *value)
 {
 	int consumed = 0;
@@ -2603,6 +2798,7 @@ static pack_t *COM_LoadPackFile (const char *packfile, int packhandle)
 	pack->handle = packhandle;
 	pack->numfiles = numpackfiles;
 	pack->files = newfiles;
+	COM_IndexPackFile (pack);
 
 	// Sys_Printf ("Added packfile %s (%i files)\n", packfile, numpackfiles);
 	return pack;
@@ -2671,6 +2867,8 @@ static void COM_AddGameDirectoryRoot (const char *base, const char *dir, unsigne
 	searchpath_t *search;
 	pack_t		 *pak;
 	char		  pakfile[MAX_OSPATH];
+	const byte	 *pakdata;
+	qfilesize_t	  paksize;
 	static byte	 *vkquake_pak_extracted;
 
 	q_strlcpy (com_gamedir, va ("%s/%s", base, dir), sizeof (com_gamedir));
@@ -2687,9 +2885,22 @@ static void COM_AddGameDirectoryRoot (const char *base, const char *dir, unsigne
 	for (i = 0;; i++)
 	{
 		q_snprintf (pakfile, sizeof (pakfile), "%s/pak%i.pak", com_gamedir, i);
-		if (Sys_FileOpenRead (pakfile, &packhandle) == -1)
+		// map the whole pak when possible: reads become memcpys and duplicating
+		// the pak handle for concurrent readers no longer reopens the file
+		pakdata = com_nomappaks ? NULL : Sys_FileMap (pakfile, &paksize);
+		if (pakdata)
+			Sys_MemFileOpenRead (pakdata, paksize, &packhandle);
+		else if (Sys_FileOpenRead (pakfile, &packhandle) == -1)
 			break;
 		pak = COM_LoadPackFile (pakfile, packhandle);
+		if (pak && pakdata)
+		{
+			pak->data = pakdata;
+			pak->datasize = paksize;
+			pak->mapped = true;
+		}
+		else if (pakdata)
+			Sys_FileUnmap (pakdata, paksize);
 		if (pak)
 		{
 			search = (searchpath_t *)Mem_Alloc (sizeof (searchpath_t));
@@ -2719,6 +2930,8 @@ static void COM_AddGameDirectoryRoot (const char *base, const char *dir, unsigne
 			qboolean pak0_modified = com_modified;
 			Sys_MemFileOpenRead (vkquake_pak_extracted, vkquake_pak_size_extracted, &packhandle);
 			pak = COM_LoadPackFile ("vkquake.pak", packhandle);
+			pak->data = vkquake_pak_extracted;
+			pak->datasize = vkquake_pak_size_extracted;
 			search = (searchpath_t *)Mem_Alloc (sizeof (searchpath_t));
 			search->path_id = path_id;
 			search->pack = pak;
@@ -2794,7 +3007,10 @@ void COM_ResetGameDirectories (const char *newdirs)
 		if (com_searchpaths->pack)
 		{
 			Sys_FileClose (com_searchpaths->pack->handle);
+			if (com_searchpaths->pack->mapped)
+				Sys_FileUnmap (com_searchpaths->pack->data, com_searchpaths->pack->datasize);
 			Mem_Free (com_searchpaths->pack->files);
+			HashMap_Destroy (com_searchpaths->pack->index);
 			Mem_Free (com_searchpaths->pack);
 		}
 		search = com_searchpaths->next;
@@ -3393,6 +3609,9 @@ void COM_InitFilesystem (void) // johnfitz -- modified based on topaz's tutorial
 	Cvar_RegisterVariable (&cmdline);
 	Cmd_AddCommand ("path", COM_Path_f);
 	Cmd_AddCommand ("game", COM_Game_f); // johnfitz
+	Cmd_AddCommand ("fs_benchmark", COM_Benchmark_f);
+
+	com_nomappaks = COM_CheckParm ("-nomappaks") != 0;
 
 	i = COM_CheckParm ("-basedir");
 	if (i && i < com_argc - 1)
@@ -3771,6 +3990,80 @@ unsigned COM_HashBlock (const void *data, size_t size)
 	return hash;
 }
 
+#define HASH64_PRIME1 0x9E3779B185EBCA87ull
+#define HASH64_PRIME2 0xC2B2AE3D27D4EB4Full
+#define HASH64_PRIME3 0x165667B19E3779F9ull
+#define HASH64_PRIME4 0x85EBCA77C2B2AE63ull
+#define HASH64_PRIME5 0x27D4EB2F165667C5ull
+
+static inline uint64_t COM_HashRotl64 (uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t COM_HashRound64 (uint64_t acc, uint64_t input)
+{
+	return COM_HashRotl64 (acc + input * HASH64_PRIME2, 31) * HASH64_PRIME1;
+}
+
+static inline uint64_t COM_HashMerge64 (uint64_t acc, uint64_t lane)
+{
+	return (acc ^ COM_HashRound64 (0, lane)) * HASH64_PRIME1 + HASH64_PRIME4;
+}
+
+/*
+================
+COM_HashBlock64
+Computes a 64 bit hash of a memory block (the xxHash64 algorithm, seed 0),
+for keys that have to stay unique across many large blocks
+================
+*/
+uint64_t COM_HashBlock64 (const void *data, size_t size)
+{
+	const byte *ptr = (const byte *)data;
+	const byte *end = ptr + size;
+	uint64_t	hash, lane;
+	uint32_t	lane32;
+
+	if (size >= 32)
+	{
+		uint64_t acc[4] = {HASH64_PRIME1 + HASH64_PRIME2, HASH64_PRIME2, 0, -HASH64_PRIME1};
+		for (; ptr + 32 <= end; ptr += 32)
+			for (int i = 0; i < 4; ++i)
+			{
+				memcpy (&lane, ptr + i * 8, 8);
+				acc[i] = COM_HashRound64 (acc[i], lane);
+			}
+		hash = COM_HashRotl64 (acc[0], 1) + COM_HashRotl64 (acc[1], 7) + COM_HashRotl64 (acc[2], 12) + COM_HashRotl64 (acc[3], 18);
+		for (int i = 0; i < 4; ++i)
+			hash = COM_HashMerge64 (hash, acc[i]);
+	}
+	else
+		hash = HASH64_PRIME5;
+
+	hash += (uint64_t)size;
+	for (; ptr + 8 <= end; ptr += 8)
+	{
+		memcpy (&lane, ptr, 8);
+		hash = COM_HashRotl64 (hash ^ COM_HashRound64 (0, lane), 27) * HASH64_PRIME1 + HASH64_PRIME4;
+	}
+	if (ptr + 4 <= end)
+	{
+		memcpy (&lane32, ptr, 4);
+		hash = COM_HashRotl64 (hash ^ ((uint64_t)lane32 * HASH64_PRIME1), 23) * HASH64_PRIME2 + HASH64_PRIME3;
+		ptr += 4;
+	}
+	for (; ptr < end; ++ptr)
+		hash = COM_HashRotl64 (hash ^ (*ptr * HASH64_PRIME5), 11) * HASH64_PRIME1;
+
+	hash ^= hash >> 33;
+	hash *= HASH64_PRIME2;
+	hash ^= hash >> 29;
+	hash *= HASH64_PRIME3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
 static size_t mz_zip_file_read_func (void *opaque, mz_uint64 ofs, void *buf, size_t n)
 {
 #ifdef USE_SDL3
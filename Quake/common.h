@@ -353,6 +353,7 @@ char *va (const char *format, ...) FUNC_PRINTF (1, 2);
 
 unsigned COM_HashString (const char *str);
 unsigned COM_HashBlock (const void *data, size_t size);
+uint64_t COM_HashBlock64 (const void *data, size_t size);
 
 // localization support for 2021 rerelease version:
 void		LOC_Init (void);
@@ -382,10 +383,14 @@ typedef struct
 
 typedef struct pack_s
 {
-	char		filename[MAX_OSPATH];
-	int			handle;
-	int			numfiles;
-	packfile_t *files;
+	char			   filename[MAX_OSPATH];
+	int				   handle;
+	int				   numfiles;
+	packfile_t		  *files;
+	struct hash_map_s *index;	 // file name -> first entry in files with that name
+	const byte		  *data;	 // whole pak contents if memory resident, else NULL
+	qfilesize_t		   datasize; // size of data
+	qboolean		   mapped;	 // data is a Sys_FileMap mapping owned by the pack
 } pack_t;
 
 typedef struct searchpath_s
@@ -431,6 +436,10 @@ byte *COM_LoadFile (const char *path, unsigned int *path_id);
 // Loads in "t" mode so CRLF to LF translation is performed on Windows.
 byte *COM_LoadMallocFile_TextMode_OSPath (const char *path, long *len_out);
 
+// Raw deflate through miniz, the compressed buffer is Mem_Alloc'ed.
+byte	*COM_Deflate (const void *data, size_t len, size_t *out_len);
+qboolean COM_Inflate (const void *data, size_t len, void *out, size_t out_len);
+
 // Attempts to parse an int, followed by a newline.
 // Returns advanced buffer position.
 // Doesn't signal parsing failure, but this is not needed for savegame loading.
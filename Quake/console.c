@@ -1556,14 +1556,7 @@ tab_t *tablist;
 
 // defs from elsewhere
 extern cmd_function_t *cmd_functions;
-#define MAX_ALIAS_NAME 32
-typedef struct cmdalias_s
-{
-	struct cmdalias_s *next;
-	char			   name[MAX_ALIAS_NAME];
-	char			  *value;
-} cmdalias_t;
-extern cmdalias_t *cmd_alias;
+extern cmdalias_t	  *cmd_alias;
 
 /*
 ============
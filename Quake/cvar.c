@@ -23,7 +23,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "quakedef.h"
 
-static cvar_t *cvar_vars;
+static cvar_t	   *cvar_vars;
+static hash_map_t *cvar_map; // name -> cvar, cvar_vars stays the sorted list for iteration
 static char	   cvar_null_string[] = "";
 
 //==============================================================================
@@ -327,15 +328,12 @@ Cvar_FindVar
 */
 cvar_t *Cvar_FindVar (const char *var_name)
 {
-	cvar_t *var;
+	cvar_t **var;
 
-	for (var = cvar_vars; var; var = var->next)
-	{
-		if (!strcmp (var_name, var->name))
-			return var;
-	}
-
-	return NULL;
+	if (!cvar_map)
+		return NULL;
+	var = HashMap_Lookup (cvar_t *, cvar_map, &var_name);
+	return var ? *var : NULL;
 }
 
 cvar_t *Cvar_FindVarAfter (const char *prev_name, unsigned int with_flags)
@@ -681,6 +679,9 @@ void Cvar_RegisterVariable (cvar_t *variable)
 		prev->next = variable;
 	}
 	// johnfitz
+	if (!cvar_map)
+		cvar_map = HashMap_Create (const char *, cvar_t *, &HashStr, &HashStrCmp);
+	HashMap_Insert (cvar_map, &variable->name, &variable);
 	variable->flags |= CVAR_REGISTERED;
 
 	// copy the value off, because future sets will Mem_Free it
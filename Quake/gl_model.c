@@ -33,6 +33,8 @@ static qboolean	 Mod_LoadMD5MeshModel (qmodel_t *mod, const void *buffer);
 static void		 Mod_LoadMD3Model (qmodel_t *mod, const void *buffer);
 static qmodel_t *Mod_LoadModel (qmodel_t *mod, qboolean crash);
 static void		 Mod_FreeModelMemory (qmodel_t *mod);
+static void		 Mod_PVSCacheKB_f (cvar_t *var);
+static void		 Mod_PVSStats_f (void);
 
 cvar_t external_ents = {"external_ents", "1", CVAR_ARCHIVE_GAME};
 cvar_t external_vis = {"external_vis", "1", CVAR_ARCHIVE_GAME};
@@ -57,6 +59,34 @@ static int	 mod_novis_capacity;
 static byte *mod_decompressed;
 static int	 mod_decompressed_capacity;
 
+#define FATPVS_MEMO_SIZE 64
+
+typedef struct pvsrow_s
+{
+	struct pvsrow_s *prev, *next; // lru list, most recently used first
+	mleaf_t			*leaf;
+	int				 bytes; // followed by the row
+} pvsrow_t;
+
+typedef struct
+{
+	qmodel_t *model; // NULL if unused
+	uint32_t  hash;
+	int		  numleafs;
+	int		  leafnums[FATPVS_MAX_LEAFS];
+	int		  bytes;
+	uint32_t  lastused;
+	byte	 *data;
+} fatpvsmemo_t;
+
+static cvar_t pvs_cachekb = {"pvs_cachekb", "16384", CVAR_NONE}; // budget of the decompressed PVS rows, 0 disables both PVS caches
+
+static SDL_Mutex	  *pvscache_mutex;
+static pvsrow_t		   pvscache_lru; // list head
+static fatpvsmemo_t	   fatpvs_memo[FATPVS_MEMO_SIZE];
+static uint32_t		   fatpvs_clock;
+static pvscachestats_t pvscache_stats;
+
 qmodel_t mod_known[MAX_MODELS];
 int		 mod_numknown;
 
@@ -159,6 +189,12 @@ void Mod_Init (void)
 	Cvar_RegisterVariable (&r_allow_replacement_md3models);
 	Cvar_RegisterVariable (&r_enhancedmodels);
 	Cvar_SetCallback (&r_enhancedmodels, Mod_EnhancedModels_f);
+	Cvar_RegisterVariable (&pvs_cachekb);
+	Cvar_SetCallback (&pvs_cachekb, Mod_PVSCacheKB_f);
+	Cmd_AddCommand ("pvs_stats", Mod_PVSStats_f);
+
+	pvscache_mutex = SDL_CreateMutex ();
+	pvscache_lru.next = pvscache_lru.prev = &pvscache_lru;
 
 	// johnfitz -- create notexture miptex
 	r_notexture_mip = (texture_t *)Mem_Alloc (sizeof (texture_t));
@@ -293,35 +329,26 @@ mleaf_t *Mod_PointInLeaf (float *p, qmodel_t *model)
 
 /*
 ===================
-Mod_DecompressVis
+Mod_DecompressVisInto
+
+Decompresses into out, which must hold (numleafs + 31) / 8 bytes.
+Touches no shared buffers, so it can run on the task workers.
 ===================
 */
-byte *Mod_DecompressVis (byte *in, qmodel_t *model)
+static byte *Mod_DecompressVisInto (byte *in, qmodel_t *model, byte *out)
 {
 	int	  c;
-	byte *out;
+	byte *start = out;
 	byte *outend;
 	int	  row;
 
 	row = (model->numleafs + 31) / 8;
-	if (mod_decompressed == NULL || row > mod_decompressed_capacity)
-	{
-		mod_decompressed_capacity = row;
-		mod_decompressed = (byte *)Mem_Realloc (mod_decompressed, mod_decompressed_capacity);
-		if (!mod_decompressed)
-			Sys_Error ("Mod_DecompressVis: realloc() failed on %d bytes", mod_decompressed_capacity);
-	}
-	out = mod_decompressed;
-	outend = mod_decompressed + row;
+	outend = out + row;
 
 	if (!in)
 	{ // no vis info, so make all visible
-		while (row)
-		{
-			*out++ = 0xff;
-			row--;
-		}
-		return mod_decompressed;
+		memset (out, 0xff, row);
+		return start;
 	}
 
 	do
@@ -334,10 +361,8 @@ byte *Mod_DecompressVis (byte *in, qmodel_t *model)
 
 		c = in[1];
 		in += 2;
-		if (c > row - (out - mod_decompressed))
-			c = row -
-				(out -
-				 mod_decompressed); // now that we're dynamically allocating pvs buffers, we have to be more careful to avoid heap overflows with buggy maps.
+		if (c > row - (out - start))
+			c = row - (out - start); // now that we're dynamically allocating pvs buffers, we have to be more careful to avoid heap overflows with buggy maps.
 		while (c)
 		{
 			if (out == outend)
@@ -347,14 +372,200 @@ byte *Mod_DecompressVis (byte *in, qmodel_t *model)
 					model->viswarn = true;
 					Con_Warning ("Mod_DecompressVis: output overrun on model \"%s\"\n", model->name);
 				}
-				return mod_decompressed;
+				return start;
 			}
 			*out++ = 0;
 			c--;
 		}
-	} while (out - mod_decompressed < row);
+	} while (out - start < row);
+
+	return start;
+}
+
+/*
+===================
+Mod_DecompressVis
+===================
+*/
+byte *Mod_DecompressVis (byte *in, qmodel_t *model)
+{
+	int row;
+
+	row = (model->numleafs + 31) / 8;
+	if (mod_decompressed == NULL || row > mod_decompressed_capacity)
+	{
+		mod_decompressed_capacity = row;
+		mod_decompressed = (byte *)Mem_Realloc (mod_decompressed, mod_decompressed_capacity);
+		if (!mod_decompressed)
+			Sys_Error ("Mod_DecompressVis: realloc() failed on %d bytes", mod_decompressed_capacity);
+	}
+	return Mod_DecompressVisInto (in, model, mod_decompressed);
+}
+
+/*
+===============================================================================
+
+PVS CACHE
+
+Decompressed PVS rows are kept per leaf up to pvs_cachekb kilobytes, the
+least recently used ones are dropped first. Next to them a few merged (fat)
+PVS rows are memoized, keyed by the set of leafs they were merged from, so
+clients standing in the same leafs share the work. The server builds its
+snapshots on the task workers, so everything is copied in and out under
+pvscache_mutex.
+
+===============================================================================
+*/
+
+/*
+===================
+Mod_UnlinkPVSRow
+===================
+*/
+static void Mod_UnlinkPVSRow (pvsrow_t *row)
+{
+	row->prev->next = row->next;
+	row->next->prev = row->prev;
+}
+
+/*
+===================
+Mod_LinkPVSRow
+===================
+*/
+static void Mod_LinkPVSRow (pvsrow_t *row)
+{
+	row->next = pvscache_lru.next;
+	row->prev = &pvscache_lru;
+	pvscache_lru.next->prev = row;
+	pvscache_lru.next = row;
+}
+
+/*
+===================
+Mod_FreePVSRow
+===================
+*/
+static void Mod_FreePVSRow (pvsrow_t *row)
+{
+	Mod_UnlinkPVSRow (row);
+	row->leaf->pvsrow = NULL;
+	pvscache_stats.rowbytes -= sizeof (pvsrow_t) + row->bytes;
+	pvscache_stats.rows--;
+	Mem_Free (row);
+}
+
+/*
+===================
+Mod_PVSCacheBudget
+===================
+*/
+static size_t Mod_PVSCacheBudget (void)
+{
+	return (size_t)q_max (pvs_cachekb.value, 0.f) * 1024;
+}
+
+/*
+===================
+Mod_TrimPVSCache
 
-	return mod_decompressed;
+Drops the least recently used rows until the cache fits into budget
+===================
+*/
+static void Mod_TrimPVSCache (size_t budget)
+{
+	while (pvscache_stats.rowbytes > budget && pvscache_lru.prev != &pvscache_lru)
+	{
+		Mod_FreePVSRow (pvscache_lru.prev);
+		pvscache_stats.rowevictions++;
+	}
+}
+
+/*
+===================
+Mod_FlushPVSCache
+
+Forgets everything cached for mod, which must be done before its leafs are freed
+===================
+*/
+static void Mod_FlushPVSCache (qmodel_t *mod)
+{
+	pvsrow_t *row, *next;
+	int		  i;
+
+	if (!pvscache_mutex || !mod->leafs)
+		return;
+
+	SDL_LockMutex (pvscache_mutex);
+	for (row = pvscache_lru.next; row != &pvscache_lru; row = next)
+	{
+		next = row->next;
+		if (row->leaf >= mod->leafs && row->leaf <= mod->leafs + mod->numleafs)
+			Mod_FreePVSRow (row);
+	}
+	for (i = 0; i < FATPVS_MEMO_SIZE; i++)
+	{
+		// submodels share the leafs of the world
+		if (fatpvs_memo[i].model && fatpvs_memo[i].model->leafs == mod->leafs)
+		{
+			pvscache_stats.fatbytes -= fatpvs_memo[i].bytes;
+			pvscache_stats.fats--;
+			fatpvs_memo[i].model = NULL;
+		}
+	}
+	SDL_UnlockMutex (pvscache_mutex);
+}
+
+/*
+===================
+Mod_PVSCacheKB_f
+===================
+*/
+static void Mod_PVSCacheKB_f (cvar_t *var)
+{
+	SDL_LockMutex (pvscache_mutex);
+	Mod_TrimPVSCache (Mod_PVSCacheBudget ());
+	SDL_UnlockMutex (pvscache_mutex);
+}
+
+/*
+===================
+Mod_PVSStats_f
+===================
+*/
+static void Mod_PVSStats_f (void)
+{
+	pvscachestats_t stats;
+
+	if (Cmd_Argc () > 1 && !q_strcasecmp (Cmd_Argv (1), "reset"))
+	{
+		SDL_LockMutex (pvscache_mutex);
+		pvscache_stats.rowhits = pvscache_stats.rowmisses = pvscache_stats.rowevictions = 0;
+		pvscache_stats.fathits = pvscache_stats.fatmisses = 0;
+		SDL_UnlockMutex (pvscache_mutex);
+		return;
+	}
+
+	Mod_GetPVSCacheStats (&stats);
+	Con_Printf (
+		"pvs rows: %i cached, %.1f of %i KB, %.1f%% hits (%" PRIu64 " hits, %" PRIu64 " misses, %" PRIu64 " evicted)\n", stats.rows,
+		stats.rowbytes / 1024.0, (int)(Mod_PVSCacheBudget () / 1024), stats.rowhits * 100.0 / q_max (stats.rowhits + stats.rowmisses, (uint64_t)1), stats.rowhits,
+		stats.rowmisses, stats.rowevictions);
+	Con_Printf (
+		"fat pvs:  %i memoized, %.1f KB, %.1f%% hits (%" PRIu64 " hits, %" PRIu64 " misses)\n", stats.fats, stats.fatbytes / 1024.0,
+		stats.fathits * 100.0 / q_max (stats.fathits + stats.fatmisses, (uint64_t)1), stats.fathits, stats.fatmisses);
+}
+
+/*
+===================
+Mod_GetPVSCacheStats
+===================
+*/
+void Mod_GetPVSCacheStats (pvscachestats_t *stats)
+{
+	SDL_LockMutex (pvscache_mutex);
+	*stats = pvscache_stats;
+	SDL_UnlockMutex (pvscache_mutex);
 }
 
 /*
@@ -364,9 +575,170 @@ Mod_LeafPVS
 */
 byte *Mod_LeafPVS (mleaf_t *leaf, qmodel_t *model)
 {
+	int row;
+
 	if (leaf == model->leafs)
 		return Mod_NoVisPVS (model);
-	return Mod_DecompressVis (leaf->compressed_vis, model);
+
+	row = (model->numleafs + 31) / 8;
+	if (mod_decompressed == NULL || row > mod_decompressed_capacity)
+	{
+		mod_decompressed_capacity = row;
+		mod_decompressed = (byte *)Mem_Realloc (mod_decompressed, mod_decompressed_capacity);
+		if (!mod_decompressed)
+			Sys_Error ("Mod_LeafPVS: realloc() failed on %d bytes", mod_decompressed_capacity);
+	}
+	return Mod_LeafPVSInto (leaf, model, mod_decompressed);
+}
+
+/*
+===================
+Mod_LeafPVSInto
+
+Reentrant Mod_LeafPVS, copies the row into out, which must hold
+(numleafs + 31) / 8 bytes.
+===================
+*/
+byte *Mod_LeafPVSInto (mleaf_t *leaf, qmodel_t *model, byte *out)
+{
+	const int	 bytes = (model->numleafs + 31) / 8;
+	const size_t budget = Mod_PVSCacheBudget ();
+	pvsrow_t	*row;
+
+	if (leaf == model->leafs)
+	{
+		memset (out, 0xff, bytes);
+		return out;
+	}
+	if (sizeof (pvsrow_t) + bytes > budget)
+		return Mod_DecompressVisInto (leaf->compressed_vis, model, out);
+
+	SDL_LockMutex (pvscache_mutex);
+	row = leaf->pvsrow;
+	if (row && row->bytes == bytes)
+	{
+		memcpy (out, row + 1, bytes);
+		Mod_UnlinkPVSRow (row);
+		Mod_LinkPVSRow (row);
+		pvscache_stats.rowhits++;
+		SDL_UnlockMutex (pvscache_mutex);
+		return out;
+	}
+	pvscache_stats.rowmisses++;
+	SDL_UnlockMutex (pvscache_mutex);
+
+	Mod_DecompressVisInto (leaf->compressed_vis, model, out);
+	row = (pvsrow_t *)Mem_AllocNonZero (sizeof (pvsrow_t) + bytes);
+	row->leaf = leaf;
+	row->bytes = bytes;
+	memcpy (row + 1, out, bytes);
+
+	SDL_LockMutex (pvscache_mutex);
+	if (leaf->pvsrow) // another thread got there first, or a submodel asked with its own row size
+		Mod_FreePVSRow (leaf->pvsrow);
+	leaf->pvsrow = row;
+	Mod_LinkPVSRow (row);
+	pvscache_stats.rowbytes += sizeof (pvsrow_t) + bytes;
+	pvscache_stats.rows++;
+	Mod_TrimPVSCache (budget);
+	SDL_UnlockMutex (pvscache_mutex);
+	return out;
+}
+
+/*
+===================
+Mod_FatPVSHash
+===================
+*/
+static uint32_t Mod_FatPVSHash (const int *leafnums, int numleafs)
+{
+	uint32_t hash = 2166136261u;
+	int		 i;
+
+	for (i = 0; i < numleafs; i++)
+		hash = (hash ^ (uint32_t)leafnums[i]) * 16777619u;
+	return hash;
+}
+
+/*
+===================
+Mod_LookupFatPVS
+
+Copies the memoized merge of the PVS rows of the given (sorted) leafs into out
+===================
+*/
+qboolean Mod_LookupFatPVS (qmodel_t *model, const int *leafnums, int numleafs, byte *out, int bytes)
+{
+	const uint32_t hash = Mod_FatPVSHash (leafnums, numleafs);
+	fatpvsmemo_t  *memo;
+	int			   i;
+
+	if (numleafs > FATPVS_MAX_LEAFS || Mod_PVSCacheBudget () == 0)
+		return false;
+
+	SDL_LockMutex (pvscache_mutex);
+	for (i = 0, memo = fatpvs_memo; i < FATPVS_MEMO_SIZE; i++, memo++)
+	{
+		if (memo->model == model && memo->hash == hash && memo->numleafs == numleafs && memo->bytes == bytes &&
+			!memcmp (memo->leafnums, leafnums, numleafs * sizeof (int)))
+		{
+			memcpy (out, memo->data, bytes);
+			memo->lastused = ++fatpvs_clock;
+			pvscache_stats.fathits++;
+			SDL_UnlockMutex (pvscache_mutex);
+			return true;
+		}
+	}
+	pvscache_stats.fatmisses++;
+	SDL_UnlockMutex (pvscache_mutex);
+	return false;
+}
+
+/*
+===================
+Mod_StoreFatPVS
+
+Memoizes pvs as the merge of the PVS rows of the given (sorted) leafs,
+replacing the least recently used entry
+===================
+*/
+void Mod_StoreFatPVS (qmodel_t *model, const int *leafnums, int numleafs, const byte *pvs, int bytes)
+{
+	fatpvsmemo_t *memo, *oldest = &fatpvs_memo[0];
+	int			  i;
+
+	if (numleafs > FATPVS_MAX_LEAFS || Mod_PVSCacheBudget () == 0)
+		return;
+
+	SDL_LockMutex (pvscache_mutex);
+	for (i = 0, memo = fatpvs_memo; i < FATPVS_MEMO_SIZE; i++, memo++)
+	{
+		if (!memo->model)
+		{
+			oldest = memo;
+			break;
+		}
+		if (memo->lastused < oldest->lastused)
+			oldest = memo;
+	}
+
+	memo = oldest;
+	if (memo->model)
+	{
+		pvscache_stats.fatbytes -= memo->bytes;
+		pvscache_stats.fats--;
+	}
+	memo->data = (byte *)Mem_Realloc (memo->data, bytes);
+	memcpy (memo->data, pvs, bytes);
+	memcpy (memo->leafnums, leafnums, numleafs * sizeof (int));
+	memo->model = model;
+	memo->hash = Mod_FatPVSHash (leafnums, numleafs);
+	memo->numleafs = numleafs;
+	memo->bytes = bytes;
+	memo->lastused = ++fatpvs_clock;
+	pvscache_stats.fatbytes += bytes;
+	pvscache_stats.fats++;
+	SDL_UnlockMutex (pvscache_mutex);
 }
 
 /*
@@ -437,6 +809,7 @@ static void Mod_FreeModelMemory (qmodel_t *mod)
 		mod->numsubmodels = 0;
 		SAFE_FREE (mod->planes);
 		mod->numplanes = 0;
+		Mod_FlushPVSCache (mod);
 		SAFE_FREE (mod->leafs);
 		mod->numleafs = 0;
 		SAFE_FREE (mod->vertexes);
@@ -219,12 +219,13 @@ typedef struct mleaf_s
 	float minmaxs[6]; // for bounding box culling
 
 	// leaf specific
-	int		 nummarksurfaces;
-	int		 combined_deps; // contains index into brush_deps_data[] with used warp and lightmap textures
-	byte	 ambient_sound_level[NUM_AMBIENTS];
-	byte	*compressed_vis;
-	int		*firstmarksurface;
-	efrag_t *efrags;
+	int				 nummarksurfaces;
+	int				 combined_deps; // contains index into brush_deps_data[] with used warp and lightmap textures
+	byte			 ambient_sound_level[NUM_AMBIENTS];
+	byte			*compressed_vis;
+	int				*firstmarksurface;
+	efrag_t			*efrags;
+	struct pvsrow_s *pvsrow; // decompressed compressed_vis, see Mod_LeafPVSInto
 } mleaf_t;
 
 // johnfitz -- for clipnodes>32k
@@ -740,8 +741,23 @@ void	  Mod_RefreshSkins_f (cvar_t *var);
 
 mleaf_t *Mod_PointInLeaf (float *p, qmodel_t *model);
 byte	*Mod_LeafPVS (mleaf_t *leaf, qmodel_t *model);
+byte	*Mod_LeafPVSInto (mleaf_t *leaf, qmodel_t *model, byte *out);
 byte	*Mod_NoVisPVS (qmodel_t *model);
 
+#define FATPVS_MAX_LEAFS 16 // merged PVS rows from more leafs than this are not memoized
+
+typedef struct
+{
+	uint64_t rowhits, rowmisses, rowevictions;
+	uint64_t fathits, fatmisses;
+	size_t	 rowbytes, fatbytes;
+	int		 rows, fats;
+} pvscachestats_t;
+
+qboolean Mod_LookupFatPVS (qmodel_t *model, const int *leafnums, int numleafs, byte *out, int bytes);
+void	 Mod_StoreFatPVS (qmodel_t *model, const int *leafnums, int numleafs, const byte *pvs, int bytes);
+void	 Mod_GetPVSCacheStats (pvscachestats_t *stats);
+
 void Mod_SetExtraFlags (qmodel_t *mod);
 
 size_t	 Mod_SanitizeMapDescription (char *dst, size_t dstsize, const char *src);
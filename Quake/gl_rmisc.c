@@ -27,6 +27,25 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "gl_heap.h"
 #include <float.h>
 
+#define PIPELINE_CACHE_FILENAME "pipeline_cache.bin"
+#define PIPELINE_CACHE_MAGIC	0x43505156 // "VQPC"
+#define PIPELINE_CACHE_VERSION	1
+#define PIPELINE_CACHE_MAX_SIZE (256 * 1024 * 1024)
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vendor_id;
+	uint32_t device_id;
+	uint32_t driver_version;
+	uint8_t	 uuid[VK_UUID_SIZE];
+	uint32_t data_size;
+	uint32_t data_crc;
+} pipelinecacheheader_t;
+
+static size_t pipeline_cache_saved_size;
+
 cvar_t r_lodbias = {"r_lodbias", "1", CVAR_ARCHIVE};
 cvar_t gl_lodbias = {"gl_lodbias", "0", CVAR_ARCHIVE};
 
@@ -2825,7 +2844,7 @@ static void R_CreateGraphicsPipeline (vulkan_pipeline_t *pipeline, pipeline_crea
 {
 	assert (pipeline->handle == VK_NULL_HANDLE);
 	infos->graphics_pipeline.layout = layout.handle;
-	const VkResult err = vkCreateGraphicsPipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos->graphics_pipeline, NULL, &pipeline->handle);
+	const VkResult err = vkCreateGraphicsPipelines (vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos->graphics_pipeline, NULL, &pipeline->handle);
 	if (err != VK_SUCCESS)
 		Sys_Error ("vkCreateGraphicsPipelines failed (%s) with code %i", name, (int)err);
 	pipeline->layout = layout;
@@ -2856,7 +2875,7 @@ static void R_CreateComputePipeline (
 	create_info.stage.pSpecializationInfo = specialization_info;
 	create_info.layout = pipeline->layout.handle;
 
-	const VkResult err = vkCreateComputePipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &create_info, NULL, &pipeline->handle);
+	const VkResult err = vkCreateComputePipelines (vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &create_info, NULL, &pipeline->handle);
 	if (err != VK_SUCCESS)
 		Sys_Error ("vkCreateComputePipelines failed (%s) with code %i", name, (int)err);
 	GL_SetObjectName ((uint64_t)pipeline->handle, VK_OBJECT_TYPE_PIPELINE, name);
@@ -4020,36 +4039,183 @@ static void R_DestroyShaderModules ()
 	DESTROY_SHADER_MODULE (skinning_8_comp);
 }
 
+/*
+===============
+R_InitPipelineCache
+
+Seeds the VkPipelineCache used by every pipeline creation with the blob saved by the
+last run. The blob is only trusted if both our header and the Vulkan cache header match
+the current device and driver, otherwise pipelines are compiled from scratch.
+===============
+*/
+void R_InitPipelineCache (void)
+{
+	pipelinecacheheader_t header;
+	void				 *data = NULL;
+	FILE				 *f;
+
+	f = COM_CheckParm ("-nopipelinecache") ? NULL : COM_FOpenPrefFile (PIPELINE_CACHE_FILENAME, "rb");
+	if (f)
+	{
+		const VkPhysicalDeviceProperties *props = &vulkan_globals.device_properties;
+		if (fread (&header, sizeof (header), 1, f) == 1 && header.magic == PIPELINE_CACHE_MAGIC && header.version == PIPELINE_CACHE_VERSION &&
+			header.vendor_id == props->vendorID && header.device_id == props->deviceID && header.driver_version == props->driverVersion &&
+			!memcmp (header.uuid, props->pipelineCacheUUID, VK_UUID_SIZE) && header.data_size >= sizeof (VkPipelineCacheHeaderVersionOne) &&
+			header.data_size <= PIPELINE_CACHE_MAX_SIZE)
+		{
+			data = Mem_AllocNonZero (header.data_size);
+			if (fread (data, header.data_size, 1, f) == 1 && Com_BlockChecksum (data, header.data_size) == header.data_crc)
+			{
+				VkPipelineCacheHeaderVersionOne vk_header;
+				memcpy (&vk_header, data, sizeof (vk_header));
+				if (vk_header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || vk_header.headerSize < sizeof (vk_header) ||
+					vk_header.vendorID != props->vendorID || vk_header.deviceID != props->deviceID ||
+					memcmp (vk_header.pipelineCacheUUID, props->pipelineCacheUUID, VK_UUID_SIZE))
+				{
+					Mem_Free (data);
+					data = NULL;
+				}
+			}
+			else
+			{
+				Mem_Free (data);
+				data = NULL;
+			}
+		}
+		fclose (f);
+		if (!data)
+			Con_Printf ("Discarding stale pipeline cache\n");
+	}
+
+	ZEROED_STRUCT (VkPipelineCacheCreateInfo, cache_create_info);
+	cache_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cache_create_info.initialDataSize = data ? header.data_size : 0;
+	cache_create_info.pInitialData = data;
+	VkResult err = vkCreatePipelineCache (vulkan_globals.device, &cache_create_info, NULL, &vulkan_globals.pipeline_cache);
+	if (err != VK_SUCCESS && data)
+	{
+		// the driver is allowed to reject the blob, start over empty
+		cache_create_info.initialDataSize = 0;
+		cache_create_info.pInitialData = NULL;
+		err = vkCreatePipelineCache (vulkan_globals.device, &cache_create_info, NULL, &vulkan_globals.pipeline_cache);
+	}
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkCreatePipelineCache failed with code %i", (int)err);
+	GL_SetObjectName ((uint64_t)vulkan_globals.pipeline_cache, VK_OBJECT_TYPE_PIPELINE_CACHE, "pipeline_cache");
+
+	pipeline_cache_saved_size = data ? header.data_size : 0;
+	Con_DPrintf ("Pipeline cache: %u bytes loaded\n", (unsigned)pipeline_cache_saved_size);
+	Mem_Free (data);
+}
+
+/*
+===============
+R_SavePipelineCache
+
+Writes the pipeline cache back to the pref dir if pipeline creation added to it
+===============
+*/
+static void R_SavePipelineCache (void)
+{
+	pipelinecacheheader_t header;
+	size_t				  size = 0;
+	void				 *data;
+	FILE				 *f;
+
+	if (COM_CheckParm ("-nopipelinecache"))
+		return;
+	if (vkGetPipelineCacheData (vulkan_globals.device, vulkan_globals.pipeline_cache, &size, NULL) != VK_SUCCESS || !size)
+		return;
+	if (size == pipeline_cache_saved_size || size > PIPELINE_CACHE_MAX_SIZE)
+		return;
+
+	data = Mem_AllocNonZero (size);
+	if (vkGetPipelineCacheData (vulkan_globals.device, vulkan_globals.pipeline_cache, &size, data) != VK_SUCCESS)
+	{
+		Mem_Free (data);
+		return;
+	}
+
+	memset (&header, 0, sizeof (header));
+	header.magic = PIPELINE_CACHE_MAGIC;
+	header.version = PIPELINE_CACHE_VERSION;
+	header.vendor_id = vulkan_globals.device_properties.vendorID;
+	header.device_id = vulkan_globals.device_properties.deviceID;
+	header.driver_version = vulkan_globals.device_properties.driverVersion;
+	memcpy (header.uuid, vulkan_globals.device_properties.pipelineCacheUUID, VK_UUID_SIZE);
+	header.data_size = (uint32_t)size;
+	header.data_crc = Com_BlockChecksum (data, (int)size);
+
+	f = COM_FOpenPrefFile (PIPELINE_CACHE_FILENAME, "wb");
+	if (f)
+	{
+		if (fwrite (&header, sizeof (header), 1, f) == 1 && fwrite (data, size, 1, f) == 1)
+			pipeline_cache_saved_size = size;
+		else
+			Con_Printf ("Couldn't write %s\n", PIPELINE_CACHE_FILENAME);
+		fclose (f);
+	}
+	Mem_Free (data);
+}
+
+/*
+===============
+R_CreatePipelineGroupTask
+===============
+*/
+typedef void (*pipeline_group_func_t) (void);
+static const pipeline_group_func_t pipeline_groups[] = {
+	R_CreateBasicPipelines,
+	R_CreateWarpPipelines,
+	R_CreateParticlesPipelines,
+	R_CreateFTEParticlesPipelines,
+	R_CreateSpritesPipelines,
+	R_CreateSkyPipelines,
+	R_CreateShowTrisPipelines,
+	R_CreateWorldPipelines,
+	R_CreateAliasPipelines,
+	R_CreateMD5Pipelines,
+	R_CreatePostprocessPipelines,
+	R_CreateScreenEffectsPipelines,
+	R_CreateUpdateLightmapPipelines,
+	R_CreateIndirectComputePipelines,
+	R_CreateRayDebugPipelines,
+	R_CreateAnimComputePipelines,
+};
+
+static void R_CreatePipelineGroupTask (int index, void *unused)
+{
+	pipeline_groups[index]();
+}
+
 /*
 ===============
 R_CreatePipelines
+
+The groups only share read-only state (shader modules, vertex formats, render passes)
+and each writes its own pipelines, so they are built on the task workers.
 ===============
 */
 void R_CreatePipelines ()
 {
 	Sys_Printf ("Creating pipelines\n");
+	const double start_time = Sys_DoubleTime ();
 
 	R_CreateShaderModules ();
 	R_InitVertexAttributes ();
 
-	R_CreateBasicPipelines ();
-	R_CreateWarpPipelines ();
-	R_CreateParticlesPipelines ();
-	R_CreateFTEParticlesPipelines ();
-	R_CreateSpritesPipelines ();
-	R_CreateSkyPipelines ();
-	R_CreateShowTrisPipelines ();
-	R_CreateWorldPipelines ();
-	R_CreateAliasPipelines ();
-	R_CreateMD5Pipelines ();
-	R_CreatePostprocessPipelines ();
-	R_CreateScreenEffectsPipelines ();
-	R_CreateUpdateLightmapPipelines ();
-	R_CreateIndirectComputePipelines ();
-	R_CreateRayDebugPipelines ();
-	R_CreateAnimComputePipelines ();
+	if (Tasks_NumWorkers () > 1 && !COM_CheckParm ("-noparallelpipelines"))
+		Task_Join (Task_AllocateAssignIndexedFuncAndSubmit (R_CreatePipelineGroupTask, countof (pipeline_groups), NULL, 0), TASK_TIMEOUT_INFINITE);
+	else
+	{
+		for (int i = 0; i < (int)countof (pipeline_groups); ++i)
+			pipeline_groups[i]();
+	}
 
 	R_DestroyShaderModules ();
+
+	Con_DPrintf ("Created pipelines in %.1f ms\n", (Sys_DoubleTime () - start_time) * 1000.0);
+	R_SavePipelineCache ();
 }
 
 /*
@@ -4614,6 +4780,9 @@ void R_NewMap (void)
 
 	VEC_CLEAR (r_pointfile);
 
+	// the map's textures are loaded, keep the texture cache index in sync with its files
+	TexMgr_SaveCacheIndex ();
+
 	if (developer.value || map_checks.value)
 		if (!cl.worldmodel->visdata && COM_FileExists (va ("maps/%s.pts", cl.mapname), NULL))
 			Cbuf_AddText ("pointfile leak\n");
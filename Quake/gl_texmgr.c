@@ -52,10 +52,65 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 static cvar_t gl_max_size = {"gl_max_size", "0", CVAR_NONE};
 static cvar_t gl_picmip = {"gl_picmip", "0", CVAR_NONE};
 
+#define TEXCACHE_MAGIC		   0x43545156 // "VQTC"
+#define TEXCACHE_VERSION	   2
+#define TEXCACHE_INDEX_VERSION 2
+#define TEXCACHE_MIN_PIXELS	   (256 * 256)
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t source_hash;
+	uint32_t params_hash;
+	uint32_t source_width; // source data, checked on load on top of the hashes
+	uint32_t source_height;
+	uint32_t source_size;
+	uint32_t width;
+	uint32_t height;
+	uint32_t flags;
+	uint32_t size;
+	uint32_t stored_size; // == size if stored uncompressed
+	uint32_t padding;
+} texcacheheader_t;
+
+typedef struct
+{
+	uint64_t source_hash;
+	uint32_t params_hash;
+	uint32_t size;
+	uint32_t last_used;
+	uint32_t padding;
+} texcacheentry_t;
+
+static cvar_t gl_texturecache = {"gl_texturecache", "1", CVAR_ARCHIVE};
+static cvar_t gl_texturecache_mb = {"gl_texturecache_mb", "1024", CVAR_ARCHIVE};
+
+static SDL_Mutex	   *texcache_mutex;
+static texcacheentry_t *texcache_entries; // VEC
+static uint64_t			texcache_total_size;
+static uint32_t			texcache_clock;
+static qboolean			texcache_dirty;
+static int				texcache_hits, texcache_misses;
+static double			texcache_load_time;
+static atomic_uint32_t	texcache_temp_counter;
+
 extern cvar_t vid_filter;
 extern cvar_t vid_anisotropic;
 
 #define MAX_MIPS 16
+
+// images of at least TEXMGR_BAND_MIN_PIXELS are processed in bands of TEXMGR_BAND_ROWS rows
+#define TEXMGR_BAND_ROWS	   64
+#define TEXMGR_BAND_MIN_PIXELS (512 * 512)
+
+typedef struct
+{
+	byte *in;
+	byte *out;
+	int	  in_width, in_height;
+	int	  out_width, out_height;
+} texmgr_band_t;
 static int			numgltextures;
 static gltexture_t *active_gltextures, *free_gltextures;
 gltexture_t		   *notexture, *nulltexture, *whitetexture, *greytexture, *greylightmap, *bluenoisetexture;
@@ -754,6 +809,10 @@ static void TexMgr_LoadMiptexPalette (byte *in, byte *out, int numcolors, unsign
 		out[-1] = 0;
 }
 
+static void TexMgr_LoadCacheIndex (void);
+static void TexMgr_TextureCache_f (void);
+static void TexMgr_ImageBench_f (void);
+
 /*
 ================
 TexMgr_NewGame
@@ -784,6 +843,8 @@ void TexMgr_Init (void)
 	cmd_function_t *cmd;
 
 	texmgr_mutex = SDL_CreateMutex ();
+	texcache_mutex = SDL_CreateMutex ();
+	TexMgr_LoadCacheIndex ();
 
 	// init texture list
 	free_gltextures = (gltexture_t *)Mem_Alloc (MAX_GLTEXTURES * sizeof (gltexture_t));
@@ -798,6 +859,10 @@ void TexMgr_Init (void)
 
 	Cvar_RegisterVariable (&gl_max_size);
 	Cvar_RegisterVariable (&gl_picmip);
+	Cvar_RegisterVariable (&gl_texturecache);
+	Cvar_RegisterVariable (&gl_texturecache_mb);
+	Cmd_AddCommand ("texturecache", TexMgr_TextureCache_f);
+	Cmd_AddCommand ("imagebench", TexMgr_ImageBench_f);
 
 	cmd = Cmd_AddCommand ("imagelist", &TexMgr_Imagelist_f);
 
@@ -836,6 +901,39 @@ void TexMgr_Init (void)
 ================================================================================
 */
 
+/*
+================
+TexMgr_UseBands
+
+Large images are split into row bands on the task workers, unless we already are
+on one (e.g. in Mod_LoadTextureTask), where waiting for other tasks could starve
+================
+*/
+static qboolean TexMgr_UseBands (int width, int height)
+{
+	return !Tasks_IsWorker () && (Tasks_NumWorkers () > 1) && (width * height >= TEXMGR_BAND_MIN_PIXELS);
+}
+
+/*
+================
+TexMgr_DownsampleBandTask
+
+Resizes output rows [index * TEXMGR_BAND_ROWS, +TEXMGR_BAND_ROWS). Shifting the
+output by the first row gives the exact same samples as the full image resize.
+================
+*/
+static void TexMgr_DownsampleBandTask (int index, void *payload)
+{
+	const texmgr_band_t *band = (const texmgr_band_t *)payload;
+	const int			 first_row = index * TEXMGR_BAND_ROWS;
+	const int			 num_rows = q_min (TEXMGR_BAND_ROWS, band->out_height - first_row);
+
+	stbir_resize_subpixel (
+		band->in, band->in_width, band->in_height, 0, band->out + (size_t)first_row * band->out_width * 4, band->out_width, num_rows, 0, STBIR_TYPE_UINT8,
+		4, -1, 0, STBIR_EDGE_CLAMP, STBIR_EDGE_CLAMP, STBIR_FILTER_DEFAULT, STBIR_FILTER_DEFAULT, STBIR_COLORSPACE_LINEAR, NULL,
+		(float)band->out_width / band->in_width, (float)band->out_height / band->in_height, 0.0f, (float)first_row);
+}
+
 /*
 ================
 TexMgr_Downsample
@@ -849,13 +947,175 @@ static unsigned *TexMgr_Downsample (unsigned *data, int in_width, int in_height,
 	assert ((out_height >= 1) && (out_height <= in_height));
 
 	TEMP_ALLOC (byte, image_resize_buffer, out_size_bytes);
-	stbir_resize_uint8 ((byte *)data, in_width, in_height, 0, image_resize_buffer, out_width, out_height, 0, 4);
+	if (TexMgr_UseBands (in_width, in_height))
+	{
+		const texmgr_band_t band = {(byte *)data, image_resize_buffer, in_width, in_height, out_width, out_height};
+		const int			num_bands = (out_height + TEXMGR_BAND_ROWS - 1) / TEXMGR_BAND_ROWS;
+		Task_Join (Task_AllocateAssignIndexedFuncAndSubmit (TexMgr_DownsampleBandTask, num_bands, (void *)&band, sizeof (band)), TASK_TIMEOUT_INFINITE);
+	}
+	else
+		stbir_resize_uint8 ((byte *)data, in_width, in_height, 0, image_resize_buffer, out_width, out_height, 0, 4);
 	memcpy (data, image_resize_buffer, out_size_bytes);
 	TEMP_FREE (image_resize_buffer);
 
 	return data;
 }
 
+/*
+===============
+TexMgr_AlphaEdgeFixPixel
+
+gives a transparent pixel the average color of its non-transparent neighbors,
+wrapping around the image edges. Only colors of opaque pixels are ever read, so
+pixels can be fixed in any order and rows in parallel.
+===============
+*/
+static void TexMgr_AlphaEdgeFixPixel (byte *data, int width, int height, int i, int j)
+{
+	const int lastrow = width * 4 * ((i == 0) ? height - 1 : i - 1);
+	const int thisrow = width * 4 * i;
+	const int nextrow = width * 4 * ((i == height - 1) ? 0 : i + 1);
+	const int lastpix = 4 * ((j == 0) ? width - 1 : j - 1);
+	const int thispix = 4 * j;
+	const int nextpix = 4 * ((j == width - 1) ? 0 : j + 1);
+	const int neighbors[8] = {lastrow + lastpix, thisrow + lastpix, nextrow + lastpix, lastrow + thispix,
+							  nextrow + thispix, lastrow + nextpix, thisrow + nextpix, nextrow + nextpix};
+	byte	 *dest = data + thisrow + thispix;
+	int		  k, b, n = 0, c[3] = {0, 0, 0};
+
+	if (dest[3]) // not transparent
+		return;
+
+	for (k = 0; k < 8; k++)
+	{
+		b = neighbors[k];
+		if (data[b + 3])
+		{
+			c[0] += data[b];
+			c[1] += data[b + 1];
+			c[2] += data[b + 2];
+			n++;
+		}
+	}
+
+	// average all non-transparent neighbors
+	if (n)
+	{
+		dest[0] = (byte)(c[0] / n);
+		dest[1] = (byte)(c[1] / n);
+		dest[2] = (byte)(c[2] / n);
+	}
+}
+
+/*
+===============
+TexMgr_AlphaEdgeFixRows
+
+SIMD version of TexMgr_AlphaEdgeFixPixel for rows [first_row, end_row), four
+pixels at a time away from the wrapping left and right columns. The quotients of
+the float divide truncate to exactly the integer ones, sums are at most 8 * 255.
+===============
+*/
+static void TexMgr_AlphaEdgeFixRows (byte *data, int width, int height, int first_row, int end_row)
+{
+	for (int i = first_row; i < end_row; i++)
+	{
+		int j = 0;
+#if defined(USE_SSE2) || defined(USE_NEON)
+		const byte *lastrow = data + width * 4 * ((i == 0) ? height - 1 : i - 1);
+		byte	   *thisrow = data + width * 4 * i;
+		const byte *nextrow = data + width * 4 * ((i == height - 1) ? 0 : i + 1);
+		if (width > 5)
+		{
+			TexMgr_AlphaEdgeFixPixel (data, width, height, i, 0);
+			for (j = 1; j + 4 < width; j += 4)
+			{
+				const byte *neighbors[8] = {lastrow + (j - 1) * 4, thisrow + (j - 1) * 4, nextrow + (j - 1) * 4, lastrow + j * 4,
+											nextrow + j * 4,	   lastrow + (j + 1) * 4, thisrow + (j + 1) * 4, nextrow + (j + 1) * 4};
+#if defined(USE_SSE2)
+				const __m128i zero = _mm_setzero_si128 ();
+				const __m128i all = _mm_cmpeq_epi32 (zero, zero);
+				const __m128i alpha_mask = _mm_set1_epi32 (0xFF000000);
+				const __m128i pixels = _mm_loadu_si128 ((const __m128i *)(thisrow + j * 4));
+				const __m128i transparent = _mm_cmpeq_epi32 (_mm_and_si128 (pixels, alpha_mask), zero);
+				if (!_mm_movemask_epi8 (transparent))
+					continue;
+
+				__m128i sum_lo = zero, sum_hi = zero, count = zero;
+				for (int k = 0; k < 8; k++)
+				{
+					const __m128i neighbor = _mm_loadu_si128 ((const __m128i *)neighbors[k]);
+					const __m128i opaque = _mm_xor_si128 (_mm_cmpeq_epi32 (_mm_and_si128 (neighbor, alpha_mask), zero), all);
+					const __m128i masked = _mm_and_si128 (neighbor, opaque);
+					sum_lo = _mm_add_epi16 (sum_lo, _mm_unpacklo_epi8 (masked, zero));
+					sum_hi = _mm_add_epi16 (sum_hi, _mm_unpackhi_epi8 (masked, zero));
+					count = _mm_sub_epi32 (count, opaque);
+				}
+
+				const __m128  countf = _mm_cvtepi32_ps (count);
+				const __m128i avg0 = _mm_cvttps_epi32 (_mm_div_ps (_mm_cvtepi32_ps (_mm_unpacklo_epi16 (sum_lo, zero)), _mm_shuffle_ps (countf, countf, 0x00)));
+				const __m128i avg1 = _mm_cvttps_epi32 (_mm_div_ps (_mm_cvtepi32_ps (_mm_unpackhi_epi16 (sum_lo, zero)), _mm_shuffle_ps (countf, countf, 0x55)));
+				const __m128i avg2 = _mm_cvttps_epi32 (_mm_div_ps (_mm_cvtepi32_ps (_mm_unpacklo_epi16 (sum_hi, zero)), _mm_shuffle_ps (countf, countf, 0xAA)));
+				const __m128i avg3 = _mm_cvttps_epi32 (_mm_div_ps (_mm_cvtepi32_ps (_mm_unpackhi_epi16 (sum_hi, zero)), _mm_shuffle_ps (countf, countf, 0xFF)));
+				const __m128i averaged = _mm_packus_epi16 (_mm_packs_epi32 (avg0, avg1), _mm_packs_epi32 (avg2, avg3));
+
+				// only transparent pixels with at least one opaque neighbor change, and keep their alpha
+				const __m128i fix = _mm_andnot_si128 (_mm_cmpeq_epi32 (count, zero), transparent);
+				const __m128i fixed = _mm_or_si128 (_mm_andnot_si128 (alpha_mask, averaged), _mm_and_si128 (pixels, alpha_mask));
+				_mm_storeu_si128 ((__m128i *)(thisrow + j * 4), _mm_or_si128 (_mm_and_si128 (fix, fixed), _mm_andnot_si128 (fix, pixels)));
+#elif defined(USE_NEON)
+				const uint32x4_t zero = vdupq_n_u32 (0);
+				const uint32x4_t alpha_mask = vdupq_n_u32 (0xFF000000);
+				const uint32x4_t pixels = vld1q_u32 ((const uint32_t *)(thisrow + j * 4));
+				const uint32x4_t transparent = vceqq_u32 (vandq_u32 (pixels, alpha_mask), zero);
+				if (!vmaxvq_u32 (transparent))
+					continue;
+
+				uint16x8_t sum_lo = vdupq_n_u16 (0), sum_hi = vdupq_n_u16 (0);
+				uint32x4_t count = zero;
+				for (int k = 0; k < 8; k++)
+				{
+					const uint32x4_t neighbor = vld1q_u32 ((const uint32_t *)neighbors[k]);
+					const uint32x4_t opaque = vtstq_u32 (neighbor, alpha_mask);
+					const uint8x16_t masked = vreinterpretq_u8_u32 (vandq_u32 (neighbor, opaque));
+					sum_lo = vaddw_u8 (sum_lo, vget_low_u8 (masked));
+					sum_hi = vaddw_u8 (sum_hi, vget_high_u8 (masked));
+					count = vsubq_u32 (count, opaque);
+				}
+
+				const float32x4_t countf = vcvtq_f32_u32 (count);
+				const uint32x4_t  avg0 = vcvtq_u32_f32 (vdivq_f32 (vcvtq_f32_u32 (vmovl_u16 (vget_low_u16 (sum_lo))), vdupq_laneq_f32 (countf, 0)));
+				const uint32x4_t  avg1 = vcvtq_u32_f32 (vdivq_f32 (vcvtq_f32_u32 (vmovl_u16 (vget_high_u16 (sum_lo))), vdupq_laneq_f32 (countf, 1)));
+				const uint32x4_t  avg2 = vcvtq_u32_f32 (vdivq_f32 (vcvtq_f32_u32 (vmovl_u16 (vget_low_u16 (sum_hi))), vdupq_laneq_f32 (countf, 2)));
+				const uint32x4_t  avg3 = vcvtq_u32_f32 (vdivq_f32 (vcvtq_f32_u32 (vmovl_u16 (vget_high_u16 (sum_hi))), vdupq_laneq_f32 (countf, 3)));
+				const uint8x16_t  averaged = vcombine_u8 (
+					 vqmovn_u16 (vcombine_u16 (vqmovn_u32 (avg0), vqmovn_u32 (avg1))), vqmovn_u16 (vcombine_u16 (vqmovn_u32 (avg2), vqmovn_u32 (avg3))));
+
+				// only transparent pixels with at least one opaque neighbor change, and keep their alpha
+				const uint32x4_t fix = vbicq_u32 (transparent, vceqq_u32 (count, zero));
+				const uint32x4_t fixed = vbslq_u32 (alpha_mask, pixels, vreinterpretq_u32_u8 (averaged));
+				vst1q_u32 ((uint32_t *)(thisrow + j * 4), vbslq_u32 (fix, fixed, pixels));
+#endif
+			}
+		}
+#endif
+		for (; j < width; j++)
+			TexMgr_AlphaEdgeFixPixel (data, width, height, i, j);
+	}
+}
+
+/*
+===============
+TexMgr_AlphaEdgeFixBandTask
+===============
+*/
+static void TexMgr_AlphaEdgeFixBandTask (int index, void *payload)
+{
+	const texmgr_band_t *band = (const texmgr_band_t *)payload;
+	const int			 first_row = index * TEXMGR_BAND_ROWS;
+	TexMgr_AlphaEdgeFixRows (band->out, band->out_width, band->out_height, first_row, q_min (first_row + TEXMGR_BAND_ROWS, band->out_height));
+}
+
 /*
 ===============
 TexMgr_AlphaEdgeFix
@@ -866,100 +1126,97 @@ operates in place on 32bit data
 */
 static void TexMgr_AlphaEdgeFix (byte *data, int width, int height)
 {
-	int	  i, j, n = 0, b, c[3] = {0, 0, 0}, lastrow, thisrow, nextrow, lastpix, thispix, nextpix;
-	byte *dest = data;
+	if (TexMgr_UseBands (width, height))
+	{
+		const texmgr_band_t band = {data, data, width, height, width, height};
+		const int			num_bands = (height + TEXMGR_BAND_ROWS - 1) / TEXMGR_BAND_ROWS;
+		Task_Join (Task_AllocateAssignIndexedFuncAndSubmit (TexMgr_AlphaEdgeFixBandTask, num_bands, (void *)&band, sizeof (band)), TASK_TIMEOUT_INFINITE);
+	}
+	else
+		TexMgr_AlphaEdgeFixRows (data, width, height, 0, height);
+}
+
+/*
+================
+TexMgr_ImageBench_f
 
-	for (i = 0; i < height; i++)
+imagebench [size] [iterations]: runs alpha edge fixing and mip chain generation on a
+random size x size image with transparent holes, through the SIMD/banded paths and
+the plain scalar/serial ones, and checks that both give the same bytes
+================
+*/
+static void TexMgr_ImageBench_f (void)
+{
+	const int	 size = CLAMP (8, Cmd_Argc () > 1 ? atoi (Cmd_Argv (1)) : 2048, 8192);
+	const int	 iterations = Cmd_Argc () > 2 ? q_max (atoi (Cmd_Argv (2)), 1) : 4;
+	const size_t bytes = (size_t)size * size * 4;
+	byte		*source = (byte *)Mem_AllocNonZero (bytes);
+	byte		*reference = (byte *)Mem_AllocNonZero (bytes);
+	byte		*test = (byte *)Mem_AllocNonZero (bytes);
+	double		 time_reference = 0.0, time_test = 0.0, start;
+	qboolean	 same = true;
+	int			 i, j, w, h;
+
+	for (i = 0; i < size * size; i++)
 	{
-		lastrow = width * 4 * ((i == 0) ? height - 1 : i - 1);
-		thisrow = width * 4 * i;
-		nextrow = width * 4 * ((i == height - 1) ? 0 : i + 1);
+		((unsigned *)source)[i] = COM_Rand () | ((unsigned)COM_Rand () << 16);
+		if ((((i / size) >> 4) + ((i % size) >> 4)) & 1) // checkerboard of 16x16 holes
+			source[i * 4 + 3] = 0;
+	}
 
-		for (j = 0; j < width; j++, dest += 4)
-		{
-			if (dest[3]) // not transparent
-				continue;
+	for (int pass = 0; pass < iterations; pass++)
+	{
+		memcpy (reference, source, bytes);
+		memcpy (test, source, bytes);
 
-			lastpix = 4 * ((j == 0) ? width - 1 : j - 1);
-			thispix = 4 * j;
-			nextpix = 4 * ((j == width - 1) ? 0 : j + 1);
+		start = Sys_DoubleTime ();
+		for (i = 0; i < size; i++)
+			for (j = 0; j < size; j++)
+				TexMgr_AlphaEdgeFixPixel (reference, size, size, i, j);
+		time_reference += Sys_DoubleTime () - start;
 
-			b = lastrow + lastpix;
-			if (data[b + 3])
-			{
-				c[0] += data[b];
-				c[1] += data[b + 1];
-				c[2] += data[b + 2];
-				n++;
-			}
-			b = thisrow + lastpix;
-			if (data[b + 3])
-			{
-				c[0] += data[b];
-				c[1] += data[b + 1];
-				c[2] += data[b + 2];
-				n++;
-			}
-			b = nextrow + lastpix;
-			if (data[b + 3])
-			{
-				c[0] += data[b];
-				c[1] += data[b + 1];
-				c[2] += data[b + 2];
-				n++;
-			}
-			b = lastrow + thispix;
-			if (data[b + 3])
-			{
-				c[0] += data[b];
-				c[1] += data[b + 1];
-				c[2] += data[b + 2];
-				n++;
-			}
-			b = nextrow + thispix;
-			if (data[b + 3])
-			{
-				c[0] += data[b];
-				c[1] += data[b + 1];
-				c[2] += data[b + 2];
-				n++;
-			}
-			b = lastrow + nextpix;
-			if (data[b + 3])
-			{
-				c[0] += data[b];
-				c[1] += data[b + 1];
-				c[2] += data[b + 2];
-				n++;
-			}
-			b = thisrow + nextpix;
-			if (data[b + 3])
-			{
-				c[0] += data[b];
-				c[1] += data[b + 1];
-				c[2] += data[b + 2];
-				n++;
-			}
-			b = nextrow + nextpix;
-			if (data[b + 3])
-			{
-				c[0] += data[b];
-				c[1] += data[b + 1];
-				c[2] += data[b + 2];
-				n++;
-			}
+		start = Sys_DoubleTime ();
+		TexMgr_AlphaEdgeFix (test, size, size);
+		time_test += Sys_DoubleTime () - start;
 
-			// average all non-transparent neighbors
-			if (n)
-			{
-				dest[0] = (byte)(c[0] / n);
-				dest[1] = (byte)(c[1] / n);
-				dest[2] = (byte)(c[2] / n);
+		same = same && !memcmp (reference, test, bytes);
+	}
+	Con_Printf (
+		"alpha edge fix %ix%i: scalar %.2f ms, simd/bands %.2f ms (%.1f Mpixels/s), %s\n", size, size, time_reference * 1000.0 / iterations,
+		time_test * 1000.0 / iterations, (double)size * size * iterations / q_max (time_test, 1e-9) / 1e6, same ? "identical" : "MISMATCH");
 
-				n = c[0] = c[1] = c[2] = 0;
-			}
+	time_reference = time_test = 0.0;
+	same = true;
+	for (int pass = 0; pass < iterations; pass++)
+	{
+		memcpy (reference, source, bytes);
+		memcpy (test, source, bytes);
+
+		for (w = size, h = size; w > 1 && h > 1; w /= 2, h /= 2)
+		{
+			const int mip_bytes = (w / 2) * (h / 2) * 4;
+
+			start = Sys_DoubleTime ();
+			TEMP_ALLOC (byte, mip, mip_bytes);
+			stbir_resize_uint8 (reference, w, h, 0, mip, w / 2, h / 2, 0, 4);
+			memcpy (reference, mip, mip_bytes);
+			TEMP_FREE (mip);
+			time_reference += Sys_DoubleTime () - start;
+
+			start = Sys_DoubleTime ();
+			TexMgr_Downsample ((unsigned *)test, w, h, w / 2, h / 2);
+			time_test += Sys_DoubleTime () - start;
+
+			same = same && !memcmp (reference, test, mip_bytes);
 		}
 	}
+	Con_Printf (
+		"mip chain %ix%i: serial %.2f ms, bands %.2f ms (%.1f Mpixels/s), %s\n", size, size, time_reference * 1000.0 / iterations,
+		time_test * 1000.0 / iterations, (double)size * size * iterations / q_max (time_test, 1e-9) / 1e6, same ? "identical" : "MISMATCH");
+
+	Mem_Free (source);
+	Mem_Free (reference);
+	Mem_Free (test);
 }
 
 /*
@@ -1024,6 +1281,341 @@ static void TexMgr_PreMultiply32 (byte *in, size_t width, size_t height)
 	}
 }
 
+/*
+================================================================================
+
+	PROCESSED TEXTURE CACHE
+
+	Large mipmapped textures (i.e. replacement packs) are stored fully processed
+	in <userdir>/texcache, keyed by a 64 bit hash of their 32bit source data and
+	a hash of the processing parameters, so a warm load skips premultiplication,
+	alpha edge fixing, downsizing and mip generation and uploads the stored chain
+	directly. The cache is shared by all games and mods, so entries also record
+	the source size and a load only uses an entry if that matches as well.
+	index.bin keeps the size and last use of every entry for LRU eviction.
+
+================================================================================
+*/
+
+/*
+================
+TexMgr_CachePath
+================
+*/
+static const char *TexMgr_CachePath (char *path, size_t size, uint64_t source_hash, uint32_t params_hash)
+{
+	if (source_hash || params_hash)
+		q_snprintf (path, size, "%s/texcache/%016" PRIx64 "%08x.tex", host_parms->userdir, source_hash, params_hash);
+	else
+		q_snprintf (path, size, "%s/texcache/index.bin", host_parms->userdir);
+	return path;
+}
+
+/*
+================
+TexMgr_FindCacheEntry
+
+texcache_mutex must be held
+================
+*/
+static texcacheentry_t *TexMgr_FindCacheEntry (uint64_t source_hash, uint32_t params_hash)
+{
+	for (size_t i = 0; i < VEC_SIZE (texcache_entries); ++i)
+		if (texcache_entries[i].source_hash == source_hash && texcache_entries[i].params_hash == params_hash)
+			return &texcache_entries[i];
+	return NULL;
+}
+
+/*
+================
+TexMgr_EvictCache
+
+Deletes the least recently used entries until the cache fits gl_texturecache_mb,
+texcache_mutex must be held
+================
+*/
+static void TexMgr_EvictCache (void)
+{
+	const uint64_t max_size = (uint64_t)q_max (gl_texturecache_mb.value, 0.0f) * 1024 * 1024;
+	char		   path[MAX_OSPATH];
+
+	while (texcache_total_size > max_size && VEC_SIZE (texcache_entries) > 0)
+	{
+		size_t oldest = 0;
+		for (size_t i = 1; i < VEC_SIZE (texcache_entries); ++i)
+			if (texcache_entries[i].last_used < texcache_entries[oldest].last_used)
+				oldest = i;
+
+		texcacheentry_t *entry = &texcache_entries[oldest];
+		remove (TexMgr_CachePath (path, sizeof (path), entry->source_hash, entry->params_hash));
+		texcache_total_size -= entry->size;
+		*entry = texcache_entries[--VEC_HEADER (texcache_entries).size];
+		texcache_dirty = true;
+	}
+}
+
+/*
+================
+TexMgr_UseCacheEntry
+
+Marks an entry as most recently used, adding it to the index if it isn't there yet
+================
+*/
+static void TexMgr_UseCacheEntry (uint64_t source_hash, uint32_t params_hash, uint32_t size)
+{
+	SDL_LockMutex (texcache_mutex);
+	texcacheentry_t *entry = TexMgr_FindCacheEntry (source_hash, params_hash);
+	if (!entry)
+	{
+		const texcacheentry_t new_entry = {source_hash, params_hash, 0, 0, 0};
+		VEC_PUSH (texcache_entries, new_entry);
+		entry = &texcache_entries[VEC_SIZE (texcache_entries) - 1];
+	}
+	texcache_total_size += (int64_t)size - entry->size;
+	entry->size = size;
+	entry->last_used = ++texcache_clock;
+	texcache_dirty = true;
+	TexMgr_EvictCache ();
+	SDL_UnlockMutex (texcache_mutex);
+}
+
+/*
+================
+TexMgr_LoadCacheIndex
+================
+*/
+static void TexMgr_LoadCacheIndex (void)
+{
+	char		path[MAX_OSPATH];
+	uint32_t	header[3] = {0, 0, 0};
+	qfilesize_t entries_size;
+	FILE	   *f;
+
+	q_snprintf (path, sizeof (path), "%s/texcache", host_parms->userdir);
+	Sys_mkdir (path);
+
+	f = Sys_fopen (TexMgr_CachePath (path, sizeof (path), 0, 0), "rb");
+	if (!f)
+		return;
+	// the entry count is only trusted as far as the file can hold the entries
+	entries_size = Sys_filelength (f) - (qfilesize_t)sizeof (header);
+	if (fread (header, sizeof (header), 1, f) != 1)
+		header[0] = 0;
+	if (header[0] == TEXCACHE_MAGIC && header[1] == TEXCACHE_INDEX_VERSION && header[2] <= (uint64_t)q_max (entries_size, 0) / sizeof (texcacheentry_t))
+	{
+		Vec_Grow ((void **)&texcache_entries, sizeof (texcacheentry_t), header[2]);
+		if (fread (texcache_entries, sizeof (texcacheentry_t), header[2], f) == header[2])
+		{
+			VEC_HEADER (texcache_entries).size = header[2];
+			for (uint32_t i = 0; i < header[2]; ++i)
+			{
+				texcache_total_size += texcache_entries[i].size;
+				texcache_clock = q_max (texcache_clock, texcache_entries[i].last_used);
+			}
+		}
+	}
+	else if (header[0] == TEXCACHE_MAGIC && header[1] == 1)
+	{
+		// version 1 was keyed on 32 bit source hashes, drop its files
+		uint32_t old_entry[4];
+		for (uint32_t i = 0; i < header[2] && fread (old_entry, sizeof (old_entry), 1, f) == 1; ++i)
+		{
+			q_snprintf (path, sizeof (path), "%s/texcache/%08x%08x.tex", host_parms->userdir, old_entry[0], old_entry[1]);
+			remove (path);
+		}
+		texcache_dirty = true;
+	}
+	fclose (f);
+}
+
+/*
+================
+TexMgr_ReplaceFile
+
+Moves a fully written temp file over path. rename () replaces the target
+atomically on POSIX but fails on Windows if it exists.
+================
+*/
+static qboolean TexMgr_ReplaceFile (const char *temppath, const char *path)
+{
+	if (rename (temppath, path) == 0)
+		return true;
+	remove (path);
+	if (rename (temppath, path) == 0)
+		return true;
+	remove (temppath);
+	return false;
+}
+
+/*
+================
+TexMgr_SaveCacheIndex
+
+Called on every map load and at shutdown, so a crash loses at most the
+entries written since the last map load. Those .tex files are orphans
+that eviction can't see until they are written again.
+================
+*/
+void TexMgr_SaveCacheIndex (void)
+{
+	char path[MAX_OSPATH];
+	char temppath[MAX_OSPATH];
+	FILE *f;
+
+	if (!texcache_mutex)
+		return;
+	SDL_LockMutex (texcache_mutex);
+	TexMgr_CachePath (path, sizeof (path), 0, 0);
+	q_snprintf (temppath, sizeof (temppath), "%s.tmp", path);
+	if (texcache_dirty && (f = Sys_fopen (temppath, "wb")))
+	{
+		const uint32_t header[3] = {TEXCACHE_MAGIC, TEXCACHE_INDEX_VERSION, (uint32_t)VEC_SIZE (texcache_entries)};
+		const qboolean ok =
+			fwrite (header, sizeof (header), 1, f) == 1 && (!header[2] || fwrite (texcache_entries, sizeof (texcacheentry_t), header[2], f) == header[2]);
+		fclose (f);
+		if (ok && TexMgr_ReplaceFile (temppath, path))
+			texcache_dirty = false;
+		else if (!ok)
+			remove (temppath);
+	}
+	SDL_UnlockMutex (texcache_mutex);
+}
+
+/*
+================
+TexMgr_ReadCachedTexture
+
+Returns a Mem_Alloc'ed mip chain and its level 0 size and flags, or NULL on a miss
+================
+*/
+static byte *TexMgr_ReadCachedTexture (
+	uint64_t source_hash, uint32_t params_hash, uint32_t source_width, uint32_t source_height, uint32_t source_size, texcacheheader_t *header)
+{
+	char  path[MAX_OSPATH];
+	byte *stored = NULL;
+	byte *mips = NULL;
+	FILE *f = Sys_fopen (TexMgr_CachePath (path, sizeof (path), source_hash, params_hash), "rb");
+
+	if (!f)
+		return NULL;
+	if (fread (header, sizeof (*header), 1, f) == 1 && header->magic == TEXCACHE_MAGIC && header->version == TEXCACHE_VERSION &&
+		header->source_hash == source_hash && header->params_hash == params_hash && header->source_width == source_width &&
+		header->source_height == source_height && header->source_size == source_size && header->width && header->height &&
+		header->size == (uint32_t)TexMgr_DeriveStagingSize (header->width, header->height) && header->stored_size <= header->size)
+	{
+		mips = (byte *)Mem_AllocNonZero (header->size);
+		stored = (header->stored_size == header->size) ? mips : (byte *)Mem_AllocNonZero (header->stored_size);
+		if (fread (stored, header->stored_size, 1, f) != 1 || (stored != mips && !COM_Inflate (stored, header->stored_size, mips, header->size)))
+		{
+			Mem_Free (mips);
+			mips = NULL;
+		}
+		if (stored != mips)
+			Mem_Free (stored);
+	}
+	fclose (f);
+
+	if (mips)
+		TexMgr_UseCacheEntry (source_hash, params_hash, sizeof (*header) + header->stored_size);
+	return mips;
+}
+
+/*
+================
+TexMgr_WriteCachedTexture
+
+Parallel loads may write the same entry at once, so each write goes to its
+own temp file that is only renamed into place once it is complete
+================
+*/
+static void TexMgr_WriteCachedTexture (
+	uint64_t source_hash, uint32_t params_hash, uint32_t source_width, uint32_t source_height, uint32_t source_size, gltexture_t *glt, const byte *mips, int size)
+{
+	char			 path[MAX_OSPATH];
+	char			 temppath[MAX_OSPATH];
+	size_t			 compressed_size;
+	byte			*compressed = COM_Deflate (mips, size, &compressed_size);
+	texcacheheader_t header;
+	FILE			*f;
+
+	// only worth inflating on load if it saves a good part of the read
+	if (compressed && compressed_size > (size_t)size / 4 * 3)
+	{
+		Mem_Free (compressed);
+		compressed = NULL;
+	}
+
+	memset (&header, 0, sizeof (header));
+	header.magic = TEXCACHE_MAGIC;
+	header.version = TEXCACHE_VERSION;
+	header.source_hash = source_hash;
+	header.params_hash = params_hash;
+	header.source_width = source_width;
+	header.source_height = source_height;
+	header.source_size = source_size;
+	header.width = glt->width;
+	header.height = glt->height;
+	header.flags = glt->flags;
+	header.size = size;
+	header.stored_size = compressed ? (uint32_t)compressed_size : (uint32_t)size;
+
+	TexMgr_CachePath (path, sizeof (path), source_hash, params_hash);
+	q_snprintf (temppath, sizeof (temppath), "%s.%u.tmp", path, Atomic_IncrementUInt32 (&texcache_temp_counter));
+	f = Sys_fopen (temppath, "wb");
+	if (f)
+	{
+		const qboolean ok = fwrite (&header, sizeof (header), 1, f) == 1 && fwrite (compressed ? compressed : mips, header.stored_size, 1, f) == 1;
+		fclose (f);
+		if (ok && TexMgr_ReplaceFile (temppath, path))
+			TexMgr_UseCacheEntry (source_hash, params_hash, sizeof (header) + header.stored_size);
+		else if (!ok)
+			remove (temppath);
+	}
+	Mem_Free (compressed);
+}
+
+/*
+================
+TexMgr_TextureCache_f
+================
+*/
+static void TexMgr_TextureCache_f (void)
+{
+	char path[MAX_OSPATH];
+
+	if (Cmd_Argc () > 1 && !strcmp (Cmd_Argv (1), "clear"))
+	{
+		SDL_LockMutex (texcache_mutex);
+		for (size_t i = 0; i < VEC_SIZE (texcache_entries); ++i)
+			remove (TexMgr_CachePath (path, sizeof (path), texcache_entries[i].source_hash, texcache_entries[i].params_hash));
+		VEC_CLEAR (texcache_entries);
+		texcache_total_size = 0;
+		texcache_dirty = true;
+		SDL_UnlockMutex (texcache_mutex);
+		TexMgr_SaveCacheIndex ();
+	}
+	else if (Cmd_Argc () > 1 && !strcmp (Cmd_Argv (1), "resetstats"))
+	{
+		texcache_hits = texcache_misses = 0;
+		texcache_load_time = 0.0;
+		return;
+	}
+
+	Con_Printf (
+		"%i cached textures, %.1f MB of %g MB\n%i hits, %i misses, %.1f ms loading cacheable textures\n", (int)VEC_SIZE (texcache_entries),
+		texcache_total_size / (1024.0 * 1024.0), gl_texturecache_mb.value, texcache_hits, texcache_misses, texcache_load_time * 1000.0);
+}
+
+/*
+================
+TexMgr_Shutdown
+================
+*/
+void TexMgr_Shutdown (void)
+{
+	TexMgr_SaveCacheIndex ();
+}
+
 /*
 ================
 TexMgr_LoadImage32 -- handles 32bit source data
@@ -1033,10 +1625,6 @@ static void TexMgr_LoadImage32 (gltexture_t *glt, unsigned *data)
 {
 	GL_DeleteTexture (glt);
 
-	// do this before any rescaling
-	if (glt->flags & TEXPREF_PREMULTIPLY)
-		TexMgr_PreMultiply32 ((byte *)data, glt->width, glt->height);
-
 	// mipmap down
 	int picmip = (glt->flags & TEXPREF_NOPICMIP) ? 0 : q_max ((int)gl_picmip.value, 0);
 	int mipwidth = q_max (glt->width >> picmip, 1);
@@ -1059,8 +1647,38 @@ static void TexMgr_LoadImage32 (gltexture_t *glt, unsigned *data)
 			mipheight = maxsize;
 		}
 	}
+
+	const qboolean cacheable = gl_texturecache.value && data && (glt->flags & TEXPREF_MIPMAP) && !(glt->flags & TEXPREF_WARPIMAGE) && !is_cube &&
+							   glt->source_format != SRC_SURF_INDICES && glt->width * glt->height >= TEXCACHE_MIN_PIXELS;
+	const double	 cache_start_time = cacheable ? Sys_DoubleTime () : 0.0;
+	const uint32_t	 source_width = glt->width, source_height = glt->height, source_size = glt->width * glt->height * 4;
+	uint64_t		 source_hash = 0;
+	uint32_t		 params_hash = 0;
+	byte			*cached_mips = NULL;
+	qboolean		 cache_hit = false;
+	if (cacheable)
+	{
+		const uint32_t params[6] = {glt->width, glt->height, mipwidth, mipheight, glt->flags, TEXCACHE_VERSION};
+		source_hash = COM_HashBlock64 (data, source_size);
+		params_hash = COM_HashBlock (params, sizeof (params));
+
+		texcacheheader_t header;
+		cached_mips = TexMgr_ReadCachedTexture (source_hash, params_hash, source_width, source_height, source_size, &header);
+		if (cached_mips)
+		{
+			cache_hit = true;
+			glt->width = mipwidth = header.width;
+			glt->height = mipheight = header.height;
+			glt->flags = header.flags;
+		}
+	}
+
+	// do this before any rescaling
+	if (!cached_mips && (glt->flags & TEXPREF_PREMULTIPLY))
+		TexMgr_PreMultiply32 ((byte *)data, glt->width, glt->height);
+
 	// has alpha detection :
-	if (data && glt->source_format == SRC_RGBA && !(glt->flags & TEXPREF_ALPHAPIXELS))
+	if (!cached_mips && data && glt->source_format == SRC_RGBA && !(glt->flags & TEXPREF_ALPHAPIXELS))
 	{
 		int	  num_pixels = glt->width * glt->height;
 		byte *pixel_data = (byte *)data;
@@ -1077,7 +1695,7 @@ static void TexMgr_LoadImage32 (gltexture_t *glt, unsigned *data)
 	}
 	// downsizing according to gl_picmip / gl_max_size: (debug only)
 	// don't attempt to downsize below 1x1
-	if (((int)glt->width != mipwidth || (int)glt->height != mipheight) && (mipwidth >= 1) && (mipheight >= 1))
+	if (!cached_mips && ((int)glt->width != mipwidth || (int)glt->height != mipheight) && (mipwidth >= 1) && (mipheight >= 1))
 	{
 		if (is_cube)
 			for (int i = 0; i < 6; i++)
@@ -1324,15 +1942,19 @@ static void TexMgr_LoadImage32 (gltexture_t *glt, unsigned *data)
 	vkCmdPipelineBarrier (command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &image_memory_barrier);
 
 	R_StagingBeginCopy ();
-	if (glt->flags & TEXPREF_MIPMAP)
+	if (cached_mips)
+		memcpy (staging_memory, cached_mips, staging_size);
+	else if (glt->flags & TEXPREF_MIPMAP)
 	{
-		int mip_offset = 0;
+		// build the chain in regular memory if it goes to the cache, staging memory is slow to read back
+		byte *mips = cacheable ? (byte *)Mem_AllocNonZero (staging_size) : staging_memory;
+		int	  mip_offset = 0;
 		mipwidth = glt->width;
 		mipheight = glt->height;
 
 		while (mipwidth >= 1 && mipheight >= 1)
 		{
-			memcpy (staging_memory + mip_offset, data, mipwidth * mipheight * 4);
+			memcpy (mips + mip_offset, data, mipwidth * mipheight * 4);
 
 			mip_offset += mipwidth * mipheight * 4;
 			num_regions += 1;
@@ -1343,6 +1965,12 @@ static void TexMgr_LoadImage32 (gltexture_t *glt, unsigned *data)
 			mipwidth /= 2;
 			mipheight /= 2;
 		}
+
+		if (cacheable)
+		{
+			memcpy (staging_memory, mips, staging_size);
+			cached_mips = mips;
+		}
 	}
 	else if (is_cube)
 	{
@@ -1360,6 +1988,21 @@ static void TexMgr_LoadImage32 (gltexture_t *glt, unsigned *data)
 				*(unsigned *)staging_memory = p[0] | p[1] << 10 | p[2] << 20;
 	}
 	R_StagingEndCopy ();
+
+	if (cacheable)
+	{
+		if (!cache_hit)
+			TexMgr_WriteCachedTexture (source_hash, params_hash, source_width, source_height, source_size, glt, cached_mips, staging_size);
+		Mem_Free (cached_mips);
+
+		SDL_LockMutex (texcache_mutex);
+		if (cache_hit)
+			++texcache_hits;
+		else
+			++texcache_misses;
+		texcache_load_time += Sys_DoubleTime () - cache_start_time;
+		SDL_UnlockMutex (texcache_mutex);
+	}
 }
 
 /*
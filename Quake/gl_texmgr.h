@@ -113,6 +113,8 @@ void		 TexMgr_FreeTextures (unsigned int flags, unsigned int mask);
 void		 TexMgr_FreeTexturesForOwner (qmodel_t *owner);
 void		 TexMgr_NewGame (void);
 void		 TexMgr_Init (void);
+void		 TexMgr_Shutdown (void);
+void		 TexMgr_SaveCacheIndex (void);
 void		 TexMgr_DeleteTextureObjects (void);
 void		 TexMgr_CollectGarbage (void);
 void		 TexMgr_LoadPalette (void);
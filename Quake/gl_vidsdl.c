@@ -4740,6 +4740,7 @@ void VID_Init (void)
 	R_InitMeshHeap ();
 	TexMgr_InitHeap ();
 	R_InitSamplers ();
+	R_InitPipelineCache ();
 	R_CreatePipelineLayouts ();
 	R_CreatePaletteOctreeBuffers (palette_octree_colors, NUM_PALETTE_OCTREE_COLORS, palette_octree_nodes, NUM_PALETTE_OCTREE_NODES);
 	// GL_CreateRenderResources ();
@@ -86,7 +86,8 @@ typedef enum
 	pt_explode,
 	pt_explode2,
 	pt_blob,
-	pt_blob2
+	pt_blob2,
+	NUM_PARTICLE_TYPES
 } ptype_t;
 
 // !!! if this is changed, it must be changed in d_ifacea.h too !!!
@@ -96,7 +97,6 @@ typedef struct particle_s
 	vec3_t			   org;
 	float			   color;
 	// drivers never touch the following fields
-	struct particle_s *next;
 	vec3_t			   vel;
 	float			   ramp;
 	float			   die;
@@ -364,6 +364,7 @@ typedef struct
 	VkPhysicalDeviceProperties		 device_properties;
 	VkPhysicalDeviceFeatures		 device_features;
 	VkPhysicalDeviceMemoryProperties memory_properties;
+	VkPipelineCache					 pipeline_cache;
 	uint32_t						 gfx_queue_family_index;
 	VkFormat						 color_format;
 	VkFormat						 depth_format;
@@ -832,6 +833,7 @@ void R_CreateDescriptorPool ();
 void R_CreateDescriptorSetLayouts ();
 void R_InitSamplers ();
 void R_CreatePipelineLayouts ();
+void R_InitPipelineCache (void);
 void R_CreatePipelines ();
 void R_DestroyPipelines ();
 
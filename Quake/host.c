@@ -89,6 +89,7 @@ cvar_t pausable = {"pausable", "1", CVAR_NONE};
 
 cvar_t autoload = {"autoload", "1", CVAR_ARCHIVE_GAME};
 cvar_t autofastload = {"autofastload", "0", CVAR_ARCHIVE_GAME};
+cvar_t savebinary = {"savebinary", "0", CVAR_ARCHIVE};
 
 cvar_t developer = {"developer", "0", CVAR_NONE};
 cvar_t map_checks = {"map_checks", "0", CVAR_NONE};
@@ -102,6 +103,8 @@ cvar_t campaign = {"campaign", "0", CVAR_NONE};	  // for the 2021 rerelease
 cvar_t horde = {"horde", "0", CVAR_NONE};		  // for the 2021 rerelease
 cvar_t sv_cheats = {"sv_cheats", "0", CVAR_NONE}; // for the 2021 rerelease
 
+sv_tickcost_t sv_tickcost;
+
 devstats_t		dev_stats, dev_peakstats;
 overflowtimes_t dev_overflows; // this stores the last time overflow messages were displayed, not the last time overflows occured
 
@@ -277,6 +280,23 @@ void Host_Error (const char *error, ...)
 	longjmp (host_abortserver, 1);
 }
 
+/*
+================
+Host_BenchAllowed
+
+The bench commands that spawn edicts, write saves, touch the VM strings or
+move the clocks only run with -bench (or -benchserver), so they can't be
+fired into a game that matters by a bind or a config
+================
+*/
+qboolean Host_BenchAllowed (void)
+{
+	if (COM_CheckParm ("-bench") || COM_CheckParm ("-benchserver"))
+		return true;
+	Con_Printf ("%s changes the running game, start with -bench to use it\n", Cmd_Argv (0));
+	return false;
+}
+
 /*
 ================
 Host_FindMaxClients
@@ -355,6 +375,9 @@ Host_InitLocal
 void Host_InitLocal (void)
 {
 	Cmd_AddCommand ("version", Host_Version_f);
+#ifdef USE_TASK_TRACE
+	Cmd_AddCommand ("tasks_trace", Tasks_Trace_f);
+#endif
 
 	Host_InitCommands ();
 
@@ -399,6 +422,7 @@ void Host_InitLocal (void)
 
 	Cvar_RegisterVariable (&autoload);
 	Cvar_RegisterVariable (&autofastload);
+	Cvar_RegisterVariable (&savebinary);
 
 	Cvar_RegisterVariable (&temp1);
 
@@ -607,6 +631,10 @@ void Host_ShutdownServer (qboolean crash)
 
 	sv.active = false;
 
+	// a Host_Error in SV_SendClientMessages leaves the send batch open, put
+	// what it holds on the wire so the disconnects below aren't queued behind it
+	NET_FlushSendBatch ();
+
 	// stop all client sounds immediately
 	if (cls.state == ca_connected)
 		CL_Disconnect ();
@@ -781,10 +809,13 @@ void Host_ServerFrame (void)
 	int			  i, active; // johnfitz
 	edict_t		 *ent;		 // johnfitz
 	double		  t0 = 0, t1 = 0, t2 = 0, t3 = 0, t4 = 0;
-	static double clients_ms, physics_ms, stats_ms, send_ms, interval_start;
+	static double clients_ms, physics_ms, stats_ms, send_ms, entities_ms, interval_start;
 	static int	  ticks;
 
-	if (sv_speeds.value)
+	sv_tickcost.enabled = sv_speeds.value || SV_Bench_Active ();
+	sv_tickcost.entities_ms = 0;
+
+	if (sv_tickcost.enabled)
 		t0 = Sys_DoubleTime ();
 
 	// run the world state
@@ -799,7 +830,7 @@ void Host_ServerFrame (void)
 	// read client messages
 	SV_RunClients ();
 
-	if (sv_speeds.value)
+	if (sv_tickcost.enabled)
 		t1 = Sys_DoubleTime ();
 
 	// move things around and think
@@ -807,7 +838,7 @@ void Host_ServerFrame (void)
 	if (!sv.paused && (svs.maxclients > 1 || key_dest == key_game))
 		SV_Physics ();
 
-	if (sv_speeds.value)
+	if (sv_tickcost.enabled)
 		t2 = Sys_DoubleTime ();
 
 	// johnfitz -- devstats
@@ -827,7 +858,7 @@ void Host_ServerFrame (void)
 	}
 	// johnfitz
 
-	if (sv_speeds.value)
+	if (sv_tickcost.enabled)
 		t3 = Sys_DoubleTime ();
 
 	// send all messages to the clients
@@ -836,10 +867,18 @@ void Host_ServerFrame (void)
 	extern double sv_speeds_think_ms, sv_speeds_pusher_ms, sv_speeds_build_ms;
 	extern int	  sv_speeds_thinks, sv_speeds_pushers, sv_speeds_pushables, sv_speeds_grid_entries;
 
+	if (sv_tickcost.enabled)
+	{
+		t4 = Sys_DoubleTime ();
+		sv_tickcost.clients_ms = (t1 - t0) * 1000.0;
+		sv_tickcost.physics_ms = (t2 - t1) * 1000.0;
+		sv_tickcost.send_ms = (t4 - t3) * 1000.0;
+	}
+
 	if (!sv_speeds.value && interval_start != 0)
 	{
 		// reset on toggle so a later enable doesn't average across the gap
-		clients_ms = physics_ms = stats_ms = send_ms = 0;
+		clients_ms = physics_ms = stats_ms = send_ms = entities_ms = 0;
 		sv_speeds_think_ms = sv_speeds_pusher_ms = sv_speeds_build_ms = 0;
 		sv_speeds_thinks = sv_speeds_pushers = sv_speeds_pushables = sv_speeds_grid_entries = 0;
 		ticks = 0;
@@ -848,11 +887,11 @@ void Host_ServerFrame (void)
 
 	if (sv_speeds.value)
 	{
-		t4 = Sys_DoubleTime ();
 		clients_ms += (t1 - t0) * 1000.0;
 		physics_ms += (t2 - t1) * 1000.0;
 		stats_ms += (t3 - t2) * 1000.0;
 		send_ms += (t4 - t3) * 1000.0;
+		entities_ms += sv_tickcost.entities_ms;
 		ticks++;
 		if (interval_start == 0)
 			interval_start = t0;
@@ -864,11 +903,11 @@ void Host_ServerFrame (void)
 			double build = sv_speeds_build_ms / ticks;
 			Con_Printf (
 				"sv_speeds: %3d ticks | clients %.3f | physics %.3f [pushers %.3f (%.0f) thinks %.3f (%.0f) build %.3f loop %.3f] | stats %.3f | send %.3f "
-				"ms/tick | %d edicts, %.0f pushables, %.0f grid entries\n",
+				"[entities %.3f] ms/tick | %d edicts, %.0f pushables, %.0f grid entries\n",
 				ticks, clients_ms / ticks, physics, pushers, (double)sv_speeds_pushers / ticks, thinks, (double)sv_speeds_thinks / ticks, build,
-				physics - pushers - thinks - build, stats_ms / ticks, send_ms / ticks, qcvm->num_edicts, (double)sv_speeds_pushables / ticks,
-				(double)sv_speeds_grid_entries / ticks);
-			clients_ms = physics_ms = stats_ms = send_ms = 0;
+				physics - pushers - thinks - build, stats_ms / ticks, send_ms / ticks, entities_ms / ticks, qcvm->num_edicts,
+				(double)sv_speeds_pushables / ticks, (double)sv_speeds_grid_entries / ticks);
+			clients_ms = physics_ms = stats_ms = send_ms = entities_ms = 0;
 			sv_speeds_think_ms = sv_speeds_pusher_ms = sv_speeds_build_ms = 0;
 			sv_speeds_thinks = sv_speeds_pushers = sv_speeds_pushables = sv_speeds_grid_entries = 0;
 			ticks = 0;
@@ -1037,6 +1076,8 @@ static void _Host_Frame (double time)
 	if (!Host_FilterTime (time))
 		return; // don't run too fast, or packets will flood out
 
+	Tasks_TraceFrame ();
+
 	if (host_speeds.value)
 		time3 = Sys_DoubleTime ();
 
@@ -1060,6 +1101,8 @@ static void _Host_Frame (double time)
 	// process console commands
 	Cbuf_Execute ();
 
+	Host_FinishSavegame (false);
+
 	NET_Poll ();
 
 	if (cl.sendprespawn)
@@ -1316,7 +1359,7 @@ void Host_Init (void)
 		Cbuf_AddText ("exec autoexec.cfg\n");
 		Cbuf_AddText ("stuffcmds");
 		Cbuf_Execute ();
-		if (!sv.active)
+		if (!sv.active && !COM_CheckParm ("-benchserver")) // the benchmark loads its own map
 			Cbuf_AddText ("map start\n");
 	}
 }
@@ -1346,6 +1389,8 @@ void Host_Shutdown (void)
 
 	Host_WriteConfiguration ();
 
+	Host_FinishSavegame (true);
+
 	NET_Shutdown ();
 
 	if (cls.state != ca_dedicated)
@@ -1357,6 +1402,7 @@ void Host_Shutdown (void)
 		CDAudio_Shutdown ();
 		S_Shutdown ();
 		IN_Shutdown ();
+		TexMgr_Shutdown ();
 		VID_Shutdown ();
 	}
 
@@ -35,6 +35,7 @@ extern cvar_t pausable;
 extern cvar_t nomonsters;
 extern cvar_t autoload;
 extern cvar_t autofastload;
+extern cvar_t savebinary;
 extern cvar_t cl_topcolor;
 extern cvar_t cl_bottomcolor;
 
@@ -1700,15 +1701,535 @@ static void Host_SavegameComment (char text[SAVEGAME_COMMENT_LENGTH + 1])
 
 /*
 ===============
-Host_Savegame_f
+Host_SavegamePath
 ===============
 */
-static void Host_Savegame_f (void)
+static void Host_SavegamePath (char *name, size_t size, const char *savename)
+{
+	if (multiuser)
+	{
+		char *save_path = SDL_GetPrefPath ("vkQuake", COM_GetGameNames (true));
+		q_snprintf (name, size, "%s%s", save_path, savename);
+		SDL_free (save_path);
+	}
+	else
+		q_snprintf (name, size, "%s/%s", com_gamedir, savename);
+	COM_AddExtension (name, ".sav", size);
+}
+
+/*
+===============
+Host_SavegameExtension
+
+Extra info (lightstyles, precaches, etc) in a way that's supposed to be compatible with DP.
+sidenote - this provides extended lightstyles and support for late precaches
+it does NOT protect against spawnfunc precache changes - we would need to include makestatics here too (and optionally baselines, or just recalculate
+those).
+Returns a VEC of '\0' terminated text.
+===============
+*/
+static void Host_ExtensionPrintf (char **ext, const char *fmt, ...) FUNC_PRINTF (2, 3);
+static void Host_ExtensionPrintf (char **ext, const char *fmt, ...)
+{
+	va_list argptr;
+	char	line[1024];
+	int		len;
+
+	va_start (argptr, fmt);
+	len = q_vsnprintf (line, sizeof (line), fmt, argptr);
+	va_end (argptr);
+	Vec_Append ((void **)ext, 1, line, q_min (len, (int)sizeof (line) - 1));
+}
+
+static char *Host_SavegameExtension (void)
+{
+	char *ext = NULL;
+	int	  i;
+
+	Host_ExtensionPrintf (&ext, "// QuakeSpasm extended savegame\n");
+	for (i = MAX_LIGHTSTYLES; i < MAX_LIGHTSTYLES; i++)
+	{
+		if (sv.lightstyles[i])
+			Host_ExtensionPrintf (&ext, "sv.lightstyles %i \"%s\"\n", i, sv.lightstyles[i]);
+	}
+	for (i = 1; i < MAX_MODELS; i++)
+	{
+		if (sv.model_precache[i])
+			Host_ExtensionPrintf (&ext, "sv.model_precache %i \"%s\"\n", i, sv.model_precache[i]);
+	}
+	for (i = 1; i < MAX_SOUNDS; i++)
+	{
+		if (sv.sound_precache[i])
+			Host_ExtensionPrintf (&ext, "sv.sound_precache %i \"%s\"\n", i, sv.sound_precache[i]);
+	}
+	for (i = 1; i < MAX_PARTICLETYPES; i++)
+	{
+		if (sv.particle_precache[i])
+			Host_ExtensionPrintf (&ext, "sv.particle_precache %i \"%s\"\n", i, sv.particle_precache[i]);
+	}
+
+	Host_ExtensionPrintf (&ext, "sv.serverflags %i\n", svs.serverflags);
+	for (i = NUM_BASIC_SPAWN_PARMS; i < NUM_TOTAL_SPAWN_PARMS; i++)
+	{
+		if (svs.clients->spawn_parms[i])
+			Host_ExtensionPrintf (&ext, "spawnparm %i \"%f\"\n", i + 1, svs.clients->spawn_parms[i]);
+	}
+
+	const char *fog_cmd = Fog_GetFogCommand (true);
+	if (fog_cmd)
+		Host_ExtensionPrintf (&ext, "%s", &fog_cmd[1]);
+
+	const char *sky_cmd = Sky_GetSkyCommand (true);
+	if (sky_cmd)
+		Host_ExtensionPrintf (&ext, "%s", &sky_cmd[1]);
+
+	VEC_PUSH (ext, '\0');
+	return ext;
+}
+
+/*
+===============
+Host_WriteSavegameText
+===============
+*/
+static qboolean Host_WriteSavegameText (const char *name)
 {
-	char  name[MAX_OSPATH];
 	FILE *f;
 	int	  i;
 	char  comment[SAVEGAME_COMMENT_LENGTH + 1];
+	char *ext;
+
+	f = Sys_fopen (name, "w");
+	if (!f)
+	{
+		Con_Printf ("ERROR: couldn't open.\n");
+		return false;
+	}
+
+	fprintf (f, "%i\n", SAVEGAME_VERSION);
+	Host_SavegameComment (comment);
+	fprintf (f, "%s\n", comment);
+	for (i = 0; i < NUM_BASIC_SPAWN_PARMS; i++)
+		fprintf (f, "%f\n", svs.clients->spawn_parms[i]);
+	fprintf (f, "%d\n", current_skill);
+	fprintf (f, "%s\n", sv.name);
+	fprintf (f, "%f\n", qcvm->time);
+
+	// write the light styles
+	for (i = 0; i < MAX_LIGHTSTYLES; i++)
+	{
+		if (sv.lightstyles[i])
+			fprintf (f, "%s\n", sv.lightstyles[i]);
+		else
+			fprintf (f, "m\n");
+	}
+
+	ED_WriteGlobals (f);
+	for (i = 0; i < qcvm->num_edicts; i++)
+	{
+		ED_Write (f, EDICT_NUM (i));
+	}
+
+	ext = Host_SavegameExtension ();
+	fprintf (f, "/*\n%s*/\n", ext);
+	VEC_FREE (ext);
+
+	fclose (f);
+	return true;
+}
+
+/*
+===============================================================================
+
+BINARY SAVEGAMES
+
+The binary format keeps the two text lines the save menu reads, followed by a
+deflated snapshot: every edict's field block as is, with strings moved to a
+table and entity references turned into edict numbers, so loading is mostly a
+copy. It is only readable with the progs.dat that made it.
+
+===============================================================================
+*/
+
+#define SAVEGAME_BINARY_VERSION 100
+#define SAVEGAME_BINARY_MAGIC	(('B' << 24) | ('V' << 16) | ('S' << 8) | 'Q')
+
+typedef struct
+{
+	int magic;
+	int size;			// of the snapshot
+	int compressedsize; // same as size when it is stored
+} savefileheader_t;
+
+typedef struct
+{
+	int	   progscrc;
+	int	   entityfields;
+	int	   numglobals; // ints of DEF_SAVEGLOBAL globals
+	int	   num_edicts;
+	int	   skill;
+	int	   extension; // string reference to the extended savegame text
+	int	   stringsofs;
+	int	   numstrings;
+	double time;
+	float  spawn_parms[NUM_BASIC_SPAWN_PARMS];
+	int	   lightstyles[MAX_LIGHTSTYLES]; // string references
+	char   mapname[64];
+} savegameheader_t;
+
+// each edict is a saveedict_t, followed by entityfields ints unless it is free
+typedef struct
+{
+	byte free;
+	byte alpha;
+	byte pad[2];
+} saveedict_t;
+
+typedef struct
+{
+	string_t num;
+	int		 ref;
+} savestring_t;
+
+typedef struct
+{
+	byte		 *data;	   // VEC
+	char		 *strings; // VEC of '\0' terminated strings
+	int			 *offsets; // VEC, start of each string
+	savestring_t *hash;
+	int			  hashsize, hashused;
+} savewriter_t;
+
+typedef struct
+{
+	char			name[MAX_OSPATH];
+	char			preamble[64 + SAVEGAME_COMMENT_LENGTH]; // the two text lines
+	byte		   *data;								  // VEC, the snapshot
+	FILE		   *f;
+	qboolean		ok;
+	atomic_uint32_t done;
+	task_handle_t	task;
+} savejob_t;
+
+static savejob_t *savegame_job;
+static int		 *savegame_stringfields;
+static int		 *savegame_entityfields;
+static string_t	 *savegame_loadedstrings;
+
+/*
+===============
+Host_SavegameFields
+
+Lists the offsets of the string and entity fields, which can't be copied as is
+===============
+*/
+static void Host_SavegameFields (void)
+{
+	const int entityfields = qcvm->progs->entityfields;
+	byte	 *kinds = (byte *)Mem_Alloc (entityfields);
+	int		  i;
+
+	for (i = 1; i < qcvm->progs->numfielddefs; i++)
+	{
+		ddef_t *d = &qcvm->fielddefs[i];
+		int		type = d->type & ~DEF_SAVEGLOBAL;
+		byte	kind = (type == ev_string) ? 1 : (type == ev_entity) ? 2 : 0;
+
+		if (d->ofs >= entityfields || !kind)
+			continue;
+		// a field aliased with two meanings stays raw
+		kinds[d->ofs] = (kinds[d->ofs] && kinds[d->ofs] != kind) ? 3 : kind;
+	}
+
+	VEC_CLEAR (savegame_stringfields);
+	VEC_CLEAR (savegame_entityfields);
+	for (i = 0; i < entityfields; i++)
+	{
+		if (kinds[i] == 1)
+			VEC_PUSH (savegame_stringfields, i);
+		else if (kinds[i] == 2)
+			VEC_PUSH (savegame_entityfields, i);
+	}
+	Mem_Free (kinds);
+}
+
+/*
+===============
+Host_SaveGlobalType
+
+Returns the type of a global the savegames keep, or -1
+===============
+*/
+static int Host_SaveGlobalType (const ddef_t *def)
+{
+	int type = def->type;
+
+	if (!(type & DEF_SAVEGLOBAL))
+		return -1;
+	type &= ~DEF_SAVEGLOBAL;
+	if (type != ev_string && type != ev_float && type != ev_ext_double && type != ev_ext_integer && type != ev_ext_uint32 && type != ev_ext_sint64 &&
+		type != ev_ext_uint64 && type != ev_entity)
+		return -1;
+	return type;
+}
+
+/*
+===============
+Host_SaveString
+
+Adds s to the string table and returns its reference, -1 - index
+===============
+*/
+static int Host_SaveString (savewriter_t *w, const char *s)
+{
+	const int index = VEC_SIZE (w->offsets);
+
+	VEC_PUSH (w->offsets, (int)VEC_SIZE (w->strings));
+	Vec_Append ((void **)&w->strings, 1, s, strlen (s) + 1);
+	return -1 - index;
+}
+
+/*
+===============
+Host_SaveStringNum
+
+References to the same string_t share one table entry, so they are still
+shared after loading
+===============
+*/
+static int Host_SaveStringNum (savewriter_t *w, string_t num)
+{
+	unsigned int i, mask;
+
+	if (!num || (num > 0 && num < qcvm->stringssize))
+		return num; // in the progs string table, which doesn't move
+
+	if (w->hashused * 2 >= w->hashsize)
+	{
+		savestring_t *old = w->hash;
+		const int	  oldsize = w->hashsize;
+
+		w->hashsize = q_max (w->hashsize * 2, 1024);
+		w->hash = (savestring_t *)Mem_Alloc (w->hashsize * sizeof (savestring_t));
+		mask = w->hashsize - 1;
+		for (int j = 0; j < oldsize; j++)
+		{
+			if (!old[j].ref)
+				continue;
+			for (i = ((unsigned int)old[j].num * 2654435761u) & mask; w->hash[i].ref; i = (i + 1) & mask)
+				;
+			w->hash[i] = old[j];
+		}
+		Mem_Free (old);
+	}
+
+	mask = w->hashsize - 1;
+	for (i = ((unsigned int)num * 2654435761u) & mask; w->hash[i].ref; i = (i + 1) & mask)
+	{
+		if (w->hash[i].num == num)
+			return w->hash[i].ref;
+	}
+	w->hash[i].num = num;
+	w->hash[i].ref = Host_SaveString (w, PR_GetString (num));
+	w->hashused++;
+	return w->hash[i].ref;
+}
+
+/*
+===============
+Host_SaveFields
+
+Appends an edict's field block, with the string and entity fields translated
+===============
+*/
+static void Host_SaveFields (savewriter_t *w, const int *values, int count, const int *strings, const int *entities)
+{
+	int *out;
+	int	 i;
+
+	Vec_Grow ((void **)&w->data, 1, count * sizeof (int));
+	out = (int *)(w->data + VEC_SIZE (w->data));
+	memcpy (out, values, count * sizeof (int));
+	VEC_HEADER (w->data).size += count * sizeof (int);
+
+	for (i = 0; i < (int)VEC_SIZE (strings); i++)
+		out[strings[i]] = Host_SaveStringNum (w, out[strings[i]]);
+	for (i = 0; i < (int)VEC_SIZE (entities); i++)
+		out[entities[i]] /= qcvm->edict_size;
+}
+
+/*
+===============
+Host_WriteSavegameTask
+===============
+*/
+static void Host_WriteSavegameTask (void *payload)
+{
+	savejob_t		*job = *(savejob_t **)payload;
+	savefileheader_t header;
+	size_t			 compressedsize;
+	byte			*snapshot = job->data;
+	byte			*compressed;
+
+	header.magic = SAVEGAME_BINARY_MAGIC;
+	header.size = VEC_SIZE (job->data);
+	compressed = COM_Deflate (snapshot, header.size, &compressedsize);
+	if (compressed && compressedsize < (size_t)header.size)
+	{
+		header.compressedsize = (int)compressedsize;
+		snapshot = compressed;
+	}
+	else
+		header.compressedsize = header.size;
+
+	job->ok = fwrite (job->preamble, strlen (job->preamble), 1, job->f) == 1;
+	job->ok = job->ok && fwrite (&header, sizeof (header), 1, job->f) == 1;
+	job->ok = job->ok && fwrite (snapshot, header.compressedsize, 1, job->f) == 1;
+	job->ok = (fclose (job->f) == 0) && job->ok;
+
+	Mem_Free (compressed);
+	Atomic_StoreUInt32 (&job->done, 1);
+}
+
+/*
+===============
+Host_FinishSavegame
+
+Reports a binary save once the worker has written it. Only waits for it when
+asked to, so saving doesn't hold up the frame.
+===============
+*/
+void Host_FinishSavegame (qboolean wait)
+{
+	savejob_t *job = savegame_job;
+
+	if (!job || (!wait && !Atomic_LoadUInt32 (&job->done)))
+		return;
+
+	Task_Join (job->task, TASK_TIMEOUT_INFINITE);
+	savegame_job = NULL;
+	if (job->ok)
+		Con_Printf ("done.\n");
+	else
+		Con_Printf ("ERROR: couldn't write %s.\n", job->name);
+	VEC_FREE (job->data);
+	Mem_Free (job);
+	SaveList_Rebuild ();
+}
+
+/*
+===============
+Host_WriteSavegameBinary
+
+Copies the state on the main thread, the compression and the file writing
+happen on a worker
+===============
+*/
+static qboolean Host_WriteSavegameBinary (const char *name)
+{
+	savewriter_t	 w;
+	savegameheader_t header;
+	savejob_t		*job;
+	char			 comment[SAVEGAME_COMMENT_LENGTH + 1];
+	char			*ext;
+	FILE			*f;
+	int				 i;
+
+	f = Sys_fopen (name, "wb");
+	if (!f)
+	{
+		Con_Printf ("ERROR: couldn't open.\n");
+		return false;
+	}
+
+	memset (&w, 0, sizeof (w));
+	memset (&header, 0, sizeof (header));
+	Vec_Grow ((void **)&w.data, 1, sizeof (header)); // filled in at the end
+	VEC_HEADER (w.data).size += sizeof (header);
+
+	header.progscrc = qcvm->progscrc;
+	header.entityfields = qcvm->progs->entityfields;
+	header.num_edicts = qcvm->num_edicts;
+	header.skill = current_skill;
+	header.time = qcvm->time;
+	for (i = 0; i < NUM_BASIC_SPAWN_PARMS; i++)
+		header.spawn_parms[i] = svs.clients->spawn_parms[i];
+	for (i = 0; i < MAX_LIGHTSTYLES; i++)
+		header.lightstyles[i] = sv.lightstyles[i] ? Host_SaveString (&w, sv.lightstyles[i]) : 0;
+	q_strlcpy (header.mapname, sv.name, sizeof (header.mapname));
+
+	Host_SavegameFields ();
+
+	for (i = 0; i < qcvm->progs->numglobaldefs; i++)
+	{
+		const ddef_t *def = &qcvm->globaldefs[i];
+		const int	  type = Host_SaveGlobalType (def);
+		int			  value;
+
+		if (type == ev_string || type == ev_entity)
+		{
+			value = ((int *)qcvm->globals)[def->ofs];
+			value = (type == ev_string) ? Host_SaveStringNum (&w, value) : value / qcvm->edict_size;
+			Vec_Append ((void **)&w.data, 1, &value, sizeof (value));
+			header.numglobals++;
+		}
+		else if (type >= 0)
+		{
+			Vec_Append ((void **)&w.data, 1, &qcvm->globals[def->ofs], type_size[type] * sizeof (int));
+			header.numglobals += type_size[type];
+		}
+	}
+
+	for (i = 0; i < qcvm->num_edicts; i++)
+	{
+		edict_t		*ed = EDICT_NUM (i);
+		saveedict_t *record;
+
+		Vec_Grow ((void **)&w.data, 1, sizeof (saveedict_t));
+		record = (saveedict_t *)(w.data + VEC_SIZE (w.data));
+		memset (record, 0, sizeof (*record));
+		record->free = ed->free;
+		record->alpha = ed->alpha;
+		VEC_HEADER (w.data).size += sizeof (saveedict_t);
+		if (!ed->free)
+			Host_SaveFields (&w, (int *)&ed->v, header.entityfields, savegame_stringfields, savegame_entityfields);
+	}
+
+	ext = Host_SavegameExtension ();
+	header.extension = Host_SaveString (&w, ext);
+	VEC_FREE (ext);
+
+	header.numstrings = VEC_SIZE (w.offsets);
+	header.stringsofs = VEC_SIZE (w.data);
+	Vec_Append ((void **)&w.data, 1, w.offsets, header.numstrings * sizeof (int));
+	Vec_Append ((void **)&w.data, 1, w.strings, VEC_SIZE (w.strings));
+	memcpy (w.data, &header, sizeof (header));
+
+	job = (savejob_t *)Mem_Alloc (sizeof (savejob_t));
+	q_strlcpy (job->name, name, sizeof (job->name));
+	Host_SavegameComment (comment);
+	q_snprintf (job->preamble, sizeof (job->preamble), "%i\n%s\n", SAVEGAME_BINARY_VERSION, comment);
+	job->data = w.data;
+	job->f = f;
+	savegame_job = job;
+	job->task = Task_AllocateAssignFuncAndSubmit (Host_WriteSavegameTask, &job, sizeof (job));
+
+	VEC_FREE (w.strings);
+	VEC_FREE (w.offsets);
+	Mem_Free (w.hash);
+	return true;
+}
+
+/*
+===============
+Host_Savegame_f
+===============
+*/
+static void Host_Savegame_f (void)
+{
+	char	 name[MAX_OSPATH];
+	int		 i;
+	qboolean binary, saved;
 
 	if (cmd_source != src_command)
 		return;
@@ -1758,187 +2279,526 @@ static void Host_Savegame_f (void)
 		}
 	}
 
-	if (multiuser)
-	{
-		char *save_path = SDL_GetPrefPath ("vkQuake", COM_GetGameNames (true));
-		q_snprintf (name, sizeof (name), "%s%s", save_path, Cmd_Argv (1));
-		SDL_free (save_path);
-	}
-	else
-		q_snprintf (name, sizeof (name), "%s/%s", com_gamedir, Cmd_Argv (1));
-	COM_AddExtension (name, ".sav", sizeof (name));
+	Host_SavegamePath (name, sizeof (name), Cmd_Argv (1));
+
+	// a binary save may still be on its way to the disk
+	Host_FinishSavegame (true);
 
 	Con_SafePrintf ("Saving game to ");
 	Con_LinkPrintf (name, "%s", name);
 	Con_SafePrintf ("...\n");
-	f = Sys_fopen (name, "w");
-	if (!f)
+
+	binary = savebinary.value != 0.f;
+	PR_SwitchQCVM (&sv.qcvm);
+	saved = binary ? Host_WriteSavegameBinary (name) : Host_WriteSavegameText (name);
+	if (saved)
 	{
-		Con_Printf ("ERROR: couldn't open.\n");
-		return;
+		// Take the occasion to check the free-list
+		// this is a long operation anyway.
+		ED_CheckFreeList ();
+		if (!binary)
+			Con_Printf ("done.\n");
 	}
+	PR_SwitchQCVM (NULL);
 
-	PR_SwitchQCVM (&sv.qcvm);
+	if (!saved)
+		return;
+	if (!binary) // the binary save rebuilds it once it is written
+		SaveList_Rebuild ();
 
-	fprintf (f, "%i\n", SAVEGAME_VERSION);
-	Host_SavegameComment (comment);
-	fprintf (f, "%s\n", comment);
-	for (i = 0; i < NUM_BASIC_SPAWN_PARMS; i++)
-		fprintf (f, "%f\n", svs.clients->spawn_parms[i]);
-	fprintf (f, "%d\n", current_skill);
-	fprintf (f, "%s\n", sv.name);
-	fprintf (f, "%f\n", qcvm->time);
+	if (strlen (Cmd_Argv (1)) < sizeof (sv.lastsave) - 1)
+		strcpy (sv.lastsave, Cmd_Argv (1));
+}
 
-	// write the light styles
+static void Send_Spawn_Info (client_t *c, qboolean loadgame)
+{
+	int		  i;
+	client_t *client;
+	edict_t	 *ent;
+
+	// send all current names, colors, and frag counts
+	SZ_Clear (&c->message);
+
+	// send time of update
+	MSG_WriteByte (&c->message, svc_time);
+	MSG_WriteFloat (&c->message, qcvm->time);
+	if (c->protocol_pext2 & PEXT2_PREDINFO)
+		MSG_WriteShort (&c->message, (c->lastmovemessage & 0xffff));
+
+	for (i = 0, client = svs.clients; i < svs.maxclients; i++, client++)
+	{
+		if (!client->knowntoqc)
+			continue;
+
+		MSG_WriteByte (&c->message, svc_updatename);
+		MSG_WriteByte (&c->message, i);
+		MSG_WriteString (&c->message, client->name);
+		MSG_WriteByte (&c->message, svc_updatecolors);
+		MSG_WriteByte (&c->message, i);
+		MSG_WriteByte (&c->message, client->colors);
+
+		MSG_WriteByte (&c->message, svc_updatefrags);
+		MSG_WriteByte (&c->message, i);
+		MSG_WriteShort (&c->message, client->old_frags);
+	}
+
+	// send all current light styles
 	for (i = 0; i < MAX_LIGHTSTYLES; i++)
 	{
-		if (sv.lightstyles[i])
-			fprintf (f, "%s\n", sv.lightstyles[i]);
+		MSG_WriteByte (&c->message, svc_lightstyle);
+		MSG_WriteByte (&c->message, (char)i);
+		MSG_WriteString (&c->message, sv.lightstyles[i]);
+	}
+
+	//
+	// send some stats
+	//
+	MSG_WriteByte (&c->message, svc_updatestat);
+	MSG_WriteByte (&c->message, STAT_TOTALSECRETS);
+	MSG_WriteLong (&c->message, pr_global_struct->total_secrets);
+
+	MSG_WriteByte (&c->message, svc_updatestat);
+	MSG_WriteByte (&c->message, STAT_TOTALMONSTERS);
+	MSG_WriteLong (&c->message, pr_global_struct->total_monsters);
+
+	MSG_WriteByte (&c->message, svc_updatestat);
+	MSG_WriteByte (&c->message, STAT_SECRETS);
+	MSG_WriteLong (&c->message, pr_global_struct->found_secrets);
+
+	MSG_WriteByte (&c->message, svc_updatestat);
+	MSG_WriteByte (&c->message, STAT_MONSTERS);
+	MSG_WriteLong (&c->message, pr_global_struct->killed_monsters);
+
+	//
+	// send a fixangle
+	// Never send a roll angle, because savegames can catch the server
+	// in a state where it is expecting the client to correct the angle
+	// and it won't happen if the game was just loaded, so you wind up
+	// with a permanent head tilt
+	ent = EDICT_NUM (1 + (c - svs.clients));
+	MSG_WriteByte (&c->message, svc_setangle);
+	for (i = 0; i < 2; i++)
+		if (loadgame)
+			MSG_WriteAngle (&c->message, ent->v.v_angle[i], sv.protocolflags);
 		else
-			fprintf (f, "m\n");
+			MSG_WriteAngle (&c->message, ent->v.angles[i], sv.protocolflags);
+	MSG_WriteAngle (&c->message, 0, sv.protocolflags);
+
+	if (!(c->protocol_pext2 & PEXT2_REPLACEMENTDELTAS))
+		SV_WriteClientdataToMessage (c, &c->message);
+}
+
+/*
+===============
+Host_ParseSavegameExtension
+
+Parses the extended savegame lines, temporarily terminating them in place
+===============
+*/
+static void Host_ParseSavegameExtension (const char *ext, float *spawn_parms, qboolean fastload)
+{
+	char *end;
+
+	while ((end = (char *)strchr (ext, '\n')))
+	{
+		*end = 0;
+		ext = COM_Parse (ext);
+		if (!strcmp (com_token, "sv.lightstyles"))
+		{
+			int idx;
+			ext = COM_Parse (ext);
+			idx = atoi (com_token);
+			ext = COM_Parse (ext);
+			if (idx >= 0 && idx < MAX_LIGHTSTYLES)
+			{
+				if (*com_token)
+					sv.lightstyles[idx] = (const char *)q_strdup (com_token);
+				else
+					sv.lightstyles[idx] = NULL;
+			}
+		}
+		else if (!strcmp (com_token, "sv.model_precache"))
+		{
+			int idx;
+			ext = COM_Parse (ext);
+			idx = atoi (com_token);
+			ext = COM_Parse (ext);
+			if (idx >= 1 && idx < MAX_MODELS)
+			{
+				sv.model_precache[idx] = (const char *)q_strdup (com_token);
+				sv.models[idx] = Mod_ForName (sv.model_precache[idx], idx == 1);
+				// if (idx == 1)
+				//	sv.worldmodel = sv.models[idx];
+			}
+		}
+		else if (!strcmp (com_token, "sv.sound_precache"))
+		{
+			int idx;
+			ext = COM_Parse (ext);
+			idx = atoi (com_token);
+			ext = COM_Parse (ext);
+			if (idx >= 1 && idx < MAX_MODELS)
+				sv.sound_precache[idx] = (const char *)q_strdup (com_token);
+		}
+		else if (!strcmp (com_token, "sv.particle_precache"))
+		{
+			int idx;
+			ext = COM_Parse (ext);
+			idx = atoi (com_token);
+			ext = COM_Parse (ext);
+			if (idx >= 1 && idx < MAX_PARTICLETYPES)
+			{
+				Mem_Free (sv.particle_precache[idx]);
+				sv.particle_precache[idx] = (const char *)q_strdup (com_token);
+			}
+		}
+		else if (!strcmp (com_token, "sv.serverflags") || !strcmp (com_token, "svs.serverflags"))
+		{
+			int fl;
+			ext = COM_Parse (ext);
+			fl = atoi (com_token);
+			svs.serverflags = fl;
+		}
+		else if (!strcmp (com_token, "spawnparm"))
+		{
+			int idx;
+			ext = COM_Parse (ext);
+			idx = atoi (com_token);
+			ext = COM_Parse (ext);
+			if (idx >= 1 && idx <= NUM_TOTAL_SPAWN_PARMS)
+				spawn_parms[idx - 1] = atof (com_token);
+		}
+		else if (!strcmp (com_token, "fog") && fastload)
+		{
+			float d, r, g, b;
+			ext = COM_Parse (ext);
+			d = atof (com_token);
+			ext = COM_Parse (ext);
+			r = atof (com_token);
+			ext = COM_Parse (ext);
+			g = atof (com_token);
+			ext = COM_Parse (ext);
+			b = atof (com_token);
+			Fog_Update (d, r, g, b, 0.0f);
+		}
+		else if (!strcmp (com_token, "sky") && fastload)
+		{
+			ext = COM_Parse (ext);
+			Sky_LoadSkyBox (com_token);
+		}
+		else if (!strcmp (com_token, "skyfog") && fastload)
+		{
+			ext = COM_Parse (ext);
+			Sky_SetSkyfog (atof (com_token));
+		}
+		*end = '\n';
+		ext = end + 1;
 	}
+}
 
-	ED_WriteGlobals (f);
-	for (i = 0; i < qcvm->num_edicts; i++)
+/*
+===============
+Host_LoadgameEdict
+
+Readies edict entnum to be loaded over
+===============
+*/
+static edict_t *Host_LoadgameEdict (int entnum)
+{
+	edict_t *ent = EDICT_NUM (entnum);
+
+	if (entnum < qcvm->num_edicts)
 	{
-		ED_Write (f, EDICT_NUM (i));
+		ent->free = false;
+		memset (&ent->v, 0, qcvm->progs->entityfields * 4);
+	}
+	else
+	{
+		// adjust qcvm->num_edicts for consistency:
+		qcvm->num_edicts = q_max (qcvm->num_edicts, entnum + 1);
+		memset (ent, 0, qcvm->edict_size);
+
+		assert (!ent->free);
+
+		ent->baseline = nullentitystate;
+#if defined(DEBUG) || defined(_DEBUG)
+		// fill debug fields, they were overwriten above:
+		ent->qcvm_owner = qcvm;
+		ent->edict_ptr = ent;
+		ent->edict_num = entnum;
+#endif
+	}
+
+	return ent;
+}
+
+/*
+===============
+Host_LoadgameText
+
+Returns the number of edicts
+===============
+*/
+static int Host_LoadgameText (const char *data, float *spawn_parms, qboolean fastload)
+{
+	edict_t *ent;
+	int		 i, entnum;
+
+	// load the light styles
+	for (i = 0; i < MAX_LIGHTSTYLES; i++)
+	{
+		data = COM_ParseStringNewline (data);
+		sv.lightstyles[i] = (const char *)q_strdup (com_token);
 	}
 
-	// add extra info (lightstyles, precaches, etc) in a way that's supposed to be compatible with DP.
-	// sidenote - this provides extended lightstyles and support for late precaches
-	// it does NOT protect against spawnfunc precache changes - we would need to include makestatics here too (and optionally baselines, or just recalculate
-	// those).
-	fprintf (f, "/*\n");
-	fprintf (f, "// QuakeSpasm extended savegame\n");
-	for (i = MAX_LIGHTSTYLES; i < MAX_LIGHTSTYLES; i++)
-	{
-		if (sv.lightstyles[i])
-			fprintf (f, "sv.lightstyles %i \"%s\"\n", i, sv.lightstyles[i]);
-	}
-	for (i = 1; i < MAX_MODELS; i++)
-	{
-		if (sv.model_precache[i])
-			fprintf (f, "sv.model_precache %i \"%s\"\n", i, sv.model_precache[i]);
+	// load the edicts out of the savegame file
+	entnum = -1; // -1 is the globals
+	while (*data)
+	{
+		while (*data == ' ' || *data == '\r' || *data == '\n')
+			data++;
+		if (data[0] == '/' && data[1] == '*' && (data[2] == '\r' || data[2] == '\n'))
+		{ // looks like an extended saved game
+			Host_ParseSavegameExtension (data + 2, spawn_parms, fastload);
+		}
+
+		data = COM_Parse (data);
+		if (!com_token[0])
+			break; // end of file
+		if (strcmp (com_token, "{"))
+		{
+			Host_Error ("First token isn't a brace");
+		}
+
+		if (entnum == -1)
+		{ // parse the global vars
+			data = ED_ParseGlobals (data);
+		}
+		else
+		{ // parse an edict
+			ent = Host_LoadgameEdict (entnum);
+			data = ED_ParseEdict (data, ent);
+
+			// link it into the bsp tree
+			if (!ent->free)
+				SV_LinkEdict (ent, false);
+		}
+
+		entnum++;
 	}
-	for (i = 1; i < MAX_SOUNDS; i++)
+
+	return entnum;
+}
+
+/*
+===============
+Host_ReadSavegameBinary
+
+Returns the Mem_Alloc'ed snapshot of a binary save, or NULL if path isn't one
+===============
+*/
+static byte *Host_ReadSavegameBinary (const char *path, int *size)
+{
+	FILE			*f;
+	savefileheader_t header;
+	byte			*compressed, *snapshot;
+	int				 version, c, lines;
+
+	f = Sys_fopen (path, "rb");
+	if (!f)
+		return NULL;
+	if (fscanf (f, "%i", &version) != 1 || version != SAVEGAME_BINARY_VERSION)
 	{
-		if (sv.sound_precache[i])
-			fprintf (f, "sv.sound_precache %i \"%s\"\n", i, sv.sound_precache[i]);
+		fclose (f);
+		return NULL;
 	}
-	for (i = 1; i < MAX_PARTICLETYPES; i++)
+	// skip the rest of the version line and the comment
+	for (lines = 0; lines < 2 && (c = fgetc (f)) != EOF;)
+		lines += (c == '\n');
+
+	if (lines != 2 || fread (&header, sizeof (header), 1, f) != 1 || header.magic != SAVEGAME_BINARY_MAGIC || header.size < (int)sizeof (savegameheader_t) ||
+		header.compressedsize <= 0 || header.compressedsize > header.size)
 	{
-		if (sv.particle_precache[i])
-			fprintf (f, "sv.particle_precache %i \"%s\"\n", i, sv.particle_precache[i]);
+		fclose (f);
+		Host_Error ("Savegame %s is corrupt", path);
 	}
 
-	fprintf (f, "sv.serverflags %i\n", svs.serverflags);
-	for (i = NUM_BASIC_SPAWN_PARMS; i < NUM_TOTAL_SPAWN_PARMS; i++)
+	snapshot = (byte *)Mem_AllocNonZero (header.size);
+	compressed = (header.compressedsize < header.size) ? (byte *)Mem_AllocNonZero (header.compressedsize) : snapshot;
+	if (fread (compressed, header.compressedsize, 1, f) != 1 || (compressed != snapshot && !COM_Inflate (compressed, header.compressedsize, snapshot, header.size)))
 	{
-		if (svs.clients->spawn_parms[i])
-			fprintf (f, "spawnparm %i \"%f\"\n", i + 1, svs.clients->spawn_parms[i]);
+		fclose (f);
+		if (compressed != snapshot)
+			Mem_Free (compressed);
+		Mem_Free (snapshot);
+		Host_Error ("Savegame %s is corrupt", path);
 	}
+	fclose (f);
+	if (compressed != snapshot)
+		Mem_Free (compressed);
 
-	const char *fog_cmd = Fog_GetFogCommand (true);
-	if (fog_cmd)
-		fprintf (f, "%s", &fog_cmd[1]);
-
-	const char *sky_cmd = Sky_GetSkyCommand (true);
-	if (sky_cmd)
-		fprintf (f, "%s", &sky_cmd[1]);
-
-	fprintf (f, "*/\n");
+	*size = header.size;
+	return snapshot;
+}
 
-	fclose (f);
+/*
+===============
+Host_SavedString
+===============
+*/
+static const char *Host_SavedString (const savegameheader_t *header, const byte *snapshot, int ref)
+{
+	const int  *offsets = (const int *)(snapshot + header->stringsofs);
+	const char *strings = (const char *)(offsets + header->numstrings);
+	const int	index = -1 - ref;
 
-	// Take the occasion to check the free-list
-	// this is a long operation anyway.
-	ED_CheckFreeList ();
+	if (index < 0 || index >= header->numstrings)
+		Host_Error ("Savegame has a bad string reference %i", ref);
+	return strings + offsets[index];
+}
 
-	Con_Printf ("done.\n");
+/*
+===============
+Host_LoadStringNum
+===============
+*/
+static string_t Host_LoadStringNum (const savegameheader_t *header, const byte *snapshot, int ref)
+{
+	const int	index = -1 - ref;
+	const char *s;
+	char	   *p;
 
-	PR_SwitchQCVM (NULL);
-	SaveList_Rebuild ();
+	if (ref >= 0)
+		return (ref < qcvm->stringssize) ? ref : 0;
 
-	if (strlen (Cmd_Argv (1)) < sizeof (sv.lastsave) - 1)
-		strcpy (sv.lastsave, Cmd_Argv (1));
+	s = Host_SavedString (header, snapshot, ref);
+	if (!savegame_loadedstrings[index])
+	{
+		const int len = strlen (s) + 1;
+		savegame_loadedstrings[index] = PR_AllocString (len, &p);
+		memcpy (p, s, len);
+	}
+	return savegame_loadedstrings[index];
 }
 
-static void Send_Spawn_Info (client_t *c, qboolean loadgame)
+/*
+===============
+Host_LoadEntityNum
+===============
+*/
+static int Host_LoadEntityNum (const savegameheader_t *header, int num)
 {
-	int		  i;
-	client_t *client;
-	edict_t	 *ent;
+	if (num < 0 || num >= header->num_edicts)
+		Host_Error ("Savegame has a bad entity reference %i", num);
+	return num * qcvm->edict_size;
+}
 
-	// send all current names, colors, and frag counts
-	SZ_Clear (&c->message);
+/*
+===============
+Host_LoadgameBinary
 
-	// send time of update
-	MSG_WriteByte (&c->message, svc_time);
-	MSG_WriteFloat (&c->message, qcvm->time);
-	if (c->protocol_pext2 & PEXT2_PREDINFO)
-		MSG_WriteShort (&c->message, (c->lastmovemessage & 0xffff));
+Returns the number of edicts
+===============
+*/
+static int Host_LoadgameBinary (byte *snapshot, int size, float *spawn_parms, qboolean fastload)
+{
+	const savegameheader_t *header = (const savegameheader_t *)snapshot;
+	const int				entityfields = qcvm->progs->entityfields;
+	const int			   *offsets;
+	const byte			   *data, *end;
+	int						i, entnum, stringssize;
+
+	if (header->progscrc != qcvm->progscrc || header->entityfields != entityfields)
+		Host_Error ("Savegame was made with a different progs.dat");
+	if (header->num_edicts < 1 || header->num_edicts > qcvm->max_edicts)
+		Host_Error ("Savegame has %i edicts (max_edicts is %i)", header->num_edicts, qcvm->max_edicts);
+
+	// check the string table once, the lookups can then trust it
+	if (header->stringsofs < (int)sizeof (*header) || header->numstrings < 1 || header->stringsofs > size ||
+		header->numstrings > (size - header->stringsofs) / (int)sizeof (int))
+		Host_Error ("Savegame is corrupt");
+	offsets = (const int *)(snapshot + header->stringsofs);
+	stringssize = size - header->stringsofs - header->numstrings * sizeof (int);
+	if (stringssize < 1 || snapshot[size - 1])
+		Host_Error ("Savegame is corrupt");
+	for (i = 0; i < header->numstrings; i++)
+	{
+		if (offsets[i] < 0 || offsets[i] >= stringssize)
+			Host_Error ("Savegame is corrupt");
+	}
+	VEC_CLEAR (savegame_loadedstrings);
+	Vec_Grow ((void **)&savegame_loadedstrings, sizeof (string_t), header->numstrings);
+	memset (savegame_loadedstrings, 0, header->numstrings * sizeof (string_t));
 
-	for (i = 0, client = svs.clients; i < svs.maxclients; i++, client++)
-	{
-		if (!client->knowntoqc)
-			continue;
+	for (i = 0; i < MAX_LIGHTSTYLES; i++)
+		sv.lightstyles[i] = (const char *)q_strdup (header->lightstyles[i] ? Host_SavedString (header, snapshot, header->lightstyles[i]) : "m");
 
-		MSG_WriteByte (&c->message, svc_updatename);
-		MSG_WriteByte (&c->message, i);
-		MSG_WriteString (&c->message, client->name);
-		MSG_WriteByte (&c->message, svc_updatecolors);
-		MSG_WriteByte (&c->message, i);
-		MSG_WriteByte (&c->message, client->colors);
+	data = snapshot + sizeof (*header);
+	end = snapshot + header->stringsofs;
+	if (header->numglobals * (int)sizeof (int) > end - data)
+		Host_Error ("Savegame is corrupt");
+	for (i = 0; i < qcvm->progs->numglobaldefs; i++)
+	{
+		const ddef_t *def = &qcvm->globaldefs[i];
+		const int	  type = Host_SaveGlobalType (def);
+		const int	  count = (type == ev_string || type == ev_entity) ? 1 : (type >= 0) ? type_size[type] : 0;
 
-		MSG_WriteByte (&c->message, svc_updatefrags);
-		MSG_WriteByte (&c->message, i);
-		MSG_WriteShort (&c->message, client->old_frags);
+		if (!count)
+			continue;
+		if (data + count * sizeof (int) > snapshot + sizeof (*header) + header->numglobals * sizeof (int))
+			Host_Error ("Savegame is corrupt");
+		memcpy (&qcvm->globals[def->ofs], data, count * sizeof (int));
+		if (type == ev_string)
+			((int *)qcvm->globals)[def->ofs] = Host_LoadStringNum (header, snapshot, ((int *)qcvm->globals)[def->ofs]);
+		else if (type == ev_entity)
+			((int *)qcvm->globals)[def->ofs] = Host_LoadEntityNum (header, ((int *)qcvm->globals)[def->ofs]);
+		data += count * sizeof (int);
 	}
 
-	// send all current light styles
-	for (i = 0; i < MAX_LIGHTSTYLES; i++)
+	Host_SavegameFields ();
+
+	for (entnum = 0; entnum < header->num_edicts; entnum++)
 	{
-		MSG_WriteByte (&c->message, svc_lightstyle);
-		MSG_WriteByte (&c->message, (char)i);
-		MSG_WriteString (&c->message, sv.lightstyles[i]);
-	}
+		saveedict_t record;
+		edict_t	   *ent;
 
-	//
-	// send some stats
-	//
-	MSG_WriteByte (&c->message, svc_updatestat);
-	MSG_WriteByte (&c->message, STAT_TOTALSECRETS);
-	MSG_WriteLong (&c->message, pr_global_struct->total_secrets);
+		if (data + sizeof (record) > end)
+			Host_Error ("Savegame is corrupt");
+		memcpy (&record, data, sizeof (record));
+		data += sizeof (record);
 
-	MSG_WriteByte (&c->message, svc_updatestat);
-	MSG_WriteByte (&c->message, STAT_TOTALMONSTERS);
-	MSG_WriteLong (&c->message, pr_global_struct->total_monsters);
+		ent = Host_LoadgameEdict (entnum);
+		if (record.free)
+		{
+			if (ent != qcvm->edicts)
+				memset (&ent->v, 0, entityfields * 4);
+			ED_Free (ent);
+			continue;
+		}
 
-	MSG_WriteByte (&c->message, svc_updatestat);
-	MSG_WriteByte (&c->message, STAT_SECRETS);
-	MSG_WriteLong (&c->message, pr_global_struct->found_secrets);
+		if (data + entityfields * sizeof (int) > end)
+			Host_Error ("Savegame is corrupt");
+		memcpy (&ent->v, data, entityfields * sizeof (int));
+		data += entityfields * sizeof (int);
+		for (i = 0; i < (int)VEC_SIZE (savegame_stringfields); i++)
+		{
+			int *value = (int *)&ent->v + savegame_stringfields[i];
+			*value = Host_LoadStringNum (header, snapshot, *value);
+		}
+		for (i = 0; i < (int)VEC_SIZE (savegame_entityfields); i++)
+		{
+			int *value = (int *)&ent->v + savegame_entityfields[i];
+			*value = Host_LoadEntityNum (header, *value);
+		}
+		ent->alpha = record.alpha;
 
-	MSG_WriteByte (&c->message, svc_updatestat);
-	MSG_WriteByte (&c->message, STAT_MONSTERS);
-	MSG_WriteLong (&c->message, pr_global_struct->killed_monsters);
+		// link it into the bsp tree
+		SV_LinkEdict (ent, false);
+	}
 
-	//
-	// send a fixangle
-	// Never send a roll angle, because savegames can catch the server
-	// in a state where it is expecting the client to correct the angle
-	// and it won't happen if the game was just loaded, so you wind up
-	// with a permanent head tilt
-	ent = EDICT_NUM (1 + (c - svs.clients));
-	MSG_WriteByte (&c->message, svc_setangle);
-	for (i = 0; i < 2; i++)
-		if (loadgame)
-			MSG_WriteAngle (&c->message, ent->v.v_angle[i], sv.protocolflags);
-		else
-			MSG_WriteAngle (&c->message, ent->v.angles[i], sv.protocolflags);
-	MSG_WriteAngle (&c->message, 0, sv.protocolflags);
+	Host_ParseSavegameExtension (Host_SavedString (header, snapshot, header->extension), spawn_parms, fastload);
 
-	if (!(c->protocol_pext2 & PEXT2_REPLACEMENTDELTAS))
-		SV_WriteClientdataToMessage (c, &c->message);
+	return entnum;
 }
 
 /*
@@ -1952,13 +2812,15 @@ static void Host_Loadgame_f (void)
 
 	char		name[MAX_OSPATH];
 	char		mapname[MAX_QPATH];
-	float		time, tfloat;
-	const char *data;
+	double		time;
+	float		tfloat;
+	const char *data = NULL;
 	int			i;
-	edict_t	   *ent;
 	int			entnum;
 	int			version;
+	int			binarysize = 0;
 	float		spawn_parms[NUM_TOTAL_SPAWN_PARMS];
+	qboolean	binary = false;
 	qboolean	was_recording = cls.demorecording;
 	int			old_skill = current_skill;
 	qboolean	fastload = !!strstr (Cmd_Argv (0), "fast") || autofastload.value;
@@ -1986,6 +2848,9 @@ static void Host_Loadgame_f (void)
 
 	cls.demonum = -1; // stop demo loop in case this fails
 
+	// a binary save may still be on its way to the disk
+	Host_FinishSavegame (true);
+
 	char	*save_path = multiuser ? SDL_GetPrefPath ("vkQuake", COM_GetGameNames (true)) : NULL;
 	qboolean loadable = false;
 	for (int j = (multiuser ? 0 : 1); j < 2; ++j)
@@ -1999,8 +2864,12 @@ static void Host_Loadgame_f (void)
 		// avoid leaking if the previous Host_Loadgame_f failed with a Host_Error
 		if (start != NULL)
 			Mem_Free (start);
+		start = NULL;
 
-		start = (char *)COM_LoadMallocFile_TextMode_OSPath (name, NULL);
+		start = (char *)Host_ReadSavegameBinary (name, &binarysize);
+		binary = start != NULL;
+		if (!binary)
+			start = (char *)COM_LoadMallocFile_TextMode_OSPath (name, NULL);
 		if (start)
 		{
 			loadable = true;
@@ -2018,28 +2887,44 @@ static void Host_Loadgame_f (void)
 
 	Con_Printf ("Loading game from %s...\n", name);
 
-	data = start;
-	data = COM_ParseIntNewline (data, &version);
-	if (version != SAVEGAME_VERSION)
+	if (binary)
 	{
-		Mem_Free (start);
-		start = NULL;
-		Host_Error ("Savegame is version %i, not %i", version, SAVEGAME_VERSION);
-		return;
+		const savegameheader_t *header = (const savegameheader_t *)start;
+		for (i = 0; i < NUM_BASIC_SPAWN_PARMS; i++)
+			spawn_parms[i] = header->spawn_parms[i];
+		for (; i < NUM_TOTAL_SPAWN_PARMS; i++)
+			spawn_parms[i] = 0;
+		current_skill = header->skill;
+		Cvar_SetValue ("skill", (float)current_skill);
+		q_strlcpy (mapname, header->mapname, sizeof (mapname));
+		time = header->time;
+	}
+	else
+	{
+		data = start;
+		data = COM_ParseIntNewline (data, &version);
+		if (version != SAVEGAME_VERSION)
+		{
+			Mem_Free (start);
+			start = NULL;
+			Host_Error ("Savegame is version %i, not %i", version, SAVEGAME_VERSION);
+			return;
+		}
+		data = COM_ParseStringNewline (data);
+		for (i = 0; i < NUM_BASIC_SPAWN_PARMS; i++)
+			data = COM_ParseFloatNewline (data, &spawn_parms[i]);
+		for (; i < NUM_TOTAL_SPAWN_PARMS; i++)
+			spawn_parms[i] = 0;
+		// this silliness is so we can load 1.06 save files, which have float skill values
+		data = COM_ParseFloatNewline (data, &tfloat);
+		current_skill = (int)(tfloat + 0.1);
+		Cvar_SetValue ("skill", (float)current_skill);
+
+		data = COM_ParseStringNewline (data);
+		q_strlcpy (mapname, com_token, sizeof (mapname));
+		data = COM_ParseFloatNewline (data, &tfloat);
+		time = tfloat;
 	}
-	data = COM_ParseStringNewline (data);
-	for (i = 0; i < NUM_BASIC_SPAWN_PARMS; i++)
-		data = COM_ParseFloatNewline (data, &spawn_parms[i]);
-	for (; i < NUM_TOTAL_SPAWN_PARMS; i++)
-		spawn_parms[i] = 0;
-	// this silliness is so we can load 1.06 save files, which have float skill values
-	data = COM_ParseFloatNewline (data, &tfloat);
-	current_skill = (int)(tfloat + 0.1);
-	Cvar_SetValue ("skill", (float)current_skill);
-
-	data = COM_ParseStringNewline (data);
-	q_strlcpy (mapname, com_token, sizeof (mapname));
-	data = COM_ParseFloatNewline (data, &time);
 
 	if (fastload && (!sv.active || cls.signon != SIGNONS || svs.maxclients != 1))
 	{
@@ -2091,169 +2976,13 @@ static void Host_Loadgame_f (void)
 	if (was_recording)
 		CL_Resume_Record (fastload);
 
-	// load the light styles
-	for (i = 0; i < MAX_LIGHTSTYLES; i++)
-	{
-		data = COM_ParseStringNewline (data);
-		sv.lightstyles[i] = (const char *)q_strdup (com_token);
-	}
-
 	if (fastload) // can be done for normal loads too, but keep the previous behavior
 		PR_ClearEdictStrings ();
 
-	// load the edicts out of the savegame file
-	entnum = -1; // -1 is the globals
-	while (*data)
-	{
-		while (*data == ' ' || *data == '\r' || *data == '\n')
-			data++;
-		if (data[0] == '/' && data[1] == '*' && (data[2] == '\r' || data[2] == '\n'))
-		{ // looks like an extended saved game
-			char	   *end;
-			const char *ext;
-			ext = data + 2;
-			while ((end = (char *)strchr (ext, '\n')))
-			{
-				*end = 0;
-				ext = COM_Parse (ext);
-				if (!strcmp (com_token, "sv.lightstyles"))
-				{
-					int idx;
-					ext = COM_Parse (ext);
-					idx = atoi (com_token);
-					ext = COM_Parse (ext);
-					if (idx >= 0 && idx < MAX_LIGHTSTYLES)
-					{
-						if (*com_token)
-							sv.lightstyles[idx] = (const char *)q_strdup (com_token);
-						else
-							sv.lightstyles[idx] = NULL;
-					}
-				}
-				else if (!strcmp (com_token, "sv.model_precache"))
-				{
-					int idx;
-					ext = COM_Parse (ext);
-					idx = atoi (com_token);
-					ext = COM_Parse (ext);
-					if (idx >= 1 && idx < MAX_MODELS)
-					{
-						sv.model_precache[idx] = (const char *)q_strdup (com_token);
-						sv.models[idx] = Mod_ForName (sv.model_precache[idx], idx == 1);
-						// if (idx == 1)
-						//	sv.worldmodel = sv.models[idx];
-					}
-				}
-				else if (!strcmp (com_token, "sv.sound_precache"))
-				{
-					int idx;
-					ext = COM_Parse (ext);
-					idx = atoi (com_token);
-					ext = COM_Parse (ext);
-					if (idx >= 1 && idx < MAX_MODELS)
-						sv.sound_precache[idx] = (const char *)q_strdup (com_token);
-				}
-				else if (!strcmp (com_token, "sv.particle_precache"))
-				{
-					int idx;
-					ext = COM_Parse (ext);
-					idx = atoi (com_token);
-					ext = COM_Parse (ext);
-					if (idx >= 1 && idx < MAX_PARTICLETYPES)
-					{
-						Mem_Free (sv.particle_precache[idx]);
-						sv.particle_precache[idx] = (const char *)q_strdup (com_token);
-					}
-				}
-				else if (!strcmp (com_token, "sv.serverflags") || !strcmp (com_token, "svs.serverflags"))
-				{
-					int fl;
-					ext = COM_Parse (ext);
-					fl = atoi (com_token);
-					svs.serverflags = fl;
-				}
-				else if (!strcmp (com_token, "spawnparm"))
-				{
-					int idx;
-					ext = COM_Parse (ext);
-					idx = atoi (com_token);
-					ext = COM_Parse (ext);
-					if (idx >= 1 && idx <= NUM_TOTAL_SPAWN_PARMS)
-						spawn_parms[idx - 1] = atof (com_token);
-				}
-				else if (!strcmp (com_token, "fog") && fastload)
-				{
-					float d, r, g, b;
-					ext = COM_Parse (ext);
-					d = atof (com_token);
-					ext = COM_Parse (ext);
-					r = atof (com_token);
-					ext = COM_Parse (ext);
-					g = atof (com_token);
-					ext = COM_Parse (ext);
-					b = atof (com_token);
-					Fog_Update (d, r, g, b, 0.0f);
-				}
-				else if (!strcmp (com_token, "sky") && fastload)
-				{
-					ext = COM_Parse (ext);
-					Sky_LoadSkyBox (com_token);
-				}
-				else if (!strcmp (com_token, "skyfog") && fastload)
-				{
-					ext = COM_Parse (ext);
-					Sky_SetSkyfog (atof (com_token));
-				}
-				*end = '\n';
-				ext = end + 1;
-			}
-		}
-
-		data = COM_Parse (data);
-		if (!com_token[0])
-			break; // end of file
-		if (strcmp (com_token, "{"))
-		{
-			Host_Error ("First token isn't a brace");
-		}
-
-		if (entnum == -1)
-		{ // parse the global vars
-			data = ED_ParseGlobals (data);
-		}
-		else
-		{ // parse an edict
-			ent = EDICT_NUM (entnum);
-			if (entnum < qcvm->num_edicts)
-			{
-				ent->free = false;
-				memset (&ent->v, 0, qcvm->progs->entityfields * 4);
-			}
-			else
-			{
-				// adjust qcvm->num_edicts for consistency:
-				qcvm->num_edicts = q_max (qcvm->num_edicts, entnum + 1);
-				memset (ent, 0, qcvm->edict_size);
-
-				assert (!ent->free);
-
-				ent->baseline = nullentitystate;
-#if defined(DEBUG) || defined(_DEBUG)
-				// fill debug fields, they were overwriten above:
-				ent->qcvm_owner = qcvm;
-				ent->edict_ptr = ent;
-				ent->edict_num = entnum;
-#endif
-			}
-			data = ED_ParseEdict (data, ent);
-
-			// link it into the bsp tree
-			if (!ent->free)
-				SV_LinkEdict (ent, false);
-		}
-
-		entnum++;
-	}
+	if (binary)
+		entnum = Host_LoadgameBinary ((byte *)start, binarysize, spawn_parms, fastload);
+	else
+		entnum = Host_LoadgameText (data, spawn_parms, fastload);
 
 	qcvm->time = time;
 
@@ -2264,6 +2993,7 @@ static void Host_Loadgame_f (void)
 	}
 	// adjust to the effective nb of edicts
 	qcvm->num_edicts = entnum;
+	ED_InvalidateFieldIndexes ();
 
 	// The loading process purposefully bypassed the free-list
 	// usage, so rebuild it now
@@ -2306,6 +3036,98 @@ static void Host_Loadgame_f (void)
 		strcpy (sv.lastsave, Cmd_Argv (1));
 }
 
+/*
+===============
+Host_SaveBench_f
+
+savebench [edicts]
+Pads the current single player game out to the given number of edicts, then
+times saving and fastloading it in the text and the binary format. The saves
+go to scratch files that are deleted again, and sv.lastsave is restored so
+autoload still picks the player's own save.
+===============
+*/
+static void Host_SaveBench_f (void)
+{
+	const int	target = (Cmd_Argc () > 1) ? atoi (Cmd_Argv (1)) : 5000;
+	const char *formats[2] = {"text", "binary"};
+	const float oldsavebinary = savebinary.value;
+	double		savetime[2], stalltime[2], loadtime[2], start;
+	long		filesize[2];
+	char		name[MAX_OSPATH];
+	char		lastsave[sizeof (sv.lastsave)];
+	int			i, edicts, added = 0;
+
+	if (!Host_BenchAllowed ())
+		return;
+
+	if (!sv.active || svs.maxclients != 1 || cls.signon != SIGNONS || cl.intermission)
+	{
+		Con_Printf ("savebench needs a local single player game\n");
+		return;
+	}
+
+	PR_SwitchQCVM (&sv.qcvm);
+	while (qcvm->num_edicts < q_min (target, qcvm->max_edicts - 1))
+	{
+		edict_t *ed = ED_Alloc ();
+		char	*netname;
+
+		ed->v.classname = PR_SetEngineString ("savebench");
+		// a distinct string each, so they all go through the string table
+		ed->v.netname = PR_AllocString (16, &netname);
+		q_snprintf (netname, 16, "bench %i", added);
+		ed->v.origin[0] = added % 64 * 32;
+		ed->v.origin[1] = added / 64 % 64 * 32;
+		ed->v.origin[2] = added / 4096 * 32;
+		ed->v.health = added;
+		ed->v.nextthink = -1;
+		added++;
+	}
+	edicts = qcvm->num_edicts;
+	PR_SwitchQCVM (NULL);
+
+	q_strlcpy (lastsave, sv.lastsave, sizeof (lastsave));
+	for (i = 0; i < 2; i++)
+	{
+		Cvar_SetValueQuick (&savebinary, i);
+		start = Sys_DoubleTime ();
+		Cmd_ExecuteString (va ("save _savebench_tmp_%s", formats[i]), src_command);
+		stalltime[i] = Sys_DoubleTime () - start;
+		Host_FinishSavegame (true);
+		savetime[i] = Sys_DoubleTime () - start;
+
+		start = Sys_DoubleTime ();
+		Cmd_ExecuteString (va ("fastload _savebench_tmp_%s", formats[i]), src_command);
+		loadtime[i] = Sys_DoubleTime () - start;
+
+		Host_SavegamePath (name, sizeof (name), va ("_savebench_tmp_%s", formats[i]));
+		FILE *f = Sys_fopen (name, "rb");
+		filesize[i] = f ? Sys_filelength (f) : 0;
+		if (f)
+			fclose (f);
+		remove (name);
+	}
+	Cvar_SetValueQuick (&savebinary, oldsavebinary);
+	q_strlcpy (sv.lastsave, lastsave, sizeof (sv.lastsave));
+
+	// drop the padding again
+	PR_SwitchQCVM (&sv.qcvm);
+	for (i = 1; i < qcvm->num_edicts; i++)
+	{
+		edict_t *ed = EDICT_NUM (i);
+		if (!ed->free && !strcmp (PR_GetString (ed->v.classname), "savebench"))
+			ED_Free (ed);
+	}
+	PR_SwitchQCVM (NULL);
+
+	Con_Printf ("savebench: %i edicts (%i added)\n", edicts, added);
+	for (i = 0; i < 2; i++)
+		Con_Printf (
+			"%-6s save %7.2f ms (%7.2f ms on the main thread), load %7.2f ms, %6ld KB\n", formats[i], savetime[i] * 1000.0, stalltime[i] * 1000.0,
+			loadtime[i] * 1000.0, filesize[i] / 1024);
+}
+
 //============================================================================
 
 /*
@@ -2660,6 +3482,7 @@ static void Host_Spawn_f (void)
 		ent = host_client->edict;
 
 		memset (&ent->v, 0, qcvm->progs->entityfields * 4);
+		ED_TouchFieldIndexes (ent);
 		ent->v.colormap = NUM_FOR_EDICT (ent);
 		ent->v.team = (host_client->colors & 15) + 1;
 		ent->v.netname = PR_SetEngineString (host_client->name);
@@ -3487,6 +4310,7 @@ void Host_InitCommands (void)
 	Cmd_AddCommand ("load", Host_Loadgame_f);
 	Cmd_AddCommand ("fastload", Host_Loadgame_f);
 	Cmd_AddCommand ("save", Host_Savegame_f);
+	Cmd_AddCommand ("savebench", Host_SaveBench_f);
 	Cmd_AddCommand ("give", Host_Give_f);
 
 	Cmd_AddCommand ("startdemos", Host_Startdemos_f);
@@ -117,6 +117,9 @@ int main (int argc, char *argv[])
 	oldtime = Sys_DoubleTime ();
 	if (isDedicated)
 	{
+		if (COM_CheckParm ("-benchserver"))
+			SV_Bench_Run (); // runs unpaced and quits when done
+
 		while (1)
 		{
 			newtime = Sys_DoubleTime ();
@@ -88,6 +88,11 @@ int NET_SendUnreliableMessage (struct qsocket_s *sock, sizebuf_t *data);
 // returns 1 if the message was sent properly
 // returns -1 if the connection died
 
+void NET_BeginSendBatch (void);
+void NET_FlushSendBatch (void);
+// datagrams sent in between may go out together at the flush. Send errors
+// are then only printed, the send functions can't return -1 for them.
+
 int NET_SendToAll (sizebuf_t *data, double blocktime);
 // This is a reliable *blocking* send to all attached clients.
 
@@ -34,7 +34,7 @@ net_driver_t net_drivers[] = {
 
 	{"Datagram", false, Datagram_Init, Datagram_Listen, Datagram_QueryAddresses, Datagram_SearchForHosts, Datagram_Connect, Datagram_CheckNewConnections,
 	 Datagram_GetAnyMessage, Datagram_GetMessage, Datagram_SendMessage, Datagram_SendUnreliableMessage, Datagram_CanSendMessage,
-	 Datagram_CanSendUnreliableMessage, Datagram_Close, Datagram_Shutdown}};
+	 Datagram_CanSendUnreliableMessage, Datagram_Close, Datagram_Shutdown, Datagram_BeginSendBatch, Datagram_FlushSendBatch}};
 
 const int net_numdrivers = countof (net_drivers);
 
@@ -62,7 +62,9 @@ net_landriver_t net_landrivers[] = {
 	 UDP4_GetAddrFromName,
 	 UDP_AddrCompare,
 	 UDP_GetSocketPort,
-	 UDP_SetSocketPort},
+	 UDP_SetSocketPort,
+	 UDP_ReadBatch,
+	 UDP_WriteBatch},
 	{"UDP6",
 	 false,
 	 0,
@@ -84,6 +86,8 @@ net_landriver_t net_landrivers[] = {
 	 UDP6_GetAddrFromName,
 	 UDP_AddrCompare,
 	 UDP_GetSocketPort,
-	 UDP_SetSocketPort}};
+	 UDP_SetSocketPort,
+	 UDP_ReadBatch,
+	 UDP_WriteBatch}};
 
 const int net_numlandrivers = (sizeof (net_landrivers) / sizeof (net_landrivers[0]));
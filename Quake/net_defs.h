@@ -65,6 +65,11 @@ struct qsockaddr
 
 #define NET_PROTOCOL_VERSION 3
 
+// windowed reliable stream, negotiated with a bit of the proquake flags of CCREQ_CONNECT and CCREP_ACCEPT
+#define NET_WINDOW_FLAG		   0x40 // proquake itself only defines 1, cheat-free, and ignores the others
+#define NET_WINDOW_MAX		   32	// fragments in flight, the width of the ack masks
+#define NET_WINDOW_HEADERSIZE  4	// message offset in front of each windowed fragment
+
 /**
 
 This is the network info/connection protocol.  It is used to find Quake
@@ -79,6 +84,8 @@ General notes:
 CCREQ_CONNECT
 		string	game_name		"QUAKE"
 		byte	net_protocol_version	NET_PROTOCOL_VERSION
+		(optional proquake fields: byte mod, byte mod_version, byte flags, long password)
+		flags & NET_WINDOW_FLAG: the client takes windowed reliable fragments
 
 CCREQ_SERVER_INFO
 		string	game_name		"QUAKE"
@@ -92,6 +99,8 @@ CCREQ_RULE_INFO
 
 CCREP_ACCEPT
 		long	port
+		(optional proquake fields: byte mod, byte mod_version, byte flags)
+		flags & NET_WINDOW_FLAG: both ends send windowed reliable fragments
 
 CCREP_REJECT
 		string	reason
@@ -149,7 +158,10 @@ typedef struct qsocket_s
 	double			  lastSendTime;
 
 	qboolean isvirtual; // qsocket is emulated by the network layer (closing will not close any system sockets).
+	qboolean indexed;	// in the address index, see NET_IndexQSocket
 	qboolean disconnected;
+	// a batched datagram failed to go out, the next send reports it
+	qboolean sendfailed;
 	qboolean canSend;
 	qboolean sendNext;
 
@@ -164,10 +176,22 @@ typedef struct qsocket_s
 	int			 sendMessageLength;
 	byte		 sendMessage[NET_MAXMESSAGE];
 
+	// windowed reliable stream, see Datagram_WindowSend. fragments of sendMessage are never moved, bit i of the masks is ackSequence + i
+	int			 window; // fragments in flight, 0 for the legacy stop-and-wait stream
+	unsigned int sendMessageBase;
+	unsigned int sendWindowNext; // next fragment to send for the first time
+	unsigned int sendAcked;
+	unsigned int sendResent;
+	double		 sendFragmentTime[NET_WINDOW_MAX]; // indexed by sequence % NET_WINDOW_MAX
+	double		 rtt;
+
 	unsigned int receiveSequence;
 	unsigned int unreliableReceiveSequence;
 	int			 receiveMessageLength;
 	byte		 receiveMessage[NET_MAXMESSAGE * NET_LOOPBACKBUFFERS + NET_LOOPBACKHEADERSIZE];
+	unsigned int receiveMask;		 // windowed fragments past receiveSequence already in receiveMessage
+	unsigned int receiveEomSequence; // valid while receiveMessageEnd >= 0
+	int			 receiveMessageEnd;
 
 	struct qsockaddr addr;
 	char			 trueaddress[NET_NAMELEN];	 // lazy address string
@@ -182,6 +206,14 @@ extern qsocket_t *net_activeSockets;
 extern qsocket_t *net_freeSockets;
 extern int		  net_numsockets;
 
+// one datagram of a ReadBatch or WriteBatch call
+typedef struct
+{
+	byte			*data;
+	int				 len; // buffer size for ReadBatch, which sets it to the datagram size. WriteBatch sets it to -1 if the datagram failed
+	struct qsockaddr addr;
+} netpacket_t;
+
 typedef struct
 {
 	const char	*name;
@@ -206,6 +238,9 @@ typedef struct
 	int (*AddrCompare) (struct qsockaddr *addr1, struct qsockaddr *addr2);
 	int (*GetSocketPort) (struct qsockaddr *addr);
 	int (*SetSocketPort) (struct qsockaddr *addr, int port);
+	// optional, move several datagrams per call. They return how many were read or sent, or -1
+	int (*ReadBatch) (sys_socket_t socketid, netpacket_t *packets, int count);
+	int (*WriteBatch) (sys_socket_t socketid, netpacket_t *packets, int count);
 
 	sys_socket_t listeningSock;
 } net_landriver_t;
@@ -232,6 +267,8 @@ typedef struct
 	qboolean (*CanSendUnreliableMessage) (qsocket_t *sock);
 	void (*Close) (qsocket_t *sock);
 	void (*Shutdown) (void);
+	void (*BeginSendBatch) (void); // optional, see NET_BeginSendBatch
+	void (*FlushSendBatch) (void);
 } net_driver_t;
 
 extern net_driver_t net_drivers[];
@@ -249,6 +286,9 @@ extern int unreliableMessagesReceived;
 
 qsocket_t *NET_NewQSocket (void);
 void	   NET_FreeQSocket (qsocket_t *);
+void	   NET_IndexQSocket (qsocket_t *sock);
+void	   NET_UnindexQSocket (qsocket_t *sock);
+qboolean   NET_LookupQSocket (int driver, const struct qsockaddr *addr, qsocket_t **sock);
 double	   SetNetTime (void);
 
 #define HOSTCACHESIZE 128 // fixme: make dynamic.
@@ -61,6 +61,7 @@ cvar_t net_masters[] = {
 	{"net_masterextra3", "dpmaster.tchr.no:27950"},
 	{NULL}};
 cvar_t		  rcon_password = {"rcon_password", ""};
+cvar_t		  net_window = {"net_window", "16"}; // reliable fragments in flight for peers that support it, 0 for stop-and-wait
 extern cvar_t net_messagetimeout;
 extern cvar_t net_connecttimeout;
 
@@ -73,6 +74,57 @@ static struct
 
 static int myDriverLevel;
 
+// datagrams read ahead from a listening socket by ReadBatch
+#define NET_RECV_BATCH 16
+
+typedef struct
+{
+	sys_socket_t socket;
+	byte		*buffers; // NET_RECV_BATCH times NET_DATAGRAMSIZE
+	netpacket_t	 packets[NET_RECV_BATCH];
+	int			 count;
+	int			 next;
+} recvbatch_t;
+
+static recvbatch_t recvBatch[MAX_NET_DRIVERS];
+
+// datagrams held back between Datagram_BeginSendBatch and Datagram_FlushSendBatch
+typedef struct
+{
+	qsocket_t	*sock; // NULL once closed
+	int			 landriver;
+	sys_socket_t socket;
+	size_t		 offset; // into sendBatchData
+	netpacket_t	 packet;
+} queuedpacket_t;
+
+// in-process link with latency and loss between two qsockets, only set up by net_windowbench
+typedef struct emupacket_s
+{
+	struct emupacket_s *next;
+	double				time;
+	qsocket_t		   *to;
+	int					len;
+	byte				data[NET_DATAGRAMSIZE];
+} emupacket_t;
+
+static struct
+{
+	qsocket_t	*a, *b;
+	double		 latency; // one way
+	int			 loss;	  // percent
+	unsigned int seed;
+	emupacket_t *head, *tail;
+} netEmu;
+
+static qboolean		   sendBatching;
+static queuedpacket_t *sendBatch;
+static int			   sendBatchCount;
+static int			   sendBatchSize;
+static byte			  *sendBatchData;
+static size_t		   sendBatchDataUsed;
+static size_t		   sendBatchDataSize;
+
 extern qboolean m_return_onerror;
 extern char		m_return_reason[32];
 static double	heartbeat_time; // when this is reached, send a heartbeat to all masters.
@@ -148,6 +200,323 @@ static void NET_Ban_f (void)
 }
 #endif // BAN_TEST
 
+/*
+==================
+Datagram_Write
+
+Queued instead of sent while a send batch is open and the lan driver can write batches
+==================
+*/
+static int Datagram_Write (qsocket_t *sock, byte *data, int len)
+{
+	queuedpacket_t *queued;
+
+	if (sock->sendfailed)
+		return -1; // a batched datagram failed since the last send
+
+	if (netEmu.a)
+	{
+		emupacket_t *packet;
+		netEmu.seed = netEmu.seed * 1103515245 + 12345;
+		if ((int)((netEmu.seed >> 16) % 100) < netEmu.loss)
+			return len;
+		packet = (emupacket_t *)Mem_AllocNonZero (sizeof (emupacket_t));
+		packet->next = NULL;
+		packet->time = net_time + netEmu.latency;
+		packet->to = (sock == netEmu.a) ? netEmu.b : netEmu.a;
+		packet->len = len;
+		memcpy (packet->data, data, len);
+		if (netEmu.tail)
+			netEmu.tail->next = packet;
+		else
+			netEmu.head = packet;
+		netEmu.tail = packet;
+		return len;
+	}
+
+	// only server connections batch, so a Host_Error before the flush can't hold back client packets
+	if (!sendBatching || !sock->isvirtual || !sfunc.WriteBatch)
+		return sfunc.Write (sock->socket, data, len, &sock->addr);
+
+	if (sendBatchCount == sendBatchSize)
+	{
+		sendBatchSize = q_max (sendBatchSize * 2, 64);
+		sendBatch = (queuedpacket_t *)Mem_Realloc (sendBatch, sendBatchSize * sizeof (queuedpacket_t));
+	}
+	if (sendBatchDataUsed + len > sendBatchDataSize)
+	{
+		sendBatchDataSize = q_max (sendBatchDataSize * 2, sendBatchDataUsed + len + 65536);
+		sendBatchData = (byte *)Mem_Realloc (sendBatchData, sendBatchDataSize);
+	}
+
+	queued = &sendBatch[sendBatchCount++];
+	queued->sock = sock;
+	queued->landriver = sock->landriver;
+	queued->socket = sock->socket;
+	queued->offset = sendBatchDataUsed;
+	queued->packet.len = len;
+	queued->packet.addr = sock->addr;
+	memcpy (sendBatchData + sendBatchDataUsed, data, len);
+	sendBatchDataUsed += len;
+	return len;
+}
+
+/*
+==================
+Datagram_BeginSendBatch
+==================
+*/
+void Datagram_BeginSendBatch (void)
+{
+	sendBatching = true;
+}
+
+/*
+==================
+Datagram_FlushSendBatch
+
+Hands the queued datagrams to the lan drivers, one WriteBatch per run of
+datagrams for the same socket. The callers were already told the datagrams
+went out, so a qsocket whose datagram failed fails its next send instead,
+and the server drops the client like for an unbatched send error.
+==================
+*/
+void Datagram_FlushSendBatch (void)
+{
+	netpacket_t packets[64];
+	int			first, num;
+
+	sendBatching = false;
+
+	for (first = 0; first < sendBatchCount; first += num)
+	{
+		const queuedpacket_t *run = &sendBatch[first];
+
+		for (num = 0; num < (int)countof (packets) && first + num < sendBatchCount; num++)
+		{
+			if (sendBatch[first + num].landriver != run->landriver || sendBatch[first + num].socket != run->socket)
+				break;
+			packets[num] = sendBatch[first + num].packet;
+			packets[num].data = sendBatchData + sendBatch[first + num].offset;
+		}
+		net_landrivers[run->landriver].WriteBatch (run->socket, packets, num);
+		for (int i = 0; i < num; i++)
+			if (packets[i].len == -1 && sendBatch[first + i].sock)
+				sendBatch[first + i].sock->sendfailed = true;
+	}
+
+	sendBatchCount = 0;
+	sendBatchDataUsed = 0;
+}
+
+/*
+==================
+Datagram_WindowSize
+
+Fragments this end keeps in flight on a windowed stream, 0 to not offer one.
+Each end only bounds what it sends, the ack masks take NET_WINDOW_MAX.
+==================
+*/
+static int Datagram_WindowSize (void)
+{
+	const int window = q_min ((int)net_window.value, NET_WINDOW_MAX);
+	return (window >= 2) ? window : 0;
+}
+
+/*
+==================
+Datagram_WindowSendFragment
+
+Sends fragment sequence of sendMessage on the windowed stream
+==================
+*/
+static int Datagram_WindowSendFragment (qsocket_t *sock, unsigned int sequence)
+{
+	unsigned int fragmentSize = q_min (sock->max_datagram, MAX_DATAGRAM - NET_WINDOW_HEADERSIZE);
+	unsigned int offset = (sequence - sock->sendMessageBase) * fragmentSize;
+	unsigned int packetLen;
+	unsigned int dataLen;
+	unsigned int eom;
+
+	dataLen = sock->sendMessageLength - offset;
+	if (dataLen <= fragmentSize)
+		eom = NETFLAG_EOM;
+	else
+	{
+		dataLen = fragmentSize;
+		eom = 0;
+	}
+	packetLen = NET_HEADERSIZE + NET_WINDOW_HEADERSIZE + dataLen;
+
+	packetBuffer.length = BigLong (packetLen | (NETFLAG_DATA | eom));
+	packetBuffer.sequence = BigLong (sequence);
+	*((unsigned int *)packetBuffer.data) = BigLong (offset);
+	memcpy (packetBuffer.data + NET_WINDOW_HEADERSIZE, sock->sendMessage + offset, dataLen);
+
+	sock->sendFragmentTime[sequence % NET_WINDOW_MAX] = net_time;
+	sock->lastSendTime = net_time;
+	return Datagram_Write (sock, (byte *)&packetBuffer, packetLen);
+}
+
+/*
+==================
+Datagram_WindowSend
+
+The windowed reliable stream keeps up to sock->window fragments of the current message in flight.
+Fragments that timed out, or that the peer's selective acks show were overtaken by later ones, are resent.
+==================
+*/
+static void Datagram_WindowSend (qsocket_t *sock)
+{
+	double		 timeout = CLAMP (0.05, sock->rtt * 2.0, 1.0);
+	unsigned int i;
+
+	for (i = 0; sock->ackSequence + i != sock->sendWindowNext; i++)
+	{
+		double age;
+
+		if (sock->sendAcked & (1u << i))
+			continue;
+		age = net_time - sock->sendFragmentTime[(sock->ackSequence + i) % NET_WINDOW_MAX];
+		if (age >= timeout || (age >= sock->rtt && (sock->sendAcked >> i)))
+		{
+			Datagram_WindowSendFragment (sock, sock->ackSequence + i);
+			sock->sendResent |= 1u << i;
+			packetsReSent++;
+		}
+	}
+
+	while (sock->sendWindowNext != sock->sendSequence && sock->sendWindowNext - sock->ackSequence < (unsigned int)sock->window)
+	{
+		Datagram_WindowSendFragment (sock, sock->sendWindowNext++);
+		packetsSent++;
+	}
+
+	sock->sendNext = false;
+}
+
+/*
+==================
+Datagram_WindowAck
+
+An ack on the windowed stream carries the receiver's next expected sequence and a mask of the fragments it holds past that
+==================
+*/
+static void Datagram_WindowAck (qsocket_t *sock, unsigned int length)
+{
+	unsigned int received;
+	unsigned int mask;
+	unsigned int i;
+
+	if (length < NET_HEADERSIZE + 8)
+	{
+		shortPacketCount++;
+		return;
+	}
+	received = BigLong (((unsigned int *)packetBuffer.data)[0]);
+	mask = BigLong (((unsigned int *)packetBuffer.data)[1]);
+	if (sock->canSend || received - sock->ackSequence > sock->sendWindowNext - sock->ackSequence)
+	{
+		Con_DPrintf ("Stale ACK received\n");
+		return;
+	}
+
+	for (i = 0; sock->ackSequence + i != sock->sendWindowNext; i++)
+	{
+		unsigned int sequence = sock->ackSequence + i;
+		int			 ahead = (int)(sequence - received);
+
+		if (sock->sendAcked & (1u << i))
+			continue;
+		if (ahead >= 0 && (ahead >= NET_WINDOW_MAX || !(mask & (1u << ahead))))
+			continue;
+		sock->sendAcked |= 1u << i;
+		if (!(sock->sendResent & (1u << i))) // resends make for ambiguous samples
+			sock->rtt += (net_time - sock->sendFragmentTime[sequence % NET_WINDOW_MAX] - sock->rtt) * 0.125;
+	}
+
+	while (sock->sendAcked & 1)
+	{
+		sock->sendAcked >>= 1;
+		sock->sendResent >>= 1;
+		sock->ackSequence++;
+	}
+
+	if (sock->ackSequence == sock->sendSequence)
+	{
+		sock->sendMessageLength = 0;
+		sock->canSend = true;
+	}
+	else
+		sock->sendNext = true;
+}
+
+/*
+==================
+Datagram_WindowData
+
+Stores a windowed fragment at its offset in receiveMessage and acks everything held so far.
+Returns 1 when the message is complete in net_message, -1 if it is over-sized.
+==================
+*/
+static int Datagram_WindowData (qsocket_t *sock, unsigned int sequence, unsigned int flags, unsigned int length)
+{
+	unsigned int slot = sequence - sock->receiveSequence;
+	unsigned int offset;
+	qboolean	 complete = false;
+
+	if (length < NET_HEADERSIZE + NET_WINDOW_HEADERSIZE)
+	{
+		shortPacketCount++;
+		return 0;
+	}
+	length -= NET_HEADERSIZE + NET_WINDOW_HEADERSIZE;
+	offset = BigLong (*((unsigned int *)packetBuffer.data));
+
+	if (slot >= NET_WINDOW_MAX || (sock->receiveMask & (1u << slot)))
+		receivedDuplicateCount++;
+	else if (offset > sizeof (sock->receiveMessage) || length > sizeof (sock->receiveMessage) - offset)
+	{
+		Con_Printf ("Over-sized reliable\n");
+		return -1;
+	}
+	else
+	{
+		memcpy (sock->receiveMessage + offset, packetBuffer.data + NET_WINDOW_HEADERSIZE, length);
+		sock->receiveMask |= 1u << slot;
+		if (flags & NETFLAG_EOM)
+		{
+			sock->receiveMessageEnd = offset + length;
+			sock->receiveEomSequence = sequence;
+		}
+		while ((sock->receiveMask & 1) && !complete)
+		{
+			complete = sock->receiveMessageEnd >= 0 && sock->receiveSequence == sock->receiveEomSequence;
+			sock->receiveMask >>= 1;
+			sock->receiveSequence++;
+		}
+	}
+
+	packetBuffer.length = BigLong ((NET_HEADERSIZE + 8) | NETFLAG_ACK);
+	packetBuffer.sequence = BigLong (sequence);
+	((unsigned int *)packetBuffer.data)[0] = BigLong (sock->receiveSequence);
+	((unsigned int *)packetBuffer.data)[1] = BigLong (sock->receiveMask);
+	Datagram_Write (sock, (byte *)&packetBuffer, NET_HEADERSIZE + 8);
+
+	if (!complete)
+		return 0;
+
+	if (sock->receiveMessageEnd > net_message.maxsize)
+	{
+		Con_Printf ("Over-sized reliable\n");
+		return -1;
+	}
+	SZ_Clear (&net_message);
+	SZ_Write (&net_message, sock->receiveMessage, sock->receiveMessageEnd);
+	sock->receiveMessageEnd = -1;
+	return 1;
+}
+
 int Datagram_SendMessage (qsocket_t *sock, sizebuf_t *data)
 {
 	unsigned int packetLen;
@@ -170,6 +539,20 @@ int Datagram_SendMessage (qsocket_t *sock, sizebuf_t *data)
 
 	sock->max_datagram = sock->pending_max_datagram; // this can apply only at the start of a reliable, to avoid issues with acks if its resized later.
 
+	if (sock->window)
+	{
+		unsigned int fragmentSize = q_min (sock->max_datagram, MAX_DATAGRAM - NET_WINDOW_HEADERSIZE);
+
+		sock->sendMessageBase = sock->sendSequence;
+		sock->sendWindowNext = sock->sendSequence;
+		sock->sendSequence += q_max ((data->cursize + fragmentSize - 1) / fragmentSize, 1u);
+		sock->sendAcked = 0;
+		sock->sendResent = 0;
+		sock->canSend = false;
+		Datagram_WindowSend (sock);
+		return 1;
+	}
+
 	if (data->cursize <= sock->max_datagram)
 	{
 		dataLen = data->cursize;
@@ -188,7 +571,7 @@ int Datagram_SendMessage (qsocket_t *sock, sizebuf_t *data)
 
 	sock->canSend = false;
 
-	if (sfunc.Write (sock->socket, (byte *)&packetBuffer, packetLen, &sock->addr) == -1)
+	if (Datagram_Write (sock, (byte *)&packetBuffer, packetLen) == -1)
 		return -1;
 
 	sock->lastSendTime = net_time;
@@ -202,6 +585,12 @@ static int SendMessageNext (qsocket_t *sock)
 	unsigned int dataLen;
 	unsigned int eom;
 
+	if (sock->window)
+	{
+		Datagram_WindowSend (sock);
+		return 1;
+	}
+
 	if (sock->sendMessageLength <= sock->max_datagram)
 	{
 		dataLen = sock->sendMessageLength;
@@ -220,7 +609,7 @@ static int SendMessageNext (qsocket_t *sock)
 
 	sock->sendNext = false;
 
-	if (sfunc.Write (sock->socket, (byte *)&packetBuffer, packetLen, &sock->addr) == -1)
+	if (Datagram_Write (sock, (byte *)&packetBuffer, packetLen) == -1)
 		return -1;
 
 	sock->lastSendTime = net_time;
@@ -250,7 +639,7 @@ static int ReSendMessage (qsocket_t *sock)
 	packetBuffer.sequence = BigLong (sock->sendSequence - 1);
 	memcpy (packetBuffer.data, sock->sendMessage, dataLen);
 
-	if (sfunc.Write (sock->socket, (byte *)&packetBuffer, packetLen, &sock->addr) == -1)
+	if (Datagram_Write (sock, (byte *)&packetBuffer, packetLen) == -1)
 		return -1;
 
 	sock->lastSendTime = net_time;
@@ -258,6 +647,21 @@ static int ReSendMessage (qsocket_t *sock)
 	return 1;
 }
 
+/*
+==================
+ReSendTimedOut
+
+Called every frame while a reliable is unacknowledged
+==================
+*/
+static void ReSendTimedOut (qsocket_t *sock)
+{
+	if (sock->window)
+		Datagram_WindowSend (sock);
+	else if ((net_time - sock->lastSendTime) > 1.0)
+		ReSendMessage (sock);
+}
+
 qboolean Datagram_CanSendMessage (qsocket_t *sock)
 {
 	if (sock->sendNext)
@@ -289,7 +693,7 @@ int Datagram_SendUnreliableMessage (qsocket_t *sock, sizebuf_t *data)
 	packetBuffer.sequence = BigLong (sock->unreliableSendSequence++);
 	memcpy (packetBuffer.data, data->data, data->cursize);
 
-	if (sfunc.Write (sock->socket, (byte *)&packetBuffer, packetLen, &sock->addr) == -1)
+	if (Datagram_Write (sock, (byte *)&packetBuffer, packetLen) == -1)
 		return -1;
 
 	packetsSent++;
@@ -351,6 +755,11 @@ qboolean Datagram_ProcessPacket (unsigned int length, qsocket_t *sock)
 
 	if (flags & NETFLAG_ACK)
 	{
+		if (sock->window)
+		{
+			Datagram_WindowAck (sock, length);
+			return false;
+		}
 		if (sequence != (sock->sendSequence - 1))
 		{
 			Con_DPrintf ("Stale ACK received\n");
@@ -383,9 +792,12 @@ qboolean Datagram_ProcessPacket (unsigned int length, qsocket_t *sock)
 
 	if (flags & NETFLAG_DATA)
 	{
+		if (sock->window)
+			return Datagram_WindowData (sock, sequence, flags, length) != 0;
+
 		packetBuffer.length = BigLong (NET_HEADERSIZE | NETFLAG_ACK);
 		packetBuffer.sequence = BigLong (sequence);
-		sfunc.Write (sock->socket, (byte *)&packetBuffer, NET_HEADERSIZE, &sock->addr);
+		Datagram_Write (sock, (byte *)&packetBuffer, NET_HEADERSIZE);
 
 		if (sequence != sock->receiveSequence)
 		{
@@ -426,6 +838,65 @@ qboolean Datagram_ProcessPacket (unsigned int length, qsocket_t *sock)
 	return false;
 }
 
+/*
+==================
+Datagram_IsVirtualFor
+
+Whether a datagram from addr to the current lan driver's listening socket belongs to s
+==================
+*/
+static qboolean Datagram_IsVirtualFor (qsocket_t *s, struct qsockaddr *addr)
+{
+	return s->driver == net_driverlevel && !s->disconnected && s->isvirtual && dfunc.AddrCompare (addr, &s->addr) == 0;
+}
+
+/*
+==================
+Datagram_ReadListening
+
+Reads the next datagram of the current lan driver's listening socket into
+packetBuffer. Returns its length, 0 if there is none or -1 on errors.
+==================
+*/
+static int Datagram_ReadListening (sys_socket_t sock, struct qsockaddr *addr)
+{
+	recvbatch_t *batch = &recvBatch[net_landriverlevel];
+	netpacket_t *packet;
+	int			 i;
+
+	if (!dfunc.ReadBatch)
+		return dfunc.Read (sock, (byte *)&packetBuffer, NET_DATAGRAMSIZE, addr);
+
+	if (batch->socket != sock)
+	{
+		batch->socket = sock;
+		batch->count = batch->next = 0;
+	}
+	if (batch->next == batch->count)
+	{
+		if (!batch->buffers)
+			batch->buffers = (byte *)Mem_AllocNonZero (NET_RECV_BATCH * NET_DATAGRAMSIZE);
+		for (i = 0; i < NET_RECV_BATCH; i++)
+		{
+			batch->packets[i].data = batch->buffers + i * NET_DATAGRAMSIZE;
+			batch->packets[i].len = NET_DATAGRAMSIZE;
+		}
+		batch->next = 0;
+		batch->count = dfunc.ReadBatch (sock, batch->packets, NET_RECV_BATCH);
+		if (batch->count <= 0)
+		{
+			i = batch->count;
+			batch->count = 0;
+			return i;
+		}
+	}
+
+	packet = &batch->packets[batch->next++];
+	memcpy (&packetBuffer, packet->data, packet->len);
+	*addr = packet->addr;
+	return packet->len;
+}
+
 qsocket_t *Datagram_GetAnyMessage (void)
 {
 	qsocket_t		*s;
@@ -442,7 +913,7 @@ qsocket_t *Datagram_GetAnyMessage (void)
 
 		while (1)
 		{
-			length = dfunc.Read (sock, (byte *)&packetBuffer, NET_DATAGRAMSIZE, &addr);
+			length = Datagram_ReadListening (sock, &addr);
 			if (length == -1 || !length)
 			{
 				// no more packets, move on to the next.
@@ -458,15 +929,22 @@ qsocket_t *Datagram_GetAnyMessage (void)
 			}
 
 			// figure out which qsocket it was for
+			if (NET_LookupQSocket (net_driverlevel, &addr, &s) && s && Datagram_IsVirtualFor (s, &addr))
+			{
+				// okay, looks like this is us. try to process it, and if there's new data
+				if (Datagram_ProcessPacket (length, s))
+				{
+					s->lastMessageTime = net_time;
+					return s; // the server needs to parse that packet.
+				}
+				continue;
+			}
+			// not indexed, the index can't tell ipv6 scopes apart, or it only
+			// holds the newest of several qsockets for this address and that
+			// one has been closed since
 			for (s = net_activeSockets; s; s = s->next)
 			{
-				if (s->driver != net_driverlevel)
-					continue;
-				if (s->disconnected)
-					continue;
-				if (!s->isvirtual)
-					continue;
-				if (dfunc.AddrCompare (&addr, &s->addr) == 0)
+				if (Datagram_IsVirtualFor (s, &addr))
 				{
 					// okay, looks like this is us. try to process it, and if there's new data
 					if (Datagram_ProcessPacket (length, s))
@@ -489,8 +967,7 @@ qsocket_t *Datagram_GetAnyMessage (void)
 		if (s->sendNext)
 			SendMessageNext (s);
 		if (!s->canSend)
-			if ((net_time - s->lastSendTime) > 1.0)
-				ReSendMessage (s);
+			ReSendTimedOut (s);
 
 		if (net_time - s->lastMessageTime > ((!s->ackSequence) ? net_connecttimeout.value : net_messagetimeout.value))
 		{ // timed out, kick them
@@ -521,8 +998,7 @@ int Datagram_GetMessage (qsocket_t *sock)
 	unsigned int	 count;
 
 	if (!sock->canSend)
-		if ((net_time - sock->lastSendTime) > 1.0)
-			ReSendMessage (sock);
+		ReSendTimedOut (sock);
 
 	while (1)
 	{
@@ -591,6 +1067,11 @@ int Datagram_GetMessage (qsocket_t *sock)
 
 		if (flags & NETFLAG_ACK)
 		{
+			if (sock->window)
+			{
+				Datagram_WindowAck (sock, length);
+				continue;
+			}
 			if (sequence != (sock->sendSequence - 1))
 			{
 				Con_DPrintf ("Stale ACK received\n");
@@ -623,9 +1104,19 @@ int Datagram_GetMessage (qsocket_t *sock)
 
 		if (flags & NETFLAG_DATA)
 		{
+			if (sock->window)
+			{
+				ret = Datagram_WindowData (sock, sequence, flags, length);
+				if (ret == -1)
+					return -1;
+				if (ret == 1)
+					break;
+				continue;
+			}
+
 			packetBuffer.length = BigLong (NET_HEADERSIZE | NETFLAG_ACK);
 			packetBuffer.sequence = BigLong (sequence);
-			sfunc.Write (sock->socket, (byte *)&packetBuffer, NET_HEADERSIZE, &readaddr);
+			Datagram_Write (sock, (byte *)&packetBuffer, NET_HEADERSIZE);
 
 			if (sequence != sock->receiveSequence)
 			{
@@ -674,6 +1165,8 @@ static void PrintStats (qsocket_t *s)
 	Con_Printf ("canSend = %4u   \n", s->canSend);
 	Con_Printf ("sendSeq = %4u   ", s->sendSequence);
 	Con_Printf ("recvSeq = %4u   \n", s->receiveSequence);
+	if (s->window)
+		Con_Printf ("window  = %4i   rtt = %.0fms\n", s->window, s->rtt * 1000.0);
 	Con_Printf ("\n");
 }
 
@@ -1013,6 +1506,216 @@ JustDoIt:
 	SchedulePollProcedure (&test2PollProcedure, 0.05);
 }
 
+/*
+==================
+NET_BatchBench_f
+
+net_batchbench [datagrams] [size]
+
+Sends datagrams between two loopback sockets of the first lan driver, first
+with a Write and Read per datagram and then with WriteBatch and ReadBatch,
+and prints how many datagrams per second each way gets through.
+==================
+*/
+#define BATCHBENCH_ROUND 64 // datagrams in flight, well below the socket buffer sizes
+
+static void NET_BatchBench_f (void)
+{
+	const int		 total = Cmd_Argc () > 1 ? q_max (BATCHBENCH_ROUND, atoi (Cmd_Argv (1))) : 200000;
+	const int		 size = Cmd_Argc () > 2 ? CLAMP (NET_HEADERSIZE, atoi (Cmd_Argv (2)), 1400) : 1024;
+	netpacket_t		 packets[BATCHBENCH_ROUND];
+	struct qsockaddr rxaddr, addr;
+	sys_socket_t	 tx, rx;
+	byte			*buffers;
+	double			 start, sendtime, recvtime;
+	int				 batched, sent, received, i, n;
+
+	net_landriverlevel = 0;
+	if (!net_numlandrivers || !dfunc.initialized)
+	{
+		Con_Printf ("net_batchbench: no lan driver running\n");
+		return;
+	}
+
+	tx = dfunc.Open_Socket (0);
+	rx = dfunc.Open_Socket (0);
+	if (tx == INVALID_SOCKET || rx == INVALID_SOCKET || dfunc.GetSocketAddr (rx, &addr) == -1)
+	{
+		Con_Printf ("net_batchbench: couldn't open the sockets\n");
+		if (tx != INVALID_SOCKET)
+			dfunc.Close_Socket (tx);
+		if (rx != INVALID_SOCKET)
+			dfunc.Close_Socket (rx);
+		return;
+	}
+	dfunc.StringToAddr ("127.0.0.1:0", &rxaddr);
+	dfunc.SetSocketPort (&rxaddr, dfunc.GetSocketPort (&addr));
+
+	buffers = (byte *)Mem_Alloc (BATCHBENCH_ROUND * size);
+	Con_Printf ("net_batchbench: %i datagrams of %i bytes over %s loopback\n", total, size, dfunc.name);
+
+	for (batched = 0; batched < 2; batched++)
+	{
+		if (batched && (!dfunc.ReadBatch || !dfunc.WriteBatch))
+		{
+			Con_Printf ("%-8s not supported by %s\n", "batched", dfunc.name);
+			break;
+		}
+
+		sendtime = recvtime = 0.0;
+		received = 0;
+		for (sent = 0; sent < total; sent += BATCHBENCH_ROUND)
+		{
+			for (i = 0; i < BATCHBENCH_ROUND; i++)
+			{
+				packets[i].data = buffers + i * size;
+				packets[i].len = size;
+				packets[i].addr = rxaddr;
+			}
+
+			start = Sys_DoubleTime ();
+			if (batched)
+				dfunc.WriteBatch (tx, packets, BATCHBENCH_ROUND);
+			else
+				for (i = 0; i < BATCHBENCH_ROUND; i++)
+					dfunc.Write (tx, packets[i].data, size, &rxaddr);
+			sendtime += Sys_DoubleTime () - start;
+
+			// loopback datagrams are already queued on rx when the send returns
+			start = Sys_DoubleTime ();
+			do
+			{
+				if (batched)
+					n = dfunc.ReadBatch (rx, packets, BATCHBENCH_ROUND);
+				else
+					n = dfunc.Read (rx, buffers, size, &addr) > 0;
+				received += q_max (n, 0);
+			} while (n > 0);
+			recvtime += Sys_DoubleTime () - start;
+		}
+
+		Con_Printf (
+			"%-8s send %10.0f/s receive %10.0f/s, %i of %i received\n", batched ? "batched" : "single", sent / q_max (sendtime, 1e-9),
+			received / q_max (recvtime, 1e-9), received, sent);
+	}
+
+	Mem_Free (buffers);
+	dfunc.Close_Socket (tx);
+	dfunc.Close_Socket (rx);
+}
+
+/*
+==================
+NET_WindowBench_f
+
+net_windowbench [rtt ms] [loss percent] [messages] [size]
+
+Streams a signon's worth of reliable messages between two qsockets over an
+emulated link with the given round trip time and random loss in both
+directions, once with the stop-and-wait stream and once with a net_window
+fragment window, and prints the simulated time until the last one arrived.
+==================
+*/
+#define WINDOWBENCH_MSS		1400
+#define WINDOWBENCH_TIMEOUT 600.0
+
+static double NET_WindowBenchRun (int window, sizebuf_t *message, int messages, int *sent, int *resent)
+{
+	qsocket_t	*tx = (qsocket_t *)Mem_Alloc (sizeof (qsocket_t));
+	qsocket_t	*rx = (qsocket_t *)Mem_Alloc (sizeof (qsocket_t));
+	emupacket_t *packet;
+	int			 queued = 0, received = 0;
+	int			 oldSent = packetsSent, oldReSent = packetsReSent;
+
+	tx->canSend = rx->canSend = true;
+	tx->pending_max_datagram = WINDOWBENCH_MSS;
+	tx->window = rx->window = window;
+	tx->rtt = rx->rtt = 0.5;
+	tx->receiveMessageEnd = rx->receiveMessageEnd = -1;
+	netEmu.a = tx;
+	netEmu.b = rx;
+	netEmu.seed = 1;
+
+	for (net_time = 0.0; received < messages && net_time < WINDOWBENCH_TIMEOUT; net_time += 0.001)
+	{
+		while (netEmu.head && netEmu.head->time <= net_time)
+		{
+			packet = netEmu.head;
+			netEmu.head = packet->next;
+			if (!netEmu.head)
+				netEmu.tail = NULL;
+			memcpy (&packetBuffer, packet->data, packet->len);
+			if (Datagram_ProcessPacket (packet->len, packet->to) && packet->to == rx)
+			{
+				if (net_message.cursize != message->cursize || net_message.data[0] != (byte)received)
+					Con_Printf ("net_windowbench: message %i arrived damaged\n", received);
+				received++;
+			}
+			Mem_Free (packet);
+		}
+
+		// same as the server's frame in Datagram_GetAnyMessage
+		if (tx->sendNext)
+			SendMessageNext (tx);
+		if (!tx->canSend)
+			ReSendTimedOut (tx);
+		if (queued < messages && Datagram_CanSendMessage (tx))
+		{
+			message->data[0] = queued++;
+			Datagram_SendMessage (tx, message);
+		}
+	}
+
+	while (netEmu.head)
+	{
+		packet = netEmu.head;
+		netEmu.head = packet->next;
+		Mem_Free (packet);
+	}
+	netEmu.tail = NULL;
+	netEmu.a = netEmu.b = NULL;
+	Mem_Free (tx);
+	Mem_Free (rx);
+
+	*sent = packetsSent - oldSent;
+	*resent = packetsReSent - oldReSent;
+	return (received == messages) ? net_time : -1.0;
+}
+
+static void NET_WindowBench_f (void)
+{
+	const double rtt = Cmd_Argc () > 1 ? CLAMP (0.0, atof (Cmd_Argv (1)), 5000.0) : 100.0;
+	const int	 loss = Cmd_Argc () > 2 ? CLAMP (0, atoi (Cmd_Argv (2)), 90) : 2;
+	const int	 messages = Cmd_Argc () > 3 ? CLAMP (1, atoi (Cmd_Argv (3)), 1000) : 32;
+	const int	 size = Cmd_Argc () > 4 ? CLAMP (1, atoi (Cmd_Argv (4)), NET_MAXMESSAGE) : 8000;
+	const int	 window = CLAMP (2, (int)net_window.value, NET_WINDOW_MAX);
+	sizebuf_t	 message;
+	double		 elapsed;
+	int			 windowed, sent, resent;
+
+	if (!Host_BenchAllowed ())
+		return;
+
+	memset (&message, 0, sizeof (message));
+	message.data = (byte *)Mem_Alloc (size);
+	message.maxsize = message.cursize = size;
+	netEmu.latency = rtt / 2000.0;
+	netEmu.loss = loss;
+
+	Con_Printf ("net_windowbench: %i messages of %i bytes, %.0fms rtt, %i%% loss\n", messages, size, rtt, loss);
+	for (windowed = 0; windowed < 2; windowed++)
+	{
+		elapsed = NET_WindowBenchRun (windowed ? window : 0, &message, messages, &sent, &resent);
+		if (elapsed < 0.0)
+			Con_Printf ("%-14s timed out, %i fragments sent, %i resent\n", windowed ? va ("window %i", window) : "stop-and-wait", sent, resent);
+		else
+			Con_Printf ("%-14s %7.2fs, %i fragments sent, %i resent\n", windowed ? va ("window %i", window) : "stop-and-wait", elapsed, sent, resent);
+	}
+
+	Mem_Free (message.data);
+	SetNetTime ();
+}
+
 int Datagram_Init (void)
 {
 	int			 i, num_inited;
@@ -1025,6 +1728,8 @@ int Datagram_Init (void)
 	myDriverLevel = net_driverlevel;
 
 	Cmd_AddCommand ("net_stats", NET_Stats_f);
+	Cvar_RegisterVariable (&net_window);
+	Cmd_AddCommand ("net_windowbench", NET_WindowBench_f);
 
 	if (safemode || COM_CheckParm ("-nolan"))
 		return -1;
@@ -1046,6 +1751,7 @@ int Datagram_Init (void)
 
 	Cmd_AddCommand ("test", Test_f);
 	Cmd_AddCommand ("test2", Test2_f);
+	Cmd_AddCommand ("net_batchbench", NET_BatchBench_f);
 
 	return 0;
 }
@@ -1071,10 +1777,15 @@ void Datagram_Shutdown (void)
 
 void Datagram_Close (qsocket_t *sock)
 {
+	for (int i = 0; i < sendBatchCount; i++)
+		if (sendBatch[i].sock == sock)
+			sendBatch[i].sock = NULL;
+
 	if (sock->isvirtual)
 	{
 		sock->isvirtual = false;
 		sock->socket = INVALID_SOCKET;
+		NET_UnindexQSocket (sock);
 	}
 	else
 		sfunc.Close_Socket (sock->socket);
@@ -1087,9 +1798,13 @@ void Datagram_Listen (qboolean state)
 	qboolean   islistening = false;
 
 	heartbeat_time = 0; // reset it
+	sendBatching = false;
+	sendBatchCount = 0;
+	sendBatchDataUsed = 0;
 
 	for (i = 0; i < net_numlandrivers; i++)
 	{
+		recvBatch[i].count = recvBatch[i].next = 0; // read ahead from a socket that may be gone now
 		if (net_landrivers[i].initialized)
 		{
 			net_landrivers[i].listeningSock = net_landrivers[i].Listen (state);
@@ -1102,6 +1817,7 @@ void Datagram_Listen (qboolean state)
 				{
 					s->isvirtual = false;
 					s->socket = INVALID_SOCKET;
+					NET_UnindexQSocket (s);
 				}
 			}
 		}
@@ -1145,6 +1861,7 @@ static void _Datagram_ServerControlPacket (sys_socket_t acceptsock, struct qsock
 	int				 ret;
 	int				 plnum;
 	int				 mod; //, mod_ver, mod_flags, mod_passwd;	//proquake extensions
+	int				 window; // reliable fragments in flight, see Datagram_WindowSend
 
 	control = BigLong (*((int *)data));
 	if (control == -1)
@@ -1432,6 +2149,15 @@ static void _Datagram_ServerControlPacket (sys_socket_t acceptsock, struct qsock
 	(void)mod_passwd;
 #endif
 
+	// the window extension is a bit of the proquake flags
+	window = 0;
+	if (mod == 1)
+	{
+		MSG_ReadByte ();
+		if ((MSG_ReadByte () & NET_WINDOW_FLAG) && !msg_badread)
+			window = Datagram_WindowSize ();
+	}
+
 #ifdef BAN_TEST
 	// check for a ban
 	// fixme: no ipv6
@@ -1481,7 +2207,7 @@ static void _Datagram_ServerControlPacket (sys_socket_t acceptsock, struct qsock
 				{
 					MSG_WriteByte (&net_message, 1);  // proquake
 					MSG_WriteByte (&net_message, 30); // ver 30 should be safe. 34 screws with our single-server-socket stuff.
-					MSG_WriteByte (&net_message, 0);  // no flags
+					MSG_WriteByte (&net_message, s->window ? NET_WINDOW_FLAG : 0);
 				}
 				*((int *)net_message.data) = BigLong (NETFLAG_CTL | (net_message.cursize & NETFLAG_LENGTH_MASK));
 				dfunc.Write (acceptsock, net_message.data, net_message.cursize, clientaddr);
@@ -1536,12 +2262,14 @@ static void _Datagram_ServerControlPacket (sys_socket_t acceptsock, struct qsock
 	}
 
 	sock->proquake_angle_hack = (mod == 1);
+	sock->window = window;
 
 	// everything is allocated, just fill in the details
 	sock->isvirtual = true;
 	sock->socket = acceptsock;
 	sock->landriver = net_landriverlevel;
 	sock->addr = *clientaddr;
+	NET_IndexQSocket (sock);
 	strcpy (sock->trueaddress, dfunc.AddrToString (clientaddr, false));
 	strcpy (sock->maskedaddress, dfunc.AddrToString (clientaddr, true));
 
@@ -1557,7 +2285,7 @@ static void _Datagram_ServerControlPacket (sys_socket_t acceptsock, struct qsock
 	{
 		MSG_WriteByte (&net_message, 1);  // proquake
 		MSG_WriteByte (&net_message, 30); // ver 30 should be safe. 34 screws with our single-server-socket stuff.
-		MSG_WriteByte (&net_message, 0);
+		MSG_WriteByte (&net_message, sock->window ? NET_WINDOW_FLAG : 0);
 	}
 	*((int *)net_message.data) = BigLong (NETFLAG_CTL | (net_message.cursize & NETFLAG_LENGTH_MASK));
 	dfunc.Write (acceptsock, net_message.data, net_message.cursize, clientaddr);
@@ -2015,6 +2743,7 @@ static qsocket_t *_Datagram_Connect (struct qsockaddr *serveraddr)
 	int				 reps;
 	double			 start_time;
 	int				 control;
+	int				 window;
 	const char		*reason;
 
 	newsock = dfunc.Open_Socket (0);
@@ -2032,6 +2761,7 @@ static qsocket_t *_Datagram_Connect (struct qsockaddr *serveraddr)
 		goto ErrorReturn;
 
 	sock->proquake_angle_hack = true;
+	window = Datagram_WindowSize (); // what was offered, even if net_window changes before the reply
 
 	// send the connection request
 	Con_SafePrintf ("trying...\n");
@@ -2050,10 +2780,10 @@ static qsocket_t *_Datagram_Connect (struct qsockaddr *serveraddr)
 		{ /*Spike -- proquake compat. if both engines claim to be using mod==1 then 16bit client->server angles can be used. server->client angles remain
 			 16bit*/
 			Con_DWarning ("Attempting to use ProQuake angle hack\n");
-			MSG_WriteByte (&net_message, 1);  /*'mod', 1=proquake*/
-			MSG_WriteByte (&net_message, 34); /*'mod' version*/
-			MSG_WriteByte (&net_message, 0);  /*flags*/
-			MSG_WriteLong (&net_message, 0);  // strtoul(password.string, NULL, 0)); /*password*/
+			MSG_WriteByte (&net_message, 1);							/*'mod', 1=proquake*/
+			MSG_WriteByte (&net_message, 34);							/*'mod' version*/
+			MSG_WriteByte (&net_message, window ? NET_WINDOW_FLAG : 0); /*flags*/
+			MSG_WriteLong (&net_message, 0);							// strtoul(password.string, NULL, 0)); /*password*/
 		}
 		*((int *)net_message.data) = BigLong (NETFLAG_CTL | (net_message.cursize & NETFLAG_LENGTH_MASK));
 		dfunc.Write (newsock, net_message.data, net_message.cursize, serveraddr);
@@ -2202,6 +2932,7 @@ static qsocket_t *_Datagram_Connect (struct qsockaddr *serveraddr)
 				goto ErrorReturn;
 			}
 			sock->proquake_angle_hack = true;
+			sock->window = (flags & NET_WINDOW_FLAG) ? window : 0;
 		}
 		else
 			sock->proquake_angle_hack = false;
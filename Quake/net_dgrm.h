@@ -36,5 +36,7 @@ qboolean   Datagram_CanSendMessage (qsocket_t *sock);
 qboolean   Datagram_CanSendUnreliableMessage (qsocket_t *sock);
 void	   Datagram_Close (qsocket_t *sock);
 void	   Datagram_Shutdown (void);
+void	   Datagram_BeginSendBatch (void);
+void	   Datagram_FlushSendBatch (void);
 
 #endif /* __NET_DATAGRAM_H */
@@ -30,9 +30,14 @@ static qboolean	  localconnectpending = false;
 static qsocket_t *loop_client = NULL;
 static qsocket_t *loop_server = NULL;
 
+// server ends of the benchmark bot connections (see Loop_ConnectBot)
+static qsocket_t *loop_bots[MAX_SCOREBOARD];
+static int		  loop_numbots = 0;
+static int		  loop_numbotsaccepted = 0;
+
 int Loop_Init (void)
 {
-	if (cls.state == ca_dedicated)
+	if (cls.state == ca_dedicated && !COM_CheckParm ("-benchserver"))
 		return -1;
 	return 0;
 }
@@ -102,8 +107,58 @@ qsocket_t *Loop_Connect (const char *host)
 	return loop_client;
 }
 
+/*
+===================
+Loop_ConnectBot
+
+Creates a loopback pair for a scripted client of the server benchmark. The
+returned client end is not a qsocket of the network layer, it is driven with
+the Loop_* functions directly and released with Loop_FreeBot.
+===================
+*/
+qsocket_t *Loop_ConnectBot (void)
+{
+	qsocket_t *bot_client;
+	qsocket_t *bot_server;
+
+	if (loop_numbots == countof (loop_bots))
+		return NULL;
+	if ((bot_server = NET_NewQSocket ()) == NULL)
+		return NULL;
+
+	bot_server->driver = 0; // IS_LOOP_DRIVER, whatever driver level NET_NewQSocket was called at
+
+	bot_client = (qsocket_t *)Mem_Alloc (sizeof (qsocket_t));
+	q_snprintf (bot_client->trueaddress, sizeof (bot_client->trueaddress), "bot%i", loop_numbots);
+	q_strlcpy (bot_client->maskedaddress, bot_client->trueaddress, sizeof (bot_client->maskedaddress));
+	q_strlcpy (bot_server->trueaddress, bot_client->trueaddress, sizeof (bot_server->trueaddress));
+	q_strlcpy (bot_server->maskedaddress, bot_client->trueaddress, sizeof (bot_server->maskedaddress));
+	bot_client->canSend = true;
+
+	bot_client->driverdata = (void *)bot_server;
+	bot_server->driverdata = (void *)bot_client;
+
+	loop_bots[loop_numbots++] = bot_server;
+	return bot_client;
+}
+
+/*
+===================
+Loop_FreeBot
+===================
+*/
+void Loop_FreeBot (qsocket_t *bot_client)
+{
+	if (bot_client->driverdata)
+		((qsocket_t *)bot_client->driverdata)->driverdata = NULL;
+	Mem_Free (bot_client);
+}
+
 qsocket_t *Loop_CheckNewConnections (void)
 {
+	if (loop_numbotsaccepted < loop_numbots)
+		return loop_bots[loop_numbotsaccepted++];
+
 	if (!localconnectpending)
 		return NULL;
 
@@ -161,11 +216,18 @@ int Loop_GetMessage (qsocket_t *sock)
 
 qsocket_t *Loop_GetAnyMessage (void)
 {
+	int i;
+
 	if (loop_server)
 	{
 		if (Loop_GetMessage (loop_server) > 0)
 			return loop_server;
 	}
+	for (i = 0; i < loop_numbotsaccepted; i++)
+	{
+		if (loop_bots[i] && Loop_GetMessage (loop_bots[i]) > 0)
+			return loop_bots[i];
+	}
 	return NULL;
 }
 
@@ -254,6 +316,8 @@ qboolean Loop_CanSendUnreliableMessage (qsocket_t *sock)
 
 void Loop_Close (qsocket_t *sock)
 {
+	int i;
+
 	if (sock->driverdata)
 		((qsocket_t *)sock->driverdata)->driverdata = NULL;
 	sock->receiveMessageLength = 0;
@@ -261,6 +325,12 @@ void Loop_Close (qsocket_t *sock)
 	sock->canSend = true;
 	if (sock == loop_client)
 		loop_client = NULL;
-	else
+	else if (sock == loop_server)
 		loop_server = NULL;
+	else
+	{
+		for (i = 0; i < loop_numbots; i++)
+			if (loop_bots[i] == sock)
+				loop_bots[i] = NULL;
+	}
 }
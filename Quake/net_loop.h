@@ -37,5 +37,7 @@ qboolean   Loop_CanSendMessage (qsocket_t *sock);
 qboolean   Loop_CanSendUnreliableMessage (qsocket_t *sock);
 void	   Loop_Close (qsocket_t *sock);
 void	   Loop_Shutdown (void);
+qsocket_t *Loop_ConnectBot (void);
+void	   Loop_FreeBot (qsocket_t *bot_client);
 
 #endif /* __NET_LOOP_H */
@@ -80,6 +80,130 @@ double SetNetTime (void)
 	return net_time;
 }
 
+/*
+===============================================================================
+
+QSOCKET ADDRESS INDEX
+
+Maps the driver and peer address of the qsockets a driver demultiplexes by
+address, so an incoming datagram finds its connection without walking
+net_activeSockets. Only IPv4 and IPv6 addresses are indexed.
+
+===============================================================================
+*/
+
+typedef struct
+{
+	int32_t	 driver;
+	int32_t	 family;
+	uint32_t port;
+	byte	 addr[16];
+} qsocketkey_t;
+
+static hash_map_t *net_qsocketindex;
+
+static uint32_t NET_HashQSocketKey (const void *const val)
+{
+	const qsocketkey_t *key = (const qsocketkey_t *)val;
+	uint32_t			hash = HashCombine (HashInt32 (&key->driver), HashCombine (HashInt32 (&key->family), HashInt32 (&key->port)));
+	uint32_t			word;
+	int					i;
+
+	for (i = 0; i < (int)sizeof (key->addr); i += 4)
+	{
+		memcpy (&word, key->addr + i, 4);
+		hash = HashCombine (hash, HashInt32 (&word));
+	}
+	return hash;
+}
+
+static qboolean NET_QSocketKey (int driver, const struct qsockaddr *addr, qsocketkey_t *key)
+{
+	memset (key, 0, sizeof (*key));
+	key->driver = driver;
+	key->family = addr->qsa_family;
+	if (addr->qsa_family == AF_INET)
+	{
+		key->port = ((const struct sockaddr_in *)addr)->sin_port;
+		memcpy (key->addr, &((const struct sockaddr_in *)addr)->sin_addr, sizeof (((const struct sockaddr_in *)addr)->sin_addr));
+		return true;
+	}
+#ifdef AF_INET6
+	if (addr->qsa_family == AF_INET6)
+	{
+		// no scope id: AddrCompare lets an unset one match any
+		key->port = ((const struct sockaddr_in6 *)addr)->sin6_port;
+		memcpy (key->addr, &((const struct sockaddr_in6 *)addr)->sin6_addr, sizeof (((const struct sockaddr_in6 *)addr)->sin6_addr));
+		return true;
+	}
+#endif
+	return false;
+}
+
+/*
+===================
+NET_IndexQSocket
+
+Called by drivers once sock->addr is set. A newer qsocket for the same
+address replaces the older one, like it comes first in net_activeSockets.
+===================
+*/
+void NET_IndexQSocket (qsocket_t *sock)
+{
+	qsocketkey_t key;
+
+	NET_UnindexQSocket (sock);
+	if (!NET_QSocketKey (sock->driver, &sock->addr, &key))
+		return;
+	if (!net_qsocketindex)
+		net_qsocketindex = HashMap_Create (qsocketkey_t, qsocket_t *, &NET_HashQSocketKey, NULL);
+	HashMap_Insert (net_qsocketindex, &key, &sock);
+	sock->indexed = true;
+}
+
+/*
+===================
+NET_UnindexQSocket
+===================
+*/
+void NET_UnindexQSocket (qsocket_t *sock)
+{
+	qsocketkey_t key;
+	qsocket_t  **indexed;
+
+	if (!sock->indexed)
+		return;
+	sock->indexed = false;
+	NET_QSocketKey (sock->driver, &sock->addr, &key);
+	indexed = HashMap_Lookup (qsocket_t *, net_qsocketindex, &key);
+	if (indexed && *indexed == sock)
+		HashMap_Erase (net_qsocketindex, &key);
+}
+
+/*
+===================
+NET_LookupQSocket
+
+Returns false if addresses of this family aren't indexed, else sets sock to
+the indexed qsocket or NULL. NULL doesn't mean there is none: an older qsocket
+for the same address drops out of the index when a newer one replaces it, so
+callers still have to search net_activeSockets on a miss
+===================
+*/
+qboolean NET_LookupQSocket (int driver, const struct qsockaddr *addr, qsocket_t **sock)
+{
+	qsocketkey_t key;
+	qsocket_t  **indexed;
+
+	if (!NET_QSocketKey (driver, addr, &key))
+		return false;
+	indexed = net_qsocketindex ? HashMap_Lookup (qsocket_t *, net_qsocketindex, &key) : NULL;
+	*sock = indexed ? *indexed : NULL;
+	return true;
+}
+
+//=============================================================================
+
 /*
 ===================
 NET_NewQSocket
@@ -107,7 +231,9 @@ qsocket_t *NET_NewQSocket (void)
 	net_activeSockets = sock;
 
 	sock->isvirtual = false;
+	sock->indexed = false;
 	sock->disconnected = false;
+	sock->sendfailed = false;
 	sock->connecttime = net_time;
 	strcpy (sock->trueaddress, "UNSET ADDRESS");
 	strcpy (sock->maskedaddress, "UNSET ADDRESS");
@@ -124,6 +250,10 @@ qsocket_t *NET_NewQSocket (void)
 	sock->receiveSequence = 0;
 	sock->unreliableReceiveSequence = 0;
 	sock->receiveMessageLength = 0;
+	sock->window = 0;
+	sock->rtt = 0.5;
+	sock->receiveMask = 0;
+	sock->receiveMessageEnd = -1;
 	sock->pending_max_datagram = 1024;
 	sock->proquake_angle_hack = false;
 
@@ -134,6 +264,8 @@ void NET_FreeQSocket (qsocket_t *sock)
 {
 	qsocket_t *s;
 
+	NET_UnindexQSocket (sock);
+
 	// remove it from active list
 	if (sock == net_activeSockets)
 		net_activeSockets = net_activeSockets->next;
@@ -697,6 +829,37 @@ int NET_SendUnreliableMessage (qsocket_t *sock, sizebuf_t *data)
 	return r;
 }
 
+/*
+==================
+NET_BeginSendBatch
+
+Until NET_FlushSendBatch, drivers may hold back the datagrams they are
+asked to send and put them on the wire together
+==================
+*/
+void NET_BeginSendBatch (void)
+{
+	int i;
+
+	for (i = 0; i < net_numdrivers; i++)
+		if (net_drivers[i].initialized && net_drivers[i].BeginSendBatch)
+			net_drivers[i].BeginSendBatch ();
+}
+
+/*
+==================
+NET_FlushSendBatch
+==================
+*/
+void NET_FlushSendBatch (void)
+{
+	int i;
+
+	for (i = 0; i < net_numdrivers; i++)
+		if (net_drivers[i].initialized && net_drivers[i].FlushSendBatch)
+			net_drivers[i].FlushSendBatch ();
+}
+
 /*
 ==================
 NET_CanSendMessage
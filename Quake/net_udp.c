@@ -372,6 +372,130 @@ int UDP_Write (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr
 
 //=============================================================================
 
+// recvmmsg and sendmmsg move a whole batch of datagrams per system call. Where
+// they are missing, or the kernel refuses them, the batches loop over recvfrom
+// and sendto instead.
+#if defined(__linux__) && defined(_GNU_SOURCE)
+#define UDP_MMSG
+#define UDP_MMSG_MAX 64
+static qboolean udp_mmsg = true;
+
+static void UDP_MMsgSetup (struct mmsghdr *msgs, struct iovec *iovs, netpacket_t *packets, int count)
+{
+	int i;
+
+	memset (msgs, 0, count * sizeof (struct mmsghdr));
+	for (i = 0; i < count; i++)
+	{
+		iovs[i].iov_base = packets[i].data;
+		iovs[i].iov_len = packets[i].len;
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_name = &packets[i].addr;
+	}
+}
+#endif
+
+int UDP_ReadBatch (sys_socket_t socketid, netpacket_t *packets, int count)
+{
+	int i, ret;
+
+#ifdef UDP_MMSG
+	if (udp_mmsg)
+	{
+		struct mmsghdr msgs[UDP_MMSG_MAX];
+		struct iovec   iovs[UDP_MMSG_MAX];
+
+		count = q_min (count, UDP_MMSG_MAX);
+		UDP_MMsgSetup (msgs, iovs, packets, count);
+		for (i = 0; i < count; i++)
+			msgs[i].msg_hdr.msg_namelen = sizeof (struct qsockaddr);
+		ret = recvmmsg (socketid, msgs, count, 0, NULL);
+		if (ret != SOCKET_ERROR)
+		{
+			for (i = 0; i < ret; i++)
+				packets[i].len = msgs[i].msg_len;
+			return ret;
+		}
+		if (SOCKETERRNO != ENOSYS)
+		{
+			int err = SOCKETERRNO;
+			if (err == NET_EWOULDBLOCK || err == NET_ECONNREFUSED)
+				return 0;
+			Con_SafePrintf ("UDP_ReadBatch, recvmmsg: %s\n", socketerror (err));
+			return -1;
+		}
+		udp_mmsg = false;
+	}
+#endif
+
+	for (i = 0; i < count; i++)
+	{
+		ret = UDP_Read (socketid, packets[i].data, packets[i].len, &packets[i].addr);
+		if (ret <= 0)
+			return (ret < 0 && !i) ? -1 : i;
+		packets[i].len = ret;
+	}
+	return count;
+}
+
+int UDP_WriteBatch (sys_socket_t socketid, netpacket_t *packets, int count)
+{
+	int sent = 0;
+
+#ifdef UDP_MMSG
+	while (udp_mmsg && sent < count)
+	{
+		struct mmsghdr msgs[UDP_MMSG_MAX];
+		struct iovec   iovs[UDP_MMSG_MAX];
+		int			   i, num, ret;
+
+		num = q_min (count - sent, UDP_MMSG_MAX);
+		UDP_MMsgSetup (msgs, iovs, packets + sent, num);
+		for (i = 0; i < num; i++)
+		{
+			if (packets[sent + i].addr.qsa_family == AF_INET)
+				msgs[i].msg_hdr.msg_namelen = sizeof (struct sockaddr_in);
+			else if (packets[sent + i].addr.qsa_family == AF_INET6)
+				msgs[i].msg_hdr.msg_namelen = sizeof (struct sockaddr_in6);
+			else
+				break;
+		}
+		if (!i)
+		{
+			// let UDP_Write complain about it
+			if (UDP_Write (socketid, packets[sent].data, packets[sent].len, &packets[sent].addr) == -1)
+				packets[sent].len = -1;
+			sent++;
+			continue;
+		}
+
+		ret = sendmmsg (socketid, msgs, i, 0);
+		if (ret > 0)
+		{
+			sent += ret;
+			continue;
+		}
+		if (SOCKETERRNO == ENOSYS)
+		{
+			udp_mmsg = false;
+			break;
+		}
+		// the first datagram failed, sendto reports why and drops it
+		if (UDP_Write (socketid, packets[sent].data, packets[sent].len, &packets[sent].addr) == -1)
+			packets[sent].len = -1;
+		sent++;
+	}
+#endif
+
+	for (; sent < count; sent++)
+		if (UDP_Write (socketid, packets[sent].data, packets[sent].len, &packets[sent].addr) == -1)
+			packets[sent].len = -1;
+	return count;
+}
+
+//=============================================================================
+
 const char *UDP_AddrToString (struct qsockaddr *addr, qboolean masked)
 {
 	static char buffer[64];
@@ -31,6 +31,8 @@ int			 UDP_Connect (sys_socket_t socketid, struct qsockaddr *addr);
 sys_socket_t UDP4_CheckNewConnections (void);
 int			 UDP_Read (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr);
 int			 UDP_Write (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr);
+int			 UDP_ReadBatch (sys_socket_t socketid, netpacket_t *packets, int count);
+int			 UDP_WriteBatch (sys_socket_t socketid, netpacket_t *packets, int count);
 int			 UDP4_Broadcast (sys_socket_t socketid, byte *buf, int len);
 const char	*UDP_AddrToString (struct qsockaddr *addr, qboolean masked);
 int			 UDP4_StringToAddr (const char *string, struct qsockaddr *addr);
@@ -51,6 +53,8 @@ int			 UDP_Connect (sys_socket_t socketid, struct qsockaddr *addr);
 sys_socket_t UDP6_CheckNewConnections (void);
 int			 UDP_Read (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr);
 int			 UDP_Write (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr);
+int			 UDP_ReadBatch (sys_socket_t socketid, netpacket_t *packets, int count);
+int			 UDP_WriteBatch (sys_socket_t socketid, netpacket_t *packets, int count);
 int			 UDP6_Broadcast (sys_socket_t socketid, byte *buf, int len);
 const char	*UDP_AddrToString (struct qsockaddr *addr, qboolean masked);
 int			 UDP6_StringToAddr (const char *string, struct qsockaddr *addr);
@@ -34,7 +34,7 @@ net_driver_t net_drivers[] = {
 
 	{"Datagram", false, Datagram_Init, Datagram_Listen, Datagram_QueryAddresses, Datagram_SearchForHosts, Datagram_Connect, Datagram_CheckNewConnections,
 	 Datagram_GetAnyMessage, Datagram_GetMessage, Datagram_SendMessage, Datagram_SendUnreliableMessage, Datagram_CanSendMessage,
-	 Datagram_CanSendUnreliableMessage, Datagram_Close, Datagram_Shutdown}};
+	 Datagram_CanSendUnreliableMessage, Datagram_Close, Datagram_Shutdown, Datagram_BeginSendBatch, Datagram_FlushSendBatch}};
 
 const int net_numdrivers = countof (net_drivers);
 
@@ -957,21 +957,35 @@ findradius (origin, radius)
 */
 static void PF_findradius (void)
 {
-	edict_t *ent, *chain;
-	float	 rad;
-	float	*org;
-	int		 i;
+	edict_t	  *ent, *chain;
+	float	   rad;
+	float	  *org;
+	vec3_t	   mins, maxs;
+	const int *ents;
+	int		   i, count;
 
 	chain = (edict_t *)qcvm->edicts;
 
 	org = G_VECTOR (OFS_PARM0);
 	rad = G_FLOAT (OFS_PARM1);
+	for (i = 0; i < 3; i++)
+	{
+		mins[i] = org[i] - fabs (rad);
+		maxs[i] = org[i] + fabs (rad);
+	}
 	rad *= rad;
 
-	ent = NEXT_EDICT (qcvm->edicts);
-	for (i = 1; i < qcvm->num_edicts; i++, ent = NEXT_EDICT (ent))
+	// the proximity grid only narrows down the edicts, they still get the exact test below
+	if (!ED_ProximityCandidates (mins, maxs, &ents, &count))
+	{
+		ents = NULL;
+		count = qcvm->num_edicts - 1;
+	}
+
+	for (i = 0; i < count; i++)
 	{
 		float d, lensq;
+		ent = EDICT_NUM_NO_CHECK (ents ? ents[i] : i + 1);
 		if (ent->free)
 			continue;
 		if (ent->v.solid == SOLID_NOT)
@@ -1061,6 +1075,8 @@ static void PF_Find (void)
 	int			f;
 	const char *s, *t;
 	edict_t	   *ed;
+	const int  *ents;
+	int			count;
 
 	e = G_EDICTNUM (OFS_PARM0);
 	f = G_INT (OFS_PARM1);
@@ -1068,6 +1084,31 @@ static void PF_Find (void)
 	if (!s)
 		PR_RunError ("PF_Find: bad search string");
 
+	if (ED_FieldIndexLookup (f, s, &ents, &count))
+	{
+		// candidates are in edict order, skip to the first one after start
+		int lo = 0, hi = count;
+		while (lo < hi)
+		{
+			const int mid = (lo + hi) / 2;
+			if (ents[mid] <= e)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		for (; lo < count; lo++)
+		{
+			ed = EDICT_NUM (ents[lo]);
+			if (!strcmp (E_STRING (ed, f), s))
+			{
+				RETURN_EDICT (ed);
+				return;
+			}
+		}
+		RETURN_EDICT (qcvm->edicts);
+		return;
+	}
+
 	for (e++; e < qcvm->num_edicts; e++)
 	{
 		ed = EDICT_NUM (e);
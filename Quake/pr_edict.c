@@ -49,6 +49,8 @@ cvar_t saved2 = {"saved2", "0", CVAR_ARCHIVE_GAME};
 cvar_t saved3 = {"saved3", "0", CVAR_ARCHIVE_GAME};
 cvar_t saved4 = {"saved4", "0", CVAR_ARCHIVE_GAME};
 
+cvar_t pr_fieldindexes = {"pr_fieldindexes", "1", CVAR_NONE};
+
 // The one and only Hook instance : no need to either lock or multiple instances,
 // because ED_* functions are only called from the main thread.
 static ED_AllocHook_func ED_ALLOC_HOOK = NULL;
@@ -89,6 +91,7 @@ edict_t *ED_Alloc (void)
 
 		if (ED_ALLOC_HOOK)
 			ED_ALLOC_HOOK (e);
+		ED_TouchFieldIndexes (e);
 
 		return e;
 	}
@@ -115,6 +118,7 @@ edict_t *ED_Alloc (void)
 
 	if (ED_ALLOC_HOOK)
 		ED_ALLOC_HOOK (e);
+	ED_TouchFieldIndexes (e);
 
 	return e;
 }
@@ -172,6 +176,602 @@ void ED_Free (edict_t *ed)
 	ed->freetime = qcvm->time;
 
 	ED_AddToFreeList (ed);
+	ED_TouchFieldIndexes (ed);
+}
+
+/*
+===============================================================================
+
+FIELD INDEXES
+
+Lookups by classname/targetname, and the proximity grid for findradius and
+findbox. QC writes straight into edict memory, so writes to an indexed field
+only mark the edict dirty (ED_TouchFieldIndexes, called from the pointer stores,
+ED_Alloc, ED_Free, SV_LinkEdict and the engine paths that fill in fields) and
+the edict is refiled by the next lookup. Anything that rewrites many edicts at once, like loading a
+game, just invalidates the indexes and the next lookup rebuilds them.
+===============================================================================
+*/
+
+#define FIELDINDEX_FILED	  1
+#define FIELDINDEX_DIRTY	  2
+#define FIELDINDEX_VOLATILE 4
+
+static const char *const fieldindex_names[NUM_FIELD_INDEXES] = {"classname", "targetname"};
+
+/*
+=================
+ED_FieldIndexString
+
+PR_GetString without the errors: returns NULL for released engine strings
+=================
+*/
+static const char *ED_FieldIndexString (int num)
+{
+	if (num >= 0 && num < qcvm->stringssize)
+		return qcvm->strings + num;
+	if (num < 0 && num >= -qcvm->numknownstrings)
+		return qcvm->knownstrings[-1 - num];
+	return qcvm->strings;
+}
+
+static int ED_FieldIndexListPos (const int *list, int e)
+{
+	int lo = 0, hi = VEC_SIZE (list);
+	while (lo < hi)
+	{
+		const int mid = (lo + hi) / 2;
+		if (list[mid] < e)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static void ED_FieldIndexListInsert (int **list, int e)
+{
+	const int pos = ED_FieldIndexListPos (*list, e);
+	int		  size;
+
+	VEC_PUSH (*list, e);
+	size = VEC_SIZE (*list);
+	if (pos < size - 1) // not the common append of a fresh edict
+	{
+		memmove (*list + pos + 1, *list + pos, (size - pos - 1) * sizeof (int));
+		(*list)[pos] = e;
+	}
+}
+
+static void ED_FieldIndexListRemove (int *list, int e)
+{
+	const int pos = ED_FieldIndexListPos (list, e);
+	const int size = VEC_SIZE (list);
+
+	memmove (list + pos, list + pos + 1, (size - pos - 1) * sizeof (int));
+	VEC_HEADER (list).size--;
+}
+
+static void ED_FieldIndexDropSlotUser (fieldindex_t *index, int e)
+{
+	const int slot = index->slots[e] - 1;
+	int		**users = HashMap_Lookup (int *, index->slotusers, &slot);
+	int		  i, size = VEC_SIZE (*users);
+
+	for (i = 0; i < size; i++)
+		if ((*users)[i] == e)
+		{
+			(*users)[i] = (*users)[--size];
+			VEC_HEADER (*users).size = size;
+			break;
+		}
+	if (!size)
+	{
+		VEC_FREE (*users);
+		HashMap_Erase (index->slotusers, &slot);
+	}
+	index->slots[e] = 0;
+}
+
+static void ED_FieldIndexAddSlotUser (fieldindex_t *index, int e, int slot)
+{
+	int **users = HashMap_Lookup (int *, index->slotusers, &slot);
+
+	if (!users)
+	{
+		int *empty = NULL;
+		HashMap_Insert (index->slotusers, &slot, &empty);
+		users = HashMap_Lookup (int *, index->slotusers, &slot);
+	}
+	VEC_PUSH (*users, e);
+	index->slots[e] = slot + 1;
+}
+
+/*
+=================
+ED_RefileEdict
+
+Progs strings never change and a string allocated by the VM keeps its contents
+until its slot is released, so those are filed by hash. Other engine strings
+may point to memory that is rewritten in place, like the rotating ftos/strcat
+temp buffers, so those edicts are returned by every lookup instead.
+=================
+*/
+static void ED_RefileEdict (fieldindex_t *index, int e)
+{
+	edict_t		*ed = EDICT_NUM_NO_CHECK (e);
+	const char	*s;
+	int		   **bucket;
+	int			 num;
+
+	if (index->flags[e] & FIELDINDEX_FILED)
+		ED_FieldIndexListRemove (*HashMap_Lookup (int *, index->buckets, &index->hashes[e]), e);
+	if (index->flags[e] & FIELDINDEX_VOLATILE)
+		ED_FieldIndexListRemove (index->volatiles, e);
+	index->flags[e] = 0;
+	if (index->slots[e])
+		ED_FieldIndexDropSlotUser (index, e);
+
+	if (e == 0 || e >= qcvm->num_edicts || ed->free)
+		return;
+	num = ((int *)&ed->v)[index->field - 1];
+	if (num < 0 && num >= -qcvm->numknownstrings)
+	{
+		ED_FieldIndexAddSlotUser (index, e, -1 - num);
+		if (!qcvm->knownstringsowned[-1 - num])
+		{
+			ED_FieldIndexListInsert (&index->volatiles, e);
+			index->flags[e] = FIELDINDEX_VOLATILE;
+			return;
+		}
+	}
+	s = ED_FieldIndexString (num);
+	if (!s)
+		return;
+
+	index->hashes[e] = COM_HashString (s);
+	bucket = HashMap_Lookup (int *, index->buckets, &index->hashes[e]);
+	if (!bucket)
+	{
+		int *empty = NULL;
+		HashMap_Insert (index->buckets, &index->hashes[e], &empty);
+		bucket = HashMap_Lookup (int *, index->buckets, &index->hashes[e]);
+	}
+	ED_FieldIndexListInsert (bucket, e);
+	index->flags[e] = FIELDINDEX_FILED;
+}
+
+static void ED_BuildFieldIndex (fieldindex_t *index)
+{
+	int e;
+
+	if (index->size != qcvm->max_edicts)
+	{
+		index->size = qcvm->max_edicts;
+		index->hashes = (unsigned int *)Mem_Realloc (index->hashes, index->size * sizeof (unsigned int));
+		index->flags = (unsigned char *)Mem_Realloc (index->flags, index->size);
+		index->slots = (int *)Mem_Realloc (index->slots, index->size * sizeof (int));
+	}
+	memset (index->flags, 0, index->size);
+	memset (index->slots, 0, index->size * sizeof (int));
+	if (!index->buckets)
+		index->buckets = HashMap_Create (unsigned int, int *, &HashInt32, NULL);
+	if (!index->slotusers)
+		index->slotusers = HashMap_Create (int, int *, &HashInt32, NULL);
+
+	for (e = 1; e < qcvm->num_edicts; e++)
+		ED_RefileEdict (index, e);
+	index->watch = index->field;
+}
+
+/*
+=================
+ED_UpdateFieldWatch
+
+Flags the field offsets whose writes have to touch the edict
+=================
+*/
+static void ED_UpdateFieldWatch (void)
+{
+	static const int proxfields[] = {
+		offsetof (entvars_t, origin) / 4, offsetof (entvars_t, mins) / 4, offsetof (entvars_t, maxs) / 4, offsetof (entvars_t, solid) / 4};
+	const int numfields = qcvm->progs->entityfields;
+	int		  i, j;
+
+	if (!qcvm->fieldwatch)
+		qcvm->fieldwatch = (unsigned char *)Mem_Alloc (numfields);
+	else
+		memset (qcvm->fieldwatch, 0, numfields);
+	qcvm->numfieldwatch = 0;
+
+	for (i = 0; i < NUM_FIELD_INDEXES; i++)
+	{
+		if (!qcvm->fieldindexes[i].watch)
+			continue;
+		qcvm->fieldwatch[qcvm->fieldindexes[i].watch - 1] = true;
+		qcvm->numfieldwatch = numfields;
+	}
+	if (qcvm->proxgrid.valid)
+	{
+		for (i = 0; i < (int)countof (proxfields); i++)
+			for (j = 0; j < ((proxfields[i] == offsetof (entvars_t, solid) / 4) ? 1 : 3); j++)
+				qcvm->fieldwatch[proxfields[i] + j] = true;
+		qcvm->numfieldwatch = numfields;
+	}
+}
+
+/*
+=================
+ED_TouchFieldIndexes
+
+Marks ed to be refiled, its indexed fields may change
+=================
+*/
+void ED_TouchFieldIndexes (edict_t *ed)
+{
+	proxgrid_t *grid = &qcvm->proxgrid;
+	int			e;
+
+	if (!qcvm->numfieldwatch)
+		return;
+	e = NUM_FOR_EDICT (ed);
+
+	for (int i = 0; i < NUM_FIELD_INDEXES; i++)
+	{
+		fieldindex_t *index = &qcvm->fieldindexes[i];
+		if (index->watch && !(index->flags[e] & FIELDINDEX_DIRTY))
+		{
+			index->flags[e] |= FIELDINDEX_DIRTY;
+			VEC_PUSH (index->dirty, e);
+		}
+	}
+	if (grid->valid && !grid->dirty[e])
+	{
+		grid->dirty[e] = true;
+		VEC_PUSH (grid->dirtylist, e);
+	}
+}
+
+/*
+=================
+ED_TouchStoredField
+
+ptr is the edicts relative address of a pointer store of size ints, touches
+the edict if any of the fields written is watched
+=================
+*/
+void ED_TouchStoredField (int ptr, int size)
+{
+	const int e = ptr / qcvm->edict_size;
+	const int ofs = (ptr - e * qcvm->edict_size - (int)offsetof (edict_t, v)) / 4;
+
+	if ((unsigned int)e >= (unsigned int)qcvm->num_edicts)
+		return;
+	for (int i = 0; i < size; i++)
+		if (ED_FIELD_WATCHED (ofs + i))
+		{
+			ED_TouchFieldIndexes (EDICT_NUM_NO_CHECK (e));
+			return;
+		}
+}
+
+/*
+=================
+ED_TouchStringSlot
+
+The known string slot is released or reused, marks the edicts whose indexed
+fields reference it to be refiled
+=================
+*/
+void ED_TouchStringSlot (int slot)
+{
+	if (!qcvm->numfieldwatch)
+		return;
+
+	for (int i = 0; i < NUM_FIELD_INDEXES; i++)
+	{
+		fieldindex_t *index = &qcvm->fieldindexes[i];
+		int			**users;
+
+		if (!index->watch || !(users = HashMap_Lookup (int *, index->slotusers, &slot)))
+			continue;
+		for (int j = 0; j < (int)VEC_SIZE (*users); j++)
+		{
+			const int e = (*users)[j];
+			if (!(index->flags[e] & FIELDINDEX_DIRTY))
+			{
+				index->flags[e] |= FIELDINDEX_DIRTY;
+				VEC_PUSH (index->dirty, e);
+			}
+		}
+	}
+}
+
+/*
+=================
+ED_InvalidateFieldIndexes
+
+Drops all indexes of the current VM, the next lookup rebuilds them. Also
+releases their memory, so it is called when the progs are cleared.
+=================
+*/
+void ED_InvalidateFieldIndexes (void)
+{
+	proxgrid_t *grid = &qcvm->proxgrid;
+
+	for (int i = 0; i < NUM_FIELD_INDEXES; i++)
+	{
+		fieldindex_t *index = &qcvm->fieldindexes[i];
+		if (index->buckets)
+		{
+			for (uint32_t j = 0, n = HashMap_Size (index->buckets); j < n; j++)
+				VEC_FREE (*HashMap_GetValue (int *, index->buckets, j));
+			HashMap_Destroy (index->buckets);
+		}
+		if (index->slotusers)
+		{
+			for (uint32_t j = 0, n = HashMap_Size (index->slotusers); j < n; j++)
+				VEC_FREE (*HashMap_GetValue (int *, index->slotusers, j));
+			HashMap_Destroy (index->slotusers);
+		}
+		Mem_Free (index->hashes);
+		Mem_Free (index->flags);
+		Mem_Free (index->slots);
+		VEC_FREE (index->volatiles);
+		VEC_FREE (index->results);
+		VEC_FREE (index->dirty);
+		index->buckets = NULL;
+		index->slotusers = NULL;
+		index->hashes = NULL;
+		index->flags = NULL;
+		index->slots = NULL;
+		index->size = 0;
+		index->watch = 0;
+	}
+
+	Mem_Free (grid->heads);
+	Mem_Free (grid->cells);
+	Mem_Free (grid->prev);
+	Mem_Free (grid->next);
+	Mem_Free (grid->dirty);
+	Mem_Free (grid->stamps);
+	VEC_FREE (grid->dirtylist);
+	VEC_FREE (grid->candidates);
+	memset (grid, 0, sizeof (*grid));
+
+	Mem_Free (qcvm->fieldwatch);
+	qcvm->fieldwatch = NULL;
+	qcvm->numfieldwatch = 0;
+}
+
+/*
+=================
+ED_FieldIndexesEnabled
+
+Drops the indexes once pr_fieldindexes is turned off
+=================
+*/
+static qboolean ED_FieldIndexesEnabled (void)
+{
+	if (pr_fieldindexes.value && qcvm->edicts)
+		return true;
+	if (qcvm->numfieldwatch)
+		ED_InvalidateFieldIndexes ();
+	return false;
+}
+
+/*
+=================
+ED_FieldIndexLookup
+
+Returns false if fieldofs isn't indexed. Otherwise ents/count are the edicts,
+in edict order, whose field string hashes like s or is an engine string:
+callers still have to compare the strings.
+=================
+*/
+qboolean ED_FieldIndexLookup (int fieldofs, const char *s, const int **ents, int *count)
+{
+	fieldindex_t *index;
+	int			**bucket;
+	int			  i, j, bucketsize, numvolatiles;
+
+	if (!ED_FieldIndexesEnabled ())
+		return false;
+
+	for (i = 0; i < NUM_FIELD_INDEXES; i++)
+	{
+		index = &qcvm->fieldindexes[i];
+		if (!index->field)
+		{
+			ddef_t *def = ED_FindField (fieldindex_names[i]);
+			index->field = (def && (def->type & ~DEF_SAVEGLOBAL) == ev_string) ? def->ofs + 1 : -1;
+		}
+		if (index->field == fieldofs + 1)
+			break;
+	}
+	if (i == NUM_FIELD_INDEXES)
+		return false;
+
+	if (!index->watch)
+	{
+		ED_BuildFieldIndex (index);
+		ED_UpdateFieldWatch ();
+	}
+	for (i = 0; i < (int)VEC_SIZE (index->dirty); i++)
+		ED_RefileEdict (index, index->dirty[i]);
+	VEC_CLEAR (index->dirty);
+
+	const unsigned int hash = COM_HashString (s);
+	bucket = HashMap_Lookup (int *, index->buckets, &hash);
+	bucketsize = bucket ? VEC_SIZE (*bucket) : 0;
+	numvolatiles = VEC_SIZE (index->volatiles);
+	if (!numvolatiles || !bucketsize)
+	{
+		*ents = bucketsize ? *bucket : index->volatiles;
+		*count = bucketsize ? bucketsize : numvolatiles;
+		return true;
+	}
+
+	VEC_CLEAR (index->results);
+	for (i = 0, j = 0; i < bucketsize || j < numvolatiles;)
+	{
+		if (j == numvolatiles || (i < bucketsize && (*bucket)[i] < index->volatiles[j]))
+			VEC_PUSH (index->results, (*bucket)[i++]);
+		else
+			VEC_PUSH (index->results, index->volatiles[j++]);
+	}
+	*ents = index->results;
+	*count = VEC_SIZE (index->results);
+	return true;
+}
+
+#define PROXGRID_SHIFT	   7	// 128 unit cells
+#define PROXGRID_LISTS	   4096 // hashed cell lists, far apart cells may share one
+#define PROXGRID_MAX_CELLS 256	// cells a query may cover before it is cheaper to scan
+#define PROXGRID_MAX_COORD (float)(1 << 20)
+
+static int ED_ProxGridCoord (float v)
+{
+	return (int)floorf (v / (float)(1 << PROXGRID_SHIFT));
+}
+
+static int ED_ProxGridList (int x, int y)
+{
+	return (int)(((unsigned int)x * 73856093u ^ (unsigned int)y * 19349663u) & (PROXGRID_LISTS - 1));
+}
+
+/*
+=================
+ED_ProxGridRefile
+
+An edict sits in the list of the cell holding its bbox center, or in the
+last list when its bbox is wider than a cell or the center is out of range
+=================
+*/
+static void ED_ProxGridRefile (int e)
+{
+	proxgrid_t *grid = &qcvm->proxgrid;
+	edict_t	   *ed = EDICT_NUM_NO_CHECK (e);
+	const float cellsize = 1 << PROXGRID_SHIFT;
+	float		center[2];
+	int			list, i;
+
+	grid->dirty[e] = false;
+	if (grid->cells[e])
+	{
+		if (grid->prev[e])
+			grid->next[grid->prev[e]] = grid->next[e];
+		else
+			grid->heads[grid->cells[e] - 1] = grid->next[e];
+		if (grid->next[e])
+			grid->prev[grid->next[e]] = grid->prev[e];
+		grid->cells[e] = 0;
+	}
+
+	if (e == 0 || e >= qcvm->num_edicts || ed->free || ed->v.solid == SOLID_NOT)
+		return;
+
+	list = PROXGRID_LISTS;
+	if (ed->v.maxs[0] - ed->v.mins[0] <= cellsize && ed->v.maxs[1] - ed->v.mins[1] <= cellsize)
+	{
+		for (i = 0; i < 2; i++)
+			center[i] = ed->v.origin[i] + (ed->v.mins[i] + ed->v.maxs[i]) * 0.5f;
+		// the negated tests send NaN to the last list too
+		if (fabsf (center[0]) < PROXGRID_MAX_COORD && fabsf (center[1]) < PROXGRID_MAX_COORD)
+			list = ED_ProxGridList (ED_ProxGridCoord (center[0]), ED_ProxGridCoord (center[1]));
+	}
+
+	grid->cells[e] = list + 1;
+	grid->prev[e] = 0;
+	grid->next[e] = grid->heads[list];
+	if (grid->next[e])
+		grid->prev[grid->next[e]] = e;
+	grid->heads[list] = e;
+}
+
+static void ED_ProxGridBuild (void)
+{
+	proxgrid_t *grid = &qcvm->proxgrid;
+
+	grid->size = qcvm->max_edicts;
+	grid->heads = (int *)Mem_Alloc ((PROXGRID_LISTS + 1) * sizeof (int));
+	grid->cells = (int *)Mem_Alloc (grid->size * sizeof (int));
+	grid->prev = (int *)Mem_Alloc (grid->size * sizeof (int));
+	grid->next = (int *)Mem_Alloc (grid->size * sizeof (int));
+	grid->dirty = (unsigned char *)Mem_Alloc (grid->size);
+	grid->stamps = (unsigned int *)Mem_Alloc ((PROXGRID_LISTS + 1) * sizeof (unsigned int));
+	for (int e = 1; e < qcvm->num_edicts; e++)
+		ED_ProxGridRefile (e);
+	grid->valid = true;
+}
+
+static int ED_CompareEdictNums (const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+/*
+=================
+ED_ProximityCandidates
+
+Returns false if the box is too big or not finite, the caller has to scan all
+edicts then. Otherwise ents/count are the non-SOLID_NOT edicts, in edict
+order, whose current bbox may overlap the box: callers still have to test them.
+=================
+*/
+qboolean ED_ProximityCandidates (const vec3_t mins, const vec3_t maxs, const int **ents, int *count)
+{
+	proxgrid_t *grid = &qcvm->proxgrid;
+	const float inflate = 0.5f * (1 << PROXGRID_SHIFT) + 1.0f; // +1 for the rounding of the centers
+	int			lo[2], hi[2];
+	int			x, y, i, list, e;
+
+	if (!ED_FieldIndexesEnabled ())
+		return false;
+	for (i = 0; i < 2; i++)
+	{
+		if (!(mins[i] <= maxs[i] && mins[i] > -PROXGRID_MAX_COORD && maxs[i] < PROXGRID_MAX_COORD))
+			return false;
+		lo[i] = ED_ProxGridCoord (mins[i] - inflate);
+		hi[i] = ED_ProxGridCoord (maxs[i] + inflate);
+	}
+	if ((hi[0] - lo[0] + 1) * (hi[1] - lo[1] + 1) > PROXGRID_MAX_CELLS)
+		return false;
+
+	if (!grid->valid)
+	{
+		ED_ProxGridBuild ();
+		ED_UpdateFieldWatch ();
+	}
+	for (i = 0; i < (int)VEC_SIZE (grid->dirtylist); i++)
+		ED_ProxGridRefile (grid->dirtylist[i]);
+	VEC_CLEAR (grid->dirtylist);
+
+	// cells may hash to the same list, gather each list once
+	if (++grid->stamp == 0)
+	{
+		memset (grid->stamps, 0, (PROXGRID_LISTS + 1) * sizeof (unsigned int));
+		grid->stamp = 1;
+	}
+	VEC_CLEAR (grid->candidates);
+	for (e = grid->heads[PROXGRID_LISTS]; e; e = grid->next[e])
+		VEC_PUSH (grid->candidates, e);
+	for (y = lo[1]; y <= hi[1]; y++)
+		for (x = lo[0]; x <= hi[0]; x++)
+		{
+			list = ED_ProxGridList (x, y);
+			if (grid->stamps[list] == grid->stamp)
+				continue;
+			grid->stamps[list] = grid->stamp;
+			for (e = grid->heads[list]; e; e = grid->next[e])
+				VEC_PUSH (grid->candidates, e);
+		}
+
+	*count = VEC_SIZE (grid->candidates);
+	*ents = grid->candidates;
+	if (*count > 1)
+		qsort (grid->candidates, *count, sizeof (int), ED_CompareEdictNums);
+	return true;
 }
 
 /*
@@ -1055,7 +1655,10 @@ static void ED_PrintEdict_f (void)
 					"Edict %u.%s==%s\n", i, PR_GetString (def->s_name),
 					PR_UglyValueString (def->type & ~DEF_SAVEGLOBAL, (eval_t *)((char *)&EDICT_NUM (i)->v + def->ofs * 4)));
 			else
+			{
 				ED_ParseEpair ((void *)&EDICT_NUM (i)->v, def, Cmd_Argv (3), false);
+				ED_TouchFieldIndexes (EDICT_NUM (i));
+			}
 		}
 	}
 	PR_SwitchQCVM (NULL);
@@ -1565,6 +2168,7 @@ const char *ED_ParseEdict (const char *data, edict_t *ent)
 			Host_Error ("ED_ParseEdict: parse error");
 	}
 
+	ED_TouchFieldIndexes (ent);
 	if (!init)
 		ED_Free (ent);
 
@@ -1763,13 +2367,19 @@ void PR_ClearProgs (qcvm_t *vm)
 		Mem_Free ((void *)qcvm->knownstrings);
 		Mem_Free (qcvm->knownstringsowned);
 	}
+	VEC_FREE (qcvm->freeknownstrings);
+	if (qcvm->knownstrings_map)
+		HashMap_Destroy (qcvm->knownstrings_map);
 	Mem_Free (qcvm->edicts); // ericw -- sv.edicts switched to use malloc()
 	if (qcvm->fielddefs != (ddef_t *)((byte *)qcvm->progs + qcvm->progs->ofs_fielddefs))
 		Mem_Free (qcvm->fielddefs);
 	Mem_Free (qcvm->entityfieldofs);
+	Mem_Free (qcvm->decoded);
 	Mem_Free (qcvm->progs); // spike -- pr_progs switched to use malloc (so menuqc doesn't end up stuck on the early hunk nor wiped on every map change)
 	if (qcvm->pusher_support)
 		HashMap_Destroy (qcvm->pusher_support);
+	ED_InvalidateFieldIndexes ();
+	Mem_Free (qcvm->areagrid.heads);
 	HashMap_Destroy (qcvm->function_map);
 	HashMap_Destroy (qcvm->fielddefs_map);
 	HashMap_Destroy (qcvm->globaldefs_map);
@@ -2123,6 +2733,8 @@ qboolean PR_LoadProgs (const char *filename, qboolean fatal, unsigned int needcr
 	for (i = 0; i < qcvm->progs->numglobals; i++)
 		((int *)qcvm->globals)[i] = LittleLong (((int *)qcvm->globals)[i]);
 
+	PR_DecodeStatements ();
+
 	memcpy (qcvm->builtins, builtins, numbuiltins * sizeof (qcvm->builtins[0]));
 	qcvm->numbuiltins = numbuiltins;
 
@@ -2162,6 +2774,9 @@ static void ED_Nomonsters_f (cvar_t *cvar)
 		Con_Warning ("\"%s\" can break gameplay.\n", cvar->name);
 }
 
+static void PR_StringBench_f (void);
+static void PR_FindBench_f (void);
+
 /*
 ===============
 PR_Init
@@ -2177,9 +2792,14 @@ void PR_Init (void)
 	Cmd_AddCommand ("edicts", ED_PrintEdicts);
 	Cmd_AddCommand ("edictcount", ED_Count);
 	Cmd_AddCommand ("profile", PR_Profile_f);
+	Cmd_AddCommand ("pr_benchmark", PR_Benchmark_f);
+	Cmd_AddCommand ("pr_stringbench", PR_StringBench_f);
+	Cmd_AddCommand ("pr_findbench", PR_FindBench_f);
 	Cmd_AddCommand ("pr_dumpplatform", PR_DumpPlatform_f);
 	Cvar_RegisterVariable (&nomonsters);
 	Cvar_SetCallback (&nomonsters, ED_Nomonsters_f);
+	Cvar_RegisterVariable (&pr_fastexec);
+	Cvar_RegisterVariable (&pr_fieldindexes);
 	Cvar_RegisterVariable (&gamecfg);
 	Cvar_RegisterVariable (&scratch1);
 	Cvar_RegisterVariable (&scratch2);
@@ -2320,11 +2940,53 @@ const char *PR_GetString (int num)
 	}
 }
 
+/*
+============
+PR_AllocStringSlot
+
+Pops a released slot, or appends a new one
+============
+*/
+static int PR_AllocStringSlot (void)
+{
+	if (VEC_SIZE (qcvm->freeknownstrings))
+	{
+		const int i = qcvm->freeknownstrings[--VEC_HEADER (qcvm->freeknownstrings).size];
+		ED_TouchStringSlot (i); // edicts may still reference the released string
+		return i;
+	}
+	if (qcvm->numknownstrings >= qcvm->maxknownstrings)
+		PR_AllocStringSlots ();
+	return qcvm->numknownstrings++;
+}
+
+static void PR_MapKnownString (int i, const char *s)
+{
+	if (!qcvm->knownstrings_map)
+		qcvm->knownstrings_map = HashMap_Create (const char *, int, &HashPtr, NULL);
+	HashMap_Insert (qcvm->knownstrings_map, &s, &i);
+}
+
+static void PR_UnmapKnownString (int i)
+{
+	const char *s = qcvm->knownstrings[i];
+	int		   *mapped;
+
+	if (!s || !qcvm->knownstrings_map)
+		return;
+	mapped = HashMap_Lookup (int, qcvm->knownstrings_map, &s);
+	if (mapped && *mapped == i)
+		HashMap_Erase (qcvm->knownstrings_map, &s);
+}
+
 void PR_ClearEngineString (int num)
 {
 	if (num < 0 && num >= -qcvm->numknownstrings)
 	{
 		num = -1 - num;
+		if (!qcvm->knownstrings[num])
+			return; // already released, don't push the slot twice
+		PR_UnmapKnownString (num);
 		if (qcvm->knownstringsowned[num])
 		{
 			SAFE_FREE (qcvm->knownstrings[num]);
@@ -2332,14 +2994,15 @@ void PR_ClearEngineString (int num)
 		}
 		else
 			qcvm->knownstrings[num] = NULL;
-		if (qcvm->freeknownstrings > num)
-			qcvm->freeknownstrings = num;
+		ED_TouchStringSlot (num);
+		VEC_PUSH (qcvm->freeknownstrings, num);
 	}
 }
 
 int PR_SetEngineString (const char *s)
 {
-	int i;
+	int	 i;
+	int *mapped;
 
 	if (!s)
 		return 0;
@@ -2350,31 +3013,18 @@ int PR_SetEngineString (const char *s)
 	if (s >= qcvm->strings && s <= qcvm->strings + qcvm->stringssize - 2)
 		return (int)(s - qcvm->strings);
 #endif
-	for (i = 0; i < qcvm->numknownstrings; i++)
+	if (qcvm->knownstrings_map)
 	{
-		if (qcvm->knownstrings[i] == s)
-			return -1 - i;
+		mapped = HashMap_Lookup (int, qcvm->knownstrings_map, &s);
+		if (mapped && qcvm->knownstrings[*mapped] == s)
+			return -1 - *mapped;
 	}
 	// new unknown engine string
 	// Con_DPrintf ("PR_SetEngineString: new engine string %p\n", s);
-	for (i = qcvm->freeknownstrings;; i++)
-	{
-		if (i < qcvm->numknownstrings)
-		{
-			if (qcvm->knownstrings[i])
-				continue;
-		}
-		else
-		{
-			if (i >= qcvm->maxknownstrings)
-				PR_AllocStringSlots ();
-			qcvm->numknownstrings++;
-		}
-		break;
-	}
-	qcvm->freeknownstrings = i + 1;
+	i = PR_AllocStringSlot ();
 	qcvm->knownstrings[i] = s;
 	qcvm->knownstringsowned[i] = false;
+	PR_MapKnownString (i, s);
 	return -1 - i;
 }
 
@@ -2385,24 +3035,10 @@ int PR_AllocString (int size, char **ptr)
 	if (!size)
 		return 0;
 
-	for (i = qcvm->freeknownstrings;; i++)
-	{
-		if (i < qcvm->numknownstrings)
-		{
-			if (qcvm->knownstrings[i])
-				continue;
-		}
-		else
-		{
-			if (i >= qcvm->maxknownstrings)
-				PR_AllocStringSlots ();
-			qcvm->numknownstrings++;
-		}
-		break;
-	}
-	qcvm->freeknownstrings = i + 1;
+	i = PR_AllocStringSlot ();
 	qcvm->knownstrings[i] = (char *)Mem_Alloc (size);
 	qcvm->knownstringsowned[i] = true;
+	PR_MapKnownString (i, qcvm->knownstrings[i]);
 	if (ptr)
 		*ptr = (char *)qcvm->knownstrings[i];
 	return -1 - i;
@@ -2413,12 +3049,295 @@ void PR_ClearEdictStrings ()
 	for (int i = qcvm->progsstrings; i < qcvm->numknownstrings; ++i)
 		if (qcvm->knownstringsowned[i])
 		{
+			PR_UnmapKnownString (i);
 			SAFE_FREE (qcvm->knownstrings[i]);
 			qcvm->knownstringsowned[i] = false;
-		}
-
+			ED_TouchStringSlot (i);
 #ifndef _DEBUG
-	// do not reuse slots in debug builds to help catch stale references
-	qcvm->freeknownstrings = qcvm->progsstrings;
+			// do not reuse slots in debug builds to help catch stale references
+			VEC_PUSH (qcvm->freeknownstrings, i);
 #endif
+		}
+}
+
+/*
+============
+PR_FindBench_f
+
+Spawns a crowd of edicts with a spread of classnames and times complete
+find (world, classname, ...) walks and findradius () around the crowd with
+and without the field indexes. Also checks that a store through a pointer
+taken before a lookup, as in self.classname = f () or self.origin = f (),
+still reaches the index and the grid.
+============
+*/
+static void PR_FindBench_f (void)
+{
+#define FINDBENCH_CLASSES 64
+	const int	 count = (Cmd_Argc () > 1) ? q_max (atoi (Cmd_Argv (1)), 1) : 8192;
+	const int	 iterations = (Cmd_Argc () > 2) ? q_max (atoi (Cmd_Argv (2)), 1) : 100;
+	const float	 oldvalue = pr_fieldindexes.value;
+	char		 tempname[16], *zonename;
+	int			 classstrings[FINDBENCH_CLASSES], nomatch, tempstring, zonestring;
+	edict_t	   **spawned;
+	builtin_t	 find, findradius;
+	const int	*ents;
+	int			 i, pass, iter, spawnedcount, side, fieldofs, entscount, found[2];
+	unsigned int chainsum[2];
+	double		 start, elapsed[2], radiuselapsed[2];
+	qboolean	 stale, stalegrid;
+	vec3_t		 spot;
+
+	if (!Host_BenchAllowed ())
+		return;
+
+	if (!sv.active)
+	{
+		Con_Printf ("no server running\n");
+		return;
+	}
+
+	PR_SwitchQCVM (&sv.qcvm);
+	find = qcvm->builtins[5];
+	findradius = qcvm->builtins[22];
+	spawnedcount = q_min (count, qcvm->max_edicts - qcvm->num_edicts - 1);
+	if (spawnedcount <= 0)
+	{
+		Con_Printf ("no free edicts\n");
+		PR_SwitchQCVM (NULL);
+		return;
+	}
+
+	for (i = 0; i < FINDBENCH_CLASSES; i++)
+	{
+		// zoned like the classnames parsed from the map
+		char *name;
+		classstrings[i] = PR_AllocString (16, &name);
+		q_snprintf (name, 16, "findbench%d", i);
+	}
+	nomatch = PR_SetEngineString ("findbench_none");
+	fieldofs = &qcvm->edicts->v.classname - (int *)&qcvm->edicts->v;
+	spawned = (edict_t **)Mem_Alloc (spawnedcount * sizeof (edict_t *));
+	side = (int)ceil (sqrt (spawnedcount));
+	for (i = 0; i < spawnedcount; i++)
+	{
+		// 48 units apart around the middle of the map, monster crowd density
+		spawned[i] = ED_Alloc ();
+		spawned[i]->v.classname = classstrings[i % FINDBENCH_CLASSES];
+		spawned[i]->v.solid = SOLID_SLIDEBOX;
+		spawned[i]->v.origin[0] = 0.5f * (qcvm->worldmodel->mins[0] + qcvm->worldmodel->maxs[0]) + (i % side - side / 2) * 48;
+		spawned[i]->v.origin[1] = 0.5f * (qcvm->worldmodel->mins[1] + qcvm->worldmodel->maxs[1]) + (i / side - side / 2) * 48;
+		spawned[i]->v.origin[2] = 0.5f * (qcvm->worldmodel->mins[2] + qcvm->worldmodel->maxs[2]);
+		spawned[i]->v.mins[0] = spawned[i]->v.mins[1] = -16;
+		spawned[i]->v.maxs[0] = spawned[i]->v.maxs[1] = 16;
+		spawned[i]->v.mins[2] = -24;
+		spawned[i]->v.maxs[2] = 32;
+	}
+
+	for (pass = 0; pass < 2; pass++)
+	{
+		Cvar_SetValueQuick (&pr_fieldindexes, pass);
+		ED_FieldIndexLookup (fieldofs, "", &ents, &entscount); // don't time the initial build
+		found[pass] = 0;
+		start = Sys_DoubleTime ();
+		for (iter = 0; iter < iterations; iter++)
+		{
+			// one populated class and one that matches nothing, like an AI
+			// loop looking for a player that isn't there
+			const int queries[2] = {classstrings[iter % FINDBENCH_CLASSES], nomatch};
+			for (i = 0; i < 2; i++)
+			{
+				G_INT (OFS_RETURN) = 0;
+				do
+				{
+					G_INT (OFS_PARM0) = G_INT (OFS_RETURN);
+					G_INT (OFS_PARM1) = fieldofs;
+					G_INT (OFS_PARM2) = queries[i];
+					qcvm->argc = 3;
+					find ();
+					found[pass]++;
+				} while (G_INT (OFS_RETURN));
+			}
+		}
+		elapsed[pass] = Sys_DoubleTime () - start;
+
+		// splash damage sized queries centered on members of the crowd
+		chainsum[pass] = 0;
+		start = Sys_DoubleTime ();
+		for (iter = 0; iter < iterations * 10; iter++)
+		{
+			VectorCopy (spawned[(iter * 7919u) % spawnedcount]->v.origin, G_VECTOR (OFS_PARM0));
+			G_FLOAT (OFS_PARM1) = 200;
+			qcvm->argc = 2;
+			findradius ();
+			for (edict_t *ed = PROG_TO_EDICT (G_INT (OFS_RETURN)); ed != qcvm->edicts; ed = PROG_TO_EDICT (ed->v.chain))
+				chainsum[pass] = chainsum[pass] * 31 + NUM_FOR_EDICT (ed);
+		}
+		radiuselapsed[pass] = Sys_DoubleTime () - start;
+	}
+
+	// self.classname = f (): OP_ADDRESS, then f runs a find that refiles the
+	// pending edict under its old name, then OP_STOREP_S writes the new one
+	ED_TouchFieldIndexes (spawned[0]);
+	const int classptr = (byte *)&spawned[0]->v.classname - (byte *)qcvm->edicts;
+	G_INT (OFS_PARM0) = 0;
+	G_INT (OFS_PARM1) = fieldofs;
+	G_INT (OFS_PARM2) = classstrings[0];
+	qcvm->argc = 3;
+	find ();
+	((eval_t *)((byte *)qcvm->edicts + classptr))->string = nomatch;
+	ED_TOUCH_STORED_FIELD (classptr, 1);
+	G_INT (OFS_PARM0) = 0;
+	G_INT (OFS_PARM2) = nomatch;
+	find ();
+	stale = PROG_TO_EDICT (G_INT (OFS_RETURN)) != spawned[0];
+
+	// ftos/strcat results are temp buffers that later calls rewrite in place
+	q_strlcpy (tempname, "findbench1", sizeof (tempname));
+	tempstring = PR_SetEngineString (tempname);
+	spawned[0]->v.classname = tempstring;
+	ED_TouchFieldIndexes (spawned[0]);
+	G_INT (OFS_PARM0) = 0;
+	G_INT (OFS_PARM2) = classstrings[1];
+	find ();
+	q_strlcpy (tempname, "findbench_temp", sizeof (tempname));
+	G_INT (OFS_PARM2) = tempstring;
+	find ();
+	stale |= PROG_TO_EDICT (G_INT (OFS_RETURN)) != spawned[0];
+
+	// strunzone while the edict still references the string, then a strzone
+	// that gets the released slot back
+	zonestring = PR_AllocString (16, &zonename);
+	q_strlcpy (zonename, "findbench1", 16);
+	spawned[0]->v.classname = zonestring;
+	ED_TouchFieldIndexes (spawned[0]);
+	G_INT (OFS_PARM2) = classstrings[1];
+	find ();
+	PR_ClearEngineString (zonestring);
+	zonestring = PR_AllocString (16, &zonename);
+	q_strlcpy (zonename, "findbench_zone", 16);
+	if (spawned[0]->v.classname == zonestring)
+	{
+		G_INT (OFS_PARM2) = zonestring;
+		find ();
+		stale |= PROG_TO_EDICT (G_INT (OFS_RETURN)) != spawned[0];
+	}
+
+	spawned[0]->v.classname = classstrings[0];
+	ED_TouchFieldIndexes (spawned[0]);
+	PR_ClearEngineString (tempstring);
+	PR_ClearEngineString (zonestring);
+
+	// self.origin = f (): f runs a findradius that refiles the pending edict
+	// in its old cell, then OP_STOREP_V moves it well clear of the crowd
+	ED_TouchFieldIndexes (spawned[0]);
+	const int originptr = (byte *)&spawned[0]->v.origin - (byte *)qcvm->edicts;
+	VectorCopy (spawned[0]->v.origin, G_VECTOR (OFS_PARM0));
+	G_FLOAT (OFS_PARM1) = 200;
+	qcvm->argc = 2;
+	findradius ();
+	VectorCopy (spawned[0]->v.origin, spot);
+	spot[0] += side * 48 + 4096;
+	VectorCopy (spot, ((eval_t *)((byte *)qcvm->edicts + originptr))->vector);
+	ED_TOUCH_STORED_FIELD (originptr, 3);
+	VectorCopy (spot, G_VECTOR (OFS_PARM0));
+	G_FLOAT (OFS_PARM1) = 8;
+	findradius ();
+	stalegrid = true;
+	for (edict_t *ed = PROG_TO_EDICT (G_INT (OFS_RETURN)); ed != qcvm->edicts; ed = PROG_TO_EDICT (ed->v.chain))
+		if (ed == spawned[0])
+			stalegrid = false;
+	spot[0] -= side * 48 + 4096;
+	VectorCopy (spot, spawned[0]->v.origin);
+	ED_TouchFieldIndexes (spawned[0]);
+	Cvar_SetValueQuick (&pr_fieldindexes, oldvalue);
+
+	Con_Printf (
+		"%d edicts, %d walks: scan %.2f us/walk, indexed %.2f us/walk (%.1fx)%s\n", qcvm->num_edicts, iterations * 2, elapsed[0] * 1e6 / (iterations * 2),
+		elapsed[1] * 1e6 / (iterations * 2), elapsed[1] > 0 ? elapsed[0] / elapsed[1] : 0.0, (found[0] != found[1]) ? " RESULTS DIFFER" : "");
+	Con_Printf (
+		"%d findradius: scan %.2f us/query, grid %.2f us/query (%.1fx)%s\n", iterations * 10, radiuselapsed[0] * 1e6 / (iterations * 10),
+		radiuselapsed[1] * 1e6 / (iterations * 10), radiuselapsed[1] > 0 ? radiuselapsed[0] / radiuselapsed[1] : 0.0,
+		(chainsum[0] != chainsum[1]) ? " RESULTS DIFFER" : "");
+	if (stale)
+		Con_Printf ("find missed a classname changed after a lookup: STALE INDEX\n");
+	if (stalegrid)
+		Con_Printf ("findradius missed an origin stored after a lookup: STALE GRID\n");
+
+	for (i = 0; i < spawnedcount; i++)
+	{
+		spawned[i]->v.classname = 0; // the names are about to go away
+		ED_Free (spawned[i]);
+	}
+	Mem_Free (spawned);
+	for (i = 0; i < FINDBENCH_CLASSES; i++)
+		PR_ClearEngineString (classstrings[i]);
+	PR_ClearEngineString (nomatch);
+	PR_SwitchQCVM (NULL);
+#undef FINDBENCH_CLASSES
+}
+
+/*
+============
+PR_StringBench_f
+
+Churns engine string registration on the server VM the way QC-heavy mods
+do (strzone/strunzone, precache names, netname updates) and reports the
+cost per operation
+============
+*/
+static void PR_StringBench_f (void)
+{
+	const int count = (Cmd_Argc () > 1) ? q_max (atoi (Cmd_Argv (1)), 1) : 10000;
+	char	 *names;
+	int		 *nums;
+	int		  i, pass;
+	double	  start, t_register, t_lookup, t_clear, t_alloc;
+
+	if (!Host_BenchAllowed ())
+		return;
+
+	if (!sv.active)
+	{
+		Con_Printf ("no server running\n");
+		return;
+	}
+
+	PR_SwitchQCVM (&sv.qcvm);
+	names = (char *)Mem_Alloc (count);
+	nums = (int *)Mem_Alloc (count * sizeof (int));
+
+	start = Sys_DoubleTime ();
+	for (i = 0; i < count; i++)
+		nums[i] = PR_SetEngineString (names + i);
+	t_register = Sys_DoubleTime () - start;
+
+	start = Sys_DoubleTime ();
+	for (pass = 0; pass < 4; pass++)
+		for (i = 0; i < count; i++)
+			if (PR_SetEngineString (names + i) != nums[i])
+				Con_Printf ("PR_StringBench_f: lookup mismatch at %d\n", i);
+	t_lookup = Sys_DoubleTime () - start;
+
+	start = Sys_DoubleTime ();
+	for (i = 0; i < count; i += 2) // release out of order to fragment the slots
+		PR_ClearEngineString (nums[i]);
+	for (i = 1; i < count; i += 2)
+		PR_ClearEngineString (nums[i]);
+	t_clear = Sys_DoubleTime () - start;
+
+	start = Sys_DoubleTime ();
+	for (i = 0; i < count; i++)
+		nums[i] = PR_AllocString (16, NULL);
+	for (i = 0; i < count; i++)
+		PR_ClearEngineString (nums[i]);
+	t_alloc = Sys_DoubleTime () - start;
+
+	Con_Printf (
+		"%d strings: register %.1f ns, lookup %.1f ns, clear %.1f ns, alloc+free %.1f ns (%d slots)\n", count, t_register * 1e9 / count,
+		t_lookup * 1e9 / (4 * count), t_clear * 1e9 / count, t_alloc * 1e9 / count, qcvm->numknownstrings);
+
+	Mem_Free (nums);
+	Mem_Free (names);
+	PR_SwitchQCVM (NULL);
 }
@@ -152,6 +152,9 @@ void PR_Profile_f (void)
 	if (!sv.active)
 		return;
 
+	if (pr_fastexec.value)
+		Con_Printf ("note: statement counts are only gathered with pr_fastexec 0\n");
+
 	PR_SwitchQCVM (&sv.qcvm);
 
 	num = 0;
@@ -291,41 +294,24 @@ static int PR_LeaveFunction (void)
 
 /*
 ====================
-PR_ExecuteProgram
+PR_ExecuteStatements
 
-The interpretation main loop
+The interpretation main loop, starting with the statement after st.
+This is the reference interpreter: it is the only one that traces and
+gathers per-function profile counts.
 ====================
 */
 #define OPA ((eval_t *)&qcvm->globals[(unsigned short)st->a])
 #define OPB ((eval_t *)&qcvm->globals[(unsigned short)st->b])
 #define OPC ((eval_t *)&qcvm->globals[(unsigned short)st->c])
 
-void PR_ExecuteProgram (func_t fnum)
+static void PR_ExecuteStatements (dstatement_t *st, int exitdepth)
 {
-	eval_t		 *ptr;
-	dstatement_t *st;
-	dfunction_t	 *f, *newf;
-	int			  profile, startprofile;
-	edict_t		 *ed;
-	int			  exitdepth;
-
-	if (!fnum || fnum >= (func_t)qcvm->progs->numfunctions)
-	{
-		if (pr_global_struct->self)
-			ED_Print (PROG_TO_EDICT (pr_global_struct->self));
-		Host_Error ("PR_ExecuteProgram: NULL function");
-	}
-
-	f = &qcvm->functions[fnum];
-
-	// FIXME: if this is a builtin, then we're going to crash.
-
-	qcvm->trace = false;
+	eval_t		*ptr;
+	dfunction_t *newf;
+	int			 profile, startprofile;
+	edict_t		*ed;
 
-	// make a stack frame
-	exitdepth = qcvm->depth;
-
-	st = &qcvm->statements[PR_EnterFunction (f)];
 	startprofile = profile = 0;
 
 	while (1)
@@ -477,12 +463,14 @@ void PR_ExecuteProgram (func_t fnum)
 		case OP_STOREP_FNC: // pointers
 			ptr = (eval_t *)((byte *)qcvm->edicts + OPB->_int);
 			ptr->_int = OPA->_int;
+			ED_TOUCH_STORED_FIELD (OPB->_int, 1);
 			break;
 		case OP_STOREP_V:
 			ptr = (eval_t *)((byte *)qcvm->edicts + OPB->_int);
 			ptr->vector[0] = OPA->vector[0];
 			ptr->vector[1] = OPA->vector[1];
 			ptr->vector[2] = OPA->vector[2];
+			ED_TOUCH_STORED_FIELD (OPB->_int, 3);
 			break;
 
 		case OP_ADDRESS:
@@ -588,3 +576,845 @@ void PR_ExecuteProgram (func_t fnum)
 #undef OPA
 #undef OPB
 #undef OPC
+
+/*
+==============================================================================
+
+PRE-DECODED STATEMENTS
+
+PR_LoadProgs translates every statement into a prdecoded_t, with the
+operands resolved to global pointers and, under GCC/clang, the address of
+its handler for direct-threaded dispatch. A comparison feeding IF/IFNOT and
+an ADDRESS feeding STOREP run as one fused handler. The decoded array
+parallels qcvm->statements, so statement numbers, branch offsets and saved
+stack frames mean the same thing to both interpreters.
+
+==============================================================================
+*/
+
+cvar_t pr_fastexec = {"pr_fastexec", "1", CVAR_NONE};
+
+#if defined(__GNUC__)
+#define PR_THREADED
+#endif
+
+// comparisons that get fused with a following IF/IFNOT: opcode, result
+#define PR_FUSED_COMPARES                           \
+	PR_FUSED (EQ_F, st->a->_float == st->b->_float) \
+	PR_FUSED (NE_F, st->a->_float != st->b->_float) \
+	PR_FUSED (EQ_E, st->a->_int == st->b->_int)     \
+	PR_FUSED (NE_E, st->a->_int != st->b->_int)     \
+	PR_FUSED (LE, st->a->_float <= st->b->_float)   \
+	PR_FUSED (GE, st->a->_float >= st->b->_float)   \
+	PR_FUSED (LT, st->a->_float < st->b->_float)    \
+	PR_FUSED (GT, st->a->_float > st->b->_float)    \
+	PR_FUSED (NOT_F, !st->a->_float)
+
+enum
+{
+	PRD_BAD = OP_BITOR + 1, // unknown opcode, kept in arg for the error message
+	PRD_ADDRESS_STOREP,
+	PRD_ADDRESS_STOREP_V,
+#define PR_FUSED(n, expr) PRD_##n##_IF, PRD_##n##_IFNOT,
+	PR_FUSED_COMPARES
+#undef PR_FUSED
+	PRD_NUMOPS
+};
+
+typedef struct prdecoded_s
+{
+#ifdef PR_THREADED
+	const void *handler;
+#endif
+	eval_t *a, *b, *c; // resolved global operands, NULL for branch offsets
+	int		arg;	   // branch offset, CALL argc or the unknown opcode
+	int		op;		   // OP_* with the aliases folded, or PRD_*
+} prdecoded_t;
+
+#ifdef PR_THREADED
+static const void *const *pr_handlers;
+#define OPCODE(op) L_##op:
+#define OPCODE_BAD L_PRD_BAD:
+#define NEXT()	   goto *st->handler
+#else
+#define OPCODE(op) case op:
+#define OPCODE_BAD default:
+#define NEXT()	   goto dispatch
+#endif
+
+// every loop has to branch backwards, so counting those is enough to catch runaways
+#define JUMP(from, ofs)                            \
+	do                                             \
+	{                                              \
+		if ((ofs) <= 0 && ++backjumps > 0x1000000) \
+		{                                          \
+			qcvm->xstatement = (from) - base;      \
+			PR_RunError ("runaway loop error");    \
+		}                                          \
+		st = (from) + (ofs);                       \
+	} while (0)
+
+/*
+====================
+PR_ExecuteDecoded
+
+The pre-decoded main loop, starting with the statement at st.
+Called with st == NULL only to publish the handler table.
+====================
+*/
+static void PR_ExecuteDecoded (prdecoded_t *st, int exitdepth)
+{
+#ifdef PR_THREADED
+	static const void *const handlers[PRD_NUMOPS] = {
+		[OP_DONE] = &&L_OP_DONE,
+		[OP_MUL_F] = &&L_OP_MUL_F,
+		[OP_MUL_V] = &&L_OP_MUL_V,
+		[OP_MUL_FV] = &&L_OP_MUL_FV,
+		[OP_MUL_VF] = &&L_OP_MUL_VF,
+		[OP_DIV_F] = &&L_OP_DIV_F,
+		[OP_ADD_F] = &&L_OP_ADD_F,
+		[OP_ADD_V] = &&L_OP_ADD_V,
+		[OP_SUB_F] = &&L_OP_SUB_F,
+		[OP_SUB_V] = &&L_OP_SUB_V,
+		[OP_EQ_F] = &&L_OP_EQ_F,
+		[OP_EQ_V] = &&L_OP_EQ_V,
+		[OP_EQ_S] = &&L_OP_EQ_S,
+		[OP_EQ_E] = &&L_OP_EQ_E,
+		[OP_NE_F] = &&L_OP_NE_F,
+		[OP_NE_V] = &&L_OP_NE_V,
+		[OP_NE_S] = &&L_OP_NE_S,
+		[OP_NE_E] = &&L_OP_NE_E,
+		[OP_LE] = &&L_OP_LE,
+		[OP_GE] = &&L_OP_GE,
+		[OP_LT] = &&L_OP_LT,
+		[OP_GT] = &&L_OP_GT,
+		[OP_LOAD_F] = &&L_OP_LOAD_F,
+		[OP_LOAD_V] = &&L_OP_LOAD_V,
+		[OP_ADDRESS] = &&L_OP_ADDRESS,
+		[OP_STORE_F] = &&L_OP_STORE_F,
+		[OP_STORE_V] = &&L_OP_STORE_V,
+		[OP_STOREP_F] = &&L_OP_STOREP_F,
+		[OP_STOREP_V] = &&L_OP_STOREP_V,
+		[OP_NOT_F] = &&L_OP_NOT_F,
+		[OP_NOT_V] = &&L_OP_NOT_V,
+		[OP_NOT_S] = &&L_OP_NOT_S,
+		[OP_NOT_ENT] = &&L_OP_NOT_ENT,
+		[OP_NOT_FNC] = &&L_OP_NOT_FNC,
+		[OP_IF] = &&L_OP_IF,
+		[OP_IFNOT] = &&L_OP_IFNOT,
+		[OP_CALL0] = &&L_OP_CALL0,
+		[OP_STATE] = &&L_OP_STATE,
+		[OP_GOTO] = &&L_OP_GOTO,
+		[OP_AND] = &&L_OP_AND,
+		[OP_OR] = &&L_OP_OR,
+		[OP_BITAND] = &&L_OP_BITAND,
+		[OP_BITOR] = &&L_OP_BITOR,
+		[PRD_BAD] = &&L_PRD_BAD,
+		[PRD_ADDRESS_STOREP] = &&L_PRD_ADDRESS_STOREP,
+		[PRD_ADDRESS_STOREP_V] = &&L_PRD_ADDRESS_STOREP_V,
+#define PR_FUSED(n, expr) [PRD_##n##_IF] = &&L_PRD_##n##_IF, [PRD_##n##_IFNOT] = &&L_PRD_##n##_IFNOT,
+		PR_FUSED_COMPARES
+#undef PR_FUSED
+	};
+#endif
+	prdecoded_t *base;
+	eval_t		*ptr;
+	dfunction_t *newf;
+	edict_t		*ed;
+	int			 backjumps;
+
+#ifdef PR_THREADED
+	if (!st)
+	{
+		pr_handlers = handlers;
+		return;
+	}
+#endif
+
+	base = qcvm->decoded;
+	backjumps = 0;
+
+	NEXT ();
+#ifndef PR_THREADED
+dispatch:
+	switch (st->op)
+#endif
+	{
+	OPCODE (OP_ADD_F)
+		st->c->_float = st->a->_float + st->b->_float;
+		st++;
+		NEXT ();
+	OPCODE (OP_ADD_V)
+		st->c->vector[0] = st->a->vector[0] + st->b->vector[0];
+		st->c->vector[1] = st->a->vector[1] + st->b->vector[1];
+		st->c->vector[2] = st->a->vector[2] + st->b->vector[2];
+		st++;
+		NEXT ();
+
+	OPCODE (OP_SUB_F)
+		st->c->_float = st->a->_float - st->b->_float;
+		st++;
+		NEXT ();
+	OPCODE (OP_SUB_V)
+		st->c->vector[0] = st->a->vector[0] - st->b->vector[0];
+		st->c->vector[1] = st->a->vector[1] - st->b->vector[1];
+		st->c->vector[2] = st->a->vector[2] - st->b->vector[2];
+		st++;
+		NEXT ();
+
+	OPCODE (OP_MUL_F)
+		st->c->_float = st->a->_float * st->b->_float;
+		st++;
+		NEXT ();
+	OPCODE (OP_MUL_V)
+		st->c->_float = st->a->vector[0] * st->b->vector[0] + st->a->vector[1] * st->b->vector[1] + st->a->vector[2] * st->b->vector[2];
+		st++;
+		NEXT ();
+	OPCODE (OP_MUL_FV)
+		st->c->vector[0] = st->a->_float * st->b->vector[0];
+		st->c->vector[1] = st->a->_float * st->b->vector[1];
+		st->c->vector[2] = st->a->_float * st->b->vector[2];
+		st++;
+		NEXT ();
+	OPCODE (OP_MUL_VF)
+		st->c->vector[0] = st->b->_float * st->a->vector[0];
+		st->c->vector[1] = st->b->_float * st->a->vector[1];
+		st->c->vector[2] = st->b->_float * st->a->vector[2];
+		st++;
+		NEXT ();
+
+	OPCODE (OP_DIV_F)
+		st->c->_float = st->a->_float / st->b->_float;
+		st++;
+		NEXT ();
+
+	OPCODE (OP_BITAND)
+		st->c->_float = (int)st->a->_float & (int)st->b->_float;
+		st++;
+		NEXT ();
+	OPCODE (OP_BITOR)
+		st->c->_float = (int)st->a->_float | (int)st->b->_float;
+		st++;
+		NEXT ();
+
+	OPCODE (OP_GE)
+		st->c->_float = st->a->_float >= st->b->_float;
+		st++;
+		NEXT ();
+	OPCODE (OP_LE)
+		st->c->_float = st->a->_float <= st->b->_float;
+		st++;
+		NEXT ();
+	OPCODE (OP_GT)
+		st->c->_float = st->a->_float > st->b->_float;
+		st++;
+		NEXT ();
+	OPCODE (OP_LT)
+		st->c->_float = st->a->_float < st->b->_float;
+		st++;
+		NEXT ();
+	OPCODE (OP_AND)
+		st->c->_float = st->a->_float && st->b->_float;
+		st++;
+		NEXT ();
+	OPCODE (OP_OR)
+		st->c->_float = st->a->_float || st->b->_float;
+		st++;
+		NEXT ();
+
+	OPCODE (OP_NOT_F)
+		st->c->_float = !st->a->_float;
+		st++;
+		NEXT ();
+	OPCODE (OP_NOT_V)
+		st->c->_float = !st->a->vector[0] && !st->a->vector[1] && !st->a->vector[2];
+		st++;
+		NEXT ();
+	OPCODE (OP_NOT_S)
+		st->c->_float = !st->a->string || !*PR_GetString (st->a->string);
+		st++;
+		NEXT ();
+	OPCODE (OP_NOT_FNC)
+		st->c->_float = !st->a->function;
+		st++;
+		NEXT ();
+	OPCODE (OP_NOT_ENT)
+		st->c->_float = (PROG_TO_EDICT (st->a->edict) == qcvm->edicts);
+		st++;
+		NEXT ();
+
+	OPCODE (OP_EQ_F)
+		st->c->_float = st->a->_float == st->b->_float;
+		st++;
+		NEXT ();
+	OPCODE (OP_EQ_V)
+		st->c->_float = (st->a->vector[0] == st->b->vector[0]) && (st->a->vector[1] == st->b->vector[1]) && (st->a->vector[2] == st->b->vector[2]);
+		st++;
+		NEXT ();
+	OPCODE (OP_EQ_S)
+		st->c->_float = !strcmp (PR_GetString (st->a->string), PR_GetString (st->b->string));
+		st++;
+		NEXT ();
+	OPCODE (OP_EQ_E) // also EQ_FNC
+		st->c->_float = st->a->_int == st->b->_int;
+		st++;
+		NEXT ();
+
+	OPCODE (OP_NE_F)
+		st->c->_float = st->a->_float != st->b->_float;
+		st++;
+		NEXT ();
+	OPCODE (OP_NE_V)
+		st->c->_float = (st->a->vector[0] != st->b->vector[0]) || (st->a->vector[1] != st->b->vector[1]) || (st->a->vector[2] != st->b->vector[2]);
+		st++;
+		NEXT ();
+	OPCODE (OP_NE_S)
+		st->c->_float = strcmp (PR_GetString (st->a->string), PR_GetString (st->b->string));
+		st++;
+		NEXT ();
+	OPCODE (OP_NE_E) // also NE_FNC
+		st->c->_float = st->a->_int != st->b->_int;
+		st++;
+		NEXT ();
+
+	OPCODE (OP_STORE_F) // also ENT, FLD, S, FNC
+		st->b->_int = st->a->_int;
+		st++;
+		NEXT ();
+	OPCODE (OP_STORE_V)
+		st->b->vector[0] = st->a->vector[0];
+		st->b->vector[1] = st->a->vector[1];
+		st->b->vector[2] = st->a->vector[2];
+		st++;
+		NEXT ();
+
+	OPCODE (OP_STOREP_F) // also ENT, FLD, S, FNC
+		ptr = (eval_t *)((byte *)qcvm->edicts + st->b->_int);
+		ptr->_int = st->a->_int;
+		ED_TOUCH_STORED_FIELD (st->b->_int, 1);
+		st++;
+		NEXT ();
+	OPCODE (OP_STOREP_V)
+		ptr = (eval_t *)((byte *)qcvm->edicts + st->b->_int);
+		ptr->vector[0] = st->a->vector[0];
+		ptr->vector[1] = st->a->vector[1];
+		ptr->vector[2] = st->a->vector[2];
+		ED_TOUCH_STORED_FIELD (st->b->_int, 3);
+		st++;
+		NEXT ();
+
+	OPCODE (OP_ADDRESS)
+		ed = PROG_TO_EDICT (st->a->edict);
+		if (ed == (edict_t *)qcvm->edicts && sv.state == ss_active)
+		{
+			qcvm->xstatement = st - base;
+			PR_RunError ("assignment to world entity");
+		}
+		st->c->_int = (byte *)((int *)&ed->v + st->b->_int) - (byte *)qcvm->edicts;
+		st++;
+		NEXT ();
+
+	OPCODE (PRD_ADDRESS_STOREP)
+		ed = PROG_TO_EDICT (st->a->edict);
+		if (ed == (edict_t *)qcvm->edicts && sv.state == ss_active)
+		{
+			qcvm->xstatement = st - base;
+			PR_RunError ("assignment to world entity");
+		}
+		if (ED_FIELD_WATCHED (st->b->_int))
+			ED_TouchFieldIndexes (ed);
+		ptr = (eval_t *)((int *)&ed->v + st->b->_int);
+		st->c->_int = (byte *)ptr - (byte *)qcvm->edicts;
+		ptr->_int = st[1].a->_int;
+		st += 2;
+		NEXT ();
+	OPCODE (PRD_ADDRESS_STOREP_V)
+		ed = PROG_TO_EDICT (st->a->edict);
+		if (ed == (edict_t *)qcvm->edicts && sv.state == ss_active)
+		{
+			qcvm->xstatement = st - base;
+			PR_RunError ("assignment to world entity");
+		}
+		if (ED_FIELD_WATCHED (st->b->_int))
+			ED_TouchFieldIndexes (ed);
+		ptr = (eval_t *)((int *)&ed->v + st->b->_int);
+		st->c->_int = (byte *)ptr - (byte *)qcvm->edicts;
+		ptr->vector[0] = st[1].a->vector[0];
+		ptr->vector[1] = st[1].a->vector[1];
+		ptr->vector[2] = st[1].a->vector[2];
+		st += 2;
+		NEXT ();
+
+	OPCODE (OP_LOAD_F) // also FLD, ENT, S, FNC
+		ed = PROG_TO_EDICT (st->a->edict);
+		st->c->_int = ((eval_t *)((int *)&ed->v + st->b->_int))->_int;
+		st++;
+		NEXT ();
+	OPCODE (OP_LOAD_V)
+		ed = PROG_TO_EDICT (st->a->edict);
+		ptr = (eval_t *)((int *)&ed->v + st->b->_int);
+		st->c->vector[0] = ptr->vector[0];
+		st->c->vector[1] = ptr->vector[1];
+		st->c->vector[2] = ptr->vector[2];
+		st++;
+		NEXT ();
+
+	OPCODE (OP_IFNOT)
+		if (!st->a->_int)
+			JUMP (st, st->arg);
+		else
+			st++;
+		NEXT ();
+	OPCODE (OP_IF)
+		if (st->a->_int)
+			JUMP (st, st->arg);
+		else
+			st++;
+		NEXT ();
+	OPCODE (OP_GOTO)
+		JUMP (st, st->arg);
+		NEXT ();
+
+#define PR_FUSED(n, expr)         \
+	OPCODE (PRD_##n##_IF)         \
+	st->c->_float = (expr);       \
+	if (st->c->_int)              \
+		JUMP (st + 1, st[1].arg); \
+	else                          \
+		st += 2;                  \
+	NEXT ();                      \
+	OPCODE (PRD_##n##_IFNOT)      \
+	st->c->_float = (expr);       \
+	if (!st->c->_int)             \
+		JUMP (st + 1, st[1].arg); \
+	else                          \
+		st += 2;                  \
+	NEXT ();
+		PR_FUSED_COMPARES
+#undef PR_FUSED
+
+	OPCODE (OP_CALL0) // CALL0 to CALL8, with argc in arg
+		qcvm->xstatement = st - base;
+		qcvm->argc = st->arg;
+		if (!st->a->function)
+			PR_RunError ("NULL function");
+		newf = &qcvm->functions[st->a->function];
+		if (newf->first_statement < 0)
+		{ // Built-in function
+			int i = -newf->first_statement;
+			if (i >= qcvm->numbuiltins)
+				i = 0; // just invoke the fixme builtin.
+			qcvm->builtins[i]();
+			if (qcvm->trace)
+			{ // traceon: the reference loop finishes this call
+				PR_ExecuteStatements (&qcvm->statements[st - base], exitdepth);
+				return;
+			}
+			st++;
+			NEXT ();
+		}
+		// Normal function
+		st = &base[PR_EnterFunction (newf) + 1];
+		NEXT ();
+
+	OPCODE (OP_DONE) // also RETURN
+		qcvm->xstatement = st - base;
+		qcvm->globals[OFS_RETURN] = st->a->vector[0];
+		qcvm->globals[OFS_RETURN + 1] = st->a->vector[1];
+		qcvm->globals[OFS_RETURN + 2] = st->a->vector[2];
+		st = &base[PR_LeaveFunction () + 1];
+		if (qcvm->depth == exitdepth)
+		{ // Done
+			return;
+		}
+		NEXT ();
+
+	OPCODE (OP_STATE)
+		ed = PROG_TO_EDICT (pr_global_struct->self);
+		ed->v.nextthink = pr_global_struct->time + 0.1;
+		ed->v.frame = st->a->_float;
+		ed->v.think = st->b->function;
+		st++;
+		NEXT ();
+
+	OPCODE_BAD
+		qcvm->xstatement = st - base;
+		PR_RunError ("Bad opcode %i", st->arg);
+	}
+}
+#undef OPCODE
+#undef OPCODE_BAD
+#undef NEXT
+#undef JUMP
+
+/*
+====================
+PR_DecodeStatements
+
+Builds qcvm->decoded from the loaded statements
+====================
+*/
+void PR_DecodeStatements (void)
+{
+	int			  i, numstatements;
+	dstatement_t *s;
+	prdecoded_t	 *d;
+
+#ifdef PR_THREADED
+	if (!pr_handlers)
+		PR_ExecuteDecoded (NULL, 0);
+#endif
+
+	numstatements = qcvm->progs->numstatements;
+	qcvm->decoded = (prdecoded_t *)Mem_Alloc (numstatements * sizeof (prdecoded_t));
+
+	for (i = 0, s = qcvm->statements, d = qcvm->decoded; i < numstatements; i++, s++, d++)
+	{
+		d->op = s->op;
+		d->a = (eval_t *)&qcvm->globals[(unsigned short)s->a];
+		d->b = (eval_t *)&qcvm->globals[(unsigned short)s->b];
+		d->c = (eval_t *)&qcvm->globals[(unsigned short)s->c];
+		d->arg = 0;
+
+		switch (s->op)
+		{
+		case OP_IF:
+		case OP_IFNOT:
+			d->b = NULL;
+			d->arg = s->b;
+			break;
+		case OP_GOTO:
+			d->a = NULL;
+			d->arg = s->a;
+			break;
+		case OP_CALL0:
+		case OP_CALL1:
+		case OP_CALL2:
+		case OP_CALL3:
+		case OP_CALL4:
+		case OP_CALL5:
+		case OP_CALL6:
+		case OP_CALL7:
+		case OP_CALL8:
+			d->op = OP_CALL0;
+			d->arg = s->op - OP_CALL0;
+			break;
+		case OP_RETURN:
+			d->op = OP_DONE;
+			break;
+		case OP_EQ_FNC:
+			d->op = OP_EQ_E;
+			break;
+		case OP_NE_FNC:
+			d->op = OP_NE_E;
+			break;
+		case OP_STORE_ENT:
+		case OP_STORE_FLD:
+		case OP_STORE_S:
+		case OP_STORE_FNC:
+			d->op = OP_STORE_F;
+			break;
+		case OP_STOREP_ENT:
+		case OP_STOREP_FLD:
+		case OP_STOREP_S:
+		case OP_STOREP_FNC:
+			d->op = OP_STOREP_F;
+			break;
+		case OP_LOAD_FLD:
+		case OP_LOAD_ENT:
+		case OP_LOAD_S:
+		case OP_LOAD_FNC:
+			d->op = OP_LOAD_F;
+			break;
+		default:
+			if (s->op > OP_BITOR)
+			{
+				d->op = PRD_BAD;
+				d->arg = s->op;
+			}
+			break;
+		}
+	}
+
+	// fuse pairs. the second statement keeps its own decoding, so branching
+	// straight to it still works and the fused handler reads its operands.
+	for (i = 0, d = qcvm->decoded; i < numstatements - 1; i++, d++)
+	{
+		if ((d[1].op == OP_IF || d[1].op == OP_IFNOT) && d[1].a == d->c)
+		{
+			switch (d->op)
+			{
+#define PR_FUSED(n, expr)                                            \
+	case OP_##n:                                                     \
+		d->op = (d[1].op == OP_IF) ? PRD_##n##_IF : PRD_##n##_IFNOT; \
+		break;
+				PR_FUSED_COMPARES
+#undef PR_FUSED
+			}
+		}
+		else if (d->op == OP_ADDRESS && d[1].b == d->c)
+		{
+			if (d[1].op == OP_STOREP_F)
+				d->op = PRD_ADDRESS_STOREP;
+			else if (d[1].op == OP_STOREP_V)
+				d->op = PRD_ADDRESS_STOREP_V;
+		}
+	}
+
+#ifdef PR_THREADED
+	for (i = 0, d = qcvm->decoded; i < numstatements; i++, d++)
+		d->handler = pr_handlers[d->op];
+#endif
+}
+
+/*
+====================
+PR_ExecuteFunction
+====================
+*/
+static void PR_ExecuteFunction (func_t fnum, qboolean decoded)
+{
+	dfunction_t *f;
+	int			 s, exitdepth;
+
+	if (!fnum || fnum >= (func_t)qcvm->progs->numfunctions)
+	{
+		if (pr_global_struct->self)
+			ED_Print (PROG_TO_EDICT (pr_global_struct->self));
+		Host_Error ("PR_ExecuteProgram: NULL function");
+	}
+
+	f = &qcvm->functions[fnum];
+
+	// FIXME: if this is a builtin, then we're going to crash.
+
+	qcvm->trace = false;
+
+	// make a stack frame
+	exitdepth = qcvm->depth;
+
+	s = PR_EnterFunction (f);
+	if (decoded && qcvm->decoded)
+		PR_ExecuteDecoded (&qcvm->decoded[s + 1], exitdepth);
+	else
+		PR_ExecuteStatements (&qcvm->statements[s], exitdepth);
+}
+
+/*
+====================
+PR_ExecuteProgram
+====================
+*/
+void PR_ExecuteProgram (func_t fnum)
+{
+	PR_ExecuteFunction (fnum, pr_fastexec.value != 0.f);
+}
+
+/*
+==============================================================================
+
+BENCHMARK
+
+==============================================================================
+*/
+
+#define PRBENCH_LOOPS 10000 // iterations per call of a pattern, well below the runaway limit
+
+// globals of the scratch VM the patterns run on
+enum
+{
+	PRB_ZERO = RESERVED_OFS,
+	PRB_ONE,
+	PRB_I,
+	PRB_N,
+	PRB_T,
+	PRB_A,
+	PRB_B,
+	PRB_C,
+	PRB_ENT,
+	PRB_FLD_F,
+	PRB_FLD_V,
+	PRB_PTR,
+	PRB_FUNC,
+	PRB_PARM,
+	PRB_V1,
+	PRB_V2 = PRB_V1 + 3,
+	PRB_V3 = PRB_V2 + 3,
+	PRB_NUMGLOBALS = PRB_V3 + 3
+};
+
+typedef struct
+{
+	const char	*name;
+	int			 numstatements;
+	dstatement_t statements[8];
+} prbenchpattern_t;
+
+// loop bodies, each run PRBENCH_LOOPS times by i = i + 1; t = i < n; if (t) goto body
+static const prbenchpattern_t pr_benchpatterns[] = {
+	{"float math", 4, {{OP_MUL_F, PRB_A, PRB_B, PRB_C}, {OP_ADD_F, PRB_C, PRB_A, PRB_C}, {OP_SUB_F, PRB_C, PRB_B, PRB_C}, {OP_DIV_F, PRB_C, PRB_B, PRB_C}}},
+	{"vector math", 4, {{OP_MUL_VF, PRB_V1, PRB_A, PRB_V3}, {OP_ADD_V, PRB_V3, PRB_V2, PRB_V3}, {OP_SUB_V, PRB_V3, PRB_V1, PRB_V3}, {OP_MUL_V, PRB_V3, PRB_V2, PRB_C}}},
+	{"compare+branch",
+	 6,
+	 {{OP_LT, PRB_A, PRB_B, PRB_C}, {OP_IFNOT, PRB_C, 1, 0}, {OP_GE, PRB_A, PRB_B, PRB_C}, {OP_IF, PRB_C, 1, 0}, {OP_NE_F, PRB_A, PRB_B, PRB_C}, {OP_IFNOT, PRB_C, 1, 0}}},
+	{"field load", 3, {{OP_LOAD_F, PRB_ENT, PRB_FLD_F, PRB_C}, {OP_LOAD_V, PRB_ENT, PRB_FLD_V, PRB_V3}, {OP_LOAD_FLD, PRB_ENT, PRB_FLD_F, PRB_T}}},
+	{"field store", 4, {{OP_ADDRESS, PRB_ENT, PRB_FLD_F, PRB_PTR}, {OP_STOREP_F, PRB_C, PRB_PTR, 0}, {OP_ADDRESS, PRB_ENT, PRB_FLD_V, PRB_PTR}, {OP_STOREP_V, PRB_V1, PRB_PTR, 0}}},
+	{"qc call", 3, {{OP_STORE_F, PRB_A, OFS_PARM0, 0}, {OP_CALL1, PRB_FUNC, 0, 0}, {OP_STORE_F, OFS_RETURN, PRB_C, 0}}},
+	{"loop only", 0, {{0}}},
+};
+
+/*
+====================
+PR_BenchmarkPatterns
+
+Runs each of pr_benchpatterns as the only function of a scratch VM, under both
+interpreters, and checks that they leave the same globals and edict behind
+====================
+*/
+static void PR_BenchmarkPatterns (int calls)
+{
+	const vec3_t  v1 = {1.f, 2.f, 3.f}, v2 = {0.5f, -1.f, 4.f};
+	qcvm_t		 *vm = (qcvm_t *)Mem_Alloc (sizeof (qcvm_t));
+	dprograms_t	  progs;
+	dfunction_t	  functions[3];
+	dstatement_t  statements[32];
+	float		  globals[2][PRB_NUMGLOBALS];
+	edict_t		 *edicts;
+	entvars_t	  ents[2];
+	int			  i, j, n, pass;
+	double		  start, elapsed[2];
+
+	memset (&progs, 0, sizeof (progs));
+	memset (functions, 0, sizeof (functions));
+	vm->progs = &progs;
+	vm->functions = functions;
+	vm->statements = statements;
+	vm->edict_size = sizeof (edict_t);
+	edicts = (edict_t *)Mem_Alloc (2 * vm->edict_size);
+	vm->edicts = edicts;
+	PR_SwitchQCVM (vm);
+
+	Con_Printf ("%d calls of %d loops per pattern\n", calls, PRBENCH_LOOPS);
+	for (i = 0; i < (int)countof (pr_benchpatterns); i++)
+	{
+		const prbenchpattern_t *pattern = &pr_benchpatterns[i];
+
+		// 0: unused, 1: the loop, then the callee: return parm * b
+		n = 0;
+		statements[n++] = (dstatement_t){OP_DONE, 0, 0, 0};
+		functions[1].first_statement = n;
+		statements[n++] = (dstatement_t){OP_STORE_F, PRB_ZERO, PRB_I, 0};
+		for (j = 0; j < pattern->numstatements; j++)
+			statements[n++] = pattern->statements[j];
+		statements[n++] = (dstatement_t){OP_ADD_F, PRB_I, PRB_ONE, PRB_I};
+		statements[n++] = (dstatement_t){OP_LT, PRB_I, PRB_N, PRB_T};
+		statements[n] = (dstatement_t){OP_IF, PRB_T, functions[1].first_statement + 1 - n, 0};
+		n++;
+		statements[n++] = (dstatement_t){OP_DONE, 0, 0, 0};
+		functions[2].first_statement = n;
+		functions[2].parm_start = PRB_PARM;
+		functions[2].locals = 1;
+		functions[2].numparms = 1;
+		functions[2].parm_size[0] = 1;
+		statements[n++] = (dstatement_t){OP_MUL_F, PRB_PARM, PRB_B, PRB_T};
+		statements[n++] = (dstatement_t){OP_RETURN, PRB_T, 0, 0};
+		progs.numstatements = n;
+		progs.numfunctions = 3;
+
+		for (pass = 0; pass < 2; pass++)
+		{
+			vm->globals = globals[pass];
+			memset (globals[pass], 0, sizeof (globals[pass]));
+			globals[pass][PRB_ONE] = 1.f;
+			globals[pass][PRB_N] = PRBENCH_LOOPS;
+			globals[pass][PRB_A] = 1.5f;
+			globals[pass][PRB_B] = 2.f;
+			((int *)globals[pass])[PRB_ENT] = vm->edict_size;
+			((int *)globals[pass])[PRB_FLD_F] = offsetof (entvars_t, health) / 4;
+			((int *)globals[pass])[PRB_FLD_V] = offsetof (entvars_t, origin) / 4;
+			((int *)globals[pass])[PRB_FUNC] = 2;
+			VectorCopy (v1, &globals[pass][PRB_V1]);
+			VectorCopy (v2, &globals[pass][PRB_V2]);
+			pr_global_struct = (globalvars_t *)vm->globals;
+			memset (edicts, 0, 2 * vm->edict_size);
+			PR_DecodeStatements ();
+
+			PR_ExecuteFunction (1, pass); // warm up
+			start = Sys_DoubleTime ();
+			for (j = 0; j < calls; j++)
+				PR_ExecuteFunction (1, pass);
+			elapsed[pass] = Sys_DoubleTime () - start;
+			ents[pass] = EDICT_NUM_NO_CHECK (1)->v;
+
+			Mem_Free (vm->decoded);
+			vm->decoded = NULL;
+		}
+
+		Con_Printf (
+			"%-16s reference %6.2f ns/loop, decoded %6.2f ns/loop (%.2fx)%s\n", pattern->name, elapsed[0] * 1e9 / ((double)calls * PRBENCH_LOOPS),
+			elapsed[1] * 1e9 / ((double)calls * PRBENCH_LOOPS), elapsed[1] > 0 ? elapsed[0] / elapsed[1] : 0.0,
+			(memcmp (globals[0], globals[1], sizeof (globals[0])) || memcmp (&ents[0], &ents[1], sizeof (ents[0]))) ? " RESULTS DIFFER" : "");
+	}
+
+	PR_SwitchQCVM (NULL);
+	Mem_Free (edicts);
+	Mem_Free (vm);
+}
+
+/*
+====================
+PR_Benchmark_f
+
+pr_benchmark [calls]: times synthetic loops of common statement patterns
+under both interpreters, on a scratch VM.
+pr_benchmark <function> [calls]: times a server QC function under both
+interpreters. The function really runs, so pick one without lasting side
+effects.
+====================
+*/
+void PR_Benchmark_f (void)
+{
+	dfunction_t *f;
+	int			 i, pass, calls;
+	double		 start, elapsed[2];
+
+	if (Cmd_Argc () < 2 || (*Cmd_Argv (1) >= '0' && *Cmd_Argv (1) <= '9'))
+	{
+		PR_BenchmarkPatterns ((Cmd_Argc () > 1) ? q_max (atoi (Cmd_Argv (1)), 1) : 200);
+		return;
+	}
+
+	if (!Host_BenchAllowed ())
+		return;
+	if (!sv.active)
+	{
+		Con_Printf ("no server running\n");
+		return;
+	}
+
+	PR_SwitchQCVM (&sv.qcvm);
+
+	f = ED_FindFunction (Cmd_Argv (1));
+	if (!f || f->first_statement < 0)
+	{
+		Con_Printf ("no QC function \"%s\"\n", Cmd_Argv (1));
+		PR_SwitchQCVM (NULL);
+		return;
+	}
+	calls = (Cmd_Argc () > 2) ? q_max (atoi (Cmd_Argv (2)), 1) : 100000;
+
+	for (pass = 0; pass < 2; pass++)
+	{
+		PR_ExecuteFunction (f - qcvm->functions, pass); // warm up
+		start = Sys_DoubleTime ();
+		for (i = 0; i < calls; i++)
+			PR_ExecuteFunction (f - qcvm->functions, pass);
+		elapsed[pass] = Sys_DoubleTime () - start;
+	}
+
+	Con_Printf (
+		"%s: %i calls, reference %.3f us/call, decoded %.3f us/call (%.2fx)\n", Cmd_Argv (1), calls, elapsed[0] * 1e6 / calls, elapsed[1] * 1e6 / calls,
+		elapsed[1] > 0 ? elapsed[0] / elapsed[1] : 0.0);
+
+	PR_SwitchQCVM (NULL);
+}
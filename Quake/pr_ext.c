@@ -2434,6 +2434,7 @@ static void PF_spawnclient (void)
 				svs.clients[i].spawned = true;
 				ent = svs.clients[i].edict;
 				memset (&ent->v, 0, qcvm->progs->entityfields * 4);
+				ED_TouchFieldIndexes (ent);
 				ent->v.colormap = NUM_FOR_EDICT (ent);
 				ent->v.team = (svs.clients[i].colors & 15) + 1;
 				ent->v.netname = PR_SetEngineString (svs.clients[i].name);
@@ -3692,6 +3693,7 @@ static void PF_copyentity (void)
 	if (src->free || dst->free)
 		Con_Printf ("PF_copyentity: entity is free\n");
 	memcpy (&dst->v, &src->v, qcvm->edict_size - sizeof (entvars_t));
+	ED_TouchFieldIndexes (dst);
 	dst->alpha = src->alpha;
 	dst->sendinterval = src->sendinterval;
 	dst->sendinterval_default = src->sendinterval_default;
@@ -3713,6 +3715,8 @@ static void PF_findchain (void)
 	int			i, f;
 	const char *s, *t;
 	int			cfld;
+	const int  *ents;
+	int			count;
 
 	chain = (edict_t *)qcvm->edicts;
 
@@ -3724,6 +3728,22 @@ static void PF_findchain (void)
 	else
 		cfld = &ent->v.chain - (int *)&ent->v;
 
+	if (ED_FieldIndexLookup (f, s, &ents, &count))
+	{
+		for (i = 0; i < count; i++)
+		{
+			ent = EDICT_NUM (ents[i]);
+			if (strcmp (s, E_STRING (ent, f)))
+				continue;
+			if (ED_FIELD_WATCHED (cfld))
+				ED_TouchFieldIndexes (ent);
+			((int *)&ent->v)[cfld] = EDICT_TO_PROG (chain);
+			chain = ent;
+		}
+		RETURN_EDICT (chain);
+		return;
+	}
+
 	for (i = 1; i < qcvm->num_edicts; i++, ent = NEXT_EDICT (ent))
 	{
 		if (ent->free)
@@ -3849,6 +3869,47 @@ static void PF_findchainflags (void)
 
 	RETURN_EDICT (chain);
 }
+// entity (vector mins, vector maxs, optional .entity chainfield) findbox
+static void PF_findbox (void)
+{
+	edict_t	  *ent, *chain;
+	float	  *mins, *maxs;
+	const int *ents;
+	int		   i, j, count, cfld;
+
+	chain = (edict_t *)qcvm->edicts;
+
+	mins = G_VECTOR (OFS_PARM0);
+	maxs = G_VECTOR (OFS_PARM1);
+	if (qcvm->argc > 2)
+		cfld = G_INT (OFS_PARM2);
+	else
+		cfld = &qcvm->edicts->v.chain - (int *)&qcvm->edicts->v;
+
+	if (!ED_ProximityCandidates (mins, maxs, &ents, &count))
+	{
+		ents = NULL;
+		count = qcvm->num_edicts - 1;
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		ent = EDICT_NUM_NO_CHECK (ents ? ents[i] : i + 1);
+		if (ent->free || ent->v.solid == SOLID_NOT)
+			continue;
+		for (j = 0; j < 3; j++)
+			if (ent->v.origin[j] + ent->v.mins[j] > maxs[j] || ent->v.origin[j] + ent->v.maxs[j] < mins[j])
+				break;
+		if (j < 3)
+			continue;
+		if (ED_FIELD_WATCHED (cfld))
+			ED_TouchFieldIndexes (ent);
+		((int *)&ent->v)[cfld] = EDICT_TO_PROG (chain);
+		chain = ent;
+	}
+
+	RETURN_EDICT (chain);
+}
 static void PF_numentityfields (void)
 {
 	G_FLOAT (OFS_RETURN) = qcvm->progs->numfielddefs;
@@ -3905,7 +3966,10 @@ static void PF_putentfldstr (void)
 	edict_t		*ent = G_EDICT (OFS_PARM1);
 	const char	*value = G_STRING (OFS_PARM2);
 	if (fldidx < (unsigned int)qcvm->progs->numfielddefs)
+	{
 		G_FLOAT (OFS_RETURN) = ED_ParseEpair ((void *)&ent->v, qcvm->fielddefs + fldidx, value, true);
+		ED_TouchFieldIndexes (ent);
+	}
 	else
 		G_FLOAT (OFS_RETURN) = false;
 }
@@ -5697,6 +5761,7 @@ static struct
 	{"cvar_string",					PF_cvar_string,					PF_cvar_string,					448,	 "string(string cvarname)"},//DP_QC_CVAR_STRING
 	{"findflags",					PF_findflags,					PF_findflags,					449,	"entity(entity start, .float fld, float match)"},//DP_QC_FINDFLAGS
 	{"findchainflags",				PF_findchainflags,				PF_findchainflags,				450,	"entity(.float fld, float match, optional .entity chainfield)"},//DP_QC_FINDCHAINFLAGS
+	{"findbox",						PF_findbox,						PF_findbox,						0,		D("entity(vector mins, vector maxs, optional .entity chainfield)", "Returns a chain of the non-free entities that are not SOLID_NOT and whose origin+mins..origin+maxs box overlaps the given box, in the same order findradius would chain them. Entities don't need to be linked, their current fields are used.")},
 	{"dropclient",					PF_dropclient,					PF_NoCSQC,						453,	"void(entity player)"},//DP_SV_BOTCLIENT
 	{"spawnclient",					PF_spawnclient,					PF_NoCSQC,						454,	"entity()", "Spawns a dummy player entity.\nNote that such dummy players will be carried from one map to the next.\nWarning: DP_SV_CLIENTCOLORS DP_SV_CLIENTNAME are not implemented in quakespasm, so use KRIMZON_SV_PARSECLIENTCOMMAND's clientcommand builtin to change the bot's name/colours/skin/team/etc, in the same way that clients would ask."},//DP_SV_BOTCLIENT
 	{"clienttype",					PF_clienttype,					PF_NoCSQC,						455,	"float(entity client)"},//botclient
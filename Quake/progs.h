@@ -64,7 +64,12 @@ typedef struct edict_s
 	// edict num is fixed after creation
 	uint64_t edict_num;
 #endif
-	link_t area; /* linked to a division node or leaf */
+	link_t	 area;		  /* linked to a division node or leaf */
+	int		 areanode;	  /* index of that node in qcvm->areanodes */
+	int		 areacell;	  /* sv_areagrid cell + 1, 0 when not in the grid */
+	int		 areaprev;	  /* edict numbers of the neighbours in that cell, 0 = none */
+	int		 areanext;
+	uint64_t arealinkseq; /* when it was linked, orders the edicts of an areanode */
 
 	unsigned int num_leafs;
 	int			 leafnums[MAX_ENT_LEAFS];
@@ -122,6 +127,13 @@ ddef_t		*ED_FindField (const char *name);
 ddef_t		*ED_FindGlobal (const char *name);
 dfunction_t *ED_FindFunction (const char *fn_name);
 
+void	 ED_TouchFieldIndexes (edict_t *ed);
+void	 ED_TouchStoredField (int ptr, int size);
+void	 ED_InvalidateFieldIndexes (void);
+qboolean ED_FieldIndexLookup (int fieldofs, const char *s, const int **ents, int *count);
+void	 ED_TouchStringSlot (int slot);
+qboolean ED_ProximityCandidates (const vec3_t mins, const vec3_t maxs, const int **ents, int *count);
+
 const char *PR_GetString (int num);
 int			PR_SetEngineString (const char *s);
 int			PR_AllocString (int bufferlength, char **ptr);
@@ -129,6 +141,11 @@ void		PR_ClearEdictStrings ();
 void		PR_ClearEngineString (int num);
 
 void PR_Profile_f (void);
+void PR_Benchmark_f (void);
+void PR_DecodeStatements (void);
+
+extern cvar_t pr_fastexec;	   // run the pre-decoded interpreter instead of the reference loop
+extern cvar_t pr_fieldindexes; // index classname/targetname and positions for the find builtins
 
 edict_t *ED_Alloc (void);
 void	 ED_Free (edict_t *ed);
@@ -357,6 +374,16 @@ typedef struct areanode_s
 #define MAX_AREA_DEPTH	   9
 #define AREA_NODES		   (2 << MAX_AREA_DEPTH)
 
+// sv_areagrid broadphase, see world.c
+typedef struct
+{
+	int	 *heads;	// first edict number of each cell, 0 = empty: solid cells, big solids, trigger cells, big triggers
+	int	  numcells; // per kind, without the big entity list
+	int	  size[2];
+	int	  shift; // log2 of the cell size
+	float origin[2];
+} areagrid_t;
+
 typedef struct hash_map_s hash_map_t;
 
 // the free-list of edicts, as a FIFO made of a circular buffer.
@@ -369,6 +396,56 @@ typedef struct freelist_s
 	uint16_t circular_buffer[MAX_EDICTS];
 } freelist_t;
 
+// secondary index of the live edicts by the contents of a string field, so
+// find () and findchain () on classname/targetname only visit the matches
+#define NUM_FIELD_INDEXES 2
+typedef struct fieldindex_s
+{
+	int			   field;	  // field offset + 1, -1 if the progs lack the field, 0 until resolved
+	int			   watch;	  // same as field while the index is valid, 0 otherwise
+	int			   size;	  // max_edicts the per-edict arrays were sized for
+	hash_map_t	  *buckets;	  // string hash -> VEC of edict numbers in ascending order
+	unsigned int  *hashes;	  // per edict, the bucket it is filed under
+	unsigned char *flags;	  // per edict, FIELDINDEX_FILED | FIELDINDEX_VOLATILE | FIELDINDEX_DIRTY
+	int			  *slots;	  // per edict, 1 + the known string slot the field referenced when refiled, 0 for none
+	hash_map_t	  *slotusers; // known string slot -> VEC of the edicts referencing it, refiled when it is reused
+	int			  *volatiles; // VEC of edicts holding engine strings, in ascending order, returned by every lookup
+	int			  *results;	  // VEC scratch for merging a bucket with the volatiles
+	int			  *dirty;	  // VEC of edicts to refile before the next lookup
+} fieldindex_t;
+
+// loose 2D grid of the non-SOLID_NOT edicts by the center of their bbox, for
+// findradius () and findbox (). Filed from the current fields, not the abs
+// box, since findradius doesn't need an edict to be linked.
+typedef struct proxgrid_s
+{
+	qboolean		valid;
+	int				size;		// max_edicts the per-edict arrays were sized for
+	int			   *heads;		// hashed cell lists, then the list of edicts too big or far out to hash
+	int			   *cells;		// per edict, list + 1 it is filed in, 0 when not filed
+	int			   *prev;		// per edict, neighbours in that list, 0 = none
+	int			   *next;
+	unsigned char  *dirty;		// per edict, refile before the next query
+	int			   *dirtylist;	// VEC
+	unsigned int   *stamps;		// per list, last query that gathered it
+	unsigned int	stamp;
+	int			   *candidates; // VEC, results of the last query
+} proxgrid_t;
+
+// true when a write to field offset ofs has to refile the edict
+#define ED_FIELD_WATCHED(ofs) ((unsigned int)(ofs) < (unsigned int)qcvm->numfieldwatch && qcvm->fieldwatch[ofs])
+
+// OP_STOREP_* through a pointer from OP_ADDRESS. The edict is touched at the store and not
+// at OP_ADDRESS: code like self.classname = f () runs f between the two, and a lookup in f
+// would refile the edict under the old value and consume the mark. size is 3 for vectors,
+// self.origin = PickSpot () has the same problem for the proximity grid.
+#define ED_TOUCH_STORED_FIELD(ptr, size)     \
+	do                                       \
+	{                                        \
+		if (qcvm->numfieldwatch)             \
+			ED_TouchStoredField (ptr, size); \
+	} while (false)
+
 struct qcvm_s
 {
 	dprograms_t	 *progs;
@@ -383,6 +460,8 @@ struct qcvm_s
 
 	int edict_size; /* in bytes */
 
+	struct prdecoded_s *decoded; // statements translated for the pre-decoded interpreter, same indexing
+
 	builtin_t builtins[1024];
 	int		  numbuiltins;
 
@@ -407,8 +486,9 @@ struct qcvm_s
 	qboolean	*knownstringsowned;
 	int			 maxknownstrings;
 	int			 numknownstrings;
-	int			 progsstrings; // allocated by PR_MergeEngineFieldDefs (), not tied to edicts
-	int			 freeknownstrings;
+	int			 progsstrings;		 // allocated by PR_MergeEngineFieldDefs (), not tied to edicts
+	int			*freeknownstrings;	 // VEC of released knownstrings slots, used as a stack
+	hash_map_t	*knownstrings_map; // engine string pointer -> knownstrings slot
 	ddef_t		*globaldefs;
 	hash_map_t	*globaldefs_map;
 
@@ -438,11 +518,18 @@ struct qcvm_s
 	// originally from world.c
 	areanode_t areanodes[AREA_NODES];
 	int		   numareanodes;
+	uint64_t   arealinkseq;
+	areagrid_t areagrid;
 
 	// pusher support records, keyed by edict number: only entities riding a
 	// pusher have one, so this stays far smaller than max_edicts
 	hash_map_t *pusher_support;
 	unsigned	pusher_support_frame;
+
+	fieldindex_t   fieldindexes[NUM_FIELD_INDEXES];
+	proxgrid_t	   proxgrid;
+	unsigned char *fieldwatch; // per field offset, writes have to ED_TouchFieldIndexes
+	int			   numfieldwatch;
 };
 extern globalvars_t *pr_global_struct;
 
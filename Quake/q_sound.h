@@ -45,8 +45,9 @@ typedef struct
 
 typedef struct sfx_s
 {
-	char		name[MAX_QPATH];
-	sfxcache_t *cache;
+	char			  name[MAX_QPATH];
+	sfxcache_t		 *cache;
+	struct sfxload_s *load; /* decode in flight, see S_LoadSoundAsync	*/
 } sfx_t;
 
 typedef struct
@@ -75,6 +76,7 @@ typedef struct
 	vec3_t origin;	   /* origin of sound effect			*/
 	vec_t  dist_mult;  /* distance multiplier (attenuation/clipK)	*/
 	int	   master_vol; /* 0-255 master volume				*/
+	int	   loading;	   /* sample still decoding, end holds the start time	*/
 } channel_t;
 
 #define WAV_FORMAT_PCM 1
@@ -111,6 +113,7 @@ void   S_BeginPrecaching (void);
 void   S_EndPrecaching (void);
 void   S_PaintChannels (int endtime);
 void   S_InitPaintChannels (void);
+void   S_MixBench_f (void);
 
 /* picks a channel based on priorities, empty slots, number of channels */
 channel_t *SND_PickChannel (int entnum, int entchannel);
@@ -182,6 +185,11 @@ extern cvar_t bgmvolume;
 
 void		S_LocalSound (const char *name);
 sfxcache_t *S_LoadSound (sfx_t *s);
+sfxcache_t *S_LoadSoundAsync (sfx_t *s);
+void		S_JoinSoundLoad (sfx_t *s);
+
+extern int snd_loadsinflight;
+extern int snd_stallsavoided;
 
 wavinfo_t GetWavinfo (const char *name, byte *wav, int wavlength);
 
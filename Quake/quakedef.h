@@ -495,6 +495,7 @@ void			   Host_ClientCommands (const char *fmt, ...) FUNC_PRINTF (1, 2);
 void			   Host_ShutdownServer (qboolean crash);
 void			   Host_WriteConfiguration (void);
 void			   Host_Resetdemos (void);
+qboolean		   Host_BenchAllowed (void);
 
 void ExtraMaps_Init (void);
 void Modlist_Init (void);
@@ -506,6 +507,7 @@ void ExtraMaps_Clear (void);
 void ExtraMaps_ShutDown (void);
 void DemoList_Rebuild (void);
 void SaveList_Rebuild (void);
+void Host_FinishSavegame (qboolean wait);
 
 void M_CheckMods (void);
 
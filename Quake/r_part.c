@@ -37,7 +37,44 @@ static const int ramp3[8] = {0x6d, 0x6b, 6, 5, 4, 3};
 
 vec3_t *r_pointfile = NULL;
 
-static particle_t *active_particles, *free_particles, *particles;
+// classic particles are kept in one structure-of-arrays bucket per ptype_t, so the
+// per-frame update runs the same straight-line math over contiguous floats
+#define NUM_PARTICLE_STREAMS	9
+#define PARTICLE_CHUNK_SIZE		2048
+#define PARTICLE_TASK_THRESHOLD 8192
+
+typedef struct
+{
+	float *data; // NUM_PARTICLE_STREAMS streams of capacity floats each
+	int	   count;
+	int	   capacity;
+} particlebucket_t;
+
+#define PARTICLE_ORG(b, j) ((b)->data + (j) * (b)->capacity)
+#define PARTICLE_VEL(b, j) ((b)->data + (3 + (j)) * (b)->capacity)
+#define PARTICLE_RAMP(b)   ((b)->data + 6 * (b)->capacity)
+#define PARTICLE_DIE(b)	   ((b)->data + 7 * (b)->capacity)
+#define PARTICLE_COLOR(b)  ((b)->data + 8 * (b)->capacity)
+
+typedef struct
+{
+	ptype_t type;
+	int		start;
+	int		end;
+} particlechunk_t;
+
+typedef struct
+{
+	float frametime;
+	float time1, time2, time3;
+	float grav;
+	float dvel;
+} particlestep_t;
+
+static particlebucket_t particle_buckets[NUM_PARTICLE_TYPES];
+static int				r_activeparticles;
+static particlechunk_t *particle_chunks;
+static particlestep_t	particle_step;
 
 // beware: different from the r_part_fte.c r_numparticles one, this is for classic particles,
 // set by "-particles" command line.
@@ -48,9 +85,12 @@ static float texturescalefactor; // johnfitz -- compensate for apparent size of
 
 cvar_t		  r_particles = {"r_particles", "1", CVAR_ARCHIVE};			// johnfitz
 static cvar_t r_quadparticles = {"r_quadparticles", "1", CVAR_ARCHIVE}; // johnfitz
+static cvar_t r_parallelparticles = {"r_parallelparticles", "1", CVAR_NONE};
 
 extern cvar_t r_showtris;
 
+static void R_ParticleBench_f (void);
+
 static VkBuffer particle_index_buffer;
 
 /*
@@ -244,16 +284,66 @@ void R_InitParticles (void)
 		r_numparticles = MAX_PARTICLES;
 	}
 
-	particles = (particle_t *)Mem_Alloc (r_numparticles * sizeof (particle_t));
+	particle_chunks = (particlechunk_t *)Mem_Alloc ((r_numparticles / PARTICLE_CHUNK_SIZE + NUM_PARTICLE_TYPES) * sizeof (particlechunk_t));
 
 	Cvar_RegisterVariable (&r_particles); // johnfitz
 	Cvar_SetCallback (&r_particles, R_SetParticleTexture_f);
 	Cvar_RegisterVariable (&r_quadparticles); // johnfitz
+	Cvar_RegisterVariable (&r_parallelparticles);
+	Cmd_AddCommand ("r_particlebench", R_ParticleBench_f);
 
 	R_InitParticleTextures (); // johnfitz
 	R_InitParticleIndexBuffer ();
 }
 
+/*
+===============
+R_GrowParticleBucket
+===============
+*/
+static void R_GrowParticleBucket (particlebucket_t *b)
+{
+	const int newcapacity = q_min (q_max (b->capacity * 2, 256), r_numparticles + 3) & ~3;
+	float	 *newdata = (float *)Mem_AllocNonZero (NUM_PARTICLE_STREAMS * newcapacity * sizeof (float));
+	int		  i;
+
+	for (i = 0; i < NUM_PARTICLE_STREAMS; i++)
+		memcpy (newdata + i * newcapacity, b->data + i * b->capacity, b->count * sizeof (float));
+	Mem_Free (b->data);
+	b->data = newdata;
+	b->capacity = newcapacity;
+}
+
+/*
+===============
+R_AddParticle
+
+Copies p into the bucket of its type, returns false once r_numparticles are alive
+===============
+*/
+static qboolean R_AddParticle (const particle_t *p)
+{
+	particlebucket_t *b = &particle_buckets[p->type];
+	int				  i, j;
+
+	if (r_activeparticles >= r_numparticles)
+		return false;
+	if (b->count == b->capacity)
+		R_GrowParticleBucket (b);
+
+	i = b->count++;
+	for (j = 0; j < 3; j++)
+	{
+		PARTICLE_ORG (b, j)[i] = p->org[j];
+		PARTICLE_VEL (b, j)[i] = p->vel[j];
+	}
+	PARTICLE_RAMP (b)[i] = p->ramp;
+	PARTICLE_DIE (b)[i] = p->die;
+	PARTICLE_COLOR (b)[i] = p->color;
+	++r_activeparticles;
+	return true;
+}
+
 /*
 ===============
 R_EntityParticles
@@ -269,14 +359,14 @@ float		 timescale = 0.01;
 
 void R_EntityParticles (entity_t *ent)
 {
-	int			i;
-	particle_t *p;
-	float		angle;
-	float		sp, sy, cp, cy;
+	int		   i;
+	particle_t p;
+	float	   angle;
+	float	   sp, sy, cp, cy;
 	//	float		sr, cr;
 	//	int		count;
-	vec3_t		forward;
-	float		dist;
+	vec3_t forward;
+	float  dist;
 
 	dist = 64;
 	//	count = 50;
@@ -307,20 +397,16 @@ void R_EntityParticles (entity_t *ent)
 		forward[1] = cp * sy;
 		forward[2] = -sp;
 
-		if (!free_particles)
+		memset (&p, 0, sizeof (p));
+		p.die = cl.time + 0.01;
+		p.color = 0x6f;
+		p.type = pt_explode;
+
+		p.org[0] = ent->origin[0] + r_avertexnormals[i][0] * dist + forward[0] * beamlength;
+		p.org[1] = ent->origin[1] + r_avertexnormals[i][1] * dist + forward[1] * beamlength;
+		p.org[2] = ent->origin[2] + r_avertexnormals[i][2] * dist + forward[2] * beamlength;
+		if (!R_AddParticle (&p))
 			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
-		p->die = cl.time + 0.01;
-		p->color = 0x6f;
-		p->type = pt_explode;
-
-		p->org[0] = ent->origin[0] + r_avertexnormals[i][0] * dist + forward[0] * beamlength;
-		p->org[1] = ent->origin[1] + r_avertexnormals[i][1] * dist + forward[1] * beamlength;
-		p->org[2] = ent->origin[2] + r_avertexnormals[i][2] * dist + forward[2] * beamlength;
 	}
 }
 
@@ -333,12 +419,9 @@ void R_ClearParticles (void)
 {
 	int i;
 
-	free_particles = &particles[0];
-	active_particles = NULL;
-
-	for (i = 0; i < r_numparticles; i++)
-		particles[i].next = &particles[i + 1];
-	particles[r_numparticles - 1].next = NULL;
+	for (i = 0; i < NUM_PARTICLE_TYPES; i++)
+		particle_buckets[i].count = 0;
+	r_activeparticles = 0;
 }
 
 /*
@@ -434,39 +517,35 @@ R_ParticleExplosion
 */
 void R_ParticleExplosion (vec3_t org)
 {
-	int			i, j;
-	particle_t *p;
+	int		   i, j;
+	particle_t p;
 
 	for (i = 0; i < 1024; i++)
 	{
-		if (!free_particles)
-			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
-		p->die = cl.time + 5;
-		p->color = ramp1[0];
-		p->ramp = COM_Rand () & 3;
+		memset (&p, 0, sizeof (p));
+		p.die = cl.time + 5;
+		p.color = ramp1[0];
+		p.ramp = COM_Rand () & 3;
 		if (i & 1)
 		{
-			p->type = pt_explode;
+			p.type = pt_explode;
 			for (j = 0; j < 3; j++)
 			{
-				p->org[j] = org[j] + ((COM_Rand () % 32) - 16);
-				p->vel[j] = (COM_Rand () % 512) - 256;
+				p.org[j] = org[j] + ((COM_Rand () % 32) - 16);
+				p.vel[j] = (COM_Rand () % 512) - 256;
 			}
 		}
 		else
 		{
-			p->type = pt_explode2;
+			p.type = pt_explode2;
 			for (j = 0; j < 3; j++)
 			{
-				p->org[j] = org[j] + ((COM_Rand () % 32) - 16);
-				p->vel[j] = (COM_Rand () % 512) - 256;
+				p.org[j] = org[j] + ((COM_Rand () % 32) - 16);
+				p.vel[j] = (COM_Rand () % 512) - 256;
 			}
 		}
+		if (!R_AddParticle (&p))
+			return;
 	}
 }
 
@@ -477,29 +556,25 @@ R_ParticleExplosion2
 */
 void R_ParticleExplosion2 (vec3_t org, int colorStart, int colorLength)
 {
-	int			i, j;
-	particle_t *p;
-	int			colorMod = 0;
+	int		   i, j;
+	particle_t p;
+	int		   colorMod = 0;
 
 	for (i = 0; i < 512; i++)
 	{
-		if (!free_particles)
-			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
-		p->die = cl.time + 0.3;
-		p->color = colorStart + (colorMod % colorLength);
+		memset (&p, 0, sizeof (p));
+		p.die = cl.time + 0.3;
+		p.color = colorStart + (colorMod % colorLength);
 		colorMod++;
 
-		p->type = pt_blob;
+		p.type = pt_blob;
 		for (j = 0; j < 3; j++)
 		{
-			p->org[j] = org[j] + ((COM_Rand () % 32) - 16);
-			p->vel[j] = (COM_Rand () % 512) - 256;
+			p.org[j] = org[j] + ((COM_Rand () % 32) - 16);
+			p.vel[j] = (COM_Rand () % 512) - 256;
 		}
+		if (!R_AddParticle (&p))
+			return;
 	}
 }
 
@@ -510,40 +585,36 @@ R_BlobExplosion
 */
 void R_BlobExplosion (vec3_t org)
 {
-	int			i, j;
-	particle_t *p;
+	int		   i, j;
+	particle_t p;
 
 	for (i = 0; i < 1024; i++)
 	{
-		if (!free_particles)
-			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
-		p->die = cl.time + 1 + (COM_Rand () & 8) * 0.05;
+		memset (&p, 0, sizeof (p));
+		p.die = cl.time + 1 + (COM_Rand () & 8) * 0.05;
 
 		if (i & 1)
 		{
-			p->type = pt_blob;
-			p->color = 66 + COM_Rand () % 6;
+			p.type = pt_blob;
+			p.color = 66 + COM_Rand () % 6;
 			for (j = 0; j < 3; j++)
 			{
-				p->org[j] = org[j] + ((COM_Rand () % 32) - 16);
-				p->vel[j] = (COM_Rand () % 512) - 256;
+				p.org[j] = org[j] + ((COM_Rand () % 32) - 16);
+				p.vel[j] = (COM_Rand () % 512) - 256;
 			}
 		}
 		else
 		{
-			p->type = pt_blob2;
-			p->color = 150 + COM_Rand () % 6;
+			p.type = pt_blob2;
+			p.color = 150 + COM_Rand () % 6;
 			for (j = 0; j < 3; j++)
 			{
-				p->org[j] = org[j] + ((COM_Rand () % 32) - 16);
-				p->vel[j] = (COM_Rand () % 512) - 256;
+				p.org[j] = org[j] + ((COM_Rand () % 32) - 16);
+				p.vel[j] = (COM_Rand () % 512) - 256;
 			}
 		}
+		if (!R_AddParticle (&p))
+			return;
 	}
 }
 
@@ -554,53 +625,49 @@ R_RunParticleEffect
 */
 void R_RunParticleEffect (vec3_t org, vec3_t dir, int color, int count)
 {
-	int			i, j;
-	particle_t *p;
+	int		   i, j;
+	particle_t p;
 
 	for (i = 0; i < count; i++)
 	{
-		if (!free_particles)
-			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
+		memset (&p, 0, sizeof (p));
 		if (count == 1024)
 		{ // rocket explosion
-			p->die = cl.time + 5;
-			p->color = ramp1[0];
-			p->ramp = COM_Rand () & 3;
+			p.die = cl.time + 5;
+			p.color = ramp1[0];
+			p.ramp = COM_Rand () & 3;
 			if (i & 1)
 			{
-				p->type = pt_explode;
+				p.type = pt_explode;
 				for (j = 0; j < 3; j++)
 				{
-					p->org[j] = org[j] + ((COM_Rand () % 32) - 16);
-					p->vel[j] = (COM_Rand () % 512) - 256;
+					p.org[j] = org[j] + ((COM_Rand () % 32) - 16);
+					p.vel[j] = (COM_Rand () % 512) - 256;
 				}
 			}
 			else
 			{
-				p->type = pt_explode2;
+				p.type = pt_explode2;
 				for (j = 0; j < 3; j++)
 				{
-					p->org[j] = org[j] + ((COM_Rand () % 32) - 16);
-					p->vel[j] = (COM_Rand () % 512) - 256;
+					p.org[j] = org[j] + ((COM_Rand () % 32) - 16);
+					p.vel[j] = (COM_Rand () % 512) - 256;
 				}
 			}
 		}
 		else
 		{
-			p->die = cl.time + 0.1 * (COM_Rand () % 5);
-			p->color = (color & ~7) + (COM_Rand () & 7);
-			p->type = pt_slowgrav;
+			p.die = cl.time + 0.1 * (COM_Rand () % 5);
+			p.color = (color & ~7) + (COM_Rand () & 7);
+			p.type = pt_slowgrav;
 			for (j = 0; j < 3; j++)
 			{
-				p->org[j] = org[j] + ((COM_Rand () & 15) - 8);
-				p->vel[j] = dir[j] * 15; // + (COM_Rand()%300)-150;
+				p.org[j] = org[j] + ((COM_Rand () & 15) - 8);
+				p.vel[j] = dir[j] * 15; // + (COM_Rand()%300)-150;
 			}
 		}
+		if (!R_AddParticle (&p))
+			return;
 	}
 }
 
@@ -611,37 +678,33 @@ R_LavaSplash
 */
 void R_LavaSplash (vec3_t org)
 {
-	int			i, j, k;
-	particle_t *p;
-	float		vel;
-	vec3_t		dir;
+	int		   i, j, k;
+	particle_t p;
+	float	   vel;
+	vec3_t	   dir;
 
 	for (i = -16; i < 16; i++)
 		for (j = -16; j < 16; j++)
 			for (k = 0; k < 1; k++)
 			{
-				if (!free_particles)
-					return;
-				p = free_particles;
-				free_particles = p->next;
-				p->next = active_particles;
-				active_particles = p;
-
-				p->die = cl.time + 2 + (COM_Rand () & 31) * 0.02;
-				p->color = 224 + (COM_Rand () & 7);
-				p->type = pt_slowgrav;
+				memset (&p, 0, sizeof (p));
+				p.die = cl.time + 2 + (COM_Rand () & 31) * 0.02;
+				p.color = 224 + (COM_Rand () & 7);
+				p.type = pt_slowgrav;
 
 				dir[0] = j * 8 + (COM_Rand () & 7);
 				dir[1] = i * 8 + (COM_Rand () & 7);
 				dir[2] = 256;
 
-				p->org[0] = org[0] + dir[0];
-				p->org[1] = org[1] + dir[1];
-				p->org[2] = org[2] + (COM_Rand () & 63);
+				p.org[0] = org[0] + dir[0];
+				p.org[1] = org[1] + dir[1];
+				p.org[2] = org[2] + (COM_Rand () & 63);
 
 				VectorNormalize (dir);
 				vel = 50 + (COM_Rand () & 63);
-				VectorScale (dir, vel, p->vel);
+				VectorScale (dir, vel, p.vel);
+				if (!R_AddParticle (&p))
+					return;
 			}
 }
 
@@ -652,37 +715,33 @@ R_TeleportSplash
 */
 void R_TeleportSplash (vec3_t org)
 {
-	int			i, j, k;
-	particle_t *p;
-	float		vel;
-	vec3_t		dir;
+	int		   i, j, k;
+	particle_t p;
+	float	   vel;
+	vec3_t	   dir;
 
 	for (i = -16; i < 16; i += 4)
 		for (j = -16; j < 16; j += 4)
 			for (k = -24; k < 32; k += 4)
 			{
-				if (!free_particles)
-					return;
-				p = free_particles;
-				free_particles = p->next;
-				p->next = active_particles;
-				active_particles = p;
-
-				p->die = cl.time + 0.2 + (COM_Rand () & 7) * 0.02;
-				p->color = 7 + (COM_Rand () & 7);
-				p->type = pt_slowgrav;
+				memset (&p, 0, sizeof (p));
+				p.die = cl.time + 0.2 + (COM_Rand () & 7) * 0.02;
+				p.color = 7 + (COM_Rand () & 7);
+				p.type = pt_slowgrav;
 
 				dir[0] = j * 8;
 				dir[1] = i * 8;
 				dir[2] = k * 8;
 
-				p->org[0] = org[0] + i + (COM_Rand () & 3);
-				p->org[1] = org[1] + j + (COM_Rand () & 3);
-				p->org[2] = org[2] + k + (COM_Rand () & 3);
+				p.org[0] = org[0] + i + (COM_Rand () & 3);
+				p.org[1] = org[1] + j + (COM_Rand () & 3);
+				p.org[2] = org[2] + k + (COM_Rand () & 3);
 
 				VectorNormalize (dir);
 				vel = 50 + (COM_Rand () & 63);
-				VectorScale (dir, vel, p->vel);
+				VectorScale (dir, vel, p.vel);
+				if (!R_AddParticle (&p))
+					return;
 			}
 }
 
@@ -695,12 +754,12 @@ FIXME -- rename function and use #defined types instead of numbers
 */
 void R_RocketTrail (vec3_t start, vec3_t end, int type)
 {
-	vec3_t		vec;
-	float		len;
-	int			j;
-	particle_t *p;
-	int			dec;
-	static int	tracercount;
+	vec3_t	   vec;
+	float	   len;
+	int		   j;
+	particle_t p;
+	int		   dec;
+	static int tracercount;
 
 	VectorSubtract (end, start, vec);
 	len = VectorNormalize (vec);
@@ -716,81 +775,76 @@ void R_RocketTrail (vec3_t start, vec3_t end, int type)
 	{
 		len -= dec;
 
-		if (!free_particles)
-			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
-		VectorCopy (vec3_origin, p->vel);
-		p->die = cl.time + 2;
+		memset (&p, 0, sizeof (p));
+		p.die = cl.time + 2;
 
 		switch (type)
 		{
 		case 0: // rocket trail
-			p->ramp = (COM_Rand () & 3);
-			p->color = ramp3[(int)p->ramp];
-			p->type = pt_fire;
+			p.ramp = (COM_Rand () & 3);
+			p.color = ramp3[(int)p.ramp];
+			p.type = pt_fire;
 			for (j = 0; j < 3; j++)
-				p->org[j] = start[j] + ((COM_Rand () % 6) - 3);
+				p.org[j] = start[j] + ((COM_Rand () % 6) - 3);
 			break;
 
 		case 1: // smoke smoke
-			p->ramp = (COM_Rand () & 3) + 2;
-			p->color = ramp3[(int)p->ramp];
-			p->type = pt_fire;
+			p.ramp = (COM_Rand () & 3) + 2;
+			p.color = ramp3[(int)p.ramp];
+			p.type = pt_fire;
 			for (j = 0; j < 3; j++)
-				p->org[j] = start[j] + ((COM_Rand () % 6) - 3);
+				p.org[j] = start[j] + ((COM_Rand () % 6) - 3);
 			break;
 
 		case 2: // blood
-			p->type = pt_grav;
-			p->color = 67 + (COM_Rand () & 3);
+			p.type = pt_grav;
+			p.color = 67 + (COM_Rand () & 3);
 			for (j = 0; j < 3; j++)
-				p->org[j] = start[j] + ((COM_Rand () % 6) - 3);
+				p.org[j] = start[j] + ((COM_Rand () % 6) - 3);
 			break;
 
 		case 3:
 		case 5: // tracer
-			p->die = cl.time + 0.5;
-			p->type = pt_static;
+			p.die = cl.time + 0.5;
+			p.type = pt_static;
 			if (type == 3)
-				p->color = 52 + ((tracercount & 4) << 1);
+				p.color = 52 + ((tracercount & 4) << 1);
 			else
-				p->color = 230 + ((tracercount & 4) << 1);
+				p.color = 230 + ((tracercount & 4) << 1);
 
 			tracercount++;
 
-			VectorCopy (start, p->org);
+			VectorCopy (start, p.org);
 			if (tracercount & 1)
 			{
-				p->vel[0] = 30 * vec[1];
-				p->vel[1] = 30 * -vec[0];
+				p.vel[0] = 30 * vec[1];
+				p.vel[1] = 30 * -vec[0];
 			}
 			else
 			{
-				p->vel[0] = 30 * -vec[1];
-				p->vel[1] = 30 * vec[0];
+				p.vel[0] = 30 * -vec[1];
+				p.vel[1] = 30 * vec[0];
 			}
 			break;
 
 		case 4: // slight blood
-			p->type = pt_grav;
-			p->color = 67 + (COM_Rand () & 3);
+			p.type = pt_grav;
+			p.color = 67 + (COM_Rand () & 3);
 			for (j = 0; j < 3; j++)
-				p->org[j] = start[j] + ((COM_Rand () % 6) - 3);
+				p.org[j] = start[j] + ((COM_Rand () % 6) - 3);
 			len -= 3;
 			break;
 
 		case 6: // voor trail
-			p->color = 9 * 16 + 8 + (COM_Rand () & 3);
-			p->type = pt_static;
-			p->die = cl.time + 0.3;
+			p.color = 9 * 16 + 8 + (COM_Rand () & 3);
+			p.type = pt_static;
+			p.die = cl.time + 0.3;
 			for (j = 0; j < 3; j++)
-				p->org[j] = start[j] + ((COM_Rand () & 15) - 8);
+				p.org[j] = start[j] + ((COM_Rand () & 15) - 8);
 			break;
 		}
+		if (!R_AddParticle (&p))
+			return;
 
 		VectorAdd (start, vec, start);
 	}
@@ -798,108 +852,337 @@ void R_RocketTrail (vec3_t start, vec3_t end, int type)
 
 /*
 ===============
-CL_RunParticles -- johnfitz -- all the particle behavior, separated from R_DrawParticles
+R_ParticleMulAdd
+
+dst[i] += src[i] * scale
 ===============
 */
-void CL_RunParticles (void)
+static void R_ParticleMulAdd (float *dst, const float *src, float scale, int count)
 {
-	particle_t	 *p, *kill;
-	int			  i;
-	float		  time1, time2, time3, dvel, frametime, grav;
-	extern cvar_t sv_gravity;
+	int i = 0;
+#if defined(USE_SSE2)
+	const __m128 vscale = _mm_set1_ps (scale);
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps (dst + i, _mm_add_ps (_mm_loadu_ps (dst + i), _mm_mul_ps (_mm_loadu_ps (src + i), vscale)));
+#elif defined(USE_NEON)
+	for (; i + 4 <= count; i += 4)
+		vst1q_f32 (dst + i, vmlaq_n_f32 (vld1q_f32 (dst + i), vld1q_f32 (src + i), scale));
+#endif
+	for (; i < count; i++)
+		dst[i] += src[i] * scale;
+}
 
-	frametime = q_max (0.0, cl.time - cl.oldtime);
-	time3 = frametime * 15;
-	time2 = frametime * 10;
-	time1 = frametime * 5;
-	grav = frametime * sv_gravity.value * 0.05;
-	dvel = 4 * frametime;
+/*
+===============
+R_ParticleScale
+===============
+*/
+static void R_ParticleScale (float *dst, float scale, int count)
+{
+	int i = 0;
+#if defined(USE_SSE2)
+	const __m128 vscale = _mm_set1_ps (scale);
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps (dst + i, _mm_mul_ps (_mm_loadu_ps (dst + i), vscale));
+#elif defined(USE_NEON)
+	for (; i + 4 <= count; i += 4)
+		vst1q_f32 (dst + i, vmulq_n_f32 (vld1q_f32 (dst + i), scale));
+#endif
+	for (; i < count; i++)
+		dst[i] *= scale;
+}
 
-	for (;;)
+/*
+===============
+R_ParticleAdd
+===============
+*/
+static void R_ParticleAdd (float *dst, float value, int count)
+{
+	int i = 0;
+#if defined(USE_SSE2)
+	const __m128 vvalue = _mm_set1_ps (value);
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps (dst + i, _mm_add_ps (_mm_loadu_ps (dst + i), vvalue));
+#elif defined(USE_NEON)
+	const float32x4_t vvalue = vdupq_n_f32 (value);
+	for (; i + 4 <= count; i += 4)
+		vst1q_f32 (dst + i, vaddq_f32 (vld1q_f32 (dst + i), vvalue));
+#endif
+	for (; i < count; i++)
+		dst[i] += value;
+}
+
+/*
+===============
+R_ParticleRamp
+
+Advances the color ramp, particles running off the end of the table get die = -1 so the
+next frame removes them, the others pick up their new color
+===============
+*/
+static void R_ParticleRamp (float *ramp, float *die, float *color, float step, const int *table, float limit, int count)
+{
+	int i = 0;
+#if defined(USE_SSE2) || defined(USE_NEON)
+	int lanes[4];
+	int k;
+#endif
+#if defined(USE_SSE2)
+	const __m128 vstep = _mm_set1_ps (step);
+	const __m128 vlimit = _mm_set1_ps (limit);
+	const __m128 vdead = _mm_set1_ps (-1.0f);
+	for (; i + 4 <= count; i += 4)
 	{
-		kill = active_particles;
-		if (kill && kill->die < cl.time)
-		{
-			active_particles = kill->next;
-			kill->next = free_particles;
-			free_particles = kill;
-			continue;
-		}
+		const __m128 r = _mm_add_ps (_mm_loadu_ps (ramp + i), vstep);
+		const __m128 dead = _mm_cmpge_ps (r, vlimit);
+		const int	 deadmask = _mm_movemask_ps (dead);
+		_mm_storeu_ps (ramp + i, r);
+		_mm_storeu_si128 ((__m128i *)lanes, _mm_cvttps_epi32 (r));
+		if (deadmask)
+			_mm_storeu_ps (die + i, _mm_or_ps (_mm_and_ps (dead, vdead), _mm_andnot_ps (dead, _mm_loadu_ps (die + i))));
+		for (k = 0; k < 4; k++)
+			if (!(deadmask & (1 << k)))
+				color[i + k] = table[lanes[k]];
+	}
+#elif defined(USE_NEON)
+	const float32x4_t vstep = vdupq_n_f32 (step);
+	const float32x4_t vlimit = vdupq_n_f32 (limit);
+	const float32x4_t vdead = vdupq_n_f32 (-1.0f);
+	uint32_t		  deadlanes[4];
+	for (; i + 4 <= count; i += 4)
+	{
+		const float32x4_t r = vaddq_f32 (vld1q_f32 (ramp + i), vstep);
+		const uint32x4_t  dead = vcgeq_f32 (r, vlimit);
+		vst1q_f32 (ramp + i, r);
+		vst1q_s32 (lanes, vcvtq_s32_f32 (r));
+		vst1q_f32 (die + i, vbslq_f32 (dead, vdead, vld1q_f32 (die + i)));
+		vst1q_u32 (deadlanes, dead);
+		for (k = 0; k < 4; k++)
+			if (!deadlanes[k])
+				color[i + k] = table[lanes[k]];
+	}
+#endif
+	for (; i < count; i++)
+	{
+		ramp[i] += step;
+		if (ramp[i] >= limit)
+			die[i] = -1;
+		else
+			color[i] = table[(int)ramp[i]];
+	}
+}
+
+/*
+===============
+R_UpdateParticles
+
+Moves particles [start, end) of one type by particle_step
+===============
+*/
+static void R_UpdateParticles (ptype_t type, int start, int end)
+{
+	particlebucket_t	 *b = &particle_buckets[type];
+	const particlestep_t *step = &particle_step;
+	const int			  count = end - start;
+	float				 *vel[3];
+	int					  j;
+
+	for (j = 0; j < 3; j++)
+	{
+		vel[j] = PARTICLE_VEL (b, j) + start;
+		R_ParticleMulAdd (PARTICLE_ORG (b, j) + start, vel[j], step->frametime, count);
+	}
+
+	switch (type)
+	{
+	case pt_static:
+		break;
+	case pt_fire:
+		R_ParticleRamp (PARTICLE_RAMP (b) + start, PARTICLE_DIE (b) + start, PARTICLE_COLOR (b) + start, step->time1, ramp3, 6, count);
+		R_ParticleAdd (vel[2], step->grav, count);
+		break;
+
+	case pt_explode:
+		R_ParticleRamp (PARTICLE_RAMP (b) + start, PARTICLE_DIE (b) + start, PARTICLE_COLOR (b) + start, step->time2, ramp1, 8, count);
+		for (j = 0; j < 3; j++)
+			R_ParticleScale (vel[j], 1 + step->dvel, count);
+		R_ParticleAdd (vel[2], -step->grav, count);
+		break;
+
+	case pt_explode2:
+		R_ParticleRamp (PARTICLE_RAMP (b) + start, PARTICLE_DIE (b) + start, PARTICLE_COLOR (b) + start, step->time3, ramp2, 8, count);
+		for (j = 0; j < 3; j++)
+			R_ParticleScale (vel[j], 1 - step->frametime, count);
+		R_ParticleAdd (vel[2], -step->grav, count);
+		break;
+
+	case pt_blob:
+		for (j = 0; j < 3; j++)
+			R_ParticleScale (vel[j], 1 + step->dvel, count);
+		R_ParticleAdd (vel[2], -step->grav, count);
+		break;
+
+	case pt_blob2:
+		for (j = 0; j < 2; j++)
+			R_ParticleScale (vel[j], 1 - step->dvel, count);
+		R_ParticleAdd (vel[2], -step->grav, count);
+		break;
+
+	case pt_grav:
+	case pt_slowgrav:
+		R_ParticleAdd (vel[2], -step->grav, count);
+		break;
+
+	default:
 		break;
 	}
+}
 
-	for (p = active_particles; p; p = p->next)
+/*
+===============
+R_UpdateParticlesTask
+===============
+*/
+static void R_UpdateParticlesTask (int index, void *unused)
+{
+	const particlechunk_t *chunk = &particle_chunks[index];
+	R_UpdateParticles (chunk->type, chunk->start, chunk->end);
+}
+
+/*
+===============
+R_KillParticles
+
+Swap-removes the particles of a bucket whose time is up
+===============
+*/
+static void R_KillParticles (particlebucket_t *b)
+{
+	float *die = PARTICLE_DIE (b);
+	int	   i, j, last;
+
+	for (i = 0; i < b->count;)
 	{
-		for (;;)
+		if (die[i] < cl.time)
 		{
-			kill = p->next;
-			if (kill && kill->die < cl.time)
-			{
-				p->next = kill->next;
-				kill->next = free_particles;
-				free_particles = kill;
-				continue;
-			}
-			break;
+			last = --b->count;
+			for (j = 0; j < NUM_PARTICLE_STREAMS; j++)
+				b->data[j * b->capacity + i] = b->data[j * b->capacity + last];
+			--r_activeparticles;
 		}
+		else
+			++i;
+	}
+}
 
-		p->org[0] += p->vel[0] * frametime;
-		p->org[1] += p->vel[1] * frametime;
-		p->org[2] += p->vel[2] * frametime;
+/*
+===============
+CL_RunParticles -- johnfitz -- all the particle behavior, separated from R_DrawParticles
+===============
+*/
+void CL_RunParticles (void)
+{
+	int			  i, start, numchunks;
+	float		  frametime;
+	extern cvar_t sv_gravity;
 
-		switch (p->type)
-		{
-		case pt_static:
-			break;
-		case pt_fire:
-			p->ramp += time1;
-			if (p->ramp >= 6)
-				p->die = -1;
-			else
-				p->color = ramp3[(int)p->ramp];
-			p->vel[2] += grav;
-			break;
+	frametime = q_max (0.0, cl.time - cl.oldtime);
+	particle_step.frametime = frametime;
+	particle_step.time3 = frametime * 15;
+	particle_step.time2 = frametime * 10;
+	particle_step.time1 = frametime * 5;
+	particle_step.grav = frametime * sv_gravity.value * 0.05;
+	particle_step.dvel = 4 * frametime;
 
-		case pt_explode:
-			p->ramp += time2;
-			if (p->ramp >= 8)
-				p->die = -1;
-			else
-				p->color = ramp1[(int)p->ramp];
-			for (i = 0; i < 3; i++)
-				p->vel[i] += p->vel[i] * dvel;
-			p->vel[2] -= grav;
-			break;
+	for (i = 0; i < NUM_PARTICLE_TYPES; i++)
+		R_KillParticles (&particle_buckets[i]);
 
-		case pt_explode2:
-			p->ramp += time3;
-			if (p->ramp >= 8)
-				p->die = -1;
-			else
-				p->color = ramp2[(int)p->ramp];
-			for (i = 0; i < 3; i++)
-				p->vel[i] -= p->vel[i] * frametime;
-			p->vel[2] -= grav;
-			break;
+	if (!r_parallelparticles.value || r_activeparticles < PARTICLE_TASK_THRESHOLD || Tasks_NumWorkers () < 2)
+	{
+		for (i = 0; i < NUM_PARTICLE_TYPES; i++)
+			R_UpdateParticles (i, 0, particle_buckets[i].count);
+		return;
+	}
 
-		case pt_blob:
-			for (i = 0; i < 3; i++)
-				p->vel[i] += p->vel[i] * dvel;
-			p->vel[2] -= grav;
-			break;
+	numchunks = 0;
+	for (i = 0; i < NUM_PARTICLE_TYPES; i++)
+	{
+		for (start = 0; start < particle_buckets[i].count; start += PARTICLE_CHUNK_SIZE)
+		{
+			particle_chunks[numchunks].type = i;
+			particle_chunks[numchunks].start = start;
+			particle_chunks[numchunks].end = q_min (start + PARTICLE_CHUNK_SIZE, particle_buckets[i].count);
+			++numchunks;
+		}
+	}
+	Task_Join (Task_AllocateAssignIndexedFuncAndSubmit (R_UpdateParticlesTask, numchunks, NULL, 0), TASK_TIMEOUT_INFINITE);
+}
 
-		case pt_blob2:
-			for (i = 0; i < 2; i++)
-				p->vel[i] -= p->vel[i] * dvel;
-			p->vel[2] -= grav;
-			break;
+/*
+===============
+R_ParticleBench_f
 
-		case pt_grav:
-		case pt_slowgrav:
-			p->vel[2] -= grav;
-			break;
+r_particlebench [count] [frames]: times CL_RunParticles over a full set of long lived
+particles of every type, once serially and once on the task workers
+===============
+*/
+static void R_ParticleBench_f (void)
+{
+	const int	 count = q_min (Cmd_Argc () > 1 ? q_max (atoi (Cmd_Argv (1)), 1) : r_numparticles, r_numparticles);
+	const int	 frames = Cmd_Argc () > 2 ? q_max (atoi (Cmd_Argv (2)), 1) : 500;
+	const double oldtime = cl.time;
+	const double oldoldtime = cl.oldtime;
+	const float	 oldparallel = r_parallelparticles.value;
+	particle_t	 p;
+	double		 start, elapsed;
+	int			 pass, frame, j;
+	int64_t		 updated;
+
+	if (!Host_BenchAllowed ())
+		return;
+
+	for (pass = 0; pass < 2; pass++)
+	{
+		R_ClearParticles ();
+		r_parallelparticles.value = pass;
+		cl.time = cl.oldtime = 0.0;
+		elapsed = 0.0;
+		updated = 0;
+		for (frame = 0; frame < frames; frame++)
+		{
+			// top up what the ramps and timeouts removed, outside of the timed section
+			while (r_activeparticles < count)
+			{
+				memset (&p, 0, sizeof (p));
+				p.type = (ptype_t)(COM_Rand () % NUM_PARTICLE_TYPES);
+				p.die = cl.time + 1 + (COM_Rand () & 7);
+				p.ramp = COM_Rand () & 3;
+				p.color = COM_Rand () & 255;
+				for (j = 0; j < 3; j++)
+				{
+					p.org[j] = (COM_Rand () % 4096) - 2048;
+					p.vel[j] = (COM_Rand () % 512) - 256;
+				}
+				R_AddParticle (&p);
+			}
+
+			cl.oldtime = cl.time;
+			cl.time += 1.0 / 72.0;
+			start = Sys_DoubleTime ();
+			CL_RunParticles ();
+			elapsed += Sys_DoubleTime () - start;
+			updated += count;
 		}
+		Con_Printf (
+			"%-8s %i particles, %i frames: %.3f ms/frame, %.1f Mparticles/s\n", pass ? "parallel" : "serial", count, frames, elapsed * 1000.0 / frames,
+			updated / q_max (elapsed, 1e-9) / 1e6);
 	}
+
+	r_parallelparticles.value = oldparallel;
+	cl.time = oldtime;
+	cl.oldtime = oldoldtime;
+	R_ClearParticles ();
 }
 
 /*
@@ -909,15 +1192,14 @@ R_DrawParticlesFaces
 */
 static void R_DrawParticlesFaces (cb_context_t *cbx)
 {
-	particle_t	 *p;
 	float		  scale, texcoord_scale;
-	vec3_t		  up, right, up_right, p_up, p_right, p_up_right;
+	vec3_t		  org, up, right, up_right, p_up, p_right, p_up_right;
 	extern cvar_t r_particles; // johnfitz
 
 	if (!r_particles.value)
 		return;
 
-	if (!active_particles)
+	if (!r_activeparticles)
 		return;
 
 	if (r_quadparticles.value)
@@ -936,9 +1218,7 @@ static void R_DrawParticlesFaces (cb_context_t *cbx)
 	for (int i = 0; i < 3; ++i)
 		up_right[i] = up[i] + right[i];
 
-	int num_particles = 0;
-	for (p = active_particles; p; p = p->next)
-		num_particles += 1;
+	const int num_particles = r_activeparticles;
 	Atomic_AddUInt32 (&rs_particles, num_particles);
 
 	VkBuffer	   vertex_buffer;
@@ -950,49 +1230,69 @@ static void R_DrawParticlesFaces (cb_context_t *cbx)
 		vertices = (basicvertex_t *)R_VertexAllocate (num_particles * 3 * sizeof (basicvertex_t), &vertex_buffer, &vertex_buffer_offset);
 
 	int current_vertex = 0;
-	for (p = active_particles; p; p = p->next)
+	for (int type = 0; type < NUM_PARTICLE_TYPES; ++type)
 	{
-		// hack a scale up to keep particles from disapearing
-		scale = (p->org[0] - r_origin[0]) * vpn[0] + (p->org[1] - r_origin[1]) * vpn[1] + (p->org[2] - r_origin[2]) * vpn[2];
-		if (scale < 20)
-			scale = 1 + 0.08; // johnfitz -- added .08 to be consistent
-		else
-			scale = 1 + scale * 0.004;
-
-		scale *= texturescalefactor; // johnfitz -- compensate for apparent size of different particle textures
-
-		byte *c = (byte *)&d_8to24table[(int)p->color];
-
-		vertices[current_vertex].position[0] = p->org[0];
-		vertices[current_vertex].position[1] = p->org[1];
-		vertices[current_vertex].position[2] = p->org[2];
-		vertices[current_vertex].texcoord[0] = 0.0f;
-		vertices[current_vertex].texcoord[1] = 0.0f;
-		vertices[current_vertex].color[0] = c[0];
-		vertices[current_vertex].color[1] = c[1];
-		vertices[current_vertex].color[2] = c[2];
-		vertices[current_vertex].color[3] = 255;
-		current_vertex++;
-
-		VectorMA (p->org, scale, up, p_up);
-		vertices[current_vertex].position[0] = p_up[0];
-		vertices[current_vertex].position[1] = p_up[1];
-		vertices[current_vertex].position[2] = p_up[2];
-		vertices[current_vertex].texcoord[0] = texcoord_scale;
-		vertices[current_vertex].texcoord[1] = 0.0f;
-		vertices[current_vertex].color[0] = c[0];
-		vertices[current_vertex].color[1] = c[1];
-		vertices[current_vertex].color[2] = c[2];
-		vertices[current_vertex].color[3] = 255;
-		current_vertex++;
-
-		if (r_quadparticles.value)
+		const particlebucket_t *b = &particle_buckets[type];
+		for (int i = 0; i < b->count; ++i)
 		{
-			VectorMA (p->org, scale, up_right, p_up_right);
-			vertices[current_vertex].position[0] = p_up_right[0];
-			vertices[current_vertex].position[1] = p_up_right[1];
-			vertices[current_vertex].position[2] = p_up_right[2];
+			org[0] = PARTICLE_ORG (b, 0)[i];
+			org[1] = PARTICLE_ORG (b, 1)[i];
+			org[2] = PARTICLE_ORG (b, 2)[i];
+
+			// hack a scale up to keep particles from disapearing
+			scale = (org[0] - r_origin[0]) * vpn[0] + (org[1] - r_origin[1]) * vpn[1] + (org[2] - r_origin[2]) * vpn[2];
+			if (scale < 20)
+				scale = 1 + 0.08; // johnfitz -- added .08 to be consistent
+			else
+				scale = 1 + scale * 0.004;
+
+			scale *= texturescalefactor; // johnfitz -- compensate for apparent size of different particle textures
+
+			byte *c = (byte *)&d_8to24table[(int)PARTICLE_COLOR (b)[i]];
+
+			vertices[current_vertex].position[0] = org[0];
+			vertices[current_vertex].position[1] = org[1];
+			vertices[current_vertex].position[2] = org[2];
+			vertices[current_vertex].texcoord[0] = 0.0f;
+			vertices[current_vertex].texcoord[1] = 0.0f;
+			vertices[current_vertex].color[0] = c[0];
+			vertices[current_vertex].color[1] = c[1];
+			vertices[current_vertex].color[2] = c[2];
+			vertices[current_vertex].color[3] = 255;
+			current_vertex++;
+
+			VectorMA (org, scale, up, p_up);
+			vertices[current_vertex].position[0] = p_up[0];
+			vertices[current_vertex].position[1] = p_up[1];
+			vertices[current_vertex].position[2] = p_up[2];
 			vertices[current_vertex].texcoord[0] = texcoord_scale;
+			vertices[current_vertex].texcoord[1] = 0.0f;
+			vertices[current_vertex].color[0] = c[0];
+			vertices[current_vertex].color[1] = c[1];
+			vertices[current_vertex].color[2] = c[2];
+			vertices[current_vertex].color[3] = 255;
+			current_vertex++;
+
+			if (r_quadparticles.value)
+			{
+				VectorMA (org, scale, up_right, p_up_right);
+				vertices[current_vertex].position[0] = p_up_right[0];
+				vertices[current_vertex].position[1] = p_up_right[1];
+				vertices[current_vertex].position[2] = p_up_right[2];
+				vertices[current_vertex].texcoord[0] = texcoord_scale;
+				vertices[current_vertex].texcoord[1] = texcoord_scale;
+				vertices[current_vertex].color[0] = c[0];
+				vertices[current_vertex].color[1] = c[1];
+				vertices[current_vertex].color[2] = c[2];
+				vertices[current_vertex].color[3] = 255;
+				current_vertex++;
+			}
+
+			VectorMA (org, scale, right, p_right);
+			vertices[current_vertex].position[0] = p_right[0];
+			vertices[current_vertex].position[1] = p_right[1];
+			vertices[current_vertex].position[2] = p_right[2];
+			vertices[current_vertex].texcoord[0] = 0.0f;
 			vertices[current_vertex].texcoord[1] = texcoord_scale;
 			vertices[current_vertex].color[0] = c[0];
 			vertices[current_vertex].color[1] = c[1];
@@ -1000,18 +1300,6 @@ static void R_DrawParticlesFaces (cb_context_t *cbx)
 			vertices[current_vertex].color[3] = 255;
 			current_vertex++;
 		}
-
-		VectorMA (p->org, scale, right, p_right);
-		vertices[current_vertex].position[0] = p_right[0];
-		vertices[current_vertex].position[1] = p_right[1];
-		vertices[current_vertex].position[2] = p_right[2];
-		vertices[current_vertex].texcoord[0] = 0.0f;
-		vertices[current_vertex].texcoord[1] = texcoord_scale;
-		vertices[current_vertex].color[0] = c[0];
-		vertices[current_vertex].color[1] = c[1];
-		vertices[current_vertex].color[2] = c[2];
-		vertices[current_vertex].color[3] = 255;
-		current_vertex++;
 	}
 
 	vulkan_globals.vk_cmd_bind_vertex_buffers (cbx->cb, 0, 1, &vertex_buffer, &vertex_buffer_offset);
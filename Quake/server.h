@@ -345,6 +345,18 @@ extern client_t *host_client;
 
 extern edict_t *sv_player;
 
+// cost of the last Host_ServerFrame, split by section. only measured while sv_speeds or the server benchmark is active
+typedef struct
+{
+	qboolean enabled;
+	double	 clients_ms;
+	double	 physics_ms;
+	double	 send_ms;
+	double	 entities_ms; // snapshot building and entity delta encoding, part of send_ms
+} sv_tickcost_t;
+
+extern sv_tickcost_t sv_tickcost;
+
 //===========================================================
 
 void SV_Init (void);
@@ -388,4 +400,7 @@ void SV_RunClients (void);
 void SV_SaveSpawnparms ();
 void SV_SpawnServer (const char *server);
 
+qboolean SV_Bench_Active (void);
+void	 SV_Bench_Run (void);
+
 #endif /* _QUAKE_SERVER_H */
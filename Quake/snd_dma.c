@@ -87,6 +87,7 @@ cvar_t snd_mixspeed = {"snd_mixspeed", "44100", CVAR_NONE};
 cvar_t snd_waterfx = {"snd_waterfx", "1", CVAR_ARCHIVE_GAME};
 
 cvar_t snd_pauselooping = {"snd_pauselooping", "1", CVAR_ARCHIVE_GAME};
+cvar_t snd_floatmix = {"snd_floatmix", "1", CVAR_ARCHIVE};
 
 #if defined(_WIN32)
 #define SND_FILTERQUALITY_DEFAULT "5"
@@ -101,6 +102,7 @@ static cvar_t ambient_level = {"ambient_level", "0.3", CVAR_NONE};
 static cvar_t ambient_fade = {"ambient_fade", "100", CVAR_NONE};
 static cvar_t snd_noextraupdate = {"snd_noextraupdate", "0", CVAR_NONE};
 static cvar_t snd_show = {"snd_show", "0", CVAR_NONE};
+static cvar_t snd_loadstats = {"snd_loadstats", "0", CVAR_NONE};
 static cvar_t _snd_mixahead = {"_snd_mixahead", "0.1", CVAR_ARCHIVE};
 
 static void S_SoundInfo_f (void)
@@ -181,12 +183,16 @@ void S_Init (void)
 	Cvar_RegisterVariable (&ambient_fade);
 	Cvar_RegisterVariable (&snd_noextraupdate);
 	Cvar_RegisterVariable (&snd_show);
+	Cvar_RegisterVariable (&snd_loadstats);
 	Cvar_RegisterVariable (&_snd_mixahead);
 	Cvar_RegisterVariable (&sndspeed);
 	Cvar_RegisterVariable (&snd_mixspeed);
 	Cvar_RegisterVariable (&snd_filterquality);
 	Cvar_RegisterVariable (&snd_waterfx);
 	Cvar_RegisterVariable (&snd_pauselooping);
+	Cvar_RegisterVariable (&snd_floatmix);
+
+	Cmd_AddCommand ("snd_mixbench", S_MixBench_f);
 
 	if (safemode || COM_CheckParm ("-nosound"))
 		return;
@@ -262,6 +268,7 @@ static void S_FlushOldestSounds (void)
 
 	for (int i = 0; i < MAX_SOUNDS; ++i)
 	{
+		S_JoinSoundLoad (&known_sfx[i]);
 		SAFE_FREE (known_sfx[i].cache);
 	}
 
@@ -340,9 +347,9 @@ sfx_t *S_PrecacheSound (const char *name)
 
 	sfx = S_FindName (name);
 
-	// cache it in
+	// start decoding it, so it is usually ready by the time it is first played
 	if (precache.value)
-		S_LoadSound (sfx);
+		S_LoadSoundAsync (sfx);
 
 	return sfx;
 }
@@ -479,8 +486,8 @@ void S_StartSound (int entnum, int entchannel, sfx_t *sfx, vec3_t origin, float
 		goto unlock_mutex;
 
 	// new channel
-	sc = S_LoadSound (sfx);
-	if (!sc)
+	sc = S_LoadSoundAsync (sfx);
+	if (!sc && !sfx->load)
 	{
 		target_chan->sfx = NULL;
 		goto unlock_mutex; // couldn't load the sound's data
@@ -488,6 +495,13 @@ void S_StartSound (int entnum, int entchannel, sfx_t *sfx, vec3_t origin, float
 
 	target_chan->sfx = sfx;
 	target_chan->pos = 0.0;
+	if (!sc)
+	{ // start silent, S_PaintChannels catches up once the sample is decoded
+		target_chan->loading = true;
+		target_chan->end = paintedtime;
+		snd_stallsavoided++;
+		goto unlock_mutex;
+	}
 	target_chan->end = paintedtime + sc->length;
 
 	// if an identical sound has also been started this frame, offset the pos
@@ -916,6 +930,9 @@ void S_Update (vec3_t origin, vec3_t forward, vec3_t right, vec3_t up)
 		Con_Printf ("----(%i)----\n", total);
 	}
 
+	if (snd_loadstats.value)
+		Con_Printf ("sound loads: %i in flight, %i mixer stalls avoided\n", snd_loadsinflight, snd_stallsavoided);
+
 	// add raw data from streamed samples
 	//	BGM_Update();	// moved to the main loop just before S_Update ()
 
@@ -1046,6 +1063,7 @@ void S_ClearAll (void)
 
 	for (int i = 0; i < num_sfx; ++i)
 	{
+		S_JoinSoundLoad (&known_sfx[i]);
 		SAFE_FREE (known_sfx[i].cache);
 	}
 
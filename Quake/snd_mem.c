@@ -24,12 +24,27 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 extern SDL_Mutex *snd_mutex;
 
+// a decode running on a worker, published into sfx->cache by the main thread under snd_mutex
+typedef struct sfxload_s
+{
+	task_handle_t	task;
+	char			name[MAX_QPATH];
+	int				outrate;
+	qboolean		as8bit;
+	sfxcache_t	   *sc;
+	const char	   *error; // format string taking the name, printed when published
+	atomic_uint32_t done;
+} sfxload_t;
+
+int snd_loadsinflight;
+int snd_stallsavoided;
+
 /*
 ================
 ResampleSfx
 ================
 */
-static void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
+static void ResampleSfx (sfxcache_t *sc, int inrate, int inwidth, byte *data, int outrate, qboolean as8bit)
 {
 	int	  outcount;
 	int	  srcsample;
@@ -37,17 +52,15 @@ static void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
 	int	  i;
 	int	  sample, fracstep;
 
-	sfxcache_t *sc = sfx->cache;
-
-	stepscale = (float)inrate / shm->speed; // this is usually 0.5, 1, or 2
+	stepscale = (float)inrate / outrate; // this is usually 0.5, 1, or 2
 
 	outcount = sc->length / stepscale;
 	sc->length = outcount;
 	if (sc->loopstart != -1)
 		sc->loopstart = sc->loopstart / stepscale;
 
-	sc->speed = shm->speed;
-	if (loadas8bit.value)
+	sc->speed = outrate;
+	if (as8bit)
 		sc->width = 1;
 	else
 		sc->width = inwidth;
@@ -87,32 +100,23 @@ static void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
 
 /*
 ==============
-S_LoadSound
+S_DecodeSound
+
+Reads, parses and resamples a wav without touching any sound state, so it can run on a worker
 ==============
 */
-sfxcache_t *S_LoadSound (sfx_t *s)
+static sfxcache_t *S_DecodeSound (const char *name, int outrate, qboolean as8bit, const char **error)
 {
 	char		namebuffer[256];
-	byte	   *data = NULL;
+	byte	   *data;
 	wavinfo_t	info;
 	int			len;
 	float		stepscale;
 	sfxcache_t *sc = NULL;
 
-	SDL_LockMutex (snd_mutex);
-
-	// see if still in memory
-	if (s->cache)
-	{
-		sc = s->cache;
-		goto unlock_mutex;
-	}
-
-	//	Con_Printf ("S_LoadSound: %x\n", (int)stackbuf);
-
 	// load it in
 	q_strlcpy (namebuffer, "sound/", sizeof (namebuffer));
-	q_strlcat (namebuffer, s->name, sizeof (namebuffer));
+	q_strlcat (namebuffer, name, sizeof (namebuffer));
 
 	//	Con_Printf ("loading %s\n",namebuffer);
 
@@ -120,52 +124,142 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 
 	if (!data)
 	{
-		Con_Printf ("Couldn't load %s\n", namebuffer);
-		goto unlock_mutex;
+		*error = "Couldn't load sound/%s\n";
+		return NULL;
 	}
 
-	info = GetWavinfo (s->name, data, com_filesize);
+	info = GetWavinfo (name, data, com_filesize);
 	if (info.channels != 1)
 	{
-		Con_Printf ("%s is a stereo sample\n", s->name);
-		goto unlock_mutex;
+		*error = "%s is a stereo sample\n";
+		goto free_data;
 	}
 
 	if (info.width != 1 && info.width != 2)
 	{
-		Con_Printf ("%s is not 8 or 16 bit\n", s->name);
-		goto unlock_mutex;
+		*error = "%s is not 8 or 16 bit\n";
+		goto free_data;
 	}
 
-	stepscale = (float)info.rate / shm->speed;
+	stepscale = (float)info.rate / outrate;
 	len = info.samples / stepscale;
 
 	len = len * info.width * info.channels;
 
 	if (info.samples == 0 || len == 0)
 	{
-		Con_Printf ("%s has zero samples\n", s->name);
-		goto unlock_mutex;
+		*error = "%s has zero samples\n";
+		goto free_data;
 	}
 
 	sc = (sfxcache_t *)Mem_Alloc (len + sizeof (sfxcache_t));
 	if (!sc)
-		goto unlock_mutex;
+		goto free_data;
 	sc->length = info.samples;
 	sc->loopstart = info.loopstart;
 	sc->speed = info.rate;
 	sc->width = info.width;
 	sc->stereo = info.channels;
 
-	s->cache = sc;
-	ResampleSfx (s, sc->speed, sc->width, data + info.dataofs);
+	ResampleSfx (sc, sc->speed, sc->width, data + info.dataofs, outrate, as8bit);
 
-unlock_mutex:
+free_data:
 	Mem_Free (data);
-	SDL_UnlockMutex (snd_mutex);
 	return sc;
 }
 
+/*
+==============
+S_LoadSoundTask
+==============
+*/
+static void S_LoadSoundTask (void *payload)
+{
+	sfxload_t *load = *(sfxload_t **)payload;
+
+	load->sc = S_DecodeSound (load->name, load->outrate, load->as8bit, &load->error);
+	Atomic_StoreUInt32 (&load->done, 1);
+}
+
+/*
+==============
+S_JoinSoundLoad
+
+Waits for a decode started by S_LoadSoundAsync and publishes its result, must hold snd_mutex
+==============
+*/
+void S_JoinSoundLoad (sfx_t *s)
+{
+	sfxload_t *load = s->load;
+
+	if (!load)
+		return;
+
+	Task_Join (load->task, TASK_TIMEOUT_INFINITE);
+	if (load->error)
+		Con_Printf (load->error, load->name);
+	s->cache = load->sc;
+	s->load = NULL;
+	Mem_Free (load);
+	snd_loadsinflight--;
+}
+
+/*
+==============
+S_LoadSoundAsync
+
+Returns the sample if it is decoded, otherwise starts decoding it on a worker and returns NULL.
+Check s->load to tell a sample that is on its way from one that failed to load.
+==============
+*/
+sfxcache_t *S_LoadSoundAsync (sfx_t *s)
+{
+	sfxload_t *load;
+
+	SDL_LockMutex (snd_mutex);
+
+	if (s->load && Atomic_LoadUInt32 (&s->load->done))
+		S_JoinSoundLoad (s);
+	if (s->cache || s->load)
+		goto unlock_mutex;
+
+	load = (sfxload_t *)Mem_Alloc (sizeof (sfxload_t));
+	q_strlcpy (load->name, s->name, sizeof (load->name));
+	load->outrate = shm->speed;
+	load->as8bit = loadas8bit.value != 0.f;
+	s->load = load;
+	snd_loadsinflight++;
+	load->task = Task_AllocateAssignFuncAndSubmit (S_LoadSoundTask, &load, sizeof (load));
+
+unlock_mutex:
+	SDL_UnlockMutex (snd_mutex);
+	return s->cache;
+}
+
+/*
+==============
+S_LoadSound
+==============
+*/
+sfxcache_t *S_LoadSound (sfx_t *s)
+{
+	const char *error = NULL;
+
+	SDL_LockMutex (snd_mutex);
+
+	// see if still in memory, or on its way
+	S_JoinSoundLoad (s);
+	if (!s->cache)
+	{
+		s->cache = S_DecodeSound (s->name, shm->speed, loadas8bit.value != 0.f, &error);
+		if (error)
+			Con_Printf (error, s->name);
+	}
+
+	SDL_UnlockMutex (snd_mutex);
+	return s->cache;
+}
+
 /*
 ===============================================================================
 
@@ -174,11 +268,12 @@ WAV loading
 ===============================================================================
 */
 
-static byte *data_p;
-static byte *iff_end;
-static byte *last_chunk;
-static byte *iff_data;
-static int	 iff_chunk_len;
+// per thread, S_LoadSoundTask parses on the workers
+static THREAD_LOCAL byte *data_p;
+static THREAD_LOCAL byte *iff_end;
+static THREAD_LOCAL byte *last_chunk;
+static THREAD_LOCAL byte *iff_data;
+static THREAD_LOCAL int	  iff_chunk_len;
 
 static short GetLittleShort (void)
 {
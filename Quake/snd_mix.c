@@ -25,6 +25,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #define PAINTBUFFER_SIZE 2048
 static portable_samplepair_t paintbuffer[PAINTBUFFER_SIZE];
+static float				 paintbufferf[PAINTBUFFER_SIZE * 2]; // float bus, interleaved left and right in 16 bit output units
 static int					 snd_scaletable[32][256];
 static int					*snd_p, snd_linear_count;
 static short				*snd_out;
@@ -150,6 +151,68 @@ static void S_TransferPaintBuffer (int endtime)
 	}
 }
 
+static void S_TransferStereo16Float (int endtime)
+{
+	int			 lpos, count, i;
+	int			 lpaintedtime = paintedtime;
+	const float *p = paintbufferf;
+	short		*out;
+
+	while (lpaintedtime < endtime)
+	{
+		// handle recirculating buffer issues
+		lpos = lpaintedtime & ((shm->samples >> 1) - 1);
+		out = (short *)shm->buffer + (lpos << 1);
+
+		count = (shm->samples >> 1) - lpos;
+		if (lpaintedtime + count > endtime)
+			count = endtime - lpaintedtime;
+		count <<= 1;
+
+		// the saturating packs do the clamp
+		i = 0;
+#if defined(USE_SSE2)
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128i lo = _mm_cvttps_epi32 (_mm_loadu_ps (p + i));
+			__m128i hi = _mm_cvttps_epi32 (_mm_loadu_ps (p + i + 4));
+			_mm_storeu_si128 ((__m128i *)(out + i), _mm_packs_epi32 (lo, hi));
+		}
+#elif defined(USE_NEON)
+		for (; i + 8 <= count; i += 8)
+		{
+			int16x4_t lo = vqmovn_s32 (vcvtq_s32_f32 (vld1q_f32 (p + i)));
+			int16x4_t hi = vqmovn_s32 (vcvtq_s32_f32 (vld1q_f32 (p + i + 4)));
+			vst1q_s16 (out + i, vcombine_s16 (lo, hi));
+		}
+#endif
+		for (; i < count; i++)
+			out[i] = (short)CLAMP ((float)SHRT_MIN, p[i], (float)SHRT_MAX);
+
+		p += count;
+		lpaintedtime += (count >> 1);
+	}
+}
+
+static void S_TransferPaintBufferFloat (int endtime)
+{
+	int i;
+
+	if (shm->samplebits == 16 && shm->channels == 2)
+	{
+		S_TransferStereo16Float (endtime);
+		return;
+	}
+
+	// the other formats are rare enough to go through the integer buffer
+	for (i = 0; i < endtime - paintedtime; i++)
+	{
+		paintbuffer[i].left = (int)(CLAMP (-65536.f, paintbufferf[i * 2], 65536.f) * 256.f);
+		paintbuffer[i].right = (int)(CLAMP (-65536.f, paintbufferf[i * 2 + 1], 65536.f) * 256.f);
+	}
+	S_TransferPaintBuffer (endtime);
+}
+
 /*
 ==============
 S_MakeBlackmanWindowKernel
@@ -197,6 +260,7 @@ typedef struct
 {
 	float *memory;	   // kernelsize floats
 	float *kernel;	   // kernelsize floats
+	float *phases;	   // kernelsize floats, every 4th tap of kernel starting at 0, 1, 2 and 3 back to back
 	int	   kernelsize; // M+1, rounded up to be a multiple of 16
 	int	   M;		   // M value used to make kernel, even
 	int	   parity;	   // 0-3
@@ -211,6 +275,8 @@ static void S_UpdateFilter (filter_t *filter, int M, float f_c)
 			Mem_Free (filter->memory);
 		if (filter->kernel != NULL)
 			Mem_Free (filter->kernel);
+		if (filter->phases != NULL)
+			Mem_Free (filter->phases);
 
 		filter->M = M;
 		filter->f_c = f_c;
@@ -220,11 +286,27 @@ static void S_UpdateFilter (filter_t *filter, int M, float f_c)
 		filter->kernelsize = (M + 1) + 16 - ((M + 1) % 16);
 		filter->memory = (float *)Mem_Alloc (filter->kernelsize * sizeof (float));
 		filter->kernel = (float *)Mem_Alloc (filter->kernelsize * sizeof (float));
+		filter->phases = (float *)Mem_Alloc (filter->kernelsize * sizeof (float));
 
 		S_MakeBlackmanWindowKernel (filter->kernel, M, f_c);
+		for (int i = 0; i < filter->kernelsize; i++)
+			filter->phases[(i % 4) * (filter->kernelsize / 4) + i / 4] = filter->kernel[i];
 	}
 }
 
+static void S_FreeFilter (filter_t *filter)
+{
+	Mem_Free (filter->memory);
+	Mem_Free (filter->kernel);
+	Mem_Free (filter->phases);
+	memset (filter, 0, sizeof (*filter));
+}
+
+// left and right of the integer bus, then of the float bus. S_MixBench_f
+// points this at its own filters so it doesn't disturb the playing sound.
+static filter_t	 lowpass_filters[4];
+static filter_t *lowpass = lowpass_filters;
+
 /*
 ==============
 S_ApplyFilter
@@ -288,14 +370,90 @@ static void S_ApplyFilter (filter_t *filter, int *data, int stride, int count)
 
 /*
 ==============
-S_LowpassFilter
+S_DotProduct
+
+count must be a multiple of 4
+==============
+*/
+static inline float S_DotProduct (const float *a, const float *b, int count)
+{
+	int i;
+#if defined(USE_SSE2)
+	__m128 sum = _mm_setzero_ps ();
+	for (i = 0; i < count; i += 4)
+		sum = _mm_add_ps (sum, _mm_mul_ps (_mm_loadu_ps (a + i), _mm_loadu_ps (b + i)));
+	sum = _mm_add_ps (sum, _mm_movehl_ps (sum, sum));
+	sum = _mm_add_ss (sum, _mm_shuffle_ps (sum, sum, 1));
+	return _mm_cvtss_f32 (sum);
+#elif defined(USE_NEON)
+	float32x4_t sum = vdupq_n_f32 (0.f);
+	for (i = 0; i < count; i += 4)
+		sum = vmlaq_f32 (sum, vld1q_f32 (a + i), vld1q_f32 (b + i));
+	return vaddvq_f32 (sum);
+#else
+	float sum[4] = {0, 0, 0, 0};
+	for (i = 0; i < count; i += 4)
+	{
+		sum[0] += a[i] * b[i];
+		sum[1] += a[i + 1] * b[i + 1];
+		sum[2] += a[i + 2] * b[i + 2];
+		sum[3] += a[i + 3] * b[i + 3];
+	}
+	return sum[0] + sum[1] + sum[2] + sum[3];
+#endif
+}
+
+/*
+==============
+S_ApplyFilterFloat
+
+S_ApplyFilter for the float bus. Whatever the parity, every output reads the
+inputs at the same position mod 4, so those are gathered into a contiguous
+buffer once and each output becomes a dot product with one of the kernel's
+phases.
+==============
+*/
+static void S_ApplyFilterFloat (filter_t *filter, float *data, int stride, int count)
+{
+	const int kernelsize = filter->kernelsize;
+	const int taps = kernelsize / 4;
+	const int phase = (4 - filter->parity) % 4;
+	int		  i, m;
+
+	TEMP_ALLOC (float, input, kernelsize + count);
+	TEMP_ALLOC (float, decimated, (kernelsize + count) / 4 + 1);
+
+	// memory holds the previous filter->kernelsize samples of input.
+	memcpy (input, filter->memory, kernelsize * sizeof (float));
+	for (i = 0; i < count; i++)
+		input[kernelsize + i] = data[i * stride] * (1.f / 32768.f);
+	memcpy (filter->memory, input + count, kernelsize * sizeof (float));
+
+	for (m = 0; phase + 4 * m < kernelsize + count; m++)
+		decimated[m] = input[phase + 4 * m];
+
+	for (i = 0; i < count; i++)
+	{
+		const int offset = (4 - (filter->parity + i) % 4) % 4;
+		// 4.0 factor makes up the volume drop of the zero-filling, as in S_ApplyFilter
+		data[i * stride] = S_DotProduct (filter->phases + offset * taps, decimated + (i + offset - phase) / 4, taps) * (32768.f * 4.f);
+	}
+
+	filter->parity = (filter->parity + count) % 4;
+
+	TEMP_FREE (decimated);
+	TEMP_FREE (input);
+}
+
+/*
+==============
+S_UpdateLowpassFilter
 
-lowpass filters 24-bit integer samples in 'data' (stored in 32-bit ints).
 assumes 44100Hz sample rate, and lowpasses at around 5kHz
 memory should be a zero-filled filter_t struct
 ==============
 */
-static void S_LowpassFilter (int *data, int stride, int count, filter_t *memory)
+static void S_UpdateLowpassFilter (filter_t *memory)
 {
 	int	  M;
 	float bw, f_c;
@@ -328,9 +486,32 @@ static void S_LowpassFilter (int *data, int stride, int count, filter_t *memory)
 	f_c = (bw * 11025 / 2.0) / 44100.0;
 
 	S_UpdateFilter (memory, M, f_c);
+}
+
+/*
+==============
+S_LowpassFilter
+
+lowpass filters 24-bit integer samples in 'data' (stored in 32-bit ints).
+==============
+*/
+static void S_LowpassFilter (int *data, int stride, int count, filter_t *memory)
+{
+	S_UpdateLowpassFilter (memory);
 	S_ApplyFilter (memory, data, stride, count);
 }
 
+/*
+==============
+S_LowpassFilterFloat
+==============
+*/
+static void S_LowpassFilterFloat (float *data, int stride, int count, filter_t *memory)
+{
+	S_UpdateLowpassFilter (memory);
+	S_ApplyFilterFloat (memory, data, stride, count);
+}
+
 /*
 ===============================================================================
 
@@ -339,12 +520,14 @@ UNDERWATER EFFECT
 ===============================================================================
 */
 
-static struct
+typedef struct
 {
 	float intensity;
 	float alpha;
 	float accum[2];
-} underwater = {0.f, 1.f, {0.f, 0.f}};
+} underwater_t;
+
+static underwater_t underwater = {0.f, 1.f, {0.f, 0.f}};
 
 extern cvar_t snd_waterfx;
 
@@ -385,6 +568,34 @@ static void S_UnderwaterFilter (int endtime)
 	}
 }
 
+static void S_UnderwaterFilterFloat (int endtime)
+{
+	// accum stays in the integer buffer's units, so switching buses mid-frame doesn't pop
+	float left = underwater.accum[0] * (1.f / 256.f);
+	float right = underwater.accum[1] * (1.f / 256.f);
+	int	  i;
+
+	if (!underwater.intensity)
+	{
+		if (endtime > 0)
+		{
+			underwater.accum[0] = paintbufferf[(endtime - 1) * 2] * 256.f;
+			underwater.accum[1] = paintbufferf[(endtime - 1) * 2 + 1] * 256.f;
+		}
+		return;
+	}
+	// a one pole recursion, so this stays sequential
+	for (i = 0; i < endtime; i++)
+	{
+		left += underwater.alpha * (paintbufferf[i * 2] - left);
+		right += underwater.alpha * (paintbufferf[i * 2 + 1] - right);
+		paintbufferf[i * 2] = left;
+		paintbufferf[i * 2 + 1] = right;
+	}
+	underwater.accum[0] = left * 256.f;
+	underwater.accum[1] = right * 256.f;
+}
+
 /*
 ===============================================================================
 
@@ -395,8 +606,117 @@ CHANNEL MIXING
 
 static void SND_PaintChannelFrom8 (channel_t *ch, sfxcache_t *sc, int endtime, int paintbufferstart);
 static void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int endtime, int paintbufferstart);
+static void SND_PaintChannelFloat8 (channel_t *ch, sfxcache_t *sc, int endtime, int paintbufferstart);
+static void SND_PaintChannelFloat16 (channel_t *ch, sfxcache_t *sc, int endtime, int paintbufferstart);
 
 extern cvar_t snd_pauselooping;
+extern cvar_t snd_floatmix;
+
+/*
+==============
+S_FinishPaintBuffer
+
+Clips, filters and adds the music to the mixed channels, then writes them out
+==============
+*/
+static void S_FinishPaintBuffer (int end)
+{
+	int i;
+
+	// clip each sample to 0dB, then reduce by 6dB (to leave some headroom for
+	// the lowpass filter and the music). the lowpass will smooth out the
+	// clipping
+	for (i = 0; i < end - paintedtime; i++)
+	{
+		paintbuffer[i].left = CLAMP (-32768 * 256, paintbuffer[i].left, 32767 * 256) / 2;
+		paintbuffer[i].right = CLAMP (-32768 * 256, paintbuffer[i].right, 32767 * 256) / 2;
+	}
+
+	// apply a lowpass filter
+	if (sndspeed.value == 11025 && shm->speed == 44100)
+	{
+		S_LowpassFilter ((int *)paintbuffer, 2, end - paintedtime, &lowpass[0]);
+		S_LowpassFilter (((int *)paintbuffer) + 1, 2, end - paintedtime, &lowpass[1]);
+	}
+
+	S_UnderwaterFilter (end - paintedtime);
+
+	// paint in the music
+	if (s_rawend >= paintedtime)
+	{ // copy from the streaming sound source
+		int s;
+		int stop;
+
+		stop = (end < s_rawend) ? end : s_rawend;
+
+		for (i = paintedtime; i < stop; i++)
+		{
+			s = i & (MAX_RAW_SAMPLES - 1);
+			// lower music by 6db to match sfx
+			paintbuffer[i - paintedtime].left += s_rawsamples[s].left / 2;
+			paintbuffer[i - paintedtime].right += s_rawsamples[s].right / 2;
+		}
+		//	if (i != end)
+		//		Con_Printf ("partial stream\n");
+		//	else
+		//		Con_Printf ("full stream\n");
+	}
+
+	// transfer out according to DMA format
+	S_TransferPaintBuffer (end);
+}
+
+/*
+==============
+S_FinishPaintBufferFloat
+
+S_FinishPaintBuffer for the float bus
+==============
+*/
+static void S_FinishPaintBufferFloat (int end)
+{
+	const int count = (end - paintedtime) * 2;
+	int		  i = 0;
+
+	// clip each sample to 0dB, then reduce by 6dB
+#if defined(USE_SSE2)
+	{
+		const __m128 lo = _mm_set1_ps (-32768.f), hi = _mm_set1_ps (32767.f), half = _mm_set1_ps (0.5f);
+		for (; i + 4 <= count; i += 4)
+			_mm_storeu_ps (paintbufferf + i, _mm_mul_ps (_mm_min_ps (_mm_max_ps (_mm_loadu_ps (paintbufferf + i), lo), hi), half));
+	}
+#elif defined(USE_NEON)
+	{
+		const float32x4_t lo = vdupq_n_f32 (-32768.f), hi = vdupq_n_f32 (32767.f);
+		for (; i + 4 <= count; i += 4)
+			vst1q_f32 (paintbufferf + i, vmulq_n_f32 (vminq_f32 (vmaxq_f32 (vld1q_f32 (paintbufferf + i), lo), hi), 0.5f));
+	}
+#endif
+	for (; i < count; i++)
+		paintbufferf[i] = CLAMP (-32768.f, paintbufferf[i], 32767.f) * 0.5f;
+
+	if (sndspeed.value == 11025 && shm->speed == 44100)
+	{
+		S_LowpassFilterFloat (paintbufferf, 2, end - paintedtime, &lowpass[2]);
+		S_LowpassFilterFloat (paintbufferf + 1, 2, end - paintedtime, &lowpass[3]);
+	}
+
+	S_UnderwaterFilterFloat (end - paintedtime);
+
+	if (s_rawend >= paintedtime)
+	{
+		int stop = (end < s_rawend) ? end : s_rawend;
+		for (i = paintedtime; i < stop; i++)
+		{
+			int s = i & (MAX_RAW_SAMPLES - 1);
+			// lower music by 6db to match sfx
+			paintbufferf[(i - paintedtime) * 2] += s_rawsamples[s].left * (1.f / 512.f);
+			paintbufferf[(i - paintedtime) * 2 + 1] += s_rawsamples[s].right * (1.f / 512.f);
+		}
+	}
+
+	S_TransferPaintBufferFloat (end);
+}
 
 void S_PaintChannels (int endtime)
 {
@@ -404,6 +724,8 @@ void S_PaintChannels (int endtime)
 	int			end, ltime, count;
 	channel_t  *ch;
 	sfxcache_t *sc;
+	qboolean	decoding;
+	qboolean	floatmix = snd_floatmix.value != 0.f;
 	qboolean	pause_loops = snd_pauselooping.value && (cl.paused || (sv.active && svs.maxclients == 1 && key_dest != key_game));
 
 	snd_vol = sfxvolume.value * 256;
@@ -416,7 +738,10 @@ void S_PaintChannels (int endtime)
 			end = paintedtime + PAINTBUFFER_SIZE;
 
 		// clear the paint buffer
-		memset (paintbuffer, 0, (end - paintedtime) * sizeof (portable_samplepair_t));
+		if (floatmix)
+			memset (paintbufferf, 0, (end - paintedtime) * 2 * sizeof (float));
+		else
+			memset (paintbuffer, 0, (end - paintedtime) * sizeof (portable_samplepair_t));
 
 		// paint in the channels.
 		ch = snd_channels;
@@ -426,9 +751,29 @@ void S_PaintChannels (int endtime)
 				continue;
 			if (!ch->leftvol && !ch->rightvol)
 				continue;
-			sc = S_LoadSound (ch->sfx);
+			decoding = ch->sfx->load != NULL;
+			sc = S_LoadSoundAsync (ch->sfx);
 			if (!sc)
+			{ // decoding on a worker instead of stalling the mix, the channel stays silent until it is ready
+				if (!decoding && ch->sfx->load)
+					snd_stallsavoided++;
+				else if (!ch->sfx->load && ch->loading)
+					ch->sfx = NULL; // couldn't load the sound's data
 				continue;
+			}
+			if (ch->loading)
+			{ // skip what would have played since the channel started
+				ch->loading = false;
+				ch->pos = paintedtime - ch->end;
+				if (ch->pos >= sc->length && sc->loopstart >= 0 && sc->loopstart < sc->length)
+					ch->pos = sc->loopstart + (ch->pos - sc->loopstart) % (sc->length - sc->loopstart);
+				if (ch->pos >= sc->length)
+				{
+					ch->sfx = NULL;
+					continue;
+				}
+				ch->end = paintedtime + sc->length - ch->pos;
+			}
 			if (sc->loopstart >= 0 && pause_loops)
 				continue;
 
@@ -445,7 +790,14 @@ void S_PaintChannels (int endtime)
 				{
 					// the last param to SND_PaintChannelFrom is the index
 					// to start painting to in the paintbuffer, usually 0.
-					if (sc->width == 1)
+					if (floatmix)
+					{
+						if (sc->width == 1)
+							SND_PaintChannelFloat8 (ch, sc, count, ltime - paintedtime);
+						else
+							SND_PaintChannelFloat16 (ch, sc, count, ltime - paintedtime);
+					}
+					else if (sc->width == 1)
 						SND_PaintChannelFrom8 (ch, sc, count, ltime - paintedtime);
 					else
 						SND_PaintChannelFrom16 (ch, sc, count, ltime - paintedtime);
@@ -470,48 +822,10 @@ void S_PaintChannels (int endtime)
 			}
 		}
 
-		// clip each sample to 0dB, then reduce by 6dB (to leave some headroom for
-		// the lowpass filter and the music). the lowpass will smooth out the
-		// clipping
-		for (i = 0; i < end - paintedtime; i++)
-		{
-			paintbuffer[i].left = CLAMP (-32768 * 256, paintbuffer[i].left, 32767 * 256) / 2;
-			paintbuffer[i].right = CLAMP (-32768 * 256, paintbuffer[i].right, 32767 * 256) / 2;
-		}
-
-		// apply a lowpass filter
-		if (sndspeed.value == 11025 && shm->speed == 44100)
-		{
-			static filter_t memory_l, memory_r;
-			S_LowpassFilter ((int *)paintbuffer, 2, end - paintedtime, &memory_l);
-			S_LowpassFilter (((int *)paintbuffer) + 1, 2, end - paintedtime, &memory_r);
-		}
-
-		S_UnderwaterFilter (end - paintedtime);
-
-		// paint in the music
-		if (s_rawend >= paintedtime)
-		{ // copy from the streaming sound source
-			int s;
-			int stop;
-
-			stop = (end < s_rawend) ? end : s_rawend;
-
-			for (i = paintedtime; i < stop; i++)
-			{
-				s = i & (MAX_RAW_SAMPLES - 1);
-				// lower music by 6db to match sfx
-				paintbuffer[i - paintedtime].left += s_rawsamples[s].left / 2;
-				paintbuffer[i - paintedtime].right += s_rawsamples[s].right / 2;
-			}
-			//	if (i != end)
-			//		Con_Printf ("partial stream\n");
-			//	else
-			//		Con_Printf ("full stream\n");
-		}
-
-		// transfer out according to DMA format
-		S_TransferPaintBuffer (end);
+		if (floatmix)
+			S_FinishPaintBufferFloat (end);
+		else
+			S_FinishPaintBuffer (end);
 		paintedtime = end;
 	}
 }
@@ -593,3 +907,240 @@ static void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int count, in
 
 	ch->pos += count;
 }
+
+/*
+==============
+SND_PaintChannelFloat8
+
+The float bus takes the volume as a gain instead of going through snd_scaletable
+==============
+*/
+static void SND_PaintChannelFloat8 (channel_t *ch, sfxcache_t *sc, int count, int paintbufferstart)
+{
+	const float		   leftvol = (q_min (ch->leftvol, 255) >> 3) * 8 * sfxvolume.value;
+	const float		   rightvol = (q_min (ch->rightvol, 255) >> 3) * 8 * sfxvolume.value;
+	const signed char *sfx = (signed char *)sc->data + ch->pos;
+	float			  *out = paintbufferf + paintbufferstart * 2;
+	int				   i = 0;
+
+#if defined(USE_SSE2)
+	{
+		const __m128 gains = _mm_setr_ps (leftvol, rightvol, leftvol, rightvol);
+		for (; i + 4 <= count; i += 4)
+		{
+			int		packed;
+			__m128i bytes;
+			__m128	samples;
+
+			memcpy (&packed, sfx + i, sizeof (packed));
+			bytes = _mm_cvtsi32_si128 (packed);
+			bytes = _mm_unpacklo_epi8 (bytes, bytes);
+			bytes = _mm_unpacklo_epi16 (bytes, bytes); // each byte in the top of its own lane
+			samples = _mm_cvtepi32_ps (_mm_srai_epi32 (bytes, 24));
+			_mm_storeu_ps (out + i * 2, _mm_add_ps (_mm_loadu_ps (out + i * 2), _mm_mul_ps (_mm_unpacklo_ps (samples, samples), gains)));
+			_mm_storeu_ps (out + i * 2 + 4, _mm_add_ps (_mm_loadu_ps (out + i * 2 + 4), _mm_mul_ps (_mm_unpackhi_ps (samples, samples), gains)));
+		}
+	}
+#elif defined(USE_NEON)
+	{
+		const float32x4_t gains = {leftvol, rightvol, leftvol, rightvol};
+		for (; i + 8 <= count; i += 8)
+		{
+			int16x8_t	  wide = vmovl_s8 (vld1_s8 ((const int8_t *)sfx + i));
+			float32x4_t	  lo = vcvtq_f32_s32 (vmovl_s16 (vget_low_s16 (wide)));
+			float32x4_t	  hi = vcvtq_f32_s32 (vmovl_s16 (vget_high_s16 (wide)));
+			float32x4x2_t zlo = vzipq_f32 (lo, lo);
+			float32x4x2_t zhi = vzipq_f32 (hi, hi);
+			vst1q_f32 (out + i * 2, vmlaq_f32 (vld1q_f32 (out + i * 2), zlo.val[0], gains));
+			vst1q_f32 (out + i * 2 + 4, vmlaq_f32 (vld1q_f32 (out + i * 2 + 4), zlo.val[1], gains));
+			vst1q_f32 (out + i * 2 + 8, vmlaq_f32 (vld1q_f32 (out + i * 2 + 8), zhi.val[0], gains));
+			vst1q_f32 (out + i * 2 + 12, vmlaq_f32 (vld1q_f32 (out + i * 2 + 12), zhi.val[1], gains));
+		}
+	}
+#endif
+	for (; i < count; i++)
+	{
+		out[i * 2] += sfx[i] * leftvol;
+		out[i * 2 + 1] += sfx[i] * rightvol;
+	}
+
+	ch->pos += count;
+}
+
+/*
+==============
+SND_PaintChannelFloat16
+==============
+*/
+static void SND_PaintChannelFloat16 (channel_t *ch, sfxcache_t *sc, int count, int paintbufferstart)
+{
+	const float	  leftvol = ch->leftvol * snd_vol * (1.f / 65536.f);
+	const float	  rightvol = ch->rightvol * snd_vol * (1.f / 65536.f);
+	const short *sfx = (short *)sc->data + ch->pos;
+	float		*out = paintbufferf + paintbufferstart * 2;
+	int			  i = 0;
+
+#if defined(USE_SSE2)
+	{
+		const __m128 gains = _mm_setr_ps (leftvol, rightvol, leftvol, rightvol);
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i words = _mm_loadl_epi64 ((const __m128i *)(sfx + i));
+			__m128	samples = _mm_cvtepi32_ps (_mm_srai_epi32 (_mm_unpacklo_epi16 (words, words), 16));
+			_mm_storeu_ps (out + i * 2, _mm_add_ps (_mm_loadu_ps (out + i * 2), _mm_mul_ps (_mm_unpacklo_ps (samples, samples), gains)));
+			_mm_storeu_ps (out + i * 2 + 4, _mm_add_ps (_mm_loadu_ps (out + i * 2 + 4), _mm_mul_ps (_mm_unpackhi_ps (samples, samples), gains)));
+		}
+	}
+#elif defined(USE_NEON)
+	{
+		const float32x4_t gains = {leftvol, rightvol, leftvol, rightvol};
+		for (; i + 4 <= count; i += 4)
+		{
+			float32x4_t	  samples = vcvtq_f32_s32 (vmovl_s16 (vld1_s16 (sfx + i)));
+			float32x4x2_t zipped = vzipq_f32 (samples, samples);
+			vst1q_f32 (out + i * 2, vmlaq_f32 (vld1q_f32 (out + i * 2), zipped.val[0], gains));
+			vst1q_f32 (out + i * 2 + 4, vmlaq_f32 (vld1q_f32 (out + i * 2 + 4), zipped.val[1], gains));
+		}
+	}
+#endif
+	for (; i < count; i++)
+	{
+		out[i * 2] += sfx[i] * leftvol;
+		out[i * 2 + 1] += sfx[i] * rightvol;
+	}
+
+	ch->pos += count;
+}
+
+/*
+==============
+S_MixBench_f
+
+snd_mixbench [channels] [seconds]
+Mixes the given number of synthetic channels into a scratch buffer with the
+integer and the float bus, with every filter stage enabled. The channels,
+filters and underwater state are scratch copies, the playing sound picks up
+where it was.
+==============
+*/
+void S_MixBench_f (void)
+{
+	extern SDL_Mutex *snd_mutex;
+	const int		  numchannels = (Cmd_Argc () > 1) ? CLAMP (1, atoi (Cmd_Argv (1)), MAX_CHANNELS) : 256;
+	const int		  seconds = (Cmd_Argc () > 2) ? CLAMP (1, atoi (Cmd_Argv (2)), 60) : 10;
+	const int		  rate = 44100;
+	const int		  length = seconds * rate;
+	volatile dma_t	 *saved_shm;
+	dma_t			  dma;
+	sfx_t			  sfx[2];
+	sfxcache_t		 *sc[2];
+	channel_t		 *saved_channels;
+	int				  saved_total_channels, saved_paintedtime, saved_rawend;
+	float			  saved_sndspeed, saved_floatmix;
+	underwater_t	  saved_underwater;
+	filter_t		  filters[4];
+	unsigned int	  seed = 0x1234567;
+	int				  i, pass;
+	double			  times[2];
+
+	if (!Host_BenchAllowed ())
+		return;
+
+	SDL_LockMutex (snd_mutex);
+
+	saved_channels = (channel_t *)Mem_AllocNonZero (sizeof (snd_channels));
+	memcpy (saved_channels, snd_channels, sizeof (snd_channels));
+	saved_total_channels = total_channels;
+	saved_paintedtime = paintedtime;
+	saved_rawend = s_rawend;
+	saved_shm = shm;
+	saved_sndspeed = sndspeed.value;
+	saved_floatmix = snd_floatmix.value;
+	saved_underwater = underwater;
+
+	// one 8 bit and one 16 bit sample of noise
+	for (i = 0; i < 2; i++)
+	{
+		int j;
+		memset (&sfx[i], 0, sizeof (sfx[i]));
+		q_snprintf (sfx[i].name, sizeof (sfx[i].name), "mixbench%i", i);
+		sc[i] = (sfxcache_t *)Mem_Alloc (sizeof (sfxcache_t) + length * (i + 1));
+		sc[i]->length = length;
+		sc[i]->loopstart = -1;
+		sc[i]->speed = rate;
+		sc[i]->width = i + 1;
+		for (j = 0; j < length; j++)
+		{
+			seed = seed * 1103515245 + 12345;
+			if (i == 0)
+				((signed char *)sc[i]->data)[j] = (signed char)(seed >> 24);
+			else
+				((short *)sc[i]->data)[j] = (short)(seed >> 16);
+		}
+		sfx[i].cache = sc[i];
+	}
+
+	memset (&dma, 0, sizeof (dma));
+	dma.channels = 2;
+	dma.samplebits = 16;
+	dma.speed = rate;
+	dma.samples = 1 << 16;
+	dma.submission_chunk = 1;
+	dma.buffer = (unsigned char *)Mem_Alloc (dma.samples * 2);
+	shm = &dma;
+	memset (filters, 0, sizeof (filters));
+	lowpass = filters;
+	Cvar_SetValueQuick (&sndspeed, 11025);
+	SND_InitScaletable ();
+
+	for (pass = 0; pass < 2; pass++)
+	{
+		double start;
+
+		memset (snd_channels, 0, sizeof (snd_channels));
+		for (i = 0; i < numchannels; i++)
+		{
+			channel_t *ch = &snd_channels[i];
+			ch->sfx = &sfx[i & 1];
+			ch->leftvol = 64 + (i * 37) % 192;
+			ch->rightvol = 255 - (i * 53) % 192;
+			ch->end = length;
+		}
+		total_channels = numchannels;
+		paintedtime = 0;
+		s_rawend = 0;
+		underwater.intensity = 1.f;
+		underwater.alpha = exp (-log (12.f));
+		underwater.accum[0] = underwater.accum[1] = 0.f;
+		Cvar_SetValueQuick (&snd_floatmix, pass);
+
+		start = Sys_DoubleTime ();
+		S_PaintChannels (length);
+		times[pass] = Sys_DoubleTime () - start;
+
+		Con_Printf (
+			"%s mix: %i channels, %i s in %.3f s (%.1fx realtime, %.1f Msamples/s)\n", pass ? "float" : "integer", numchannels, seconds, times[pass],
+			seconds / q_max (times[pass], 1e-6), (double)numchannels * length / q_max (times[pass], 1e-6) / 1e6);
+	}
+	Con_Printf ("float mix speedup: %.2fx\n", times[0] / q_max (times[1], 1e-6));
+
+	memcpy (snd_channels, saved_channels, sizeof (snd_channels));
+	total_channels = saved_total_channels;
+	paintedtime = saved_paintedtime;
+	s_rawend = saved_rawend;
+	shm = saved_shm;
+	lowpass = lowpass_filters;
+	for (i = 0; i < 4; i++)
+		S_FreeFilter (&filters[i]);
+	Cvar_SetValueQuick (&sndspeed, saved_sndspeed);
+	Cvar_SetValueQuick (&snd_floatmix, saved_floatmix);
+	underwater = saved_underwater;
+	SND_InitScaletable ();
+
+	SDL_UnlockMutex (snd_mutex);
+
+	Mem_Free (dma.buffer);
+	Mem_Free (sc[0]);
+	Mem_Free (sc[1]);
+	Mem_Free (saved_channels);
+}
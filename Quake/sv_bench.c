@@ -0,0 +1,629 @@
+/*
+Copyright (C) 1996-2001 Id Software, Inc.
+Copyright (C) 2010-2014 QuakeSpasm developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// sv_bench.c -- headless server frame benchmark
+
+/*
+
+vkquake -dedicated 16 -benchserver e1m1 [-benchticks 2000] [-benchjson file] [-benchnopext] [-benchsweep]
+
+Loads the map and connects one scripted bot per client slot over loopback
+connections, so the server builds and sends real datagrams to every bot.
+Once all bots are spawned, a fixed number of ticks is run back to back at
+sys_ticrate without any real time pacing, then the per-tick cost of each
+server frame section is printed and optionally written out as JSON. The
+bots negotiate the same protocol extensions as the vkQuake client unless
+-benchnopext is given, which benchmarks the vanilla entity updates instead.
+The world state hash printed at the end must not change with settings that
+only affect speed, so e.g. a run with +sv_parallelphysics 1 can be checked
+against a serial one.
+
+-benchsweep then runs the same number of ticks again for sv_snapshotjobs
+1, 2, 4, ... up to the number of task workers and prints how the cost of
+building and sending the client datagrams scales with the job count.
+
+*/
+
+#include "quakedef.h"
+#include "net_sys.h"
+#include "net_defs.h"
+#include "net_loop.h"
+
+#define BENCH_DEFAULT_TICKS 2000
+#define BENCH_WARMUP_TICKS	72	 // settle physics and spawn effects after the last bot joined
+#define BENCH_SIGNON_TICKS	2000 // give up if the bots are not in the game by then
+
+typedef enum
+{
+	BOT_CONNECTING,
+	BOT_SERVERINFO,
+	BOT_PRESPAWN,
+	BOT_SPAWN,
+	BOT_BEGIN,
+	BOT_ACTIVE,
+} botstage_t;
+
+typedef struct
+{
+	qsocket_t *sock; // our end of the loopback pair
+	client_t  *client;
+	botstage_t stage;
+	uint32_t   rand;
+	int		   num;
+	int		   movemessages;
+	vec3_t	   viewangles;
+} benchbot_t;
+
+typedef enum
+{
+	BENCH_FRAME,
+	BENCH_CLIENTS,
+	BENCH_PHYSICS,
+	BENCH_SEND,
+	BENCH_ENTITIES,
+	BENCH_NUM_PHASES
+} benchphase_t;
+
+static const char *bench_phase_names[BENCH_NUM_PHASES] = {"frame", "clients", "physics", "send", "entities"};
+static const char *bench_phase_funcs[BENCH_NUM_PHASES] = {
+	"Host_ServerFrame", "SV_RunClients", "SV_Physics", "SV_SendClientMessages", "SV_WriteEntitiesToClient"};
+
+typedef struct
+{
+	double mean;
+	double p50;
+	double p99;
+	double max;
+} benchstats_t;
+
+typedef struct
+{
+	int	   jobs;
+	double send;
+	double entities;
+} benchsweep_t;
+
+static qboolean bench_active;
+
+/*
+==================
+SV_Bench_Active
+==================
+*/
+qboolean SV_Bench_Active (void)
+{
+	return bench_active;
+}
+
+/*
+==================
+Bench_Rand
+
+xorshift32, every bot has its own stream so the input does not depend on the bot count
+==================
+*/
+static uint32_t Bench_Rand (benchbot_t *bot)
+{
+	uint32_t x = bot->rand;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	bot->rand = x;
+	return x;
+}
+
+/*
+==================
+Bench_SendCommand
+
+Sends one clc_stringcmd per line of commands in a single reliable message
+==================
+*/
+static void Bench_SendCommand (benchbot_t *bot, const char *commands)
+{
+	byte		data[256];
+	char		line[128];
+	sizebuf_t	buf;
+	const char *end;
+
+	buf.data = data;
+	buf.maxsize = sizeof (data);
+	buf.cursize = 0;
+	buf.allowoverflow = false;
+	buf.overflowed = false;
+
+	while (*commands)
+	{
+		end = strchr (commands, '\n');
+		if (!end)
+			end = commands + strlen (commands);
+		q_strlcpy (line, commands, q_min ((size_t)(end - commands) + 1, sizeof (line)));
+		MSG_WriteByte (&buf, clc_stringcmd);
+		MSG_WriteString (&buf, line);
+		commands = *end ? end + 1 : end;
+	}
+
+	if (!Loop_CanSendMessage (bot->sock))
+		Sys_Error ("benchserver: bot %i reliable channel is stalled", bot->num);
+	Loop_SendMessage (bot->sock, &buf);
+}
+
+/*
+==================
+Bench_SendMove
+
+Scripted input: run forward while turning, strafe from side to side, and
+jump and fire in bursts. Everything is derived from the bot's own random
+stream and the tick count, so every run sends the same commands.
+==================
+*/
+static void Bench_SendMove (benchbot_t *bot, int tick, const int *acks, int numacks)
+{
+	byte	  data[128];
+	sizebuf_t buf;
+	int		  i;
+	int		  buttons = 0;
+
+	buf.data = data;
+	buf.maxsize = sizeof (data);
+	buf.cursize = 0;
+	buf.allowoverflow = false;
+	buf.overflowed = false;
+
+	for (i = 0; i < numacks; i++)
+	{
+		MSG_WriteByte (&buf, clcdp_ackframe);
+		MSG_WriteLong (&buf, acks[i]);
+	}
+
+	if ((tick & 63) == 0)
+		bot->viewangles[YAW] += (float)(Bench_Rand (bot) % 360);
+	bot->viewangles[YAW] = anglemod (bot->viewangles[YAW] + 2.0f + (bot->num & 3));
+	bot->viewangles[PITCH] = (float)((int)(Bench_Rand (bot) % 11) - 5);
+	if (((tick + bot->num * 7) % 50) == 0)
+		buttons |= 2;
+	if (((tick + bot->num * 13) & 63) < 16)
+		buttons |= 1;
+
+	MSG_WriteByte (&buf, clc_move);
+	if (bot->client->protocol_pext2 & PEXT2_PREDINFO)
+	{
+		MSG_WriteShort (&buf, bot->movemessages & 0xffff);
+		MSG_WriteFloat (&buf, sv.qcvm.time);
+	}
+	else
+		MSG_WriteFloat (&buf, sv.qcvm.time);
+	for (i = 0; i < 3; i++)
+	{
+		if (sv.protocol == PROTOCOL_NETQUAKE && !(bot->client->protocol_pext2 & PEXT2_PREDINFO))
+			MSG_WriteAngle (&buf, bot->viewangles[i], sv.protocolflags);
+		else
+			MSG_WriteAngle16 (&buf, bot->viewangles[i], sv.protocolflags);
+	}
+	MSG_WriteShort (&buf, 400);
+	MSG_WriteShort (&buf, ((tick + bot->num * 17) & 127) < 64 ? 350 : -350);
+	MSG_WriteShort (&buf, 0);
+	MSG_WriteByte (&buf, buttons);
+	MSG_WriteByte (&buf, 0);
+	bot->movemessages++;
+
+	Loop_SendUnreliableMessage (bot->sock, &buf);
+}
+
+/*
+==================
+Bench_UpdateBot
+
+Plays the client side of the signon sequence. Instead of parsing the
+server messages the bot looks at its client_t, a stage is complete once
+the server has flushed everything it had queued for it.
+==================
+*/
+static void Bench_UpdateBot (benchbot_t *bot, int tick)
+{
+	int acks[8];
+	int numacks = 0;
+	int ret;
+	int i;
+
+	// drain everything the server sent, so its reliable channel never stalls
+	while ((ret = Loop_GetMessage (bot->sock)) > 0)
+	{
+		if (ret == 2 && bot->stage == BOT_ACTIVE && numacks < (int)countof (acks))
+			acks[numacks++] = bot->sock->unreliableReceiveSequence - 1;
+	}
+
+	if (!bot->client)
+	{
+		for (i = 0; i < svs.maxclients; i++)
+			if (svs.clients[i].active && svs.clients[i].netconnection == bot->sock->driverdata)
+				bot->client = &svs.clients[i];
+		if (!bot->client)
+			return;
+	}
+	else if (!bot->client->active || bot->client->netconnection != bot->sock->driverdata)
+		Sys_Error ("benchserver: bot %i was dropped", bot->num);
+
+	switch (bot->stage)
+	{
+	case BOT_CONNECTING:
+		if (!bot->client->pextknown)
+		{
+			if (COM_CheckParm ("-benchnopext"))
+				Bench_SendCommand (bot, "pext");
+			else
+				Bench_SendCommand (bot, va ("pext %#x %#x", PROTOCOL_FTE_PEXT2, PEXT2_SUPPORTED_CLIENT));
+		}
+		bot->stage = BOT_SERVERINFO;
+		break;
+	case BOT_SERVERINFO:
+		if (bot->client->pextknown && bot->client->sendsignon == PRESPAWN_DONE)
+		{
+			Bench_SendCommand (bot, "prespawn");
+			bot->stage = BOT_PRESPAWN;
+		}
+		break;
+	case BOT_PRESPAWN:
+		if (bot->client->sendsignon == PRESPAWN_DONE)
+		{
+			Bench_SendCommand (bot, va ("name \"bot%i\"\ncolor %i %i\nspawn", bot->num, bot->num & 15, (bot->num + 4) & 15));
+			bot->stage = BOT_SPAWN;
+		}
+		break;
+	case BOT_SPAWN:
+		if (bot->client->sendsignon == PRESPAWN_DONE)
+		{
+			Bench_SendCommand (bot, "begin");
+			bot->stage = BOT_BEGIN;
+		}
+		break;
+	case BOT_BEGIN:
+		if (bot->client->spawned)
+			bot->stage = BOT_ACTIVE;
+		break;
+	case BOT_ACTIVE:
+		Bench_SendMove (bot, tick, acks, numacks);
+		break;
+	}
+}
+
+/*
+==================
+Bench_CompareDoubles
+==================
+*/
+static int Bench_CompareDoubles (const void *a, const void *b)
+{
+	const double x = *(const double *)a;
+	const double y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+/*
+==================
+Bench_CalcStats
+==================
+*/
+static benchstats_t Bench_CalcStats (double *samples, int count)
+{
+	benchstats_t stats;
+	double		 total = 0;
+	int			 i;
+
+	for (i = 0; i < count; i++)
+		total += samples[i];
+	qsort (samples, count, sizeof (double), Bench_CompareDoubles);
+
+	stats.mean = total / count;
+	stats.p50 = samples[(count - 1) / 2];
+	stats.p99 = samples[q_min (count - 1, (int)(count * 0.99))];
+	stats.max = samples[count - 1];
+	return stats;
+}
+
+/*
+==================
+Bench_WorldStateHash
+
+FNV-1a over the fields of every edict in use. Runs with the same arguments
+must end up with the same hash whatever the physics settings, see
+sv_parallelphysics.
+==================
+*/
+static uint32_t Bench_WorldStateHash (void)
+{
+	uint32_t	hash = 2166136261u;
+	const int	size = sv.qcvm.progs->entityfields * 4;
+	const byte *bytes;
+	edict_t	   *ed;
+	int			i, j;
+
+	for (i = 0; i < sv.qcvm.num_edicts; i++)
+	{
+		ed = (edict_t *)((byte *)sv.qcvm.edicts + i * sv.qcvm.edict_size);
+		if (ed->free)
+			continue;
+		bytes = (const byte *)&ed->v;
+		for (j = 0; j < size; j++)
+			hash = (hash ^ bytes[j]) * 16777619u;
+	}
+	return hash;
+}
+
+/*
+==================
+Bench_WriteJSONString
+
+Writes s as a quoted JSON string, the map name comes from the command line
+==================
+*/
+static void Bench_WriteJSONString (FILE *f, const char *s)
+{
+	fputc ('"', f);
+	for (; *s; s++)
+	{
+		if (*s == '"' || *s == '\\')
+			fprintf (f, "\\%c", *s);
+		else if ((unsigned char)*s < 0x20)
+			fprintf (f, "\\u%04x", (unsigned char)*s);
+		else
+			fputc (*s, f);
+	}
+	fputc ('"', f);
+}
+
+/*
+==================
+Bench_WriteJSON
+==================
+*/
+static void Bench_WriteJSON (
+	const char *path, const char *map, int numbots, int ticks, int edicts, uint32_t statehash, const benchstats_t *stats, const benchsweep_t *sweep, int numsweep)
+{
+	FILE *f = Sys_fopen (path, "w");
+	int	  i;
+
+	if (!f)
+	{
+		Con_Printf ("benchserver: couldn't write %s\n", path);
+		return;
+	}
+
+	fprintf (f, "{\n");
+	fprintf (f, "\t\"map\": ");
+	Bench_WriteJSONString (f, map);
+	fprintf (f, ",\n");
+	fprintf (f, "\t\"clients\": %i,\n", numbots);
+	fprintf (f, "\t\"ticks\": %i,\n", ticks);
+	fprintf (f, "\t\"ticrate\": %g,\n", sys_ticrate.value);
+	fprintf (f, "\t\"edicts\": %i,\n", edicts);
+	fprintf (f, "\t\"pext2\": %u,\n", svs.clients[0].protocol_pext2);
+	fprintf (f, "\t\"statehash\": \"%08x\",\n", statehash);
+	fprintf (f, "\t\"phases\": {\n");
+	for (i = 0; i < BENCH_NUM_PHASES; i++)
+	{
+		fprintf (f, "\t\t");
+		Bench_WriteJSONString (f, bench_phase_names[i]);
+		fprintf (f, ": {\"function\": ");
+		Bench_WriteJSONString (f, bench_phase_funcs[i]);
+		fprintf (
+			f, ", \"mean_ms\": %.6f, \"p50_ms\": %.6f, \"p99_ms\": %.6f, \"max_ms\": %.6f}%s\n", stats[i].mean, stats[i].p50, stats[i].p99, stats[i].max,
+			(i + 1 < BENCH_NUM_PHASES) ? "," : "");
+	}
+	fprintf (f, "\t}%s\n", numsweep ? "," : "");
+	if (numsweep)
+	{
+		fprintf (f, "\t\"snapshotjobs\": [\n");
+		for (i = 0; i < numsweep; i++)
+		{
+			fprintf (
+				f, "\t\t{\"jobs\": %i, \"send_mean_ms\": %.6f, \"entities_mean_ms\": %.6f}%s\n", sweep[i].jobs, sweep[i].send, sweep[i].entities,
+				(i + 1 < numsweep) ? "," : "");
+		}
+		fprintf (f, "\t]\n");
+	}
+	fprintf (f, "}\n");
+	fclose (f);
+
+	Con_Printf ("benchserver: wrote %s\n", path);
+}
+
+/*
+==================
+Bench_PrintPVSStats
+==================
+*/
+static void Bench_PrintPVSStats (void)
+{
+	pvscachestats_t stats;
+
+	Mod_GetPVSCacheStats (&stats);
+	Con_Printf (
+		"benchserver: pvs rows %.1f%% hits, fat pvs %.1f%% hits, %.1f KB cached\n", stats.rowhits * 100.0 / q_max (stats.rowhits + stats.rowmisses, (uint64_t)1),
+		stats.fathits * 100.0 / q_max (stats.fathits + stats.fatmisses, (uint64_t)1), (stats.rowbytes + stats.fatbytes) / 1024.0);
+}
+
+/*
+==================
+Bench_RunTicks
+==================
+*/
+static void Bench_RunTicks (benchbot_t *bots, int numbots, int *tick, int ticks, double **samples)
+{
+	double frame_start;
+	int	   i, j;
+
+	for (i = 0; i < ticks; i++, (*tick)++)
+	{
+		for (j = 0; j < numbots; j++)
+			Bench_UpdateBot (&bots[j], *tick);
+		frame_start = Sys_DoubleTime ();
+		Host_Frame (sys_ticrate.value);
+		samples[BENCH_FRAME][i] = (Sys_DoubleTime () - frame_start) * 1000.0;
+		samples[BENCH_CLIENTS][i] = sv_tickcost.clients_ms;
+		samples[BENCH_PHYSICS][i] = sv_tickcost.physics_ms;
+		samples[BENCH_SEND][i] = sv_tickcost.send_ms;
+		samples[BENCH_ENTITIES][i] = sv_tickcost.entities_ms;
+	}
+}
+
+/*
+==================
+Bench_SnapshotSweep
+
+Reruns the ticks for a growing number of sv_snapshotjobs
+==================
+*/
+static int Bench_SnapshotSweep (benchbot_t *bots, int numbots, int *tick, int ticks, double **samples, benchsweep_t *sweep)
+{
+	const int workers = Tasks_NumWorkers ();
+	int		  numsweep = 0;
+	int		  jobs;
+
+	Con_Printf ("benchserver: sv_snapshotjobs sweep, mean ms per tick:\n");
+	Con_Printf ("%-6s %10s %10s %10s\n", "jobs", "send", "entities", "speedup");
+	for (jobs = 1;; jobs = q_min (jobs * 2, workers))
+	{
+		Cvar_SetValue ("sv_snapshotjobs", jobs);
+		bench_active = true;
+		Bench_RunTicks (bots, numbots, tick, ticks, samples);
+		bench_active = false;
+
+		sweep[numsweep].jobs = jobs;
+		sweep[numsweep].send = Bench_CalcStats (samples[BENCH_SEND], ticks).mean;
+		sweep[numsweep].entities = Bench_CalcStats (samples[BENCH_ENTITIES], ticks).mean;
+		Con_Printf (
+			"%-6i %10.4f %10.4f %9.2fx\n", jobs, sweep[numsweep].send, sweep[numsweep].entities,
+			sweep[numsweep].entities > 0 ? sweep[0].entities / sweep[numsweep].entities : 0.0);
+		numsweep++;
+		if (jobs >= workers)
+			break;
+	}
+	Cvar_SetValue ("sv_snapshotjobs", 0);
+	return numsweep;
+}
+
+/*
+==================
+SV_Bench_Run
+
+Never returns, quits once the report is written
+==================
+*/
+void SV_Bench_Run (void)
+{
+	benchbot_t	*bots;
+	double		*samples[BENCH_NUM_PHASES];
+	benchstats_t stats[BENCH_NUM_PHASES];
+	benchsweep_t sweep[8];
+	int			 numsweep = 0;
+	char		 map[MAX_QPATH];
+	const float	 ticrate = sys_ticrate.value;
+	int			 numbots = svs.maxclients;
+	int			 ticks = BENCH_DEFAULT_TICKS;
+	int			 tick, i, j;
+	int			 signon_ticks;
+	uint32_t	 statehash;
+
+	i = COM_CheckParm ("-benchserver");
+	q_strlcpy (map, (i + 1 < com_argc && com_argv[i + 1][0] != '-' && com_argv[i + 1][0] != '+') ? com_argv[i + 1] : "start", sizeof (map));
+	i = COM_CheckParm ("-benchticks");
+	if (i && i + 1 < com_argc)
+		ticks = q_max (1, atoi (com_argv[i + 1]));
+
+	// same random sequence for every run, for both the map spawn and the physics
+	COM_SeedRand (0);
+	Cmd_ExecuteString (va ("map %s", map), src_command);
+	if (!sv.active)
+		Sys_Error ("benchserver: couldn't load map %s", map);
+
+	bots = (benchbot_t *)Mem_Alloc (numbots * sizeof (benchbot_t));
+	for (i = 0; i < numbots; i++)
+	{
+		bots[i].num = i;
+		bots[i].rand = 0x9e3779b9u * (i + 1);
+		bots[i].sock = Loop_ConnectBot ();
+		if (!bots[i].sock)
+			Sys_Error ("benchserver: couldn't connect bot %i", i);
+	}
+
+	bench_active = true;
+
+	// signon
+	tick = 0;
+	for (signon_ticks = 0;; signon_ticks++, tick++)
+	{
+		qboolean all_active = true;
+		if (signon_ticks == BENCH_SIGNON_TICKS)
+			Sys_Error ("benchserver: bots didn't finish signon in %i ticks", BENCH_SIGNON_TICKS);
+		for (i = 0; i < numbots; i++)
+		{
+			Bench_UpdateBot (&bots[i], tick);
+			all_active = all_active && (bots[i].stage == BOT_ACTIVE);
+		}
+		if (all_active)
+			break;
+		Host_Frame (ticrate);
+	}
+	for (i = 0; i < BENCH_WARMUP_TICKS; i++, tick++)
+	{
+		for (j = 0; j < numbots; j++)
+			Bench_UpdateBot (&bots[j], tick);
+		Host_Frame (ticrate);
+	}
+
+	Con_Printf ("benchserver: %s, %i clients (signon took %i ticks), running %i ticks\n", map, numbots, signon_ticks, ticks);
+
+	for (i = 0; i < BENCH_NUM_PHASES; i++)
+		samples[i] = (double *)Mem_Alloc (ticks * sizeof (double));
+	Bench_RunTicks (bots, numbots, &tick, ticks, samples);
+
+	bench_active = false;
+
+	Con_Printf ("benchserver: %d edicts, ms per tick:\n", sv.qcvm.num_edicts);
+	Con_Printf ("%-10s %10s %10s %10s %10s\n", "phase", "mean", "p50", "p99", "max");
+	for (i = 0; i < BENCH_NUM_PHASES; i++)
+	{
+		stats[i] = Bench_CalcStats (samples[i], ticks);
+		Con_Printf ("%-10s %10.4f %10.4f %10.4f %10.4f\n", bench_phase_names[i], stats[i].mean, stats[i].p50, stats[i].p99, stats[i].max);
+	}
+
+	statehash = Bench_WorldStateHash ();
+	Con_Printf ("benchserver: world state hash %08x, %i precomputed world clips used", statehash, sv_worldclip_hits);
+	if (sv_worldclip_mismatches)
+		Con_Printf (", %i MISMATCHED", sv_worldclip_mismatches);
+	Con_Printf ("\n");
+
+	Bench_PrintPVSStats ();
+
+	if (COM_CheckParm ("-benchsweep"))
+		numsweep = Bench_SnapshotSweep (bots, numbots, &tick, ticks, samples, sweep);
+
+	i = COM_CheckParm ("-benchjson");
+	if (i && i + 1 < com_argc)
+		Bench_WriteJSON (com_argv[i + 1], map, numbots, ticks, sv.qcvm.num_edicts, statehash, stats, sweep, numsweep);
+
+	for (i = 0; i < BENCH_NUM_PHASES; i++)
+		Mem_Free (samples[i]);
+	for (i = 0; i < numbots; i++)
+		Loop_FreeBot (bots[i].sock);
+	Mem_Free (bots);
+	Sys_Quit ();
+}
@@ -35,6 +35,7 @@ unsigned int sv_protocol_pext1 = PEXT1_SUPPORTED_SERVER; // spike
 unsigned int sv_protocol_pext2 = PEXT2_SUPPORTED_SERVER; // spike
 
 static cvar_t sv_netsort = {"sv_netsort", "1", CVAR_NONE};
+static cvar_t sv_snapshotjobs = {"sv_snapshotjobs", "0", CVAR_NONE}; // 0 = one job per task worker, 1 = build on the main thread
 static cvar_t sv_smoothplatformlerps = {"sv_smoothplatformlerps", "1", CVAR_NONE};
 
 extern cvar_t nomonsters;
@@ -429,9 +430,36 @@ static void MSGFTE_WriteEntityUpdate (unsigned int bits, entity_state_t *state,
 #endif
 }
 
-static struct entity_num_state_s *snapshot_entstate;
-static size_t					  snapshot_numents;
-static size_t					  snapshot_maxents;
+// fat pvs of a client, see SV_CalcFatPVS
+typedef struct
+{
+	byte *pvs;
+	byte *leafpvs; // decompressed pvs of a single leaf
+	int	  bytes;
+	int	  capacity;
+	int	 *leafnums; // non-solid leafs within 8 pixels, sorted
+	int	  numleafs;
+	int	  maxleafs;
+} fatpvs_t;
+
+// scratch of a job building client datagrams, see SV_BuildClientDatagrams
+typedef struct
+{
+	fatpvs_t fatpvs;
+
+	// entities visible to the client being built, swapped with its previousentities by SVFTE_CalcEntityDeltas
+	struct entity_num_state_s *snapshot_entstate;
+	size_t					   snapshot_numents;
+	size_t					   snapshot_maxents;
+
+	// visible entities for SV_WriteEntitiesToClient, bucket sorted by distance
+	uint16_t net_edicts[MAX_EDICTS];
+	byte	 net_edict_dists[MAX_EDICTS];
+	int		 net_edict_bins[256];
+	uint16_t net_edicts_sorted[MAX_EDICTS];
+} svnetscratch_t;
+
+static byte *SV_CalcFatPVS (fatpvs_t *fat, vec3_t org, qmodel_t *worldmodel);
 
 void SVFTE_DestroyFrames (client_t *client)
 {
@@ -639,7 +667,7 @@ static void SVFTE_WriteStats (client_t *client, sizebuf_t *msg)
 		}
 	}
 }
-static void SVFTE_CalcEntityDeltas (client_t *client)
+static void SVFTE_CalcEntityDeltas (client_t *client, svnetscratch_t *scratch)
 {
 	struct entity_num_state_s *olds, *news, *oldstop, *newstop;
 
@@ -658,8 +686,8 @@ static void SVFTE_CalcEntityDeltas (client_t *client)
 		client->pendingentities_bits[0] = UF_REMOVE;
 	}
 
-	news = snapshot_entstate;
-	newstop = news + snapshot_numents;
+	news = scratch->snapshot_entstate;
+	newstop = news + scratch->snapshot_numents;
 	olds = client->previousentities;
 	oldstop = (olds != NULL) ? (olds + client->numpreviousentities) : NULL;
 
@@ -699,13 +727,13 @@ static void SVFTE_CalcEntityDeltas (client_t *client)
 	olds = client->previousentities;
 	oldstop = (olds != NULL) ? (olds + client->maxpreviousentities) : NULL;
 
-	client->previousentities = snapshot_entstate;
-	client->numpreviousentities = snapshot_numents;
-	client->maxpreviousentities = snapshot_maxents;
+	client->previousentities = scratch->snapshot_entstate;
+	client->numpreviousentities = scratch->snapshot_numents;
+	client->maxpreviousentities = scratch->snapshot_maxents;
 
-	snapshot_entstate = olds;
-	snapshot_numents = 0;
-	snapshot_maxents = (olds != NULL) ? (oldstop - olds) : 0;
+	scratch->snapshot_entstate = olds;
+	scratch->snapshot_numents = 0;
+	scratch->snapshot_maxents = (olds != NULL) ? (oldstop - olds) : 0;
 }
 static void SVFTE_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, size_t overflowsize)
 {
@@ -808,11 +836,6 @@ static void SVFTE_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, size_
 
 	// remember how far we got, so we can keep things flushed, instead of only updating the first N entities.
 	client->snapshotresume = entnum;
-
-	if (msg->cursize > 1024 && dev_peakstats.packetsize <= 1024)
-		Con_DWarning ("%i byte packet exceeds standard limit of 1024.\n", msg->cursize);
-	dev_stats.packetsize = msg->cursize;
-	dev_peakstats.packetsize = q_max (msg->cursize, dev_peakstats.packetsize);
 }
 
 /*
@@ -873,7 +896,7 @@ void SV_BuildEntityState (edict_t *ent, entity_state_t *state)
 #endif
 }
 
-static void SVFTE_BuildSnapshotForClient (client_t *client)
+static void SVFTE_BuildSnapshotForClient (client_t *client, svnetscratch_t *scratch)
 {
 	unsigned int  e, i;
 	byte		 *pvs;
@@ -885,13 +908,13 @@ static void SVFTE_BuildSnapshotForClient (client_t *client)
 	unsigned char eflags;
 	int			  proged = EDICT_TO_PROG (clent);
 
-	struct entity_num_state_s *ents = snapshot_entstate;
+	struct entity_num_state_s *ents = scratch->snapshot_entstate;
 	size_t					   numents = 0;
-	size_t					   maxents = snapshot_maxents;
+	size_t					   maxents = scratch->snapshot_maxents;
 
 	// find the client's PVS
 	VectorAdd (clent->v.origin, clent->v.view_ofs, org);
-	pvs = SV_FatPVS (org, qcvm->worldmodel);
+	pvs = SV_CalcFatPVS (&scratch->fatpvs, org, qcvm->worldmodel);
 
 	if (maxentities > (unsigned int)qcvm->num_edicts)
 		maxentities = (unsigned int)qcvm->num_edicts;
@@ -966,9 +989,9 @@ static void SVFTE_BuildSnapshotForClient (client_t *client)
 		numents++;
 	}
 
-	snapshot_entstate = ents;
-	snapshot_numents = numents;
-	snapshot_maxents = maxents;
+	scratch->snapshot_entstate = ents;
+	scratch->snapshot_numents = numents;
+	scratch->snapshot_maxents = maxents;
 }
 
 void MSG_WriteStaticOrBaseLine (sizebuf_t *buf, int idx, entity_state_t *state, unsigned int protocol_pext2, unsigned int protocol, unsigned int protocolflags)
@@ -1144,6 +1167,7 @@ void SV_Init (void)
 	extern cvar_t sv_fastpushmove;
 	extern cvar_t sv_pushgrid;
 	extern cvar_t sv_analyticphysics;
+	extern cvar_t sv_parallelphysics;
 	extern cvar_t sv_friction;
 	extern cvar_t sv_edgefriction;
 	extern cvar_t sv_stopspeed;
@@ -1156,6 +1180,7 @@ void SV_Init (void)
 	// FTE optimized world geometry checks
 	extern cvar_t sv_fte_recursivehullckeck;
 	extern cvar_t sv_fte_createareanode;
+	extern cvar_t sv_areagrid;
 
 	Cvar_RegisterVariable (&sv_maxvelocity);
 	Cvar_RegisterVariable (&sv_gravity);
@@ -1177,13 +1202,17 @@ void SV_Init (void)
 	Cvar_RegisterVariable (&sv_fastpushmove);
 	Cvar_RegisterVariable (&sv_pushgrid);
 	Cvar_RegisterVariable (&sv_analyticphysics);
+	Cvar_RegisterVariable (&sv_parallelphysics);
 	Cvar_RegisterVariable (&pr_checkextension);
 	Cvar_RegisterVariable (&sv_altnoclip); // johnfitz
 	Cvar_RegisterVariable (&sv_netsort);
+	Cvar_RegisterVariable (&sv_snapshotjobs);
 	Cvar_RegisterVariable (&sv_smoothplatformlerps);
 
 	Cvar_RegisterVariable (&sv_fte_recursivehullckeck);
 	Cvar_RegisterVariable (&sv_fte_createareanode);
+	Cvar_RegisterVariable (&sv_areagrid);
+	Cmd_AddCommand ("sv_areabench", SV_AreaBench_f);
 
 	Cmd_AddCommand ("pext", SV_Pext_f);
 	Cmd_AddCommand ("sv_protocol", &SV_Protocol_f); // johnfitz
@@ -1814,29 +1843,34 @@ crosses a waterline.
 =============================================================================
 */
 
-static int		fatbytes;
-static byte	   *fatpvs;
-static int		fatpvs_capacity;
-static qboolean fatpvs_any;
-
-void SV_AddToFatPVS (vec3_t org, mnode_t *node, qmodel_t *worldmodel) // johnfitz -- added worldmodel as a parameter
+/*
+=============
+SV_AddToFatPVS
+=============
+*/
+static void SV_AddToFatPVS (fatpvs_t *fat, vec3_t org, mnode_t *node, qmodel_t *worldmodel) // johnfitz -- added worldmodel as a parameter
 {
-	int		  i;
-	byte	 *pvs;
+	int		  i, leafnum;
 	mplane_t *plane;
 	float	  d;
 
 	while (1)
 	{
-		// if this is a leaf, accumulate the pvs bits
+		// if this is a leaf, remember it for the merge
 		if (node->contents < 0)
 		{
 			if (node->contents != CONTENTS_SOLID)
 			{
-				fatpvs_any = true;
-				pvs = Mod_LeafPVS ((mleaf_t *)node, worldmodel); // johnfitz -- worldmodel as a parameter
-				for (i = 0; i < fatbytes - 3; i += 4)
-					*(uint32_t *)&fatpvs[i] |= *(uint32_t *)&pvs[i];
+				if (fat->numleafs == fat->maxleafs)
+				{
+					fat->maxleafs = q_max (fat->maxleafs * 2, FATPVS_MAX_LEAFS);
+					fat->leafnums = (int *)Mem_Realloc (fat->leafnums, fat->maxleafs * sizeof (int));
+				}
+				leafnum = (mleaf_t *)node - worldmodel->leafs;
+				for (i = fat->numleafs; i > 0 && fat->leafnums[i - 1] > leafnum; i--)
+					fat->leafnums[i] = fat->leafnums[i - 1];
+				fat->leafnums[i] = leafnum;
+				fat->numleafs++;
 			}
 			return;
 		}
@@ -1848,13 +1882,59 @@ void SV_AddToFatPVS (vec3_t org, mnode_t *node, qmodel_t *worldmodel) // johnfit
 		else if (d < -8)
 			node = node->children[1];
 		else
-		{														 // go down both
-			SV_AddToFatPVS (org, node->children[0], worldmodel); // johnfitz -- worldmodel as a parameter
+		{															  // go down both
+			SV_AddToFatPVS (fat, org, node->children[0], worldmodel); // johnfitz -- worldmodel as a parameter
 			node = node->children[1];
 		}
 	}
 }
 
+/*
+=============
+SV_CalcFatPVS
+
+Calculates a PVS that is the inclusive or of all leafs within 8 pixels of the
+given point, using the buffers in fat only. The merged rows are memoized by
+their set of leafs, see Mod_LookupFatPVS.
+=============
+*/
+static byte *SV_CalcFatPVS (fatpvs_t *fat, vec3_t org, qmodel_t *worldmodel)
+{
+	int	  i, j;
+	byte *pvs;
+
+	fat->bytes = (worldmodel->numleafs + 31) / 8;
+	if (fat->pvs == NULL || fat->bytes > fat->capacity)
+	{
+		fat->capacity = fat->bytes;
+		fat->pvs = (byte *)Mem_Realloc (fat->pvs, fat->capacity);
+		fat->leafpvs = (byte *)Mem_Realloc (fat->leafpvs, fat->capacity);
+		if (!fat->pvs || !fat->leafpvs)
+			Sys_Error ("SV_FatPVS: realloc() failed on %d bytes", fat->capacity);
+	}
+
+	fat->numleafs = 0;
+	SV_AddToFatPVS (fat, org, worldmodel->nodes, worldmodel); // johnfitz -- worldmodel as a parameter
+	if (fat->numleafs == 0)
+	{
+		memset (fat->pvs, 0xff, fat->bytes);
+		return fat->pvs;
+	}
+
+	if (Mod_LookupFatPVS (worldmodel, fat->leafnums, fat->numleafs, fat->pvs, fat->bytes))
+		return fat->pvs;
+
+	memset (fat->pvs, 0, fat->bytes);
+	for (j = 0; j < fat->numleafs; j++)
+	{
+		pvs = Mod_LeafPVSInto (&worldmodel->leafs[fat->leafnums[j]], worldmodel, fat->leafpvs); // johnfitz -- worldmodel as a parameter
+		for (i = 0; i < fat->bytes - 3; i += 4)
+			*(uint32_t *)&fat->pvs[i] |= *(uint32_t *)&pvs[i];
+	}
+	Mod_StoreFatPVS (worldmodel, fat->leafnums, fat->numleafs, fat->pvs, fat->bytes);
+	return fat->pvs;
+}
+
 /*
 =============
 SV_FatPVS
@@ -1865,21 +1945,9 @@ given point.
 */
 byte *SV_FatPVS (vec3_t org, qmodel_t *worldmodel) // johnfitz -- added worldmodel as a parameter
 {
-	fatbytes = (worldmodel->numleafs + 31) / 8;
-	if (fatpvs == NULL || fatbytes > fatpvs_capacity)
-	{
-		fatpvs_capacity = fatbytes;
-		fatpvs = (byte *)Mem_Realloc (fatpvs, fatpvs_capacity);
-		if (!fatpvs)
-			Sys_Error ("SV_FatPVS: realloc() failed on %d bytes", fatpvs_capacity);
-	}
+	static fatpvs_t fatpvs;
 
-	memset (fatpvs, 0, fatbytes);
-	fatpvs_any = false;
-	SV_AddToFatPVS (org, worldmodel->nodes, worldmodel); // johnfitz -- worldmodel as a parameter
-	if (fatpvs_any == false)
-		memset (fatpvs, 0xff, fatbytes);
-	return fatpvs;
+	return SV_CalcFatPVS (&fatpvs, org, worldmodel);
 }
 
 /*
@@ -1918,18 +1986,14 @@ qboolean SV_VisibleToClient (edict_t *client, edict_t *test, qmodel_t *worldmode
 
 //=============================================================================
 
-static uint16_t net_edicts[MAX_EDICTS];
-static byte		net_edict_dists[MAX_EDICTS];
-static int		net_edict_bins[256];
-static uint16_t net_edicts_sorted[MAX_EDICTS];
-
 /*
 =============
 SV_WriteEntitiesToClient
 
+Returns false if not all visible entities fit into the message
 =============
 */
-void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, size_t overflowsize)
+qboolean SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, size_t overflowsize, svnetscratch_t *scratch)
 {
 	edict_t		*clent = client->edict;
 	unsigned int e, i, maxedict = qcvm->num_edicts, j, numents;
@@ -1941,6 +2005,8 @@ void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, size_t overflow
 	eval_t		*val;
 	size_t		 rollbacksize, origmaxsize = msg->maxsize;
 	qboolean	 sort = sv_netsort.value > 1;
+	qboolean	 overflowed = false;
+	byte		 alpha;
 	float		 scale;
 	const char	*model;
 
@@ -1955,23 +2021,23 @@ void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, size_t overflow
 
 	// find the client's PVS
 	VectorAdd (clent->v.origin, clent->v.view_ofs, org);
-	pvs = SV_FatPVS (org, qcvm->worldmodel);
+	pvs = SV_CalcFatPVS (&scratch->fatpvs, org, qcvm->worldmodel);
 
 	// find the client's orientation
 	AngleVectors (clent->v.v_angle, forward, right, up);
 
 	// reset sorting bins
-	memset (net_edict_bins, 0, sizeof (net_edict_bins));
+	memset (scratch->net_edict_bins, 0, sizeof (scratch->net_edict_bins));
 
 	// add clent
 	if (sort)
 	{
-		net_edicts[0] = NUM_FOR_EDICT (clent);
-		net_edict_dists[0] = 0;
-		net_edict_bins[0] = 1;
+		scratch->net_edicts[0] = NUM_FOR_EDICT (clent);
+		scratch->net_edict_dists[0] = 0;
+		scratch->net_edict_bins[0] = 1;
 	}
 	else
-		net_edicts_sorted[0] = NUM_FOR_EDICT (clent);
+		scratch->net_edicts_sorted[0] = NUM_FOR_EDICT (clent);
 	numents = 1;
 
 	// add all other entities that touch the pvs
@@ -2032,20 +2098,20 @@ void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, size_t overflow
 
 				// use scaled square root of (distance/size) as sort key
 				dist = 8.f * sqrt (sqrt (dist / size));
-				net_edict_dists[numents] = (int)q_min (dist, 255.f);
-				net_edicts[numents] = e;
+				scratch->net_edict_dists[numents] = (int)q_min (dist, 255.f);
+				scratch->net_edicts[numents] = e;
 
 				// compute max distance along forward axis
 				dist = 0.f;
 				for (i = 0; i < 3; i++)
 					dist += ((forward[i] < 0.f ? ent->v.absmin[i] : ent->v.absmax[i]) - org[i]) * forward[i];
 				if (dist < 0.f)
-					net_edict_dists[numents] |= 128; // deprioritize entities behind the client
+					scratch->net_edict_dists[numents] |= 128; // deprioritize entities behind the client
 
-				net_edict_bins[net_edict_dists[numents]]++;
+				scratch->net_edict_bins[scratch->net_edict_dists[numents]]++;
 			}
 			else
-				net_edicts_sorted[numents] = e;
+				scratch->net_edicts_sorted[numents] = e;
 
 			++numents;
 		}
@@ -2057,22 +2123,22 @@ void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, size_t overflow
 	{
 		// compute bin offsets
 		e = 0;
-		for (i = 0; i < countof (net_edict_bins); i++)
+		for (i = 0; i < countof (scratch->net_edict_bins); i++)
 		{
-			int tmp = net_edict_bins[i];
-			net_edict_bins[i] = e;
+			int tmp = scratch->net_edict_bins[i];
+			scratch->net_edict_bins[i] = e;
 			e += tmp;
 		}
 
 		// generate sorted list
 		for (e = 0; e < numents; e++)
-			net_edicts_sorted[net_edict_bins[net_edict_dists[e]]++] = net_edicts[e];
+			scratch->net_edicts_sorted[scratch->net_edict_bins[scratch->net_edict_dists[e]]++] = scratch->net_edicts[e];
 	}
 
 	// send entities (closest first)
 	for (j = 0; j < numents; j++)
 	{
-		e = net_edicts_sorted[j];
+		e = scratch->net_edicts_sorted[j];
 		ent = EDICT_NUM (e);
 
 		rollbacksize = msg->cursize;
@@ -2132,12 +2198,14 @@ void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, size_t overflow
 
 		// johnfitz -- alpha
 		//  TODO: find a cleaner place to put this code
+		// only store it on the client's own edict (for weaponalpha), other clients may be built in parallel
 		val = GetEdictFieldValue (ent, qcvm->extfields.alpha);
-		if (val)
-			ent->alpha = ENTALPHA_ENCODE (val->_float);
+		alpha = val ? ENTALPHA_ENCODE (val->_float) : ent->alpha;
+		if (ent == clent)
+			ent->alpha = alpha;
 
 		// don't send invisible entities unless they have effects
-		if (ent->alpha == ENTALPHA_ZERO && !((int)ent->v.effects & sv.effectsmask))
+		if (alpha == ENTALPHA_ZERO && !((int)ent->v.effects & sv.effectsmask))
 			continue;
 		// johnfitz
 
@@ -2147,7 +2215,7 @@ void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, size_t overflow
 		// johnfitz -- PROTOCOL_FITZQUAKE
 		if (sv.protocol != PROTOCOL_NETQUAKE)
 		{
-			if (ent->baseline.alpha != ent->alpha)
+			if (ent->baseline.alpha != alpha)
 				bits |= U_ALPHA;
 			if (sv.protocol == PROTOCOL_RMQ)
 			{
@@ -2222,7 +2290,7 @@ void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, size_t overflow
 
 		// johnfitz -- PROTOCOL_FITZQUAKE
 		if (bits & U_ALPHA)
-			MSG_WriteByte (msg, ent->alpha);
+			MSG_WriteByte (msg, alpha);
 		if (bits & U_SCALE)
 			MSG_WriteByte (msg, scale);
 		if (bits & U_FRAME2)
@@ -2236,24 +2304,13 @@ void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, size_t overflow
 		if ((size_t)msg->cursize > origmaxsize)
 		{
 			msg->cursize = rollbacksize; // roll back
-			// johnfitz -- less spammy overflow message
-			if (!dev_overflows.packetsize || dev_overflows.packetsize + CONSOLE_RESPAM_TIME < realtime)
-			{
-				Con_Printf ("Packet overflow!\n");
-				dev_overflows.packetsize = realtime;
-			}
+			overflowed = true;
 			break; // we could keep searching for something else that fits, but ehh
 		}
 	}
 
 	msg->maxsize = origmaxsize;
-
-	// johnfitz -- devstats
-	if (msg->cursize > 1024 && dev_peakstats.packetsize <= 1024)
-		Con_DWarning ("%i byte packet exceeds standard limit of 1024 (max = %d).\n", msg->cursize, msg->maxsize);
-	dev_stats.packetsize = msg->cursize;
-	dev_peakstats.packetsize = q_max (msg->cursize, dev_peakstats.packetsize);
-	// johnfitz
+	return !overflowed;
 }
 
 /*
@@ -2495,17 +2552,191 @@ void SV_WriteClientdataToMessage (client_t *client, sizebuf_t *msg)
 										 // johnfitz
 }
 
-void SV_PresendClientDatagram (client_t *client)
+/*
+==============================================================================
+
+CLIENT DATAGRAM BUILDING
+
+The entity part of every client's first datagram of the frame only depends on
+that client and the edicts, so it is built for all clients up front. With
+sv_snapshotjobs != 1 the clients are split over jobs on the task workers, each
+job with its own scratch and each client writing into its own buffer. Damage
+and stats (which move sv_player around) are written serially in between, and
+the sends stay in SV_SendClientDatagram on the main thread, so the packets are
+the same whichever way they were built.
+
+==============================================================================
+*/
+
+#define SV_DATAGRAM_BUFSIZE (MAX_DATAGRAM + 1000)
+
+typedef struct
 {
-	if (!client->netconnection)
-		return; // botclient
-	if (!client->spawned)
-		return; // not ready yet.
-	if (!(client->protocol_pext2 & PEXT2_REPLACEMENTDELTAS))
-		return; // brute force networking.
-	SVFTE_BuildSnapshotForClient (client);
-	SVFTE_CalcEntityDeltas (client);
-	client->snapshotresume = 0;
+	byte	 *data; // SV_DATAGRAM_BUFSIZE bytes
+	sizebuf_t msg;
+	qboolean  built;
+	qboolean  overflowed; // SV_WriteEntitiesToClient ran out of space
+} svdatagram_t;
+
+typedef enum
+{
+	SV_BUILD_SNAPSHOTS,	   // fte snapshots and deltas, all of the legacy entity updates
+	SV_BUILD_FTE_ENTITIES, // first fte entity updates, after the stats
+} svbuildstage_t;
+
+static svdatagram_t	  *sv_datagrams;
+static int			   sv_numdatagrams;
+static svnetscratch_t *sv_netscratch[TASKS_MAX_WORKERS];
+static int			   sv_numbuildjobs;
+
+/*
+=======================
+SV_BuildClientDatagramsTask
+=======================
+*/
+static void SV_BuildClientDatagramsTask (int job, void *data)
+{
+	const svbuildstage_t stage = *(svbuildstage_t *)data;
+	svnetscratch_t		*scratch = sv_netscratch[job];
+	client_t			*client;
+	svdatagram_t		*dg;
+	int					 i;
+
+	for (i = job; i < svs.maxclients; i += sv_numbuildjobs)
+	{
+		client = &svs.clients[i];
+		dg = &sv_datagrams[i];
+		if (!dg->built)
+			continue;
+
+		if (client->protocol_pext2 & PEXT2_REPLACEMENTDELTAS)
+		{
+			if (stage == SV_BUILD_SNAPSHOTS)
+			{
+				SVFTE_BuildSnapshotForClient (client, scratch);
+				SVFTE_CalcEntityDeltas (client, scratch);
+				client->snapshotresume = 0;
+			}
+			else
+				SVFTE_WriteEntitiesToClient (client, &dg->msg, SV_DATAGRAM_BUFSIZE); // must always write some data, or the stats will break
+		}
+		else if (stage == SV_BUILD_SNAPSHOTS)
+		{
+			MSG_WriteByte (&dg->msg, svc_time);
+			MSG_WriteFloat (&dg->msg, qcvm->time);
+			if (client->protocol_pext2 & PEXT2_PREDINFO)
+				MSG_WriteShort (&dg->msg, (client->lastmovemessage & 0xffff));
+			dg->overflowed = !SV_WriteEntitiesToClient (client, &dg->msg, SV_DATAGRAM_BUFSIZE, scratch);
+		}
+	}
+}
+
+/*
+=======================
+SV_RunBuildStage
+=======================
+*/
+static void SV_RunBuildStage (svbuildstage_t stage)
+{
+	double		  start = sv_tickcost.enabled ? Sys_DoubleTime () : 0;
+	task_handle_t task;
+
+	if (sv_numbuildjobs > 1)
+	{
+		task = Task_AllocateAssignIndexedFuncAndSubmit (SV_BuildClientDatagramsTask, sv_numbuildjobs, &stage, sizeof (stage));
+		Task_Join (task, TASK_TIMEOUT_INFINITE);
+	}
+	else
+		SV_BuildClientDatagramsTask (0, &stage);
+
+	if (sv_tickcost.enabled)
+		sv_tickcost.entities_ms += (Sys_DoubleTime () - start) * 1000.0;
+}
+
+/*
+=======================
+SV_BuildClientDatagrams
+
+Builds the start of the next datagram of every spawned network client,
+see SV_SendClientDatagram for the rest.
+=======================
+*/
+static void SV_BuildClientDatagrams (void)
+{
+	client_t	 *client;
+	svdatagram_t *dg;
+	int			  i, numjobs;
+	qboolean	  anyfte = false;
+
+	if (sv_numdatagrams < svs.maxclients)
+	{
+		sv_datagrams = (svdatagram_t *)Mem_Realloc (sv_datagrams, svs.maxclients * sizeof (svdatagram_t));
+		for (i = sv_numdatagrams; i < svs.maxclients; i++)
+		{
+			memset (&sv_datagrams[i], 0, sizeof (svdatagram_t));
+			sv_datagrams[i].data = (byte *)Mem_AllocNonZero (SV_DATAGRAM_BUFSIZE);
+		}
+		sv_numdatagrams = svs.maxclients;
+	}
+
+	numjobs = (sv_snapshotjobs.value >= 1.f) ? (int)sv_snapshotjobs.value : Tasks_NumWorkers ();
+	if (Tasks_IsWorker ())
+		numjobs = 1;
+	numjobs = CLAMP (1, numjobs, q_min (svs.maxclients, TASKS_MAX_WORKERS));
+	for (i = 0; i < numjobs; i++)
+		if (!sv_netscratch[i])
+			sv_netscratch[i] = (svnetscratch_t *)Mem_Alloc (sizeof (svnetscratch_t));
+	sv_numbuildjobs = numjobs;
+
+	for (i = 0, client = svs.clients; i < svs.maxclients; i++, client++)
+	{
+		dg = &sv_datagrams[i];
+		dg->msg.allowoverflow = false;
+		dg->msg.overflowed = false;
+		dg->msg.data = dg->data;
+		dg->msg.maxsize = q_min (MAX_DATAGRAM, client->limit_unreliable);
+		dg->msg.cursize = 0;
+		dg->built = client->active && client->netconnection && client->spawned;
+		dg->overflowed = false;
+		if (dg->built && (client->protocol_pext2 & PEXT2_REPLACEMENTDELTAS))
+			anyfte = true;
+	}
+
+	SV_RunBuildStage (SV_BUILD_SNAPSHOTS);
+	if (!anyfte)
+		return;
+
+	// the fte stats go in front of the entities, and come after the deltas that SVFTE_DroppedFrame adds to
+	for (i = 0, client = svs.clients; i < svs.maxclients; i++, client++)
+	{
+		dg = &sv_datagrams[i];
+		if (!dg->built || !(client->protocol_pext2 & PEXT2_REPLACEMENTDELTAS))
+			continue;
+		host_client = client;
+		sv_player = client->edict;
+		SV_WriteDamageToMessage (client->edict, &dg->msg);
+		if (!(client->protocol_pext2 & PEXT2_PREDINFO))
+			SV_WriteClientdataToMessage (client, &dg->msg);
+		else
+			SVFTE_WriteStats (client, &dg->msg);
+	}
+
+	SV_RunBuildStage (SV_BUILD_FTE_ENTITIES);
+}
+
+/*
+=======================
+SV_UpdatePacketStats
+=======================
+*/
+static void SV_UpdatePacketStats (sizebuf_t *msg)
+{
+	// johnfitz -- devstats
+	if (msg->cursize > 1024 && dev_peakstats.packetsize <= 1024)
+		Con_DWarning ("%i byte packet exceeds standard limit of 1024 (max = %d).\n", msg->cursize, msg->maxsize);
+	dev_stats.packetsize = msg->cursize;
+	dev_peakstats.packetsize = q_max (msg->cursize, dev_peakstats.packetsize);
+	// johnfitz
 }
 
 /*
@@ -2537,10 +2768,9 @@ SV_SendClientDatagram
 */
 qboolean SV_SendClientDatagram (client_t *client)
 {
-	// made static to prevent too big stack usage.
-	// fine as a temporary because only called from the main thread.
-	static byte buf[MAX_DATAGRAM + 1000];
-	sizebuf_t	msg;
+	svdatagram_t *dg;
+	sizebuf_t	  msg;
+	double		  entities_start;
 
 	if (!client->netconnection)
 	{
@@ -2549,25 +2779,18 @@ qboolean SV_SendClientDatagram (client_t *client)
 		return true;
 	}
 
-	msg.allowoverflow = false;
-	msg.data = buf;
-	msg.maxsize = q_min (MAX_DATAGRAM, client->limit_unreliable);
-	msg.cursize = 0;
+	// the entities are already in, see SV_BuildClientDatagrams
+	dg = &sv_datagrams[client - svs.clients];
+	msg = dg->msg;
 
 	host_client = client;
-	if (client->spawned)
+	if (client->spawned && dg->built)
 	{
 		sv_player = client->edict;
+		SV_UpdatePacketStats (&msg);
 
 		if (client->protocol_pext2 & PEXT2_REPLACEMENTDELTAS)
 		{
-			SV_WriteDamageToMessage (client->edict, &msg);
-			if (!(client->protocol_pext2 & PEXT2_PREDINFO))
-				SV_WriteClientdataToMessage (client, &msg);
-			else
-				SVFTE_WriteStats (client, &msg);
-			SVFTE_WriteEntitiesToClient (client, &msg, sizeof (buf)); // must always write some data, or the stats will break
-
 			// this delta protocol doesn't wipe old state just because there's a new packet.
 			// the server isn't required to sync with the client frames either
 			// so we can just spam multiple packets to keep our udp data under the MTU
@@ -2575,17 +2798,21 @@ qboolean SV_SendClientDatagram (client_t *client)
 			{
 				NET_SendUnreliableMessage (client->netconnection, &msg);
 				SZ_Clear (&msg);
-				SVFTE_WriteEntitiesToClient (client, &msg, sizeof (buf));
+				entities_start = sv_tickcost.enabled ? Sys_DoubleTime () : 0;
+				SVFTE_WriteEntitiesToClient (client, &msg, SV_DATAGRAM_BUFSIZE);
+				if (sv_tickcost.enabled)
+					sv_tickcost.entities_ms += (Sys_DoubleTime () - entities_start) * 1000.0;
+				SV_UpdatePacketStats (&msg);
 			}
 		}
-		else
+		else if (dg->overflowed)
 		{
-			MSG_WriteByte (&msg, svc_time);
-			MSG_WriteFloat (&msg, qcvm->time);
-			if (client->protocol_pext2 & PEXT2_PREDINFO)
-				MSG_WriteShort (&msg, (client->lastmovemessage & 0xffff));
-
-			SV_WriteEntitiesToClient (client, &msg, sizeof (buf));
+			// johnfitz -- less spammy overflow message
+			if (!dev_overflows.packetsize || dev_overflows.packetsize + CONSOLE_RESPAM_TIME < realtime)
+			{
+				Con_Printf ("Packet overflow!\n");
+				dev_overflows.packetsize = realtime;
+			}
 		}
 
 		// copy the private datagram if there is space
@@ -2858,13 +3085,11 @@ void SV_SendClientMessages (void)
 	// update frags, names, etc
 	SV_UpdateToReliableMessages ();
 
-	for (i = 0, host_client = svs.clients; i < svs.maxclients; i++, host_client++)
-	{
-		if (!host_client->active)
-			continue;
+	// generates client snapshots (and updates csqc pending flags)
+	SV_BuildClientDatagrams ();
 
-		SV_PresendClientDatagram (host_client); // generates client snapshots (and updates csqc pending flags)
-	}
+	// one sendmmsg for all clients where the network driver supports it
+	NET_BeginSendBatch ();
 
 	// build individual updates
 	for (i = 0, host_client = svs.clients; i < svs.maxclients; i++, host_client++)
@@ -2983,6 +3208,8 @@ void SV_SendClientMessages (void)
 		}
 	}
 
+	NET_FlushSendBatch ();
+
 	// clear muzzle flashes
 	SV_CleanupEnts ();
 }
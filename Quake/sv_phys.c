@@ -52,6 +52,7 @@ cvar_t sv_gameplayfix_bouncedownslopes = {"sv_gameplayfix_bouncedownslopes", "1"
 cvar_t sv_fastpushmove = {"sv_fastpushmove", "1", CVAR_NONE};								  // 0=old SV_PushMove processing; 1= faster SV_PushMove, (default)
 cvar_t sv_pushgrid = {"sv_pushgrid", "1", CVAR_NONE};				// cull SV_PushMove candidates with a spatial hash, needs sv_fastpushmove
 cvar_t sv_analyticphysics = {"sv_analyticphysics", "1", CVAR_NONE}; // gravity/friction integration matches 72Hz physics at any tick rate
+cvar_t sv_parallelphysics = {"sv_parallelphysics", "0", CVAR_NONE}; // trace the world part of toss/freefall moves on the task workers, 2=verify them
 
 qboolean sv_analyticphysics_frame = true; // sv_analyticphysics latched per SV_Physics, QC can flip the cvar mid-tick
 
@@ -680,10 +681,15 @@ the bias after the move; both phases sum to gravity*frametime and the bias is
 zero when frametime == 1/72.
 ============
 */
-static void SV_AddGravity (edict_t *ent)
+static void SV_AddGravityTo (edict_t *ent, vec3_t velocity)
 {
 	const double dt = sv_analyticphysics_frame ? (host_frametime + 1.0 / MAX_PHYSICS_FREQ) * 0.5 : host_frametime;
-	ent->v.velocity[2] -= SV_EntGravity (ent) * sv_gravity.value * dt;
+	velocity[2] -= SV_EntGravity (ent) * sv_gravity.value * dt;
+}
+
+static void SV_AddGravity (edict_t *ent)
+{
+	SV_AddGravityTo (ent, ent->v.velocity);
 }
 
 static void SV_FinishGravity (edict_t *ent)
@@ -2421,6 +2427,143 @@ static void SV_Physics_Step (edict_t *ent)
 		SV_CheckWaterTransition (ent);
 }
 
+/*
+===============================================================================
+
+PARALLEL WORLD CLIPS
+
+===============================================================================
+*/
+
+#define PARALLEL_CLIPS_MIN	  16 // fewer moves than this aren't worth waking the workers for
+#define PARALLEL_CLIPS_PER_TASK 16 // traced together by SV_PrecomputeWorldClipBatch
+
+typedef struct
+{
+	edict_t *ent;
+	int		 entnum;
+	vec3_t	 end;
+} sv_clipjob_t;
+
+static sv_clipjob_t clip_jobs[MAX_EDICTS];
+static int			num_clip_jobs;
+
+/*
+=============
+SV_PredictMoveEnd
+
+Replays the velocity updates SV_Physics_Toss and SV_Physics_Step make before
+their first SV_Move, for entities that run no QC before it. Returns false if
+the entity won't trace this tick or its move can't be foreseen.
+=============
+*/
+static qboolean SV_PredictMoveEnd (edict_t *ent, vec3_t end)
+{
+	vec3_t velocity;
+	int	   i;
+
+	if ((int)ent->v.flags & FL_ONGROUND)
+		return false;
+
+	VectorCopy (ent->v.velocity, velocity);
+	if (ent->v.movetype == MOVETYPE_STEP)
+	{
+		if ((int)ent->v.flags & (FL_FLY | FL_SWIM))
+			return false;
+		SV_AddGravityTo (ent, velocity);
+	}
+	else if (ent->v.nextthink > 0 && ent->v.nextthink <= qcvm->time + host_frametime)
+		return false; // SV_RunThink goes first
+
+	for (i = 0; i < 3; i++)
+	{
+		if (IS_NAN (velocity[i]) || IS_NAN (ent->v.origin[i]))
+			return false;
+		if (velocity[i] > sv_maxvelocity.value)
+			velocity[i] = sv_maxvelocity.value;
+		else if (velocity[i] < -sv_maxvelocity.value)
+			velocity[i] = -sv_maxvelocity.value;
+	}
+
+	if (ent->v.movetype == MOVETYPE_STEP)
+	{
+		const float time = host_frametime; // SV_FlyMove's time argument
+		if (!velocity[0] && !velocity[1] && !velocity[2])
+			return false;
+		for (i = 0; i < 3; i++)
+			end[i] = ent->v.origin[i] + time * velocity[i];
+	}
+	else
+	{
+		if (ent->v.movetype != MOVETYPE_FLY && ent->v.movetype != MOVETYPE_FLYMISSILE)
+			SV_AddGravityTo (ent, velocity);
+		VectorMA (ent->v.origin, host_frametime, velocity, end);
+	}
+
+	return true;
+}
+
+static void SV_PrecomputeClipTask (int task, void *unused)
+{
+	sv_clipmove_t moves[PARALLEL_CLIPS_PER_TASK];
+	sv_clipjob_t *job;
+	const int	  first = task * PARALLEL_CLIPS_PER_TASK;
+	const int	  count = q_min (num_clip_jobs - first, PARALLEL_CLIPS_PER_TASK);
+	int			  i;
+
+	for (i = 0; i < count; i++)
+	{
+		job = &clip_jobs[first + i];
+		moves[i].entnum = job->entnum;
+		moves[i].start = job->ent->v.origin;
+		moves[i].mins = job->ent->v.mins;
+		moves[i].maxs = job->ent->v.maxs;
+		moves[i].end = job->end;
+	}
+	SV_PrecomputeWorldClipBatch (moves, count, CONTENTMASK_ANYSOLID);
+}
+
+/*
+=============
+SV_PrecomputeWorldClips
+
+sv_parallelphysics: traces the world part of this tick's toss and freefall
+moves on the task workers. The serial entity loop still runs every think,
+touch and move in edict order, and SV_Move only takes a clip for the move
+it was traced for, so the results match sv_parallelphysics 0 exactly.
+=============
+*/
+static void SV_PrecomputeWorldClips (int entity_cap)
+{
+	edict_t		 *ent;
+	int			  i;
+	task_handle_t task;
+
+	num_clip_jobs = 0;
+	for (i = svs.maxclients + 1; i < entity_cap; i++)
+	{
+		ent = EDICT_NUM (i);
+		if (ent->free)
+			continue;
+		if (ent->v.movetype != MOVETYPE_STEP && ent->v.movetype != MOVETYPE_TOSS && ent->v.movetype != MOVETYPE_GIB &&
+			ent->v.movetype != MOVETYPE_BOUNCE && ent->v.movetype != MOVETYPE_FLY && ent->v.movetype != MOVETYPE_FLYMISSILE)
+			continue;
+		if (!SV_PredictMoveEnd (ent, clip_jobs[num_clip_jobs].end))
+			continue;
+		clip_jobs[num_clip_jobs].ent = ent;
+		clip_jobs[num_clip_jobs].entnum = i;
+		num_clip_jobs++;
+	}
+
+	if (num_clip_jobs < PARALLEL_CLIPS_MIN)
+		return;
+
+	SV_BeginWorldClips (sv_parallelphysics.value >= 2.f);
+	task = Task_AllocateAssignIndexedFuncAndSubmit (
+		SV_PrecomputeClipTask, (num_clip_jobs + PARALLEL_CLIPS_PER_TASK - 1) / PARALLEL_CLIPS_PER_TASK, NULL, 0);
+	Task_Join (task, TASK_TIMEOUT_INFINITE);
+}
+
 //============================================================================
 
 // track ED_Alloc during SV_Physics execution
@@ -2542,6 +2685,9 @@ void SV_Physics (void)
 		previous_alloc_hook = ED_AllocSetHook (SV_Physics_Alloc_Hook);
 	}
 
+	if (sv_parallelphysics.value > 0.f && qcvm == &sv.qcvm && Tasks_NumWorkers () > 1 && !Tasks_IsWorker ())
+		SV_PrecomputeWorldClips (entity_cap);
+
 	// for (i=0 ; i<sv.num_edicts ; i++, ent = NEXT_EDICT(ent))
 	for (i = 0; i < entity_cap; i++, ent = NEXT_EDICT (ent))
 	{
@@ -2598,6 +2744,8 @@ void SV_Physics (void)
 		// johnfitz
 	}
 
+	SV_EndWorldClips ();
+
 	if (pr_global_struct->force_retouch)
 		pr_global_struct->force_retouch--;
 
@@ -48,6 +48,12 @@ qfilesize_t Sys_FileOpenRead (const char *path, int *hndl);
 
 void Sys_MemFileOpenRead (const byte *memory, qfilesize_t size, int *hndl);
 
+// Maps a whole file read-only into memory. Returns NULL if the file is
+// missing or the platform can't map it, in which case callers should fall
+// back to regular reads. The mapping must be released with Sys_FileUnmap.
+const byte *Sys_FileMap (const char *path, qfilesize_t *size);
+void		Sys_FileUnmap (const byte *data, qfilesize_t size);
+
 // Duplicate a (read) handle : make a copy of a given handle designating the same resource,
 // to independently seek and read from the original handle.
 int Sys_DuplicateHandle (int handle);
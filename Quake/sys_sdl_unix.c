@@ -35,6 +35,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <sys/sysctl.h>
 #endif
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <sys/time.h>
 #include <fcntl.h>
 #include <dirent.h>
@@ -107,6 +108,37 @@ FILE *Sys_fopen (const char *path, const char *mode)
 	return fopen (path, mode);
 }
 
+const byte *Sys_FileMap (const char *path, qfilesize_t *size)
+{
+	struct stat st;
+	void	   *data;
+	int			fd;
+
+	fd = open (path, O_RDONLY);
+	if (fd == -1)
+		return NULL;
+	if (fstat (fd, &st) != 0 || !S_ISREG (st.st_mode) || st.st_size <= 0 || (uint64_t)st.st_size > (size_t)-1)
+	{
+		close (fd);
+		return NULL;
+	}
+
+	// the mapping holds its own reference to the file
+	data = mmap (NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close (fd);
+	if (data == MAP_FAILED)
+		return NULL;
+
+	*size = (qfilesize_t)st.st_size;
+	return (const byte *)data;
+}
+
+void Sys_FileUnmap (const byte *data, qfilesize_t size)
+{
+	if (data)
+		munmap ((void *)data, (size_t)size);
+}
+
 static qboolean Sys_Exec (const char *cmd, ...)
 {
 	pid_t p = fork ();
@@ -115,6 +115,44 @@ FILE *Sys_fopen (const char *path, const char *mode)
 	return _wfopen (wpath, wmode);
 }
 
+const byte *Sys_FileMap (const char *path, qfilesize_t *size)
+{
+	wchar_t		  wpath[MAX_PATH];
+	HANDLE		  file, mapping;
+	LARGE_INTEGER filesize;
+	void		 *data = NULL;
+
+	UTF8ToWideString (path, wpath, countof (wpath));
+	file = CreateFileW (wpath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return NULL;
+	if (!GetFileSizeEx (file, &filesize) || filesize.QuadPart <= 0 || (uint64_t)filesize.QuadPart > (SIZE_T)-1)
+	{
+		CloseHandle (file);
+		return NULL;
+	}
+
+	// the view keeps the mapping and the file alive until it is unmapped
+	mapping = CreateFileMappingW (file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle (file);
+	if (mapping)
+	{
+		data = MapViewOfFile (mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle (mapping);
+	}
+	if (!data)
+		return NULL;
+
+	*size = (qfilesize_t)filesize.QuadPart;
+	return (const byte *)data;
+}
+
+void Sys_FileUnmap (const byte *data, qfilesize_t size)
+{
+	if (data)
+		UnmapViewOfFile (data);
+}
+
 static void WideStringToUTF8 (const wchar_t *src, char *dst, size_t maxbytes)
 {
 	if (!WideCharToMultiByte (CP_UTF8, 0, src, -1, dst, (int)maxbytes, NULL, NULL))
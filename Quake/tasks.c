@@ -74,6 +74,9 @@ typedef struct
 	atomic_uint32_t remaining_dependencies;
 	uint64_t		epoch;
 	void		   *func;
+#ifdef USE_TASK_TRACE
+	const char	   *name;
+#endif
 	SDL_Mutex	   *epoch_mutex;
 	SDL_Condition  *epoch_condition;
 	uint8_t			payload[MAX_PAYLOAD_SIZE];
@@ -96,6 +99,7 @@ typedef struct
 	atomic_uint64_t tail;
 	uint64_t		tail_padding[7];
 	uint32_t		capacity_mask;
+	const char	   *name;
 	SDL_Semaphore  *push_semaphore;
 	SDL_Semaphore  *pop_semaphore;
 	task_slot_t		task_slots[1];
@@ -189,12 +193,107 @@ static inline void CPUPause ()
 #endif
 }
 
+#ifdef USE_TASK_TRACE
+#define TRACE_RING_SIZE		(1u << 15)
+#define TRACE_EXTRA_RINGS	4
+#define TRACE_MAX_RINGS		(TASKS_MAX_WORKERS + TRACE_EXTRA_RINGS)
+#define TRACE_MAX_FRAMES	1000
+#define TRACE_DEFAULT_FRAMES 60
+
+typedef enum
+{
+	TRACE_TASK_BEGIN,
+	TRACE_TASK_END,
+	TRACE_WAIT_BEGIN,
+	TRACE_WAIT_END,
+	TRACE_SLEEP_BEGIN,
+	TRACE_SLEEP_END,
+	TRACE_STEAL,
+	TRACE_FRAME,
+} trace_event_type_t;
+
+typedef struct
+{
+	uint64_t	time;
+	const char *name;
+	uint16_t	type;
+	uint16_t	worker_index;
+	uint32_t	count;
+} trace_event_t;
+
+// Single writer ring per thread. head only ever grows, the exporter reads
+// it after tracing was switched off to find the events that are complete.
+typedef struct
+{
+	trace_event_t  *events;
+	atomic_uint32_t head;
+	uint32_t		head_padding[13]; // Pad to 64 byte cache line size
+} trace_ring_t;
+
+static trace_ring_t		trace_rings[TRACE_MAX_RINGS];
+static uint32_t			trace_start_heads[TRACE_MAX_RINGS];
+static atomic_uint32_t	trace_active;
+static atomic_uint32_t	trace_num_extra_rings;
+static uint64_t			trace_start_time;
+static int				trace_frames_left;
+static int				trace_frame_ring = -1;
+static char				trace_filename[MAX_OSPATH];
+static THREAD_LOCAL int tl_trace_ring; // ring index + 1, 0 if not claimed yet, -1 if none was left
+
+/*
+====================
+TraceRing
+
+Workers own the ring matching their index, any other thread
+claims one of the extra rings the first time it records
+====================
+*/
+static trace_ring_t *TraceRing (void)
+{
+	if (tl_trace_ring == 0)
+	{
+		const uint32_t extra_ring = Atomic_IncrementUInt32 (&trace_num_extra_rings);
+		tl_trace_ring = (extra_ring < TRACE_EXTRA_RINGS) ? (TASKS_MAX_WORKERS + extra_ring + 1) : -1;
+	}
+	return (tl_trace_ring > 0) ? &trace_rings[tl_trace_ring - 1] : NULL;
+}
+
+/*
+====================
+TraceEvent
+====================
+*/
+static inline void TraceEvent (trace_event_type_t type, const char *name, int worker_index, uint32_t count)
+{
+	if (!Atomic_LoadUInt32 (&trace_active))
+		return;
+	trace_ring_t *ring = TraceRing ();
+	if (!ring)
+		return;
+	const uint32_t head = Atomic_LoadUInt32 (&ring->head);
+	trace_event_t *event = &ring->events[head & (TRACE_RING_SIZE - 1)];
+	event->time = SDL_GetPerformanceCounter ();
+	event->name = name;
+	event->type = type;
+	event->worker_index = worker_index;
+	event->count = count;
+	Atomic_StoreUInt32 (&ring->head, head + 1);
+}
+
+#define TASK_TRACE(type, name, worker_index, count) TraceEvent (type, name, worker_index, count)
+#else
+#define TASK_TRACE(type, name, worker_index, count) \
+	do                                              \
+	{                                               \
+	} while (false)
+#endif
+
 /*
 ====================
 SpinWaitSemaphore
 ====================
 */
-static inline void SpinWaitSemaphore (SDL_Semaphore *semaphore)
+static inline void SpinWaitSemaphore (SDL_Semaphore *semaphore, const char *queue_name, qboolean push)
 {
 	int	 remaining_spins = WAIT_SPIN_COUNT;
 	bool signalled = false;
@@ -205,7 +304,11 @@ static inline void SpinWaitSemaphore (SDL_Semaphore *semaphore)
 			break;
 	}
 	if (!signalled)
+	{
+		TASK_TRACE (TRACE_SLEEP_BEGIN, queue_name, 0, push);
 		SDL_WaitSemaphore (semaphore);
+		TASK_TRACE (TRACE_SLEEP_END, queue_name, 0, push);
+	}
 }
 
 /*
@@ -213,12 +316,13 @@ static inline void SpinWaitSemaphore (SDL_Semaphore *semaphore)
 CreateTaskQueue
 ====================
 */
-static task_queue_t *CreateTaskQueue (int capacity)
+static task_queue_t *CreateTaskQueue (const char *name, int capacity)
 {
 	assert (capacity >= 256);				   // Required for ShuffleIndex to be a bijection
 	assert ((capacity & (capacity - 1)) == 0); // Needs to be power of 2
 	task_queue_t *queue = Mem_Alloc (sizeof (task_queue_t) + (sizeof (task_slot_t) * (capacity - 1)));
 	queue->capacity_mask = capacity - 1;
+	queue->name = name;
 	queue->push_semaphore = SDL_CreateSemaphore (capacity - 1);
 	queue->pop_semaphore = SDL_CreateSemaphore (0);
 	for (uint32_t i = 0; i < (uint32_t)capacity; ++i)
@@ -233,7 +337,7 @@ TaskQueuePush
 */
 static inline void TaskQueuePush (task_queue_t *queue, uint32_t task_index)
 {
-	SpinWaitSemaphore (queue->push_semaphore);
+	SpinWaitSemaphore (queue->push_semaphore, queue->name, true);
 	const uint64_t ticket = Atomic_IncrementUInt64 (&queue->head);
 	task_slot_t	  *slot = &queue->task_slots[ShuffleIndex ((uint32_t)ticket & queue->capacity_mask)];
 
@@ -253,7 +357,7 @@ TaskQueuePop
 */
 static inline uint32_t TaskQueuePop (task_queue_t *queue)
 {
-	SpinWaitSemaphore (queue->pop_semaphore);
+	SpinWaitSemaphore (queue->pop_semaphore, queue->name, false);
 	const uint64_t ticket = Atomic_IncrementUInt64 (&queue->tail);
 	task_slot_t	  *slot = &queue->task_slots[ShuffleIndex ((uint32_t)ticket & queue->capacity_mask)];
 
@@ -281,10 +385,14 @@ static inline void Task_ExecuteIndexed (int worker_index, task_t *task, uint32_t
 		int				counter_index = IndexedTaskCounterIndex (task_index, steal_worker_index);
 		task_counter_t *counter = &indexed_task_counters[counter_index];
 		uint32_t		index = 0;
+		uint32_t		num_executed = 0;
 		while ((index = Atomic_IncrementUInt32 (&counter->index)) < counter->limit)
 		{
 			((task_indexed_func_t)task->func) (index, task->payload);
+			++num_executed;
 		}
+		if ((i > 0) && (num_executed > 0))
+			TASK_TRACE (TRACE_STEAL, task->name, steal_worker_index, num_executed);
 	}
 }
 
@@ -299,6 +407,9 @@ static int Task_Worker (void *data)
 
 	const int worker_index = (intptr_t)data;
 	tl_worker_index = worker_index;
+#ifdef USE_TASK_TRACE
+	tl_trace_ring = worker_index + 1;
+#endif
 
 	// try to pin workers on different cores, if set
 	if (num_pinned_workers)
@@ -318,6 +429,7 @@ static int Task_Worker (void *data)
 		task_t	*task = &tasks[task_index];
 		ANNOTATE_HAPPENS_AFTER (task);
 
+		TASK_TRACE (TRACE_TASK_BEGIN, task->name, worker_index, task->indexed_limit);
 		if (task->task_type == TASK_TYPE_SCALAR)
 		{
 			((task_func_t)task->func) (task->payload);
@@ -326,6 +438,7 @@ static int Task_Worker (void *data)
 		{
 			Task_ExecuteIndexed (worker_index, task, task_index);
 		}
+		TASK_TRACE (TRACE_TASK_END, task->name, worker_index, 0);
 
 #if defined(USE_HELGRIND)
 		ANNOTATE_HAPPENS_BEFORE (task);
@@ -418,8 +531,8 @@ Tasks_Init
 */
 void Tasks_Init (void)
 {
-	free_task_queue = CreateTaskQueue (MAX_PENDING_TASKS);
-	executable_task_queue = CreateTaskQueue (MAX_EXECUTABLE_TASKS);
+	free_task_queue = CreateTaskQueue ("free", MAX_PENDING_TASKS);
+	executable_task_queue = CreateTaskQueue ("executable", MAX_EXECUTABLE_TASKS);
 
 	for (uint32_t task_index = 0; task_index < (MAX_PENDING_TASKS - 1); ++task_index)
 	{
@@ -497,6 +610,9 @@ task_handle_t Task_Allocate (void)
 	task->num_dependents = 0;
 	task->indexed_limit = 0;
 	task->func = NULL;
+#ifdef USE_TASK_TRACE
+	task->name = NULL;
+#endif
 	return CreateTaskHandle (task_index, task->epoch);
 }
 
@@ -542,6 +658,20 @@ void Task_AssignIndexedFunc (task_handle_t handle, task_indexed_func_t func, uin
 		memcpy (&task->payload, payload, payload_size);
 }
 
+#ifdef USE_TASK_TRACE
+/*
+====================
+Task_SetName
+
+name has to outlive the task, the helpers in tasks.h pass string literals
+====================
+*/
+void Task_SetName (task_handle_t handle, const char *name)
+{
+	tasks[IndexFromTaskHandle (handle)].name = name;
+}
+#endif
+
 /*
 ====================
 Task_Submit
@@ -613,19 +743,245 @@ qboolean Task_Join (task_handle_t handle, uint32_t timeout)
 	task_t		  *task = &tasks[IndexFromTaskHandle (handle)];
 	const uint64_t handle_task_epoch = EpochFromTaskHandle (handle);
 	SDL_LockMutex (task->epoch_mutex);
+	const qboolean waiting = task->epoch == handle_task_epoch;
+	if (waiting)
+		TASK_TRACE (TRACE_WAIT_BEGIN, task->name, 0, 0);
 	while (task->epoch == handle_task_epoch)
 	{
 		if (!SDL_WaitConditionTimeout (task->epoch_condition, task->epoch_mutex, timeout))
 		{
 			SDL_UnlockMutex (task->epoch_mutex);
+			TASK_TRACE (TRACE_WAIT_END, NULL, 0, 0);
 			return false;
 		}
 	}
 	SDL_UnlockMutex (task->epoch_mutex);
+	if (waiting)
+		TASK_TRACE (TRACE_WAIT_END, NULL, 0, 0);
 	ANNOTATE_HAPPENS_AFTER (task);
 	return true;
 }
 
+#ifdef USE_TASK_TRACE
+/*
+====================
+TraceName
+
+Task names are the stringified function argument, drop a leading cast
+====================
+*/
+static const char *TraceName (const char *name)
+{
+	if (!name)
+		return "task";
+	if (*name == '(')
+	{
+		const char *end = strchr (name, ')');
+		if (end)
+			name = end + 1;
+	}
+	while (*name == ' ')
+		++name;
+	return name;
+}
+
+/*
+====================
+TraceWriteEvent
+
+Writes the common part of a trace event, the caller adds args and closes it
+====================
+*/
+static void TraceWriteEvent (FILE *f, const char *name, const char *category, char phase, double ts, int tid)
+{
+	fputs (",\n{", f);
+	if (name)
+		fprintf (f, "\"name\":\"%s\",\"cat\":\"%s\",", name, category);
+	fprintf (f, "\"ph\":\"%c\",\"ts\":%.3f,\"pid\":0,\"tid\":%d", phase, ts, tid);
+}
+
+/*
+====================
+TraceWrite
+
+Dumps the traced window in the Chrome trace event format, which
+chrome://tracing, ui.perfetto.dev and speedscope all load
+====================
+*/
+static void TraceWrite (void)
+{
+	const uint64_t end_time = SDL_GetPerformanceCounter ();
+	const double   ticks_to_us = 1000000.0 / (double)SDL_GetPerformanceFrequency ();
+	const double   end_ts = (double)(end_time - trace_start_time) * ticks_to_us;
+	int			   num_events = 0;
+	uint32_t	   num_lost = 0;
+
+	FILE *f = Sys_fopen (trace_filename, "w");
+	if (!f)
+	{
+		Con_Printf ("ERROR: couldn't open file %s.\n", trace_filename);
+		return;
+	}
+
+	fputs ("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", f);
+	fputs ("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"vkQuake\"}}", f);
+	for (int ring_index = 0; ring_index < TRACE_MAX_RINGS; ++ring_index)
+	{
+		trace_ring_t  *ring = &trace_rings[ring_index];
+		uint32_t	   begin = trace_start_heads[ring_index];
+		const uint32_t end = Atomic_LoadUInt32 (&ring->head);
+		if (!ring->events || (begin == end))
+			continue;
+
+		// A thread that saw tracing still enabled may be overwriting the oldest slot
+		if ((end - begin) > (TRACE_RING_SIZE - 1))
+		{
+			num_lost += (end - begin) - (TRACE_RING_SIZE - 1);
+			begin = end - (TRACE_RING_SIZE - 1);
+		}
+
+		char thread_name[32];
+		if (ring_index == trace_frame_ring)
+			q_strlcpy (thread_name, "main", sizeof (thread_name));
+		else if (ring_index < TASKS_MAX_WORKERS)
+			q_snprintf (thread_name, sizeof (thread_name), "worker %d", ring_index);
+		else
+			q_snprintf (thread_name, sizeof (thread_name), "thread %d", ring_index - TASKS_MAX_WORKERS);
+		fprintf (f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", ring_index, thread_name);
+		fprintf (
+			f, ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"sort_index\":%d}}", ring_index,
+			(ring_index == trace_frame_ring) ? -1 : ring_index);
+
+		// Slices that began before the window are dropped, ones still open at the end are closed
+		int depth = 0;
+		for (uint32_t i = begin; i != end; ++i)
+		{
+			const trace_event_t *event = &ring->events[i & (TRACE_RING_SIZE - 1)];
+			if ((event->time < trace_start_time) || (event->time > end_time))
+				continue;
+			const double ts = (double)(event->time - trace_start_time) * ticks_to_us;
+			switch (event->type)
+			{
+			case TRACE_TASK_BEGIN:
+				TraceWriteEvent (f, TraceName (event->name), "task", 'B', ts, ring_index);
+				if (event->count)
+					fprintf (f, ",\"args\":{\"items\":%u}", event->count);
+				fputs ("}", f);
+				++depth;
+				break;
+			case TRACE_WAIT_BEGIN:
+				TraceWriteEvent (f, "wait", "wait", 'B', ts, ring_index);
+				fprintf (f, ",\"args\":{\"task\":\"%s\"}}", TraceName (event->name));
+				++depth;
+				break;
+			case TRACE_SLEEP_BEGIN:
+				TraceWriteEvent (f, "sleep", "sleep", 'B', ts, ring_index);
+				fprintf (f, ",\"args\":{\"queue\":\"%s\",\"op\":\"%s\"}}", event->name, event->count ? "push" : "pop");
+				++depth;
+				break;
+			case TRACE_TASK_END:
+			case TRACE_WAIT_END:
+			case TRACE_SLEEP_END:
+				if (depth == 0)
+					continue;
+				TraceWriteEvent (f, NULL, NULL, 'E', ts, ring_index);
+				fputs ("}", f);
+				--depth;
+				break;
+			case TRACE_STEAL:
+				TraceWriteEvent (f, "steal", "steal", 'i', ts, ring_index);
+				fprintf (f, ",\"s\":\"t\",\"args\":{\"task\":\"%s\",\"from\":%d,\"items\":%u}}", TraceName (event->name), event->worker_index, event->count);
+				break;
+			case TRACE_FRAME:
+				TraceWriteEvent (f, "frame", "frame", 'i', ts, ring_index);
+				fprintf (f, ",\"s\":\"g\",\"args\":{\"frame\":%u}}", event->count);
+				break;
+			}
+			++num_events;
+		}
+		for (; depth > 0; --depth)
+		{
+			TraceWriteEvent (f, NULL, NULL, 'E', end_ts, ring_index);
+			fputs ("}", f);
+		}
+	}
+	fputs ("\n]}\n", f);
+	fclose (f);
+
+	Con_Printf ("Wrote %d task trace events to %s\n", num_events, trace_filename);
+	if (num_lost)
+		Con_Printf ("%u events were overwritten, trace fewer frames to keep them\n", num_lost);
+}
+
+/*
+====================
+Tasks_TraceFrame
+
+Called at the start of every host frame, marks frame boundaries
+and writes the trace once the requested number of frames passed
+====================
+*/
+void Tasks_TraceFrame (void)
+{
+	if (!Atomic_LoadUInt32 (&trace_active))
+		return;
+	if (trace_frames_left-- > 0)
+	{
+		TraceEvent (TRACE_FRAME, NULL, 0, host_framecount);
+		trace_frame_ring = tl_trace_ring - 1;
+		return;
+	}
+	Atomic_StoreUInt32 (&trace_active, 0);
+	TraceWrite ();
+}
+
+/*
+====================
+Tasks_Trace_f
+
+tasks_trace [frames] [filename]: records task execution for the next
+frames and writes it to filename.json in the game directory
+====================
+*/
+void Tasks_Trace_f (void)
+{
+	char relname[MAX_OSPATH];
+
+	if (Cmd_Argc () > 3)
+	{
+		Con_Printf ("usage: tasks_trace [frames] [filename]\n");
+		return;
+	}
+	if (Atomic_LoadUInt32 (&trace_active))
+	{
+		Con_Printf ("Already tracing, %d frames left\n", trace_frames_left);
+		return;
+	}
+
+	const int num_frames = CLAMP (1, (Cmd_Argc () >= 2) ? atoi (Cmd_Argv (1)) : TRACE_DEFAULT_FRAMES, TRACE_MAX_FRAMES);
+	q_strlcpy (relname, (Cmd_Argc () >= 3) ? Cmd_Argv (2) : "tasks_trace", sizeof (relname));
+	COM_AddExtension (relname, ".json", sizeof (relname));
+	q_snprintf (trace_filename, sizeof (trace_filename), "%s/%s", com_gamedir, relname);
+
+	// Rings stay allocated once used, a late writer may still touch them after tracing stopped
+	for (int ring_index = 0; ring_index < TRACE_MAX_RINGS; ++ring_index)
+	{
+		trace_ring_t *ring = &trace_rings[ring_index];
+		if ((ring_index >= num_workers) && (ring_index < TASKS_MAX_WORKERS))
+			continue;
+		if (!ring->events)
+			ring->events = Mem_Alloc (sizeof (trace_event_t) * TRACE_RING_SIZE);
+		trace_start_heads[ring_index] = Atomic_LoadUInt32 (&ring->head);
+	}
+
+	trace_frames_left = num_frames;
+	trace_frame_ring = -1;
+	trace_start_time = SDL_GetPerformanceCounter ();
+	Atomic_StoreUInt32 (&trace_active, 1);
+	Con_Printf ("Tracing tasks for %d frames\n", num_frames);
+}
+#endif
+
 #ifdef _DEBUG
 /*
 =================
@@ -29,6 +29,11 @@
 #define INVALID_TASK_HANDLE UINT64_MAX
 #define TASKS_MAX_WORKERS	32
 
+// Task tracing is compiled in unless the build defines NO_TASK_TRACE
+#ifndef NO_TASK_TRACE
+#define USE_TASK_TRACE
+#endif
+
 typedef uint64_t task_handle_t;
 typedef void (*task_func_t) (void *);
 typedef void (*task_indexed_func_t) (int, void *);
@@ -45,36 +50,66 @@ void		  Tasks_Submit (int num_handles, task_handle_t *handles);
 void		  Task_AddDependency (task_handle_t before, task_handle_t after);
 qboolean	  Task_Join (task_handle_t handle, uint32_t timeout);
 
-static inline task_handle_t Task_AllocateAndAssignFunc (task_func_t func, void *payload, size_t payload_size)
+#ifdef USE_TASK_TRACE
+#define TASK_NAME(func) #func
+void Task_SetName (task_handle_t handle, const char *name);
+void Tasks_TraceFrame (void);
+void Tasks_Trace_f (void);
+#else
+#define TASK_NAME(func) NULL
+#define Task_SetName(handle, name) \
+	do                             \
+	{                              \
+	} while (false)
+#define Tasks_TraceFrame() \
+	do                     \
+	{                      \
+	} while (false)
+#endif
+
+static inline task_handle_t Task_AllocateAndAssignNamedFunc (task_func_t func, const char *name, void *payload, size_t payload_size)
 {
 	task_handle_t handle = Task_Allocate ();
 	Task_AssignFunc (handle, func, payload, payload_size);
+	Task_SetName (handle, name);
 	return handle;
 }
 
-static inline task_handle_t Task_AllocateAndAssignIndexedFunc (task_indexed_func_t func, uint32_t limit, void *payload, size_t payload_size)
+static inline task_handle_t Task_AllocateAndAssignNamedIndexedFunc (task_indexed_func_t func, const char *name, uint32_t limit, void *payload, size_t payload_size)
 {
 	task_handle_t handle = Task_Allocate ();
 	Task_AssignIndexedFunc (handle, func, limit, payload, payload_size);
+	Task_SetName (handle, name);
 	return handle;
 }
 
-static inline task_handle_t Task_AllocateAssignFuncAndSubmit (task_func_t func, void *payload, size_t payload_size)
+static inline task_handle_t Task_AllocateAssignNamedFuncAndSubmit (task_func_t func, const char *name, void *payload, size_t payload_size)
 {
 	task_handle_t handle = Task_Allocate ();
 	Task_AssignFunc (handle, func, payload, payload_size);
+	Task_SetName (handle, name);
 	Task_Submit (handle);
 	return handle;
 }
 
-static inline task_handle_t Task_AllocateAssignIndexedFuncAndSubmit (task_indexed_func_t func, uint32_t limit, void *payload, size_t payload_size)
+static inline task_handle_t Task_AllocateAssignNamedIndexedFuncAndSubmit (
+	task_indexed_func_t func, const char *name, uint32_t limit, void *payload, size_t payload_size)
 {
 	task_handle_t handle = Task_Allocate ();
 	Task_AssignIndexedFunc (handle, func, limit, payload, payload_size);
+	Task_SetName (handle, name);
 	Task_Submit (handle);
 	return handle;
 }
 
+// The helpers name tasks after the function passed in, which is what shows up in traces
+#define Task_AllocateAndAssignFunc(func, payload, payload_size) Task_AllocateAndAssignNamedFunc (func, TASK_NAME (func), payload, payload_size)
+#define Task_AllocateAndAssignIndexedFunc(func, limit, payload, payload_size) \
+	Task_AllocateAndAssignNamedIndexedFunc (func, TASK_NAME (func), limit, payload, payload_size)
+#define Task_AllocateAssignFuncAndSubmit(func, payload, payload_size) Task_AllocateAssignNamedFuncAndSubmit (func, TASK_NAME (func), payload, payload_size)
+#define Task_AllocateAssignIndexedFuncAndSubmit(func, limit, payload, payload_size) \
+	Task_AllocateAssignNamedIndexedFuncAndSubmit (func, TASK_NAME (func), limit, payload, payload_size)
+
 #ifdef _DEBUG
 void TestTasks_f (void);
 #endif
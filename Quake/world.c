@@ -34,6 +34,9 @@ cvar_t sv_fte_recursivehullckeck = {"sv_fte_recursivehullckeck", "1", CVAR_NONE}
 
 cvar_t sv_fte_createareanode = {"sv_fte_createareanode", "1", CVAR_NONE};
 
+// find the edicts near a move or a trigger toucher with a loose grid instead of the areanode lists, same results
+cvar_t sv_areagrid = {"sv_areagrid", "0", CVAR_NONE};
+
 /*
 
 entities never clip against themselves, or their owner
@@ -243,6 +246,222 @@ hull_t *SV_HullForEntity (edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t offset)
 /*
 ===============================================================================
 
+AREA GRID
+
+With sv_areagrid, SV_Move and trigger touching take their candidates from a
+loose grid over the world instead of walking the areanode lists, which get
+long when thousands of entities crowd a few nodes. A linked edict sits in
+the cell holding the center of its absbox, or in the big entity list when it
+is wider than a cell, so a box query only has to look at the cells within
+half a cell of it. The areanodes stay linked either way and the candidates
+are sorted back into the order the areanode walk visits them, so both give
+the same results. Queries that would cover too many cells walk the areanodes.
+
+===============================================================================
+*/
+
+#define AREA_GRID_MIN_SHIFT	  7	  // 128 unit cells
+#define AREA_GRID_MAX_SIZE	  512 // cells along an axis, bigger worlds get bigger cells
+#define AREA_GRID_MAX_CELLS	  64  // cells a query may cover before the areanodes are walked instead
+#define AREA_GRID_MAX_RESULTS 512 // same for candidates
+
+typedef struct
+{
+	uint64_t order; // areanode, then link sequence
+	edict_t *ent;
+} areagridhit_t;
+
+/*
+===============
+SV_AreaGridCoord
+
+Clamped to the grid, so edicts outside the world share the border cells
+===============
+*/
+static int SV_AreaGridCoord (float v, int axis)
+{
+	const areagrid_t *grid = &qcvm->areagrid;
+
+	v = (v - grid->origin[axis]) / (float)(1 << grid->shift);
+	if (!(v >= 0.0f)) // also catches NaN
+		return 0;
+	if (v >= grid->size[axis] - 1)
+		return grid->size[axis] - 1;
+	return (int)v;
+}
+
+/*
+===============
+SV_AreaGridInsert
+
+Edicts of an areanode trigger list go to the trigger cells, the others to the solid cells
+===============
+*/
+static void SV_AreaGridInsert (edict_t *ent, qboolean trigger)
+{
+	areagrid_t *grid = &qcvm->areagrid;
+	const float cellsize = 1 << grid->shift;
+	const int	num = NUM_FOR_EDICT (ent);
+	int			cell;
+
+	// the negated tests send NaN boxes to the big list, the areanode walk can't prune them either
+	if (!(ent->v.absmax[0] - ent->v.absmin[0] <= cellsize) || !(ent->v.absmax[1] - ent->v.absmin[1] <= cellsize))
+		cell = grid->numcells;
+	else
+		cell = SV_AreaGridCoord (0.5f * (ent->v.absmin[0] + ent->v.absmax[0]), 0) +
+			   SV_AreaGridCoord (0.5f * (ent->v.absmin[1] + ent->v.absmax[1]), 1) * grid->size[0];
+	if (trigger)
+		cell += grid->numcells + 1;
+
+	ent->areacell = cell + 1;
+	ent->areaprev = 0;
+	ent->areanext = grid->heads[cell];
+	if (ent->areanext)
+		EDICT_NUM (ent->areanext)->areaprev = num;
+	grid->heads[cell] = num;
+}
+
+/*
+===============
+SV_AreaGridRemove
+===============
+*/
+static void SV_AreaGridRemove (edict_t *ent)
+{
+	areagrid_t *grid = &qcvm->areagrid;
+
+	if (ent->areaprev)
+		EDICT_NUM (ent->areaprev)->areanext = ent->areanext;
+	else
+		grid->heads[ent->areacell - 1] = ent->areanext;
+	if (ent->areanext)
+		EDICT_NUM (ent->areanext)->areaprev = ent->areaprev;
+	ent->areacell = 0;
+}
+
+/*
+===============
+SV_AreaGridBuild
+
+Sized to the world model and filled from the areanodes, kept up to date by
+SV_LinkEdict and SV_UnlinkEdict from then on until SV_ClearWorld
+===============
+*/
+static void SV_AreaGridBuild (void)
+{
+	areagrid_t *grid = &qcvm->areagrid;
+	const float extent = q_max (qcvm->worldmodel->maxs[0] - qcvm->worldmodel->mins[0], qcvm->worldmodel->maxs[1] - qcvm->worldmodel->mins[1]);
+	link_t	   *l;
+	int			i;
+
+	grid->shift = AREA_GRID_MIN_SHIFT;
+	while (grid->shift < 20 && extent / (float)(1 << grid->shift) >= AREA_GRID_MAX_SIZE)
+		grid->shift++;
+	for (i = 0; i < 2; i++)
+	{
+		grid->origin[i] = qcvm->worldmodel->mins[i];
+		grid->size[i] = CLAMP (1, (int)((qcvm->worldmodel->maxs[i] - qcvm->worldmodel->mins[i]) / (float)(1 << grid->shift)) + 1, AREA_GRID_MAX_SIZE);
+	}
+	grid->numcells = grid->size[0] * grid->size[1];
+	grid->heads = (int *)Mem_Alloc (2 * (grid->numcells + 1) * sizeof (int));
+
+	for (i = 0; i < qcvm->numareanodes; i++)
+	{
+		for (l = qcvm->areanodes[i].solid_edicts.next; l != &qcvm->areanodes[i].solid_edicts; l = l->next)
+			SV_AreaGridInsert (EDICT_FROM_AREA (l), false);
+		for (l = qcvm->areanodes[i].trigger_edicts.next; l != &qcvm->areanodes[i].trigger_edicts; l = l->next)
+			SV_AreaGridInsert (EDICT_FROM_AREA (l), true);
+	}
+}
+
+/*
+===============
+SV_AreaGridActive
+===============
+*/
+static qboolean SV_AreaGridActive (void)
+{
+	if (!sv_areagrid.value || !qcvm->worldmodel)
+		return false;
+	if (!qcvm->areagrid.heads)
+		SV_AreaGridBuild ();
+	return true;
+}
+
+/*
+===============
+SV_AreaGridGatherCell
+
+Returns the new hit count, or -1 once there are too many
+===============
+*/
+static int SV_AreaGridGatherCell (int num, const vec3_t mins, const vec3_t maxs, areagridhit_t *hits, int numhits)
+{
+	edict_t *touch;
+
+	for (; num; num = touch->areanext)
+	{
+		touch = EDICT_NUM (num);
+		if (mins[0] > touch->v.absmax[0] || mins[1] > touch->v.absmax[1] || mins[2] > touch->v.absmax[2] || maxs[0] < touch->v.absmin[0] ||
+			maxs[1] < touch->v.absmin[1] || maxs[2] < touch->v.absmin[2])
+			continue;
+		if (numhits == AREA_GRID_MAX_RESULTS)
+			return -1;
+		hits[numhits].order = ((uint64_t)touch->areanode << 48) | (touch->arealinkseq & 0xffffffffffffull);
+		hits[numhits].ent = touch;
+		numhits++;
+	}
+	return numhits;
+}
+
+/*
+===============
+SV_AreaGridGather
+
+Collects the solid or trigger edicts whose absbox overlaps the box, in the
+order SV_ClipToLinks and SV_AreaTriggerEdicts would find them. Returns the
+count, or -1 if the caller has to walk the areanodes.
+===============
+*/
+static int SV_AreaGridGather (const vec3_t mins, const vec3_t maxs, qboolean triggers, areagridhit_t *hits)
+{
+	const areagrid_t *grid = &qcvm->areagrid;
+	const float		  inflate = 0.5f * (1 << grid->shift) + 1.0f; // +1 for the rounding of the centers
+	const int		  base = triggers ? grid->numcells + 1 : 0;
+	int				  lo[2], hi[2];
+	int				  x, y, i, j;
+	int				  numhits;
+
+	for (i = 0; i < 2; i++)
+	{
+		// NaN, inverted or huge boxes are left to the areanode walk
+		if (!(mins[i] <= maxs[i] && mins[i] > -(float)(1 << 23) && maxs[i] < (float)(1 << 23)))
+			return -1;
+		lo[i] = SV_AreaGridCoord (mins[i] - inflate, i);
+		hi[i] = SV_AreaGridCoord (maxs[i] + inflate, i);
+	}
+	if ((hi[0] - lo[0] + 1) * (hi[1] - lo[1] + 1) > AREA_GRID_MAX_CELLS)
+		return -1;
+
+	numhits = SV_AreaGridGatherCell (grid->heads[base + grid->numcells], mins, maxs, hits, 0);
+	for (y = lo[1]; y <= hi[1] && numhits >= 0; y++)
+		for (x = lo[0]; x <= hi[0] && numhits >= 0; x++)
+			numhits = SV_AreaGridGatherCell (grid->heads[base + y * grid->size[0] + x], mins, maxs, hits, numhits);
+
+	// areanodes are numbered in the order the walk visits them, and edicts link at the tail of a node
+	for (i = 1; i < numhits; i++)
+	{
+		areagridhit_t hit = hits[i];
+		for (j = i - 1; j >= 0 && hits[j].order > hit.order; j--)
+			hits[j + 1] = hits[j];
+		hits[j + 1] = hit;
+	}
+	return numhits;
+}
+
+/*
+===============================================================================
+
 ENTITY AREA CHECKING
 
 ===============================================================================
@@ -316,10 +535,15 @@ SV_ClearWorld
 void SV_ClearWorld (void)
 {
 	SV_InitBoxHull ();
+	SV_EndWorldClips (); // a tick aborted by Host_Error may have left some, and they belong to the old world
 
 	memset (qcvm->areanodes, 0, sizeof (qcvm->areanodes));
 	qcvm->numareanodes = 0;
 	SV_CreateAreaNode (0, qcvm->worldmodel->mins, qcvm->worldmodel->maxs);
+
+	// rebuilt for the new world on first use
+	Mem_Free (qcvm->areagrid.heads);
+	memset (&qcvm->areagrid, 0, sizeof (qcvm->areagrid));
 }
 
 /*
@@ -334,6 +558,25 @@ void SV_UnlinkEdict (edict_t *ent)
 		return; // not linked in anywhere
 	RemoveLink (&ent->area);
 	ent->area.prev = ent->area.next = NULL;
+	if (ent->areacell)
+		SV_AreaGridRemove (ent);
+}
+
+/*
+====================
+SV_TriggerTouches
+====================
+*/
+static qboolean SV_TriggerTouches (edict_t *ent, edict_t *touch)
+{
+	if (touch == ent)
+		return false;
+	if (!touch->v.touch || touch->v.solid != SOLID_TRIGGER)
+		return false;
+	if (ent->v.absmin[0] > touch->v.absmax[0] || ent->v.absmin[1] > touch->v.absmax[1] || ent->v.absmin[2] > touch->v.absmax[2] ||
+		ent->v.absmax[0] < touch->v.absmin[0] || ent->v.absmax[1] < touch->v.absmin[1] || ent->v.absmax[2] < touch->v.absmin[2])
+		return false;
+	return true;
 }
 
 /*
@@ -354,12 +597,7 @@ static void SV_AreaTriggerEdicts (edict_t *ent, areanode_t *node, uint16_t *list
 	{
 		next = l->next;
 		touch = EDICT_FROM_AREA (l);
-		if (touch == ent)
-			continue;
-		if (!touch->v.touch || touch->v.solid != SOLID_TRIGGER)
-			continue;
-		if (ent->v.absmin[0] > touch->v.absmax[0] || ent->v.absmin[1] > touch->v.absmax[1] || ent->v.absmin[2] > touch->v.absmax[2] ||
-			ent->v.absmax[0] < touch->v.absmin[0] || ent->v.absmax[1] < touch->v.absmin[1] || ent->v.absmax[2] < touch->v.absmin[2])
+		if (!SV_TriggerTouches (ent, touch))
 			continue;
 
 		if (*listcount == listspace)
@@ -379,6 +617,26 @@ static void SV_AreaTriggerEdicts (edict_t *ent, areanode_t *node, uint16_t *list
 		SV_AreaTriggerEdicts (ent, node->children[1], list, listcount, listspace);
 }
 
+/*
+====================
+SV_AreaGridTriggerEdicts
+
+SV_AreaTriggerEdicts from the sv_areagrid cells, returns -1 if the areanodes have to be walked
+====================
+*/
+static int SV_AreaGridTriggerEdicts (edict_t *ent, uint16_t *list, const int listspace)
+{
+	areagridhit_t hits[AREA_GRID_MAX_RESULTS];
+	int			  numhits = SV_AreaGridGather (ent->v.absmin, ent->v.absmax, true, hits);
+	int			  listcount = 0;
+	int			  i;
+
+	for (i = 0; i < numhits && listcount < listspace; i++)
+		if (SV_TriggerTouches (ent, hits[i].ent))
+			list[listcount++] = NUM_FOR_EDICT (hits[i].ent);
+	return numhits < 0 ? -1 : listcount;
+}
+
 /*
 ====================
 SV_TouchLinks
@@ -401,8 +659,12 @@ static void SV_TouchLinks (edict_t *ent)
 	// but it is unclear if recursion could happen.
 	TEMP_ALLOC (uint16_t, list, qcvm->num_edicts);
 
-	listcount = 0;
-	SV_AreaTriggerEdicts (ent, qcvm->areanodes, list, &listcount, qcvm->num_edicts);
+	listcount = SV_AreaGridActive () ? SV_AreaGridTriggerEdicts (ent, list, qcvm->num_edicts) : -1;
+	if (listcount < 0)
+	{
+		listcount = 0;
+		SV_AreaTriggerEdicts (ent, qcvm->areanodes, list, &listcount, qcvm->num_edicts);
+	}
 
 	old_self = pr_global_struct->self;
 	old_other = pr_global_struct->other;
@@ -412,12 +674,7 @@ static void SV_TouchLinks (edict_t *ent)
 		edict_t *touch = EDICT_NUM (list[i]);
 		// re-validate in case of PR_ExecuteProgram having side effects that make
 		// edicts later in the list no longer touch
-		if (touch->free || touch == ent)
-			continue;
-		if (!touch->v.touch || touch->v.solid != SOLID_TRIGGER)
-			continue;
-		if (ent->v.absmin[0] > touch->v.absmax[0] || ent->v.absmin[1] > touch->v.absmax[1] || ent->v.absmin[2] > touch->v.absmax[2] ||
-			ent->v.absmax[0] < touch->v.absmin[0] || ent->v.absmax[1] < touch->v.absmin[1] || ent->v.absmax[2] < touch->v.absmin[2])
+		if (touch->free || !SV_TriggerTouches (ent, touch))
 			continue;
 
 		pr_global_struct->self = EDICT_TO_PROG (touch);
@@ -490,6 +747,8 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers)
 {
 	areanode_t *node;
 
+	ED_TouchFieldIndexes (ent); // origin, mins, maxs or solid may have changed
+
 	if (ent->area.prev)
 		SV_UnlinkEdict (ent); // unlink from old position
 
@@ -578,6 +837,10 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers)
 		InsertLinkBefore (&ent->area, &node->trigger_edicts);
 	else
 		InsertLinkBefore (&ent->area, &node->solid_edicts);
+	ent->areanode = node - qcvm->areanodes;
+	ent->arealinkseq = ++qcvm->arealinkseq;
+	if (qcvm->areagrid.heads)
+		SV_AreaGridInsert (ent, ent->v.solid == SOLID_TRIGGER);
 
 	// if touch_triggers, touch all entities at this node and decend for more
 	if (touch_triggers)
@@ -938,6 +1201,28 @@ static qboolean SV_SlowRecursiveHullCheck (hull_t *hull, int num, float p1f, flo
 	return false;
 }
 
+/*
+==================
+SV_PointTraceContents
+
+The result of a point trace that ended up in the leaf with contents c
+==================
+*/
+static void SV_PointTraceContents (int c, trace_t *trace, unsigned int hitcontents)
+{
+	trace->contents = c;
+	if (hitcontents & CONTENTMASK_FROMQ1 (c))
+		trace->startsolid = true;
+	else
+	{
+		trace->allsolid = false;
+		if (c == CONTENTS_EMPTY)
+			trace->inopen = true;
+		else if (c != CONTENTS_SOLID)
+			trace->inwater = true;
+	}
+}
+
 /*
 ==================
 SV_RecursiveHullCheck
@@ -952,18 +1237,7 @@ qboolean SV_RecursiveHullCheck (hull_t *hull, vec3_t p1, vec3_t p2, trace_t *tra
 	else if (p1[0] == p2[0] && p1[1] == p2[1] && p1[2] == p2[2])
 	{
 		/*points cannot cross planes, so do it faster*/
-		int c = SV_HullPointContents (hull, hull->firstclipnode, p1);
-		trace->contents = c;
-		if (hitcontents & CONTENTMASK_FROMQ1 (c))
-			trace->startsolid = true;
-		else
-		{
-			trace->allsolid = false;
-			if (c == CONTENTS_EMPTY)
-				trace->inopen = true;
-			else if (c != CONTENTS_SOLID)
-				trace->inwater = true;
-		}
+		SV_PointTraceContents (SV_HullPointContents (hull, hull->firstclipnode, p1), trace, hitcontents);
 		return true;
 	}
 	else
@@ -978,6 +1252,328 @@ qboolean SV_RecursiveHullCheck (hull_t *hull, vec3_t p1, vec3_t p2, trace_t *tra
 	}
 }
 
+/*
+===============================================================================
+
+BATCHED LINE TESTING IN HULLS
+
+SV_RecursiveHullCheckBatch walks a batch of segments through the clipnodes
+together, in SoA form like the surface culling in r_world.c. At every node
+the segments that are completely on one side are tested against the plane
+four at a time and passed on to that child together. Until a segment
+crosses a plane, the scalar trace does exactly the same: it only follows
+one child with unchanged end points. A crossing segment is therefore
+handed to Q1BSP_RecursiveHullTrace at that node, and a segment that
+reaches a leaf is finished there, so the results match the scalar path bit
+for bit. Point traces never cross a plane and come out at their leaf.
+
+The plane distances are computed like the scalar code does: a float
+subtraction for axial planes, and a double dot product that is rounded to
+float for the others. The SIMD path is only used where scalar float math
+is SSE or NEON as well, not x87, so that every distance is rounded the
+same way. The build also turns off floating point contraction: on AArch64,
+or x86-64 with -mfma, GCC fuses multiply-adds into FMA in the scalar trace
+and the intrinsics alike, but not in the same places.
+
+===============================================================================
+*/
+
+#if defined(USE_SIMD) && (defined(__x86_64__) || defined(_M_X64) || defined(__aarch64__))
+#define HULLTRACE_SIMD
+#endif
+
+enum
+{
+	HULLTRACE_FRONT,
+	HULLTRACE_BACK,
+	HULLTRACE_CROSS
+};
+
+typedef struct
+{
+	hull_t		*hull;
+	hulltrace_t *traces;
+	unsigned int hitcontents;
+
+	// the segments still descending, reordered as they are passed down, padded for the 4 wide loads
+	int		 lane[HULLTRACE_BATCH + 4];
+	qboolean point[HULLTRACE_BATCH + 4];
+	float	 p[6][HULLTRACE_BATCH + 4]; // start xyz, end xyz
+	byte	 side[HULLTRACE_BATCH + 4];
+} hullbatch_t;
+
+/*
+==================
+SV_HullBatchClassify
+
+Sets side for the segments [first, end) against plane
+==================
+*/
+static void SV_HullBatchClassify (hullbatch_t *b, mplane_t *plane, int first, int end)
+{
+	int i;
+#if defined(HULLTRACE_SIMD)
+	int j, front, back;
+#if defined(USE_SSE2)
+	const __m128 zero = _mm_setzero_ps ();
+	__m128		 t1, t2;
+
+	for (i = first; i < end; i += 4)
+	{
+		if (plane->type < 3)
+		{
+			const __m128 dist = _mm_set1_ps (plane->dist);
+			t1 = _mm_sub_ps (_mm_loadu_ps (&b->p[plane->type][i]), dist);
+			t2 = _mm_sub_ps (_mm_loadu_ps (&b->p[3 + plane->type][i]), dist);
+		}
+		else
+		{
+			const __m128d nx = _mm_set1_pd (plane->normal[0]);
+			const __m128d ny = _mm_set1_pd (plane->normal[1]);
+			const __m128d nz = _mm_set1_pd (plane->normal[2]);
+			const __m128d dist = _mm_set1_pd (plane->dist);
+			__m128		  t[2];
+			for (j = 0; j < 2; j++)
+			{
+				const __m128 x = _mm_loadu_ps (&b->p[3 * j + 0][i]);
+				const __m128 y = _mm_loadu_ps (&b->p[3 * j + 1][i]);
+				const __m128 z = _mm_loadu_ps (&b->p[3 * j + 2][i]);
+				__m128d		 lo = _mm_add_pd (
+					 _mm_add_pd (_mm_mul_pd (nx, _mm_cvtps_pd (x)), _mm_mul_pd (ny, _mm_cvtps_pd (y))), _mm_mul_pd (nz, _mm_cvtps_pd (z)));
+				__m128d hi = _mm_add_pd (
+					_mm_add_pd (_mm_mul_pd (nx, _mm_cvtps_pd (_mm_movehl_ps (x, x))), _mm_mul_pd (ny, _mm_cvtps_pd (_mm_movehl_ps (y, y)))),
+					_mm_mul_pd (nz, _mm_cvtps_pd (_mm_movehl_ps (z, z))));
+				t[j] = _mm_movelh_ps (_mm_cvtpd_ps (_mm_sub_pd (lo, dist)), _mm_cvtpd_ps (_mm_sub_pd (hi, dist)));
+			}
+			t1 = t[0];
+			t2 = t[1];
+		}
+		front = _mm_movemask_ps (_mm_and_ps (_mm_cmpge_ps (t1, zero), _mm_cmpge_ps (t2, zero)));
+		back = _mm_movemask_ps (_mm_and_ps (_mm_cmplt_ps (t1, zero), _mm_cmplt_ps (t2, zero)));
+		for (j = 0; j < 4 && i + j < end; j++)
+			b->side[i + j] = ((front >> j) & 1) ? HULLTRACE_FRONT : ((back >> j) & 1) ? HULLTRACE_BACK : HULLTRACE_CROSS;
+	}
+#elif defined(USE_NEON)
+	const float32x4_t zero = vdupq_n_f32 (0.0f);
+	float32x4_t		  t1, t2;
+	uint32_t		  fronts[4], backs[4];
+
+	for (i = first; i < end; i += 4)
+	{
+		if (plane->type < 3)
+		{
+			const float32x4_t dist = vdupq_n_f32 (plane->dist);
+			t1 = vsubq_f32 (vld1q_f32 (&b->p[plane->type][i]), dist);
+			t2 = vsubq_f32 (vld1q_f32 (&b->p[3 + plane->type][i]), dist);
+		}
+		else
+		{
+			const float64x2_t nx = vdupq_n_f64 (plane->normal[0]);
+			const float64x2_t ny = vdupq_n_f64 (plane->normal[1]);
+			const float64x2_t nz = vdupq_n_f64 (plane->normal[2]);
+			const float64x2_t dist = vdupq_n_f64 (plane->dist);
+			float32x4_t		  t[2];
+			for (j = 0; j < 2; j++)
+			{
+				const float32x4_t x = vld1q_f32 (&b->p[3 * j + 0][i]);
+				const float32x4_t y = vld1q_f32 (&b->p[3 * j + 1][i]);
+				const float32x4_t z = vld1q_f32 (&b->p[3 * j + 2][i]);
+				float64x2_t		  lo = vaddq_f64 (
+					  vaddq_f64 (vmulq_f64 (nx, vcvt_f64_f32 (vget_low_f32 (x))), vmulq_f64 (ny, vcvt_f64_f32 (vget_low_f32 (y)))),
+					  vmulq_f64 (nz, vcvt_f64_f32 (vget_low_f32 (z))));
+				float64x2_t hi = vaddq_f64 (
+					vaddq_f64 (vmulq_f64 (nx, vcvt_high_f64_f32 (x)), vmulq_f64 (ny, vcvt_high_f64_f32 (y))), vmulq_f64 (nz, vcvt_high_f64_f32 (z)));
+				t[j] = vcombine_f32 (vcvt_f32_f64 (vsubq_f64 (lo, dist)), vcvt_f32_f64 (vsubq_f64 (hi, dist)));
+			}
+			t1 = t[0];
+			t2 = t[1];
+		}
+		vst1q_u32 (fronts, vandq_u32 (vcgeq_f32 (t1, zero), vcgeq_f32 (t2, zero)));
+		vst1q_u32 (backs, vandq_u32 (vcltq_f32 (t1, zero), vcltq_f32 (t2, zero)));
+		front = back = 0;
+		for (j = 0; j < 4; j++)
+		{
+			front |= (fronts[j] & 1) << j;
+			back |= (backs[j] & 1) << j;
+		}
+		for (j = 0; j < 4 && i + j < end; j++)
+			b->side[i + j] = ((front >> j) & 1) ? HULLTRACE_FRONT : ((back >> j) & 1) ? HULLTRACE_BACK : HULLTRACE_CROSS;
+	}
+#endif
+#else
+	float t1, t2;
+
+	for (i = first; i < end; i++)
+	{
+		if (plane->type < 3)
+		{
+			t1 = b->p[plane->type][i] - plane->dist;
+			t2 = b->p[3 + plane->type][i] - plane->dist;
+		}
+		else
+		{
+			t1 = (double)plane->normal[0] * b->p[0][i] + (double)plane->normal[1] * b->p[1][i] + (double)plane->normal[2] * b->p[2][i] - plane->dist;
+			t2 = (double)plane->normal[0] * b->p[3][i] + (double)plane->normal[1] * b->p[4][i] + (double)plane->normal[2] * b->p[5][i] - plane->dist;
+		}
+		if (t1 >= 0 && t2 >= 0)
+			b->side[i] = HULLTRACE_FRONT;
+		else if (t1 < 0 && t2 < 0)
+			b->side[i] = HULLTRACE_BACK;
+		else
+			b->side[i] = HULLTRACE_CROSS;
+	}
+#endif
+}
+
+/*
+==================
+SV_HullBatchSwap
+==================
+*/
+static void SV_HullBatchSwap (hullbatch_t *b, int i, int j)
+{
+	int		 k, lane;
+	qboolean point;
+	float	 f;
+	byte	 side;
+
+	lane = b->lane[i];
+	b->lane[i] = b->lane[j];
+	b->lane[j] = lane;
+	point = b->point[i];
+	b->point[i] = b->point[j];
+	b->point[j] = point;
+	side = b->side[i];
+	b->side[i] = b->side[j];
+	b->side[j] = side;
+	for (k = 0; k < 6; k++)
+	{
+		f = b->p[k][i];
+		b->p[k][i] = b->p[k][j];
+		b->p[k][j] = f;
+	}
+}
+
+/*
+==================
+SV_HullBatchFinish
+
+Continues the scalar trace of the segment in slot i from clipnode num
+==================
+*/
+static void SV_HullBatchFinish (hullbatch_t *b, int i, int num)
+{
+	hulltrace_t	   *ht = &b->traces[b->lane[i]];
+	struct rhtctx_s ctx;
+
+	if (b->point[i])
+	{
+		// can only get here at a leaf
+		SV_PointTraceContents (num, ht->trace, b->hitcontents);
+		ht->empty = true;
+		return;
+	}
+
+	VectorCopy (ht->start, ctx.start);
+	VectorCopy (ht->end, ctx.end);
+	ctx.clipnodes = b->hull->clipnodes;
+	ctx.planes = b->hull->planes;
+	ctx.hitcontents = b->hitcontents;
+	ht->empty = Q1BSP_RecursiveHullTrace (&ctx, num, 0, 1, ht->start, ht->end, ht->trace) != rht_impact;
+}
+
+/*
+==================
+SV_HullBatchNode
+
+Passes the segments [first, end) down from clipnode num
+==================
+*/
+static void SV_HullBatchNode (hullbatch_t *b, int num, int first, int end)
+{
+	mclipnode_t *node;
+	int			 i, lo, hi;
+
+	while (first < end)
+	{
+		if (num < 0)
+		{
+			for (i = first; i < end; i++)
+				SV_HullBatchFinish (b, i, num);
+			return;
+		}
+
+		node = b->hull->clipnodes + num;
+		SV_HullBatchClassify (b, b->hull->planes + node->planenum, first, end);
+
+		// front to the start, crossing to the end, back in between
+		lo = first;
+		hi = end;
+		for (i = first; i < hi;)
+		{
+			if (b->side[i] == HULLTRACE_CROSS && b->point[i])
+				b->side[i] = HULLTRACE_FRONT; // a NaN distance, SV_HullPointContents goes to the front
+			if (b->side[i] == HULLTRACE_FRONT)
+				SV_HullBatchSwap (b, i++, lo++);
+			else if (b->side[i] == HULLTRACE_CROSS)
+				SV_HullBatchSwap (b, i, --hi);
+			else
+				i++;
+		}
+
+		for (i = hi; i < end; i++)
+			SV_HullBatchFinish (b, i, num);
+		if (lo < hi)
+			SV_HullBatchNode (b, node->children[1], lo, hi);
+		num = node->children[0];
+		end = lo;
+	}
+}
+
+/*
+==================
+SV_RecursiveHullCheckBatch
+==================
+*/
+void SV_RecursiveHullCheckBatch (hull_t *hull, hulltrace_t *traces, int count, unsigned int hitcontents)
+{
+	hullbatch_t b;
+	int			i, j, n;
+
+	if (sv_fte_recursivehullckeck.value <= 0.0f || !pr_checkextension.value)
+	{
+		for (i = 0; i < count; i++)
+			traces[i].empty = SV_SlowRecursiveHullCheck (hull, hull->firstclipnode, 0, 1, traces[i].start, traces[i].end, traces[i].trace);
+		return;
+	}
+
+	b.hull = hull;
+	b.traces = traces;
+	b.hitcontents = hitcontents;
+	for (i = 0; i < count; i += HULLTRACE_BATCH)
+	{
+		n = q_min (count - i, HULLTRACE_BATCH);
+		for (j = 0; j < n; j++)
+		{
+			hulltrace_t *ht = &traces[i + j];
+			b.lane[j] = i + j;
+			b.point[j] = ht->start[0] == ht->end[0] && ht->start[1] == ht->end[1] && ht->start[2] == ht->end[2];
+			b.p[0][j] = ht->start[0];
+			b.p[1][j] = ht->start[1];
+			b.p[2][j] = ht->start[2];
+			b.p[3][j] = ht->end[0];
+			b.p[4][j] = ht->end[1];
+			b.p[5][j] = ht->end[2];
+		}
+		for (; j < n + 4; j++)
+		{
+			b.p[0][j] = b.p[1][j] = b.p[2][j] = 0.0f;
+			b.p[3][j] = b.p[4][j] = b.p[5][j] = 0.0f;
+		}
+		SV_HullBatchNode (&b, hull->firstclipnode, 0, n);
+	}
+}
+
 /*
 ==================
 SV_ClipMoveToEntity
@@ -1043,91 +1639,312 @@ trace_t SV_ClipMoveToEntity (edict_t *ent, vec3_t start, vec3_t mins, vec3_t max
 	return trace;
 }
 
-//===========================================================================
-
 /*
-====================
-SV_ClipToLinks
+===============================================================================
 
-Mins and maxs enclose the entire area swept by the move
-====================
+PRECOMPUTED WORLD CLIPS
+
+With sv_parallelphysics, SV_Physics traces the world part of the coming
+moves on the task workers before the serial entity loop. A precomputed clip
+is keyed by the mover's edict number and is used at most once, and only
+when the move asks for exactly the same start, end, size and contents. The
+world hull does not change during a tick, so a reused clip is what
+SV_ClipMoveToEntity would have returned anyway.
+
+===============================================================================
 */
-static void SV_ClipToLinks (areanode_t *node, moveclip_t *clip, const sv_ignore_edicts_t *ignore_edicts)
-{
-	link_t	*l, *next;
-	edict_t *touch;
-	trace_t	 trace;
 
-	// touch linked edicts
-	for (l = node->solid_edicts.next; l != &node->solid_edicts; l = next)
-	{
-		next = l->next;
-		touch = EDICT_FROM_AREA (l);
-		if (touch->v.solid == SOLID_NOT)
-			continue;
-		if (touch == clip->passedict)
-			continue;
-		if (touch->v.solid == SOLID_TRIGGER)
-			Sys_Error ("Trigger in clipping list");
+typedef struct
+{
+	vec3_t		 start, mins, maxs, end;
+	unsigned int hitcontents;
+	qboolean	 fastcheck; // which SV_RecursiveHullCheck path traced it
+	qboolean	 valid;
+	trace_t		 trace;
+} sv_worldclip_t;
 
-		if (clip->type == MOVE_NOMONSTERS && touch->v.solid != SOLID_BSP)
-			continue;
+static sv_worldclip_t *sv_worldclips;
+static int			   sv_maxworldclips;
+static qcvm_t		  *sv_worldclips_qcvm; // non-NULL while precomputed clips can be used
+static qboolean		   sv_worldclips_verify;
+int					   sv_worldclip_hits, sv_worldclip_mismatches;
 
-		if (clip->boxmins[0] > touch->v.absmax[0] || clip->boxmins[1] > touch->v.absmax[1] || clip->boxmins[2] > touch->v.absmax[2] ||
-			clip->boxmaxs[0] < touch->v.absmin[0] || clip->boxmaxs[1] < touch->v.absmin[1] || clip->boxmaxs[2] < touch->v.absmin[2])
-			continue;
+static qboolean SV_WorldClipFastCheck (void)
+{
+	return sv_fte_recursivehullckeck.value > 0.0f && pr_checkextension.value;
+}
 
-		if (clip->passedict && clip->passedict->v.size[0] && !touch->v.size[0])
-			continue; // points never interact
+/*
+==================
+SV_BeginWorldClips
+==================
+*/
+void SV_BeginWorldClips (qboolean verify)
+{
+	if (sv_maxworldclips < qcvm->max_edicts)
+	{
+		Mem_Free (sv_worldclips);
+		sv_maxworldclips = qcvm->max_edicts;
+		sv_worldclips = (sv_worldclip_t *)Mem_Alloc (sv_maxworldclips * sizeof (sv_worldclip_t));
+	}
+	sv_worldclips_qcvm = qcvm;
+	sv_worldclips_verify = verify;
+}
 
-		// last, after the cheap rejections: this walks a list, and almost every
-		// edict reaching this loop is discarded by the bbox test above
-		if (SV_MoveIgnoresEdict (ignore_edicts, touch))
-			continue;
+/*
+==================
+SV_PrecomputeWorldClipBatch
 
-		// might intersect, so do an exact clip
-		if (clip->trace.allsolid)
-			return;
-		if (clip->passedict)
+Safe to run on the task workers, for distinct edicts. The moves are
+grouped by the hull they clip against and traced with
+SV_RecursiveHullCheckBatch, everything else is what SV_ClipMoveToEntity
+does for the world.
+==================
+*/
+void SV_PrecomputeWorldClipBatch (const sv_clipmove_t *moves, int count, unsigned int hitcontents)
+{
+	hulltrace_t		hulltraces[HULLTRACE_BATCH];
+	hull_t		   *hulls[HULLTRACE_BATCH];
+	vec3_t			offsets[HULLTRACE_BATCH];
+	int				batch[HULLTRACE_BATCH];
+	qboolean		done[HULLTRACE_BATCH];
+	sv_worldclip_t *clip;
+	const qboolean	fastcheck = SV_WorldClipFastCheck ();
+	int				first, n, i, j, numbatch;
+
+	for (first = 0; first < count; first += HULLTRACE_BATCH)
+	{
+		n = q_min (count - first, HULLTRACE_BATCH);
+		for (i = 0; i < n; i++)
 		{
-			if (PROG_TO_EDICT (touch->v.owner) == clip->passedict)
-				continue; // don't clip against own missiles
-			if (PROG_TO_EDICT (clip->passedict->v.owner) == touch)
-				continue; // don't clip against owner
+			const sv_clipmove_t *move = &moves[first + i];
+			clip = &sv_worldclips[move->entnum];
+			VectorCopy (move->start, clip->start);
+			VectorCopy (move->mins, clip->mins);
+			VectorCopy (move->maxs, clip->maxs);
+			VectorCopy (move->end, clip->end);
+			clip->hitcontents = hitcontents;
+			clip->fastcheck = fastcheck;
+
+			// fill in a default trace
+			memset (&clip->trace, 0, sizeof (trace_t));
+			clip->trace.fraction = 1;
+			clip->trace.allsolid = true;
+			VectorCopy (move->end, clip->trace.endpos);
+
+			// get the clipping hull
+			hulls[i] = SV_HullForEntity (qcvm->edicts, move->mins, move->maxs, offsets[i]);
+			VectorSubtract (move->start, offsets[i], hulltraces[i].start);
+			VectorSubtract (move->end, offsets[i], hulltraces[i].end);
+			hulltraces[i].trace = &clip->trace;
+			done[i] = false;
 		}
 
-		if (touch->v.skin < 0)
+		for (i = 0; i < n; i++)
 		{
-			if (!(clip->hitcontents & (1 << -(int)touch->v.skin)))
-				continue; // not solid, don't bother trying to clip.
-			if ((int)touch->v.flags & FL_MONSTER)
-				trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins2, clip->maxs2, clip->end, ~(1u << -CONTENTS_EMPTY));
+			if (done[i])
+				continue;
+			numbatch = 0;
+			for (j = i; j < n; j++)
+			{
+				if (!done[j] && hulls[j] == hulls[i])
+				{
+					done[j] = true;
+					batch[numbatch++] = j;
+				}
+			}
+			if (numbatch == 1)
+				hulltraces[i].empty = SV_RecursiveHullCheck (hulls[i], hulltraces[i].start, hulltraces[i].end, hulltraces[i].trace, hitcontents);
 			else
-				trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins, clip->maxs, clip->end, ~(1u << -CONTENTS_EMPTY));
-			if (trace.contents != CONTENTS_EMPTY)
-				trace.contents = touch->v.skin;
+			{
+				hulltrace_t grouped[HULLTRACE_BATCH];
+				for (j = 0; j < numbatch; j++)
+					grouped[j] = hulltraces[batch[j]];
+				SV_RecursiveHullCheckBatch (hulls[i], grouped, numbatch, hitcontents);
+			}
 		}
-		else
+
+		for (i = 0; i < n; i++)
 		{
-			if ((int)touch->v.flags & FL_MONSTER)
-				trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins2, clip->maxs2, clip->end, clip->hitcontents);
-			else
-				trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins, clip->maxs, clip->end, clip->hitcontents);
+			clip = &sv_worldclips[moves[first + i].entnum];
+
+			// fix trace up by the offset
+			if (clip->trace.fraction != 1)
+				VectorAdd (clip->trace.endpos, offsets[i], clip->trace.endpos);
+
+			// did we clip the move?
+			if (clip->trace.fraction < 1 || clip->trace.startsolid)
+				clip->trace.ent = qcvm->edicts;
+			clip->valid = true;
 		}
+	}
+}
 
-		if (trace.allsolid || trace.startsolid || trace.fraction < clip->trace.fraction)
+/*
+==================
+SV_EndWorldClips
+
+Drops whatever clips the tick didn't use
+==================
+*/
+void SV_EndWorldClips (void)
+{
+	int i;
+
+	if (!sv_worldclips_qcvm)
+		return;
+	for (i = 0; i < q_min (sv_worldclips_qcvm->num_edicts, sv_maxworldclips); i++)
+		sv_worldclips[i].valid = false;
+	sv_worldclips_qcvm = NULL;
+}
+
+static qboolean SV_TracesEqual (const trace_t *a, const trace_t *b)
+{
+	return a->allsolid == b->allsolid && a->startsolid == b->startsolid && a->inopen == b->inopen && a->inwater == b->inwater &&
+		   !memcmp (&a->fraction, &b->fraction, sizeof (float)) && !memcmp (a->endpos, b->endpos, sizeof (vec3_t)) &&
+		   !memcmp (&a->plane, &b->plane, sizeof (plane_t)) && a->ent == b->ent && a->contents == b->contents;
+}
+
+/*
+==================
+SV_ClipMoveToWorld
+
+SV_ClipMoveToEntity against the world, reusing a precomputed clip if the
+move matches it bit for bit
+==================
+*/
+static trace_t SV_ClipMoveToWorld (edict_t *passedict, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, unsigned int hitcontents)
+{
+	sv_worldclip_t *clip;
+	trace_t			trace;
+	int				entnum;
+
+	if (sv_worldclips_qcvm != qcvm || !passedict)
+		return SV_ClipMoveToEntity (qcvm->edicts, start, mins, maxs, end, hitcontents);
+
+	entnum = NUM_FOR_EDICT (passedict);
+	clip = &sv_worldclips[entnum];
+	if (!clip->valid)
+		return SV_ClipMoveToEntity (qcvm->edicts, start, mins, maxs, end, hitcontents);
+	clip->valid = false;
+
+	if (memcmp (clip->start, start, sizeof (vec3_t)) || memcmp (clip->end, end, sizeof (vec3_t)) || memcmp (clip->mins, mins, sizeof (vec3_t)) ||
+		memcmp (clip->maxs, maxs, sizeof (vec3_t)) || clip->hitcontents != hitcontents || clip->fastcheck != SV_WorldClipFastCheck ())
+		return SV_ClipMoveToEntity (qcvm->edicts, start, mins, maxs, end, hitcontents);
+
+	sv_worldclip_hits++;
+	if (sv_worldclips_verify)
+	{
+		trace = SV_ClipMoveToEntity (qcvm->edicts, start, mins, maxs, end, hitcontents);
+		if (!SV_TracesEqual (&trace, &clip->trace))
 		{
-			trace.ent = touch;
-			if (clip->trace.startsolid)
-			{
-				clip->trace = trace;
-				clip->trace.startsolid = true;
-			}
-			else
-				clip->trace = trace;
+			sv_worldclip_mismatches++;
+			Con_Warning ("sv_parallelphysics: precomputed world clip for edict %i differs from the serial one\n", entnum);
 		}
-		else if (trace.startsolid)
+		return trace;
+	}
+
+	return clip->trace;
+}
+
+//===========================================================================
+
+/*
+====================
+SV_ClipToEdict
+
+Returns false once the clip is allsolid and nothing else needs to be checked
+====================
+*/
+static qboolean SV_ClipToEdict (edict_t *touch, moveclip_t *clip, const sv_ignore_edicts_t *ignore_edicts)
+{
+	trace_t trace;
+
+	if (touch->v.solid == SOLID_NOT)
+		return true;
+	if (touch == clip->passedict)
+		return true;
+	if (touch->v.solid == SOLID_TRIGGER)
+		Sys_Error ("Trigger in clipping list");
+
+	if (clip->type == MOVE_NOMONSTERS && touch->v.solid != SOLID_BSP)
+		return true;
+
+	if (clip->boxmins[0] > touch->v.absmax[0] || clip->boxmins[1] > touch->v.absmax[1] || clip->boxmins[2] > touch->v.absmax[2] ||
+		clip->boxmaxs[0] < touch->v.absmin[0] || clip->boxmaxs[1] < touch->v.absmin[1] || clip->boxmaxs[2] < touch->v.absmin[2])
+		return true;
+
+	if (clip->passedict && clip->passedict->v.size[0] && !touch->v.size[0])
+		return true; // points never interact
+
+	// last, after the cheap rejections: this walks a list, and almost every
+	// edict reaching this loop is discarded by the bbox test above
+	if (SV_MoveIgnoresEdict (ignore_edicts, touch))
+		return true;
+
+	// might intersect, so do an exact clip
+	if (clip->trace.allsolid)
+		return false;
+	if (clip->passedict)
+	{
+		if (PROG_TO_EDICT (touch->v.owner) == clip->passedict)
+			return true; // don't clip against own missiles
+		if (PROG_TO_EDICT (clip->passedict->v.owner) == touch)
+			return true; // don't clip against owner
+	}
+
+	if (touch->v.skin < 0)
+	{
+		if (!(clip->hitcontents & (1 << -(int)touch->v.skin)))
+			return true; // not solid, don't bother trying to clip.
+		if ((int)touch->v.flags & FL_MONSTER)
+			trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins2, clip->maxs2, clip->end, ~(1u << -CONTENTS_EMPTY));
+		else
+			trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins, clip->maxs, clip->end, ~(1u << -CONTENTS_EMPTY));
+		if (trace.contents != CONTENTS_EMPTY)
+			trace.contents = touch->v.skin;
+	}
+	else
+	{
+		if ((int)touch->v.flags & FL_MONSTER)
+			trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins2, clip->maxs2, clip->end, clip->hitcontents);
+		else
+			trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins, clip->maxs, clip->end, clip->hitcontents);
+	}
+
+	if (trace.allsolid || trace.startsolid || trace.fraction < clip->trace.fraction)
+	{
+		trace.ent = touch;
+		if (clip->trace.startsolid)
+		{
+			clip->trace = trace;
 			clip->trace.startsolid = true;
+		}
+		else
+			clip->trace = trace;
+	}
+	else if (trace.startsolid)
+		clip->trace.startsolid = true;
+	return true;
+}
+
+/*
+====================
+SV_ClipToLinks
+
+Mins and maxs enclose the entire area swept by the move
+====================
+*/
+static void SV_ClipToLinks (areanode_t *node, moveclip_t *clip, const sv_ignore_edicts_t *ignore_edicts)
+{
+	link_t *l, *next;
+
+	// touch linked edicts
+	for (l = node->solid_edicts.next; l != &node->solid_edicts; l = next)
+	{
+		next = l->next;
+		if (!SV_ClipToEdict (EDICT_FROM_AREA (l), clip, ignore_edicts))
+			return;
 	}
 
 	// recurse down both sides
@@ -1140,6 +1957,29 @@ static void SV_ClipToLinks (areanode_t *node, moveclip_t *clip, const sv_ignore_
 		SV_ClipToLinks (node->children[1], clip, ignore_edicts);
 }
 
+/*
+====================
+SV_ClipToAreaGrid
+
+SV_ClipToLinks from the sv_areagrid cells
+====================
+*/
+static void SV_ClipToAreaGrid (moveclip_t *clip, const sv_ignore_edicts_t *ignore_edicts)
+{
+	areagridhit_t hits[AREA_GRID_MAX_RESULTS];
+	const int	  numhits = SV_AreaGridGather (clip->boxmins, clip->boxmaxs, false, hits);
+	int			  i;
+
+	if (numhits < 0)
+	{
+		SV_ClipToLinks (qcvm->areanodes, clip, ignore_edicts);
+		return;
+	}
+	for (i = 0; i < numhits; i++)
+		if (!SV_ClipToEdict (hits[i].ent, clip, ignore_edicts))
+			return;
+}
+
 static void World_ClipToNetwork (moveclip_t *clip)
 {
 	entity_t *touch;
@@ -1336,7 +2176,7 @@ trace_t SV_MoveWithEdictIgnoreMask (vec3_t start, vec3_t mins, vec3_t maxs, vec3
 		clip.hitcontents = CONTENTMASK_ANYSOLID;
 
 	// clip to world
-	clip.trace = SV_ClipMoveToEntity (qcvm->edicts, start, mins, maxs, end, clip.hitcontents);
+	clip.trace = SV_ClipMoveToWorld (passedict, start, mins, maxs, end, clip.hitcontents);
 
 	clip.start = start;
 	clip.end = end;
@@ -1363,7 +2203,10 @@ trace_t SV_MoveWithEdictIgnoreMask (vec3_t start, vec3_t mins, vec3_t maxs, vec3
 	SV_MoveBounds (start, clip.mins2, clip.maxs2, end, clip.boxmins, clip.boxmaxs);
 
 	// clip to entities
-	SV_ClipToLinks (qcvm->areanodes, &clip, ignore_edicts);
+	if (SV_AreaGridActive ())
+		SV_ClipToAreaGrid (&clip, ignore_edicts);
+	else
+		SV_ClipToLinks (qcvm->areanodes, &clip, ignore_edicts);
 
 	if (qcvm == &cl.qcvm)
 		World_ClipToNetwork (&clip);
@@ -1378,3 +2221,213 @@ trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, e
 {
 	return SV_MoveWithEdictIgnoreMask (start, mins, maxs, end, type, passedict, NULL);
 }
+
+/*
+===============================================================================
+
+AREA GRID BENCHMARK
+
+===============================================================================
+*/
+
+typedef struct
+{
+	vec3_t start, end;
+} areabenchmove_t;
+
+static float SV_AreaBenchRand (uint32_t *seed)
+{
+	*seed = *seed * 1664525u + 1013904223u;
+	return (*seed >> 8) * (1.0f / (1 << 24));
+}
+
+/*
+==================
+SV_AreaBenchClip
+
+Entity part of SV_Move with a player sized box, the world is left out
+==================
+*/
+static trace_t SV_AreaBenchClip (const areabenchmove_t *move, qboolean grid)
+{
+	static vec3_t mins = {-16, -16, -24}, maxs = {16, 16, 32};
+	moveclip_t	  clip;
+
+	memset (&clip, 0, sizeof (clip));
+	clip.trace.fraction = 1;
+	VectorCopy (move->end, clip.trace.endpos);
+	clip.hitcontents = CONTENTMASK_ANYSOLID;
+	clip.start = (float *)move->start;
+	clip.end = (float *)move->end;
+	clip.mins = mins;
+	clip.maxs = maxs;
+	VectorCopy (mins, clip.mins2);
+	VectorCopy (maxs, clip.maxs2);
+	clip.type = MOVE_NORMAL;
+	SV_MoveBounds (clip.start, clip.mins2, clip.maxs2, clip.end, clip.boxmins, clip.boxmaxs);
+	if (grid)
+		SV_ClipToAreaGrid (&clip, NULL);
+	else
+		SV_ClipToLinks (qcvm->areanodes, &clip, NULL);
+	return clip.trace;
+}
+
+/*
+==================
+SV_AreaBenchTouch
+
+The trigger list SV_TouchLinks would build for a player sized probe at the end of the move
+==================
+*/
+static int SV_AreaBenchTouch (edict_t *probe, const areabenchmove_t *move, qboolean grid, uint16_t *list)
+{
+	int listcount = -1;
+
+	VectorAdd (move->end, probe->v.mins, probe->v.absmin);
+	VectorAdd (move->end, probe->v.maxs, probe->v.absmax);
+	if (grid)
+		listcount = SV_AreaGridTriggerEdicts (probe, list, qcvm->num_edicts);
+	if (listcount < 0)
+	{
+		listcount = 0;
+		SV_AreaTriggerEdicts (probe, qcvm->areanodes, list, &listcount, qcvm->num_edicts);
+	}
+	return listcount;
+}
+
+/*
+==================
+SV_AreaBench_f
+
+sv_areabench [entities] [queries]
+
+Crowds the middle of the running map with synthetic boxes and triggers,
+times the same traces and trigger touch queries through the areanodes and
+through the sv_areagrid cells, and checks that both find the same edicts.
+The synthetic edicts are freed again before the command returns.
+==================
+*/
+void SV_AreaBench_f (void)
+{
+	const int		 numents = Cmd_Argc () > 1 ? atoi (Cmd_Argv (1)) : 4000;
+	const int		 numqueries = Cmd_Argc () > 2 ? q_max (1, atoi (Cmd_Argv (2))) : 100000;
+	uint32_t		 seed = 1;
+	edict_t		   **ents;
+	edict_t			*probe;
+	areabenchmove_t *moves;
+	uint16_t		*list[2];
+	vec3_t			 center;
+	double			 start, time[2][2];
+	float			 spread;
+	int				 count, mismatches = 0;
+	int				 i, j, grid;
+
+	if (!Host_BenchAllowed ())
+		return;
+
+	if (!sv.active)
+	{
+		Con_Printf ("sv_areabench: no map running\n");
+		return;
+	}
+
+	PR_SwitchQCVM (&sv.qcvm);
+
+	// keep some edicts free for the game, and one for the probe
+	const int headroom = qcvm->max_edicts - qcvm->num_edicts - 64;
+	if (headroom <= 0)
+	{
+		Con_Printf ("sv_areabench: no free edicts (raise max_edicts)\n");
+		PR_SwitchQCVM (NULL);
+		return;
+	}
+	count = CLAMP (1, numents, headroom);
+	ents = (edict_t **)Mem_Alloc (count * sizeof (edict_t *));
+	moves = (areabenchmove_t *)Mem_Alloc (numqueries * sizeof (areabenchmove_t));
+	list[0] = (uint16_t *)Mem_Alloc (qcvm->max_edicts * sizeof (uint16_t));
+	list[1] = (uint16_t *)Mem_Alloc (qcvm->max_edicts * sizeof (uint16_t));
+
+	// about one entity per 48x48 column, in a layer about as high as a room
+	VectorAdd (qcvm->worldmodel->mins, qcvm->worldmodel->maxs, center);
+	VectorScale (center, 0.5f, center);
+	spread = 48.0f * sqrtf ((float)count);
+	for (i = 0; i < count; i++)
+	{
+		edict_t *ent = ED_Alloc ();
+		ents[i] = ent;
+		ent->v.solid = (i % 4 == 3) ? SOLID_TRIGGER : SOLID_BBOX;
+		ent->v.touch = (ent->v.solid == SOLID_TRIGGER); // never called, nothing is touched for real
+		for (j = 0; j < 3; j++)
+		{
+			ent->v.origin[j] = center[j] + (SV_AreaBenchRand (&seed) - 0.5f) * (j == 2 ? 192.0f : spread);
+			ent->v.maxs[j] = 8.0f + SV_AreaBenchRand (&seed) * 24.0f;
+			ent->v.mins[j] = -ent->v.maxs[j];
+		}
+		VectorSubtract (ent->v.maxs, ent->v.mins, ent->v.size);
+		SV_LinkEdict (ent, false);
+	}
+	for (i = 0; i < numqueries; i++)
+	{
+		for (j = 0; j < 3; j++)
+		{
+			moves[i].start[j] = center[j] + (SV_AreaBenchRand (&seed) - 0.5f) * (j == 2 ? 192.0f : spread);
+			moves[i].end[j] = moves[i].start[j] + (SV_AreaBenchRand (&seed) - 0.5f) * (j == 2 ? 64.0f : 256.0f);
+		}
+	}
+
+	// never linked, SV_AreaTriggerEdicts only looks at its absbox
+	probe = ED_Alloc ();
+	probe->v.mins[0] = probe->v.mins[1] = -16;
+	probe->v.mins[2] = -24;
+	probe->v.maxs[0] = probe->v.maxs[1] = 16;
+	probe->v.maxs[2] = 32;
+
+	if (!qcvm->areagrid.heads)
+		SV_AreaGridBuild ();
+
+	for (grid = 0; grid < 2; grid++)
+	{
+		start = Sys_DoubleTime ();
+		for (i = 0; i < numqueries; i++)
+			SV_AreaBenchClip (&moves[i], grid);
+		time[0][grid] = Sys_DoubleTime () - start;
+
+		start = Sys_DoubleTime ();
+		for (i = 0; i < numqueries; i++)
+			SV_AreaBenchTouch (probe, &moves[i], grid, list[grid]);
+		time[1][grid] = Sys_DoubleTime () - start;
+	}
+
+	for (i = 0; i < numqueries; i++)
+	{
+		trace_t trace[2];
+		int		listcount[2];
+
+		for (grid = 0; grid < 2; grid++)
+		{
+			trace[grid] = SV_AreaBenchClip (&moves[i], grid);
+			listcount[grid] = SV_AreaBenchTouch (probe, &moves[i], grid, list[grid]);
+		}
+		if (trace[0].ent != trace[1].ent || trace[0].fraction != trace[1].fraction || trace[0].startsolid != trace[1].startsolid ||
+			listcount[0] != listcount[1] || memcmp (list[0], list[1], listcount[0] * sizeof (uint16_t)))
+			mismatches++;
+	}
+
+	Con_Printf ("sv_areabench: %i entities over %.0f units, %i queries\n", count, spread, numqueries);
+	for (i = 0; i < 2; i++)
+		Con_Printf (
+			"%-8s %9.1f ns areanodes %9.1f ns areagrid %6.2fx\n", i ? "touches" : "traces", time[i][0] * 1e9 / numqueries, time[i][1] * 1e9 / numqueries,
+			time[i][1] > 0.0 ? time[i][0] / time[i][1] : 0.0);
+	if (mismatches)
+		Con_Printf ("sv_areabench: %i queries MISMATCHED\n", mismatches);
+
+	ED_Free (probe);
+	for (i = 0; i < count; i++)
+		ED_Free (ents[i]);
+	Mem_Free (list[0]);
+	Mem_Free (list[1]);
+	Mem_Free (moves);
+	Mem_Free (ents);
+
+	PR_SwitchQCVM (NULL);
+}
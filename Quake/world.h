@@ -65,6 +65,9 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers);
 void SV_PushGridEntityLinked (edict_t *ent);
 // sv_phys.c: keeps the SV_PushMove spatial grid in sync with entities that move mid-tick
 
+void SV_AreaBench_f (void);
+// times SV_Move and trigger queries with and without sv_areagrid on a crowd of synthetic entities
+
 int SV_PointContentsAllBsps (vec3_t p, edict_t *forent); // check all SOLID_BSP ents
 int SV_PointContents (vec3_t p);
 int SV_TruePointContents (vec3_t p);
@@ -78,6 +81,21 @@ edict_t *SV_TestEntityPosition (edict_t *ent);
 #define CONTENTMASK_ANYSOLID  (CONTENTMASK_FROMQ1 (CONTENTS_SOLID) | CONTENTMASK_FROMQ1 (CONTENTS_CLIP))
 trace_t SV_ClipMoveToEntity (edict_t *ent, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, unsigned int hitcontents);
 trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict);
+
+typedef struct
+{
+	int	   entnum;
+	float *start, *mins, *maxs, *end;
+} sv_clipmove_t;
+
+void SV_BeginWorldClips (qboolean verify);
+void SV_PrecomputeWorldClipBatch (const sv_clipmove_t *moves, int count, unsigned int hitcontents);
+void SV_EndWorldClips (void);
+// sv_parallelphysics: world clips traced ahead of time on the task workers, keyed
+// by the moving edict. SV_Move uses each at most once, and only for the identical
+// move; with verify set it recomputes them anyway and warns about any difference
+extern int sv_worldclip_hits, sv_worldclip_mismatches;
+
 // Entities a move should not clip against, as a list rather than a per-edict
 // array: nothing to allocate or clear between moves. A big elevator can carry
 // hundreds of riders, so `riders` is binary searched and must be sorted
@@ -106,6 +124,19 @@ trace_t SV_MoveWithEdictIgnoreMask (vec3_t start, vec3_t mins, vec3_t maxs, vec3
 int SV_HullPointContents (hull_t *hull, int num, vec3_t p);
 
 qboolean SV_RecursiveHullCheck (hull_t *hull, vec3_t p1, vec3_t p2, trace_t *trace, unsigned int hitcontents);
+
+#define HULLTRACE_BATCH 64
+
+typedef struct
+{
+	vec3_t	 start, end;
+	trace_t *trace;
+	qboolean empty; // what SV_RecursiveHullCheck returned
+} hulltrace_t;
+
+void SV_RecursiveHullCheckBatch (hull_t *hull, hulltrace_t *traces, int count, unsigned int hitcontents);
+// same results as SV_RecursiveHullCheck on each trace, bit for bit, but the
+// segments descend the clipnodes together until they cross a plane
 byte	*SV_FatPVS (vec3_t org, qmodel_t *worldmodel);
 qboolean SV_EdictInPVS (edict_t *test, byte *pvs);
 qboolean SV_BoxInPVS (vec3_t mins, vec3_t maxs, byte *pvs, qmodel_t *worldmodel);